@@ -0,0 +1,586 @@
+/**
+ * Replay benchmark of the acquisition pipeline (PlatformIO env:native)
+ *
+ * Feeds recorded days from visualization/data/ through the firmware's own
+ * sampler, decimator, conversion, SD logging and MQTT batching code against
+ * the mocks in bench/mocks, as fast as the host allows. The recorded 1 Hz
+ * values are turned back into ADC input voltages and linearly interpolated
+ * between seconds, so the pipeline sees ADS_DATA_RATE conversions per
+ * second with realistic gain switching.
+ *
+ * Reports host time, card bytes and heap allocations per stage, and can
+ * save the results as a baseline and compare later runs against it:
+ *
+ *   pio run -e native
+ *   .pio/build/native/program visualization/data/2025-03-07 --save bench/baseline.txt
+ *   .pio/build/native/program visualization/data/2025-03-07 --baseline bench/baseline.txt
+ *
+ * Exit status: 0 ok, 1 usage or input error, 2 regression against the baseline.
+ */
+
+#include <Arduino.h>
+#include <Adafruit_ADS1X15.h>
+#include <RTClib.h>
+#include <SdFat.h>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+#include "bench_hooks.h"
+#include "sampler.h"
+#include "decimator.h"
+#include "scaler.h"
+#include "calibration.h"
+#include "coulomb.h"
+#include "burst.h"
+#include "anomaly.h"
+#include "sd_access.h"
+#include "sd_logger.h"
+#include "binlog.h"
+#include "file_index.h"
+#include "mqtt_batch.h"
+#include "net_manager.h"
+#include "time_service.h"
+
+// ===== CONFIGURATION =====
+// Same hardware as main.cpp; channels and calibration come from channels.h
+#define ADS_DATA_RATE RATE_ADS1115_860SPS
+#define OUTPUT_INTERVAL_MS 1000
+
+#define DEFAULT_VOLTS 12.8         // Battery voltage for days without a Volts file
+#define DEFAULT_TOLERANCE 10.0     // Allowed slowdown against a baseline, percent
+#define SECONDS_PER_DAY 86400
+#define BOOT_LEAD_S 2              // Virtual boot this long before the first day, for the RTC edge search
+
+// Globals that main.cpp defines for the firmware
+SdFat sd;
+RTC_DS3231 rtc;
+static Adafruit_ADS1115 ads[NUM_ADC_DEVICES];
+
+// No network in the bench; metrics.cpp reports these counters
+const NetStats &net_stats() {
+  static NetStats stats = {};
+  return stats;
+}
+
+// ===== RECORDINGS =====
+
+/**
+ * One recorded day, one value per second (NAN where nothing was logged)
+ */
+struct Recording {
+  std::string name;
+  uint32_t midnight;                 // Unix time of 00:00:00 of the day
+  std::vector<float> amps;
+  std::vector<float> volts;
+};
+
+/**
+ * Parse a text log ("HH:MM:SS --> v, v, ...", one value per second)
+ * @return false if the file cannot be read
+ */
+static bool read_text_log(const std::string &path, std::vector<float> &values) {
+  std::ifstream in(path);
+  if (!in) return false;
+  values.assign(SECONDS_PER_DAY, NAN);
+
+  std::string line;
+  while (std::getline(in, line)) {
+    int h, m, s;
+    size_t arrow = line.find("-->");
+    if (arrow == std::string::npos || sscanf(line.c_str(), "%d:%d:%d", &h, &m, &s) != 3) {
+      continue;  // Blank line or the untimed continuation at the top of a file
+    }
+    uint32_t second = h * 3600 + m * 60 + s;
+    const char *p = line.c_str() + arrow + 3;
+    char *end;
+    for (;;) {
+      float value = strtof(p, &end);
+      if (end == p) break;
+      if (second < SECONDS_PER_DAY) values[second++] = value;
+      p = end;
+      while (*p == ',' || *p == ' ') p++;
+    }
+  }
+  return true;
+}
+
+/**
+ * Load "Amps YYYY-MM-DD.txt" (and "Volts ..." if present) from a day directory
+ */
+static bool load_recording(std::string dir, Recording &rec) {
+  while (!dir.empty() && dir.back() == '/') dir.pop_back();
+  rec.name = dir.substr(dir.rfind('/') + 1);
+
+  int year, month, day;
+  if (sscanf(rec.name.c_str(), "%d-%d-%d", &year, &month, &day) != 3) {
+    fprintf(stderr, "ERROR: %s is not a YYYY-MM-DD directory\n", dir.c_str());
+    return false;
+  }
+  rec.midnight = DateTime(year, month, day).unixtime();
+
+  if (!read_text_log(dir + "/Amps " + rec.name + ".txt", rec.amps)) {
+    fprintf(stderr, "ERROR: no Amps %s.txt in %s\n", rec.name.c_str(), dir.c_str());
+    return false;
+  }
+  if (!read_text_log(dir + "/Volts " + rec.name + ".txt", rec.volts)) {
+    rec.volts.assign(SECONDS_PER_DAY, DEFAULT_VOLTS);
+  }
+  return true;
+}
+
+// ===== STAGES =====
+enum BenchStage : uint8_t {
+  BENCH_SAMPLE,    // RDY interrupt and sampler_service(): ADC read, auto-range, ring push
+  BENCH_DECIMATE,  // Ring drain, burst_feed() and the decimator
+  BENCH_CONVERT,   // Scaling, coulomb counting, auto-zero, anomaly detection and log codes per frame
+  BENCH_SD_LOG,    // sd_logger_log(), coulomb_persist() and burst_write_sd()
+  BENCH_PUBLISH,   // MQTT batch assembly and event hand-off
+  NUM_BENCH_STAGES
+};
+
+static const char *const bench_stage_names[NUM_BENCH_STAGES] = {
+  "sample", "decimate", "convert", "sd_log", "publish"
+};
+
+struct StageTotals {
+  uint64_t ns;
+  uint64_t calls;
+  uint64_t bytes_written;    // To the mock card
+  uint64_t allocs;
+  uint64_t alloc_bytes;
+};
+
+static StageTotals totals[NUM_BENCH_STAGES];
+static uint64_t published_bytes = 0;
+static uint32_t published_batches = 0;
+static uint32_t published_events = 0;
+static uint32_t published_alerts = 0;
+
+/**
+ * Accounts one run of a stage: host time, card writes and heap use
+ */
+class BenchTimer {
+public:
+  explicit BenchTimer(BenchStage stage)
+    : stage(stage), sd_start(bench_sd_stats().bytes_written), alloc_start(bench_alloc_stats()),
+      start(std::chrono::steady_clock::now()) {}
+
+  ~BenchTimer() {
+    auto elapsed = std::chrono::steady_clock::now() - start;
+    StageTotals &t = totals[stage];
+    t.ns += std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    t.calls++;
+    t.bytes_written += bench_sd_stats().bytes_written - sd_start;
+    BenchAllocStats alloc = bench_alloc_stats();
+    t.allocs += alloc.calls - alloc_start.calls;
+    t.alloc_bytes += alloc.bytes - alloc_start.bytes;
+  }
+
+private:
+  BenchStage stage;
+  uint64_t sd_start;
+  BenchAllocStats alloc_start;
+  std::chrono::steady_clock::time_point start;
+};
+
+// ===== PIPELINE =====
+static Decimator decimator;
+static MqttBatch mqtt_batch;
+static uint8_t mqtt_payload[MQTT_BATCH_MAX_PAYLOAD];
+static uint64_t raw_samples = 0;
+static uint64_t frames = 0;
+
+static void calibration_headers(float scale[NUM_CHANNELS], float offset[NUM_CHANNELS]) {
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    const Scaler &scaler = calibration_scaler(ch);
+    scale[ch] = scaler.scale();
+    offset[ch] = scaler.offset_units();
+  }
+}
+
+static void apply_calibration() {
+  CalibrationProfile profile = calibration_profile();
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    sampler_set_gain_range(ch, calibration_min_gain(ch), profile.ch[ch].gain);
+  }
+}
+
+// Firmware setup() without the hardware checks
+static void pipeline_begin() {
+  sd.begin(15);
+  sd_access_begin();
+  time_service_begin(&rtc);
+
+  calibration_begin(calibration_table_defaults());
+  calibration_on_change(apply_calibration);
+  apply_calibration();
+
+  BinLogConfig binlog_config;
+  binlog_config.interval_ms = OUTPUT_INTERVAL_MS;
+  calibration_headers(binlog_config.scale, binlog_config.offset);
+  sd_logger_begin(15, SPI_FULL_SPEED, binlog_config);
+  burst_begin(binlog_config.scale, binlog_config.offset, BURST_CONSUMER_SD | BURST_CONSUMER_MQTT);
+  coulomb_begin();
+  file_index_begin();
+  mqtt_batch.begin(OUTPUT_INTERVAL_MS, binlog_config.scale, binlog_config.offset);
+  decimator.begin(OUTPUT_INTERVAL_MS * 1000UL);
+  for (uint8_t d = 0; d < NUM_ADC_DEVICES; d++) {
+    ads[d].begin(adc_devices[d].address);
+  }
+  sampler_begin(ads, ADS_DATA_RATE);
+}
+
+// What mqtt_task does with a finished batch, minus the broker
+static void finish_mqtt_batch() {
+  if (mqtt_batch.empty()) return;
+  published_bytes += mqtt_batch.finish(mqtt_payload, 0);
+  published_batches++;
+}
+
+/**
+ * Acquisition, SD writer and MQTT task work for one decimated frame
+ */
+static void handle_frame(const DecimatedFrame &frame) {
+  frames++;
+  DateTime timestamp;
+  int32_t values[NUM_CHANNELS];
+  int16_t log_codes[NUM_CHANNELS];
+  uint8_t gains[NUM_CHANNELS];
+  int16_t batch_codes[NUM_CHANNELS];
+  {
+    BenchTimer timer(BENCH_CONVERT);
+    const ChannelStats &amps = frame.ch[CH_AMPS];
+    if (amps.count > 0) {
+      coulomb_add(calibration_scaler(CH_AMPS).from_mean(amps.mean), frame.interval_us);
+    }
+    calibration_feed(frame);
+    uint32_t end_us = frame.t_us + frame.interval_us;
+    int64_t wall_us = time_at_us(end_us);
+    timestamp = DateTime((uint32_t)(wall_us / 1000000));
+    burst_set_clock(wall_us / 1000000, end_us - (uint32_t)(wall_us % 1000000));
+    anomaly_feed(frame, timestamp.unixtime());
+
+    for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+      const ChannelStats &stats = frame.ch[ch];
+      values[ch] = calibration_scaler(ch).from_mean(stats.mean);
+      uint8_t reference = sampler_reference_gain(ch);
+      uint8_t shift;
+      log_codes[ch] = stats_code_ranged(stats, reference > ADS_GAIN_1 ? reference - ADS_GAIN_1 : 0, shift);
+      gains[ch] = reference - shift;
+      batch_codes[ch] = stats.count ? stats_code(stats) : MQTT_BATCH_NO_DATA;
+    }
+  }
+  {
+    BenchTimer timer(BENCH_SD_LOG);
+    sd_logger_log(timestamp, values, log_codes, gains);
+    coulomb_persist();
+    burst_write_sd();
+  }
+  {
+    BenchTimer timer(BENCH_PUBLISH);
+    uint32_t epoch = timestamp.unixtime();
+    if (!mqtt_batch.accepts(epoch)) finish_mqtt_batch();
+    mqtt_batch.add(epoch, batch_codes);
+    if (mqtt_batch.full()) finish_mqtt_batch();
+
+    const BurstEvent *event = burst_peek(BURST_CONSUMER_MQTT);
+    if (event) {
+      published_bytes += burst_event_size(event);
+      published_events++;
+      burst_release(BURST_CONSUMER_MQTT, event);
+    }
+
+    AnomalyAlert alert;
+    if (anomaly_peek(alert)) {
+      char message[ANOMALY_ALERT_JSON_SIZE];
+      published_bytes += anomaly_alert_json(alert, message, sizeof(message));
+      published_alerts++;
+      anomaly_release();
+    }
+  }
+}
+
+// Drain the sampler ring into the decimator
+static void drain_ring() {
+  DecimatedFrame frame;
+  for (;;) {
+    bool have_frame = false;
+    {
+      BenchTimer timer(BENCH_DECIMATE);
+      RawSample sample;
+      while (sample_ring.pop(sample)) {
+        burst_feed(sample);
+        if (decimator.add(sample, frame)) {
+          have_frame = true;
+          break;
+        }
+      }
+    }
+    if (!have_frame) return;
+    handle_frame(frame);
+  }
+}
+
+// Recorded value at a fractional second, holding the last value over gaps
+static float value_at(const std::vector<float> &values, uint32_t second, double fraction, float &last) {
+  float a = values[second];
+  if (isnan(a)) return last;
+  last = a;
+  float b = second + 1 < values.size() ? values[second + 1] : NAN;
+  return isnan(b) ? a : a + (b - a) * fraction;
+}
+
+/**
+ * Replay one day at ADS_DATA_RATE conversions per second
+ * @param boot_epoch Unix time at virtual micros() 0
+ * @param max_seconds Stop after this many recorded seconds (0 = whole day)
+ * @return Recorded seconds replayed
+ */
+static uint32_t replay(const Recording &rec, uint32_t boot_epoch, uint32_t max_seconds) {
+  const double period_us = 1e6 / Adafruit_ADS1115::samples_per_second(ADS_DATA_RATE);
+  const ChannelDescriptor &shunt = channel_table[CH_AMPS];
+  const ChannelDescriptor &divider = channel_table[CH_VOLTS];
+  const double amps_to_volts = shunt.den / 1000.0 / shunt.num;
+  const double volts_to_pin = (double)divider.den / divider.num;
+  const double volts_offset = divider.offset / 1e6;
+  const double amps_offset = shunt.offset / 1e6;
+
+  float last_amps = 0, last_volts = DEFAULT_VOLTS;
+  uint32_t replayed = 0;
+  uint64_t day_start_us = (uint64_t)(rec.midnight - boot_epoch) * 1000000;
+
+  for (uint32_t second = 0; second < SECONDS_PER_DAY; second++) {
+    if (isnan(rec.amps[second]) && isnan(rec.volts[second])) continue;  // Logger was off
+    if (max_seconds && replayed >= max_seconds) break;
+    replayed++;
+
+    // Conversions whose RDY edge falls into this second
+    uint64_t second_start = day_start_us + (uint64_t)second * 1000000;
+    uint64_t first = (uint64_t)ceil((second_start - day_start_us) / period_us);
+    {
+      BenchTimer timer(BENCH_SAMPLE);
+      for (uint64_t n = first;; n++) {
+        double t = n * period_us;
+        uint64_t t_us = day_start_us + (uint64_t)t;
+        if (t_us >= second_start + 1000000) break;
+        double fraction = (t_us - second_start) / 1e6;
+        double amps = value_at(rec.amps, second, fraction, last_amps);
+        double volts = value_at(rec.volts, second, fraction, last_volts);
+        bench_set_input(shunt.mux, (amps - amps_offset) * amps_to_volts);
+        bench_set_input(divider.mux, (volts - volts_offset) * volts_to_pin);
+
+        bench_set_micros(t_us);
+        bench_fire_interrupt();
+        sampler_service();
+        raw_samples++;
+      }
+    }
+    drain_ring();
+  }
+  return replayed;
+}
+
+// ===== REPORT =====
+typedef std::map<std::string, double> Results;
+
+static Results collect(double wall_s, uint64_t recorded_seconds) {
+  Results r;
+  r["samples"] = raw_samples;
+  r["frames"] = frames;
+  r["samples_per_s"] = raw_samples / wall_s;
+  r["realtime_factor"] = recorded_seconds / wall_s;
+  r["published_bytes"] = published_bytes;
+  for (int s = 0; s < NUM_BENCH_STAGES; s++) {
+    std::string key = std::string("stage.") + bench_stage_names[s] + ".";
+    const StageTotals &t = totals[s];
+    r[key + "ns_per_sample"] = raw_samples ? (double)t.ns / raw_samples : 0;
+    r[key + "ns_per_call"] = t.calls ? (double)t.ns / t.calls : 0;
+    r[key + "bytes_written"] = t.bytes_written;
+    r[key + "allocs"] = t.allocs;
+    r[key + "alloc_bytes"] = t.alloc_bytes;
+  }
+  return r;
+}
+
+static void print_report(const Results &r, double wall_s) {
+  printf("\nReplayed %.0f samples into %.0f frames in %.3f s: %.0f samples/s, %.0fx real time\n",
+         r.at("samples"), r.at("frames"), wall_s, r.at("samples_per_s"), r.at("realtime_factor"));
+  printf("%-10s %10s %10s %10s %12s %8s %12s\n",
+         "stage", "ns/sample", "ns/call", "calls", "card bytes", "allocs", "alloc bytes");
+  for (int s = 0; s < NUM_BENCH_STAGES; s++) {
+    const StageTotals &t = totals[s];
+    printf("%-10s %10.1f %10.0f %10llu %12llu %8llu %12llu\n", bench_stage_names[s],
+           raw_samples ? (double)t.ns / raw_samples : 0.0, t.calls ? (double)t.ns / t.calls : 0.0,
+           (unsigned long long)t.calls,
+           (unsigned long long)t.bytes_written, (unsigned long long)t.allocs,
+           (unsigned long long)t.alloc_bytes);
+  }
+  BenchSdStats sd_stats = bench_sd_stats();
+  printf("Card: %llu bytes in %u writes, %u syncs, %zu files holding %llu bytes\n",
+         (unsigned long long)sd_stats.bytes_written, sd_stats.writes, sd_stats.syncs,
+         bench_sd_file_count(), (unsigned long long)bench_sd_stored_bytes());
+  printf("MQTT: %u batches, %u events and %u alerts, %llu bytes\n", published_batches, published_events,
+         published_alerts, (unsigned long long)published_bytes);
+  printf("Sampler: %u dropped, %u missed, %u range switches | Events: %u captured, %u dropped\n",
+         sampler_dropped_samples(), sampler_missed_conversions(), sampler_range_switches(),
+         burst_events(), burst_dropped());
+}
+
+static bool save_results(const char *path, const Results &r) {
+  FILE *f = fopen(path, "w");
+  if (!f) return false;
+  fprintf(f, "# bench/bench_main.cpp results, one \"key value\" per line\n");
+  for (const auto &entry : r) fprintf(f, "%s %.10g\n", entry.first.c_str(), entry.second);
+  fclose(f);
+  return true;
+}
+
+static bool load_results(const char *path, Results &r) {
+  std::ifstream in(path);
+  if (!in) return false;
+  std::string key;
+  double value;
+  while (in >> key) {
+    if (key[0] == '#') {
+      std::getline(in, key);
+      continue;
+    }
+    if (in >> value) r[key] = value;
+  }
+  return true;
+}
+
+/**
+ * Compare against a baseline of the same replay.
+ * Throughput may drop and times may grow by tolerance percent; card bytes
+ * and allocations are deterministic and must not grow at all.
+ * @return Number of regressions, -1 if the baseline is from another replay
+ */
+static int compare(const Results &now, const Results &base, double tolerance) {
+  if (now.at("samples") != base.at("samples")) {
+    fprintf(stderr, "ERROR: the baseline replayed %.0f samples, this run %.0f; use the same days and --seconds\n",
+            base.at("samples"), now.at("samples"));
+    return -1;
+  }
+
+  int regressions = 0;
+  printf("\n%-34s %14s %14s %9s\n", "vs baseline", "baseline", "now", "change");
+  for (const auto &entry : base) {
+    auto it = now.find(entry.first);
+    if (it == now.end()) continue;
+    const std::string &key = entry.first;
+    double was = entry.second, is = it->second;
+    double change = was != 0 ? (is - was) / was * 100 : (is != 0 ? 100 : 0);
+
+    bool timing = key.find(".ns_per_") != std::string::npos;
+    bool higher_better = key == "samples_per_s" || key == "realtime_factor";
+    bool counted = key.find("bytes_written") != std::string::npos || key.find("alloc") != std::string::npos;
+    bool regressed = (higher_better && change < -tolerance) ||
+                     (timing && change > tolerance) ||
+                     (counted && is > was);
+    if (!timing && !higher_better && was == is) continue;  // Unchanged counts
+
+    printf("%-34s %14.6g %14.6g %+8.1f%%%s\n", key.c_str(), was, is, change, regressed ? "  REGRESSION" : "");
+    if (regressed) regressions++;
+  }
+  return regressions;
+}
+
+static void usage() {
+  fprintf(stderr,
+          "usage: program <day dir>... [--seconds N] [--save FILE] [--baseline FILE]\n"
+          "               [--tolerance PERCENT] [--verbose]\n"
+          "  <day dir>   visualization/data/YYYY-MM-DD with \"Amps YYYY-MM-DD.txt\"\n"
+          "  --seconds   Replay only the first N recorded seconds of each day\n"
+          "  --save      Write the results as a baseline\n"
+          "  --baseline  Compare with a saved baseline, exit 2 on regression\n"
+          "  --tolerance Allowed slowdown against the baseline (default %.0f%%)\n"
+          "  --verbose   Show the firmware's Serial output\n", DEFAULT_TOLERANCE);
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> days;
+  uint32_t max_seconds = 0;
+  const char *save_path = nullptr;
+  const char *baseline_path = nullptr;
+  double tolerance = DEFAULT_TOLERANCE;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    bool has_value = i + 1 < argc;
+    if (arg == "--seconds" && has_value) max_seconds = strtoul(argv[++i], nullptr, 10);
+    else if (arg == "--save" && has_value) save_path = argv[++i];
+    else if (arg == "--baseline" && has_value) baseline_path = argv[++i];
+    else if (arg == "--tolerance" && has_value) tolerance = strtod(argv[++i], nullptr);
+    else if (arg == "--verbose") bench_serial_echo(true);
+    else if (arg.rfind("--", 0) == 0) { usage(); return 1; }
+    else days.push_back(arg);
+  }
+  if (days.empty()) {
+    usage();
+    return 1;
+  }
+
+  std::vector<Recording> recordings(days.size());
+  for (size_t i = 0; i < days.size(); i++) {
+    if (!load_recording(days[i], recordings[i])) return 1;
+  }
+  // Time only moves forward: replay in date order, each day once
+  std::sort(recordings.begin(), recordings.end(),
+            [](const Recording &a, const Recording &b) { return a.midnight < b.midnight; });
+  for (size_t i = 1; i < recordings.size(); i++) {
+    if (recordings[i].midnight == recordings[i - 1].midnight) {
+      fprintf(stderr, "ERROR: %s given twice\n", recordings[i].name.c_str());
+      return 1;
+    }
+  }
+
+  // The RTC runs on the virtual clock from BOOT_LEAD_S before the first midnight
+  uint32_t boot_epoch = recordings[0].midnight - BOOT_LEAD_S;
+  bench_set_epoch(boot_epoch);
+  pipeline_begin();
+
+  uint64_t recorded_seconds = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (const Recording &rec : recordings) {
+    uint32_t seconds = replay(rec, boot_epoch, max_seconds);
+    printf("%s: %u recorded seconds\n", rec.name.c_str(), seconds);
+    recorded_seconds += seconds;
+  }
+  {
+    BenchTimer timer(BENCH_SD_LOG);
+    sd_logger_close();
+  }
+  {
+    BenchTimer timer(BENCH_PUBLISH);
+    finish_mqtt_batch();
+  }
+  double wall_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  Results results = collect(wall_s, recorded_seconds);
+  print_report(results, wall_s);
+
+  if (save_path && !save_results(save_path, results)) {
+    fprintf(stderr, "ERROR: cannot write %s\n", save_path);
+    return 1;
+  }
+  if (baseline_path) {
+    Results baseline;
+    if (!load_results(baseline_path, baseline)) {
+      fprintf(stderr, "ERROR: cannot read %s\n", baseline_path);
+      return 1;
+    }
+    if (!baseline.count("samples")) {
+      fprintf(stderr, "ERROR: %s is not a bench result file\n", baseline_path);
+      return 1;
+    }
+    int regressions = compare(results, baseline, tolerance);
+    if (regressions < 0) return 1;
+    printf("%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+    if (regressions) return 2;
+  }
+  return 0;
+}
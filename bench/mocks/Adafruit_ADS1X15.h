@@ -0,0 +1,93 @@
+// Adafruit_ADS1X15.h (bench mock)
+#ifndef BENCH_ADAFRUIT_ADS1X15_H
+#define BENCH_ADAFRUIT_ADS1X15_H
+
+#include <stdint.h>
+
+/**
+ * ADS1115 that converts the input voltages set with bench_set_input().
+ *
+ * Like the real device in continuous mode, a conversion uses the gain and
+ * mux that were set when it started: a startADCReading() or config register
+ * write (Wire mock) while converting takes effect with the next conversion,
+ * one that wakes a powered-down device starts converting at once. Every
+ * bench_fire_interrupt() completes a conversion. Codes saturate at +/-32767
+ * so auto-ranging sees genuine clipping. All devices share the inputs, keyed
+ * by mux setting.
+ */
+
+typedef enum {
+  GAIN_TWOTHIRDS = 0x0000,  // +/-6.144 V
+  GAIN_ONE = 0x0200,        // +/-4.096 V
+  GAIN_TWO = 0x0400,        // +/-2.048 V
+  GAIN_FOUR = 0x0600,       // +/-1.024 V
+  GAIN_EIGHT = 0x0800,      // +/-0.512 V
+  GAIN_SIXTEEN = 0x0A00     // +/-0.256 V
+} adsGain_t;
+
+#define RATE_ADS1115_8SPS (0x0000)
+#define RATE_ADS1115_16SPS (0x0020)
+#define RATE_ADS1115_32SPS (0x0040)
+#define RATE_ADS1115_64SPS (0x0060)
+#define RATE_ADS1115_128SPS (0x0080)
+#define RATE_ADS1115_250SPS (0x00A0)
+#define RATE_ADS1115_475SPS (0x00C0)
+#define RATE_ADS1115_860SPS (0x00E0)
+
+#define ADS1X15_REG_CONFIG_MUX_DIFF_0_1 (0x0000)
+#define ADS1X15_REG_CONFIG_MUX_DIFF_0_3 (0x1000)
+#define ADS1X15_REG_CONFIG_MUX_DIFF_1_3 (0x2000)
+#define ADS1X15_REG_CONFIG_MUX_DIFF_2_3 (0x3000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_0 (0x4000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_1 (0x5000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_2 (0x6000)
+#define ADS1X15_REG_CONFIG_MUX_SINGLE_3 (0x7000)
+
+#define ADS1X15_ADDRESS (0x48)
+#define ADS1X15_REG_POINTER_CONFIG (0x01)
+#define ADS1X15_REG_POINTER_LOWTHRESH (0x02)
+#define ADS1X15_REG_POINTER_HITHRESH (0x03)
+#define ADS1X15_REG_CONFIG_MODE_CONTIN (0x0000)
+#define ADS1X15_REG_CONFIG_MODE_SINGLE (0x0100)
+#define ADS1X15_REG_CONFIG_CMODE_TRAD (0x0000)
+#define ADS1X15_REG_CONFIG_CMODE_WINDOW (0x0010)
+#define ADS1X15_REG_CONFIG_CPOL_ACTVLOW (0x0000)
+#define ADS1X15_REG_CONFIG_CLAT_NONLAT (0x0000)
+#define ADS1X15_REG_CONFIG_CLAT_LATCH (0x0004)
+#define ADS1X15_REG_CONFIG_CQUE_1CONV (0x0000)
+
+class Adafruit_ADS1115 {
+public:
+  bool begin(uint8_t address = ADS1X15_ADDRESS);
+  void setGain(adsGain_t gain) { this->gain = gain; }
+  adsGain_t getGain() { return gain; }
+  void setDataRate(uint16_t rate) { this->rate = rate; }
+  uint16_t getDataRate() { return rate; }
+
+  void startADCReading(uint16_t mux, bool continuous);
+  bool conversionComplete() { return true; }
+  int16_t getLastConversionResults();
+
+  // Sample rate of a RATE_ADS1115_xxxSPS setting
+  static uint32_t samples_per_second(uint16_t rate);
+
+  // Register write over I2C to the device begun at an address (Wire mock)
+  static void write_register(uint8_t address, uint8_t reg, uint16_t value);
+
+  // Finish the running conversion and start the next one (bench_fire_interrupt)
+  void finish_conversion();
+
+private:
+  uint8_t address = 0;
+  adsGain_t gain = GAIN_TWOTHIRDS;
+  uint16_t rate = RATE_ADS1115_128SPS;
+  uint16_t mux = ADS1X15_REG_CONFIG_MUX_DIFF_0_1;
+  bool converting = false;       // Continuous mode; false while powered down
+  uint16_t conversion_mux = 0;   // Settings of the running conversion
+  adsGain_t conversion_gain = GAIN_TWOTHIRDS;
+  int16_t result = 0;
+
+  void start_if_idle();
+};
+
+#endif
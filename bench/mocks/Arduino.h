@@ -0,0 +1,191 @@
+// Arduino.h (bench mock)
+#ifndef BENCH_ARDUINO_H
+#define BENCH_ARDUINO_H
+
+/**
+ * Host replacement for the parts of the Arduino-ESP32 core and FreeRTOS
+ * that the acquisition pipeline uses, for the native bench environment.
+ *
+ * Time is virtual: micros()/millis() return what the bench set with
+ * bench_set_micros() (bench_hooks.h), so a recorded day replays at full host speed. The
+ * cycle counter follows the host's monotonic clock at 240 MHz, so the
+ * firmware's own stage metrics (metrics.h) measure real host time.
+ *
+ * Tasks are not started and queues, mutexes and critical sections are
+ * no-ops: the bench drives every stage from a single thread.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+// ===== ATTRIBUTES AND PINS =====
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+#define PROGMEM
+#define F(x) x
+
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define FALLING 0x02
+#define LOW 0
+#define HIGH 1
+
+typedef bool boolean;
+
+template <class T, class L, class H>
+T constrain(T x, L low, H high) { return x < low ? low : (x > high ? high : x); }
+
+// ===== VIRTUAL TIME =====
+uint32_t micros();
+uint32_t millis();
+// Advances the virtual clock, so polling loops terminate
+void delay(uint32_t ms);
+
+// SNTP is never started in the bench
+inline void configTime(long, int, const char *, const char * = nullptr, const char * = nullptr) {}
+inline void configTzTime(const char *, const char *, const char * = nullptr, const char * = nullptr) {}
+
+// ===== GPIO / INTERRUPTS =====
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline int digitalPinToInterrupt(uint8_t pin) { return pin; }
+
+void attachInterrupt(int interrupt, void (*isr)(), int mode);
+inline void detachInterrupt(int) {}
+
+// ===== FREERTOS =====
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+typedef uint32_t TickType_t;
+typedef void *TaskHandle_t;
+typedef void *QueueHandle_t;
+typedef void *SemaphoreHandle_t;
+typedef int portMUX_TYPE;
+
+#define pdPASS 1
+#define pdTRUE 1
+#define pdFALSE 0
+#define configMAX_PRIORITIES 25
+#define portMAX_DELAY 0xFFFFFFFFu
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (ms)
+#define portMUX_INITIALIZER_UNLOCKED 0
+#define portENTER_CRITICAL(mux) ((void)(mux))
+#define portEXIT_CRITICAL(mux) ((void)(mux))
+#define portENTER_CRITICAL_ISR(mux) ((void)(mux))
+#define portEXIT_CRITICAL_ISR(mux) ((void)(mux))
+#define portYIELD_FROM_ISR()
+
+inline BaseType_t xTaskCreatePinnedToCore(void (*)(void *), const char *, uint32_t, void *,
+                                          UBaseType_t, TaskHandle_t *handle, int) {
+  if (handle) *handle = nullptr;
+  return pdPASS;
+}
+inline uint32_t ulTaskNotifyTake(BaseType_t, TickType_t) { return 0; }
+inline void vTaskNotifyGiveFromISR(TaskHandle_t, BaseType_t *woken) { if (woken) *woken = pdFALSE; }
+inline void xTaskNotifyGive(TaskHandle_t) {}
+inline void vTaskDelay(TickType_t) {}
+inline TickType_t xTaskGetTickCount() { return millis(); }
+
+inline SemaphoreHandle_t xSemaphoreCreateMutex() { return (SemaphoreHandle_t)1; }
+inline SemaphoreHandle_t xSemaphoreCreateRecursiveMutex() { return (SemaphoreHandle_t)1; }
+inline BaseType_t xSemaphoreTake(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGive(SemaphoreHandle_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t, TickType_t) { return pdTRUE; }
+inline BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t) { return pdTRUE; }
+
+// ===== ESP =====
+class EspClass {
+public:
+  uint32_t getCycleCount();
+  uint32_t getCpuFreqMHz() { return 240; }
+  uint32_t getFreeHeap() { return 0; }
+  uint32_t getMinFreeHeap() { return 0; }
+  uint32_t getMaxAllocHeap() { return 0; }
+  void restart() { exit(1); }
+};
+extern EspClass ESP;
+
+// ===== STRING =====
+class String {
+public:
+  String() {}
+  String(const char *text) : value(text ? text : "") {}
+  String(int number) : value(std::to_string(number)) {}
+  String(unsigned number) : value(std::to_string(number)) {}
+  String(long number) : value(std::to_string(number)) {}
+  String(unsigned long number) : value(std::to_string(number)) {}
+
+  const char *c_str() const { return value.c_str(); }
+  unsigned length() const { return value.size(); }
+  bool isEmpty() const { return value.empty(); }
+  long toInt() const { return atol(value.c_str()); }
+  bool equalsIgnoreCase(const String &other) const { return strcasecmp(c_str(), other.c_str()) == 0; }
+  bool operator==(const char *other) const { return value == other; }
+  String &operator+=(const String &other) { value += other.value; return *this; }
+  friend String operator+(const String &a, const String &b) { String s(a); s += b; return s; }
+
+private:
+  std::string value;
+};
+
+// ===== PRINT =====
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t *data, size_t len) {
+    size_t n = 0;
+    while (n < len && write(data[n])) n++;
+    return n;
+  }
+
+  size_t write(const char *text) { return write((const uint8_t *)text, strlen(text)); }
+  size_t print(const char *text) { return write(text); }
+  size_t print(const String &text) { return write(text.c_str()); }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(int n) { return printf("%d", n); }
+  size_t print(unsigned n) { return printf("%u", n); }
+  size_t print(long n) { return printf("%ld", n); }
+  size_t print(unsigned long n) { return printf("%lu", n); }
+  size_t print(double n, int digits = 2) { return printf("%.*f", digits, n); }
+  size_t println() { return write("\r\n"); }
+  template <class T> size_t println(const T &value) { return print(value) + println(); }
+  size_t println(double n, int digits) { return print(n, digits) + println(); }
+
+  size_t printf(const char *format, ...) __attribute__((format(printf, 2, 3))) {
+    char buffer[256];
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (len < 0) return 0;
+    return write((const uint8_t *)buffer, min((size_t)len, sizeof(buffer) - 1));
+  }
+};
+
+// Serial port, dropped unless the bench runs with --verbose
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long) {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t *data, size_t len) override;
+  using Print::write;
+};
+extern HardwareSerial Serial;
+
+#endif
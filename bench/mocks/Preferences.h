@@ -0,0 +1,25 @@
+// Preferences.h (bench mock)
+#ifndef BENCH_PREFERENCES_H
+#define BENCH_PREFERENCES_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * NVS key/value store kept in RAM for the lifetime of the process
+ */
+class Preferences {
+public:
+  bool begin(const char *name, bool read_only = false);
+  void end() {}
+  size_t putBytes(const char *key, const void *value, size_t len);
+  size_t getBytes(const char *key, void *buf, size_t max_len);
+  size_t getBytesLength(const char *key);
+  bool remove(const char *key);
+  bool isKey(const char *key);
+
+private:
+  char space[16] = "";
+};
+
+#endif
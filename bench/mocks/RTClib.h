@@ -0,0 +1,56 @@
+// RTClib.h (bench mock)
+#ifndef BENCH_RTCLIB_H
+#define BENCH_RTCLIB_H
+
+#include <Arduino.h>
+
+/**
+ * DateTime and a DS3231 whose time follows the bench's virtual clock
+ * (bench_set_epoch() + micros()), so a replayed day keeps its dates.
+ */
+
+class TimeSpan {
+public:
+  TimeSpan(int32_t seconds = 0) : seconds(seconds) {}
+  int32_t totalseconds() const { return seconds; }
+
+private:
+  int32_t seconds;
+};
+
+class DateTime {
+public:
+  // Unix time in UTC
+  DateTime(uint32_t t = 946684800);
+  DateTime(uint16_t year, uint8_t month, uint8_t day,
+           uint8_t hour = 0, uint8_t minute = 0, uint8_t second = 0)
+    : y(year), m(month), d(day), hh(hour), mm(minute), ss(second) {}
+
+  uint16_t year() const { return y; }
+  uint8_t month() const { return m; }
+  uint8_t day() const { return d; }
+  uint8_t hour() const { return hh; }
+  uint8_t minute() const { return mm; }
+  uint8_t second() const { return ss; }
+  uint8_t dayOfTheWeek() const { return (unixtime() / 86400 + 4) % 7; }
+  bool isValid() const { return m >= 1 && m <= 12 && d >= 1 && d <= 31; }
+  uint32_t unixtime() const;
+
+  DateTime operator+(const TimeSpan &span) const { return DateTime(unixtime() + span.totalseconds()); }
+  TimeSpan operator-(const DateTime &other) const { return TimeSpan((int32_t)(unixtime() - other.unixtime())); }
+
+private:
+  uint16_t y;
+  uint8_t m, d, hh, mm, ss;
+};
+
+class RTC_DS3231 {
+public:
+  bool begin() { return true; }
+  DateTime now();
+  void adjust(const DateTime &) {}
+  bool lostPower() { return false; }
+  float getTemperature() { return 25.0f; }
+};
+
+#endif
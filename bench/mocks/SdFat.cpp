@@ -0,0 +1,221 @@
+#include <SdFat.h>
+#include "bench_hooks.h"
+
+typedef std::vector<uint8_t> Contents;
+
+static std::map<std::string, std::shared_ptr<Contents>> &card_files() {
+  static std::map<std::string, std::shared_ptr<Contents>> files;
+  return files;
+}
+
+static BenchSdStats sd_stats;
+
+// Paths are stored without the leading '/'
+static std::string normalize(const char *path) {
+  while (*path == '/') path++;
+  return path;
+}
+
+BenchSdStats bench_sd_stats() {
+  return sd_stats;
+}
+
+size_t bench_sd_file_count() {
+  return card_files().size();
+}
+
+uint64_t bench_sd_stored_bytes() {
+  uint64_t total = 0;
+  for (const auto &entry : card_files()) total += entry.second->size();
+  return total;
+}
+
+// ===== FILES =====
+
+bool FatFile::open(const char *path, oflag_t flags) {
+  BenchUntracked untracked;
+  close();
+  std::string key = normalize(path);
+  if (key.empty() || key.back() == '/') {
+    name = key;
+    dir = true;
+    next_entry = 0;
+    opened = true;
+    return true;
+  }
+
+  auto &files = card_files();
+  auto it = files.find(key);
+  if (it == files.end()) {
+    if (!(flags & O_CREAT)) return false;
+    it = files.emplace(key, std::make_shared<Contents>()).first;
+  } else if ((flags & O_CREAT) && (flags & O_EXCL)) {
+    return false;
+  }
+
+  data = it->second;
+  name = key;
+  if (flags & O_TRUNC) data->clear();
+  pos = (flags & O_AT_END) ? data->size() : 0;
+  dir = false;
+  opened = true;
+  sd_stats.opens++;
+  return true;
+}
+
+bool FatFile::open(FatFile *, const char *path, oflag_t flags) {
+  return open(path, flags);
+}
+
+bool FatFile::openNext(FatFile *directory, oflag_t) {
+  if (!directory->isDir()) return false;
+  close();
+
+  auto &files = card_files();
+  auto it = files.begin();
+  std::advance(it, std::min(directory->next_entry, files.size()));
+  if (it == files.end()) return false;
+  directory->next_entry++;
+
+  BenchUntracked untracked;
+  data = it->second;
+  name = it->first;
+  pos = 0;
+  dir = false;
+  opened = true;
+  return true;
+}
+
+bool FatFile::close() {
+  BenchUntracked untracked;
+  data.reset();
+  opened = false;
+  dir = false;
+  return true;
+}
+
+int FatFile::read() {
+  uint8_t b;
+  return read(&b, 1) == 1 ? b : -1;
+}
+
+int FatFile::read(void *buf, size_t count) {
+  if (!data) return -1;
+  size_t n = pos < data->size() ? std::min(count, data->size() - pos) : 0;
+  memcpy(buf, data->data() + pos, n);
+  pos += n;
+  sd_stats.bytes_read += n;
+  return (int)n;
+}
+
+int FatFile::available() const {
+  return data && pos < data->size() ? (int)(data->size() - pos) : 0;
+}
+
+size_t FatFile::write(const void *buf, size_t count) {
+  if (!data) return 0;
+  BenchUntracked untracked;
+  if (pos + count > data->size()) data->resize(pos + count);
+  memcpy(data->data() + pos, buf, count);
+  pos += count;
+  sd_stats.bytes_written += count;
+  sd_stats.writes++;
+  return count;
+}
+
+bool FatFile::seekSet(uint32_t position) {
+  if (!data || position > data->size()) return false;
+  pos = position;
+  return true;
+}
+
+bool FatFile::seekEnd(int32_t offset) {
+  return data && seekSet(data->size() + offset);
+}
+
+bool FatFile::rewind() {
+  pos = 0;
+  next_entry = 0;
+  return true;
+}
+
+bool FatFile::sync() {
+  if (!opened) return false;
+  sd_stats.syncs++;
+  return true;
+}
+
+bool FatFile::truncate() {
+  return truncate(pos);
+}
+
+bool FatFile::truncate(uint32_t length) {
+  if (!data) return false;
+  BenchUntracked untracked;
+  data->resize(std::min<size_t>(length, data->size()));
+  pos = std::min(pos, length);
+  return true;
+}
+
+bool FatFile::preAllocate(uint32_t length) {
+  if (!data || !data->empty()) return false;
+  BenchUntracked untracked;
+  data->assign(length, 0x00);
+  return true;
+}
+
+bool FatFile::contiguousRange(uint32_t *first_sector, uint32_t *last_sector) {
+  if (!data) return false;
+  *first_sector = 0;
+  *last_sector = data->empty() ? 0 : (data->size() - 1) / 512;
+  return true;
+}
+
+size_t FatFile::getName(char *out, size_t size) {
+  if (size == 0) return 0;
+  size_t slash = name.rfind('/');
+  const char *base = name.c_str() + (slash == std::string::npos ? 0 : slash + 1);
+  strncpy(out, base, size - 1);
+  out[size - 1] = '\0';
+  return strlen(out);
+}
+
+bool FatFile::remove() {
+  if (!data) return false;
+  BenchUntracked untracked;
+  card_files().erase(name);
+  close();
+  return true;
+}
+
+bool FatFile::rename(const char *path) {
+  if (!data) return false;
+  BenchUntracked untracked;
+  card_files().erase(name);
+  name = normalize(path);
+  card_files()[name] = data;
+  return true;
+}
+
+// ===== VOLUME =====
+
+bool SdFat::exists(const char *path) {
+  BenchUntracked untracked;
+  return card_files().count(normalize(path)) > 0;
+}
+
+bool SdFat::remove(const char *path) {
+  BenchUntracked untracked;
+  return card_files().erase(normalize(path)) > 0;
+}
+
+bool SdFat::rename(const char *old_path, const char *new_path) {
+  BenchUntracked untracked;
+  auto &files = card_files();
+  auto it = files.find(normalize(old_path));
+  if (it == files.end()) return false;
+  std::shared_ptr<Contents> contents = it->second;
+  files.erase(it);
+  files[normalize(new_path)] = contents;
+  return true;
+}
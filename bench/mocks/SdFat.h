@@ -0,0 +1,112 @@
+// SdFat.h (bench mock)
+#ifndef BENCH_SDFAT_H
+#define BENCH_SDFAT_H
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * In-memory SD card with the subset of the SdFat API the loggers use.
+ *
+ * Files live in a flat map keyed by path; a directory listing walks all of
+ * them. Every write(), read() and sync() that reaches the card is counted
+ * (bench_sd_stats()), which is what the bench reports as bytes written per
+ * stage. preAllocate() extends an empty file with zeros, the state an
+ * erased card reads back as, and contiguousRange() always succeeds.
+ */
+
+typedef int oflag_t;
+
+#define O_READ 0x00
+#define O_RDONLY 0x00
+#define O_WRITE 0x01
+#define O_WRONLY 0x01
+#define O_RDWR 0x02
+#define O_APPEND 0x08
+#define O_CREAT 0x10
+#define O_TRUNC 0x20
+#define O_AT_END 0x40
+#define O_EXCL 0x80
+
+#define SPI_FULL_SPEED 2
+#define SPI_HALF_SPEED 1
+#define SD_SCK_MHZ(mhz) (mhz)
+
+class FatFile {
+public:
+  /**
+   * Open a file, or a directory if the path is empty or ends with '/'
+   * @return false if the file does not exist and O_CREAT is not set
+   */
+  bool open(const char *path, oflag_t flags = O_READ);
+  bool open(FatFile *dir, const char *path, oflag_t flags = O_READ);
+
+  // Open the next file of an open directory
+  bool openNext(FatFile *dir, oflag_t flags = O_READ);
+
+  bool close();
+  bool isOpen() const { return opened; }
+  bool isDir() const { return opened && dir; }
+  bool isFile() const { return opened && !dir; }
+
+  int read();
+  int read(void *buf, size_t count);
+  int available() const;
+  size_t write(const void *buf, size_t count);
+
+  uint32_t fileSize() const { return data ? data->size() : 0; }
+  uint32_t curPosition() const { return pos; }
+  bool seekSet(uint32_t position);
+  bool seekEnd(int32_t offset = 0);
+  bool rewind();
+
+  bool sync();
+  // Cut the file at the current position
+  bool truncate();
+  bool truncate(uint32_t length);
+  bool preAllocate(uint32_t length);
+  bool contiguousRange(uint32_t *first_sector, uint32_t *last_sector);
+
+  size_t getName(char *name, size_t size);
+  bool remove();
+  bool rename(const char *path);
+
+private:
+  std::shared_ptr<std::vector<uint8_t>> data;
+  std::string name;
+  uint32_t pos = 0;
+  size_t next_entry = 0;      // Directory listing position
+  bool dir = false;
+  bool opened = false;
+};
+
+class SdFile : public FatFile, public Print {
+public:
+  size_t write(uint8_t b) override { return FatFile::write(&b, 1); }
+  size_t write(const uint8_t *buf, size_t count) override { return FatFile::write(buf, count); }
+  size_t write(const char *text) { return FatFile::write(text, strlen(text)); }
+  size_t write(const void *buf, size_t count) { return FatFile::write(buf, count); }
+};
+
+class SdSpiCard {
+public:
+  bool erase(uint32_t, uint32_t) { return true; }
+};
+
+class SdFat {
+public:
+  bool begin(uint8_t, uint32_t = SPI_FULL_SPEED) { return true; }
+  SdSpiCard *card() { return &spi_card; }
+  bool exists(const char *path);
+  bool remove(const char *path);
+  bool rename(const char *old_path, const char *new_path);
+  bool mkdir(const char *) { return true; }
+
+private:
+  SdSpiCard spi_card;
+};
+
+#endif
@@ -0,0 +1,38 @@
+// Wire.h (bench mock)
+#ifndef BENCH_WIRE_H
+#define BENCH_WIRE_H
+
+#include <Arduino.h>
+#include <Adafruit_ADS1X15.h>
+
+/**
+ * I2C bus that hands three-byte register writes to the Adafruit_ADS1115
+ * mock of the addressed device (the sampler's config-only mux switches)
+ * and drops every other transfer.
+ */
+class TwoWire {
+public:
+  void begin() {}
+  void setClock(uint32_t) {}
+  void beginTransmission(uint8_t address) {
+    this->address = address;
+    length = 0;
+  }
+  size_t write(uint8_t data) {
+    if (length < sizeof(bytes)) bytes[length++] = data;
+    return 1;
+  }
+  uint8_t endTransmission(bool = true) {
+    if (length == 3) Adafruit_ADS1115::write_register(address, bytes[0], (bytes[1] << 8) | bytes[2]);
+    return 0;
+  }
+
+private:
+  uint8_t address = 0;
+  uint8_t bytes[3];
+  uint8_t length = 0;
+};
+
+inline TwoWire Wire;
+
+#endif
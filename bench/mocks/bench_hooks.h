@@ -0,0 +1,71 @@
+// bench_hooks.h
+#ifndef BENCH_HOOKS_H
+#define BENCH_HOOKS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Controls and counters of the mocked hardware, used by the bench driver
+ * (bench_main.cpp). The firmware sources never include this header.
+ */
+
+// ===== VIRTUAL TIME =====
+// Set the clock behind micros() and millis()
+void bench_set_micros(uint64_t us);
+uint64_t bench_micros64();
+
+// RTC time at virtual micros() 0; rtc.now() runs with the virtual clock
+void bench_set_epoch(uint32_t epoch);
+
+// ===== ADS1115 =====
+// Call the ISR registered with attachInterrupt(), as a RDY edge would
+void bench_fire_interrupt();
+
+/**
+ * Analog input seen by one mux setting
+ * @param mux ADS1X15_REG_CONFIG_MUX_* value
+ * @param volts Differential or single-ended input voltage
+ */
+void bench_set_input(uint16_t mux, double volts);
+
+// ===== HEAP =====
+struct BenchAllocStats {
+  uint64_t calls;   // operator new calls by the code under test
+  uint64_t bytes;   // Bytes they requested
+};
+BenchAllocStats bench_alloc_stats();
+
+/**
+ * Excludes the mocks' own allocations (file contents, preferences) from
+ * bench_alloc_stats() while in scope
+ */
+class BenchUntracked {
+public:
+  BenchUntracked() { depth++; }
+  ~BenchUntracked() { depth--; }
+  static bool active() { return depth > 0; }
+
+private:
+  static int depth;
+};
+
+// ===== SD CARD =====
+struct BenchSdStats {
+  uint64_t bytes_written;
+  uint64_t bytes_read;
+  uint32_t writes;   // write() calls that reached the card
+  uint32_t syncs;
+  uint32_t opens;
+};
+BenchSdStats bench_sd_stats();
+
+// Files on the mock card and their total size
+size_t bench_sd_file_count();
+uint64_t bench_sd_stored_bytes();
+
+// ===== SERIAL =====
+// Print firmware Serial output to stdout (dropped by default)
+void bench_serial_echo(bool echo);
+
+#endif
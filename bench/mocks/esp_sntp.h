@@ -0,0 +1,11 @@
+// esp_sntp.h (bench mock)
+#ifndef BENCH_ESP_SNTP_H
+#define BENCH_ESP_SNTP_H
+
+#include <sys/time.h>
+
+// There is no network in the bench, so SNTP never reports a sync
+typedef void (*sntp_sync_time_cb_t)(struct timeval *tv);
+inline void sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t) {}
+
+#endif
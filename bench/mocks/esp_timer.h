@@ -0,0 +1,10 @@
+// esp_timer.h (bench mock)
+#ifndef BENCH_ESP_TIMER_H
+#define BENCH_ESP_TIMER_H
+
+#include <stdint.h>
+
+// Virtual clock in microseconds; micros() is its low 32 bits
+int64_t esp_timer_get_time();
+
+#endif
@@ -0,0 +1,265 @@
+#include <Arduino.h>
+#include <Adafruit_ADS1X15.h>
+#include <RTClib.h>
+#include <Preferences.h>
+#include <esp_timer.h>
+#include <chrono>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include "bench_hooks.h"
+
+HardwareSerial Serial;
+EspClass ESP;
+
+// ===== VIRTUAL TIME =====
+static uint64_t virtual_us = 0;
+static uint32_t epoch_base = 0;
+
+void bench_set_micros(uint64_t us) {
+  virtual_us = us;
+}
+
+uint64_t bench_micros64() {
+  return virtual_us;
+}
+
+void bench_set_epoch(uint32_t epoch) {
+  epoch_base = epoch;
+}
+
+uint32_t micros() {
+  return (uint32_t)virtual_us;
+}
+
+uint32_t millis() {
+  return (uint32_t)(virtual_us / 1000);
+}
+
+void delay(uint32_t ms) {
+  virtual_us += (uint64_t)ms * 1000;
+}
+
+int64_t esp_timer_get_time() {
+  return (int64_t)virtual_us;
+}
+
+// Real host time, so the firmware's stage metrics are meaningful
+uint32_t EspClass::getCycleCount() {
+  auto now = std::chrono::steady_clock::now().time_since_epoch();
+  return (uint32_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() * 240 / 1000);
+}
+
+// ===== INTERRUPTS =====
+static void (*registered_isr)() = nullptr;
+
+void attachInterrupt(int, void (*isr)(), int) {
+  registered_isr = isr;
+}
+
+static void finish_conversions();
+
+void bench_fire_interrupt() {
+  finish_conversions();
+  if (registered_isr) registered_isr();
+}
+
+// ===== SERIAL =====
+static bool serial_echo = false;
+
+void bench_serial_echo(bool echo) {
+  serial_echo = echo;
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (serial_echo) fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t *data, size_t len) {
+  if (serial_echo) fwrite(data, 1, len, stdout);
+  return len;
+}
+
+// ===== HEAP =====
+int BenchUntracked::depth = 0;
+static BenchAllocStats alloc_stats;
+
+BenchAllocStats bench_alloc_stats() {
+  return alloc_stats;
+}
+
+static void *tracked_alloc(size_t size) {
+  if (!BenchUntracked::active()) {
+    alloc_stats.calls++;
+    alloc_stats.bytes += size;
+  }
+  void *p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+
+void *operator new(size_t size) { return tracked_alloc(size); }
+void *operator new[](size_t size) { return tracked_alloc(size); }
+void operator delete(void *p) noexcept { free(p); }
+void operator delete[](void *p) noexcept { free(p); }
+void operator delete(void *p, size_t) noexcept { free(p); }
+void operator delete[](void *p, size_t) noexcept { free(p); }
+
+// ===== ADS1115 =====
+// Input voltage per mux setting (ADS1X15_REG_CONFIG_MUX_* >> 12)
+static double analog_inputs[8];
+
+void bench_set_input(uint16_t mux, double volts) {
+  analog_inputs[(mux >> 12) & 7] = volts;
+}
+
+static int16_t convert(uint16_t mux, adsGain_t gain) {
+  static const double full_scale[] = { 6.144, 4.096, 2.048, 1.024, 0.512, 0.256 };
+  uint8_t index = gain >> 9;
+  double volts = analog_inputs[(mux >> 12) & 7];
+  double code = lround(volts * 32768.0 / full_scale[index < 6 ? index : 5]);
+  if (code > 32767) code = 32767;
+  if (code < -32768) code = -32768;
+  return (int16_t)code;
+}
+
+int16_t Adafruit_ADS1115::getLastConversionResults() {
+  return result;
+}
+
+void Adafruit_ADS1115::start_if_idle() {
+  if (converting) return;  // Applies to the next conversion
+  converting = true;
+  conversion_mux = mux;
+  conversion_gain = gain;
+}
+
+void Adafruit_ADS1115::startADCReading(uint16_t mux, bool continuous) {
+  (void)continuous;
+  this->mux = mux;
+  start_if_idle();
+}
+
+void Adafruit_ADS1115::finish_conversion() {
+  if (!converting) return;
+  result = convert(conversion_mux, conversion_gain);
+  conversion_mux = mux;
+  conversion_gain = gain;
+}
+
+// Devices by address, for register writes
+static Adafruit_ADS1115 *ads_devices[4];
+
+static void finish_conversions() {
+  for (Adafruit_ADS1115 *ads : ads_devices) {
+    if (ads) ads->finish_conversion();
+  }
+}
+
+bool Adafruit_ADS1115::begin(uint8_t address) {
+  if (address < ADS1X15_ADDRESS || address >= ADS1X15_ADDRESS + 4) return false;
+  this->address = address;
+  ads_devices[address - ADS1X15_ADDRESS] = this;
+  return true;
+}
+
+void Adafruit_ADS1115::write_register(uint8_t address, uint8_t reg, uint16_t value) {
+  if (address < ADS1X15_ADDRESS || address >= ADS1X15_ADDRESS + 4 || reg != ADS1X15_REG_POINTER_CONFIG) return;
+  Adafruit_ADS1115 *ads = ads_devices[address - ADS1X15_ADDRESS];
+  if (!ads) return;
+  ads->mux = value & 0x7000;
+  ads->gain = (adsGain_t)(value & 0x0E00);
+  ads->rate = value & 0x00E0;
+  if (value & ADS1X15_REG_CONFIG_MODE_SINGLE) {
+    ads->converting = false;  // Powered down until the next start
+  } else {
+    ads->start_if_idle();
+  }
+}
+
+uint32_t Adafruit_ADS1115::samples_per_second(uint16_t rate) {
+  static const uint32_t rates[] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+  return rates[(rate >> 5) & 7];
+}
+
+// ===== RTC =====
+
+// Days since 1970-01-01 of a civil date (proleptic Gregorian)
+static int32_t days_from_civil(int32_t y, uint32_t m, uint32_t d) {
+  y -= m <= 2;
+  int32_t era = (y >= 0 ? y : y - 399) / 400;
+  uint32_t yoe = (uint32_t)(y - era * 400);
+  uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return era * 146097 + (int32_t)doe - 719468;
+}
+
+DateTime::DateTime(uint32_t t) {
+  int32_t z = t / 86400 + 719468;
+  uint32_t secs = t % 86400;
+  int32_t era = z / 146097;
+  uint32_t doe = (uint32_t)(z - era * 146097);
+  uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  uint32_t mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = yoe + era * 400 + (m <= 2);
+  hh = secs / 3600;
+  mm = secs / 60 % 60;
+  ss = secs % 60;
+}
+
+uint32_t DateTime::unixtime() const {
+  return (uint32_t)days_from_civil(y, m, d) * 86400 + hh * 3600 + mm * 60 + ss;
+}
+
+DateTime RTC_DS3231::now() {
+  return DateTime(epoch_base + (uint32_t)(virtual_us / 1000000));
+}
+
+// ===== PREFERENCES =====
+static std::map<std::string, std::vector<uint8_t>> nvs;
+
+static std::string nvs_key(const char *space, const char *key) {
+  return std::string(space) + "/" + key;
+}
+
+bool Preferences::begin(const char *name, bool) {
+  strncpy(space, name, sizeof(space) - 1);
+  return true;
+}
+
+size_t Preferences::putBytes(const char *key, const void *value, size_t len) {
+  BenchUntracked untracked;
+  const uint8_t *bytes = (const uint8_t *)value;
+  nvs[nvs_key(space, key)].assign(bytes, bytes + len);
+  return len;
+}
+
+size_t Preferences::getBytes(const char *key, void *buf, size_t max_len) {
+  BenchUntracked untracked;
+  auto it = nvs.find(nvs_key(space, key));
+  if (it == nvs.end()) return 0;
+  size_t len = std::min(max_len, it->second.size());
+  memcpy(buf, it->second.data(), len);
+  return len;
+}
+
+size_t Preferences::getBytesLength(const char *key) {
+  BenchUntracked untracked;
+  auto it = nvs.find(nvs_key(space, key));
+  return it == nvs.end() ? 0 : it->second.size();
+}
+
+bool Preferences::remove(const char *key) {
+  BenchUntracked untracked;
+  return nvs.erase(nvs_key(space, key)) > 0;
+}
+
+bool Preferences::isKey(const char *key) {
+  BenchUntracked untracked;
+  return nvs.count(nvs_key(space, key)) > 0;
+}
@@ -0,0 +1,306 @@
+#include "anomaly.h"
+#include "calibration.h"
+#include "ring_buffer.h"
+#include <math.h>
+
+#define US_PER_S 1000000LL
+
+// Detector state of one channel, owned by the acquisition task
+struct ChannelDetector {
+  // Welford accumulators of the current window
+  uint32_t n;
+  double mean;
+  double m2;
+  uint64_t window_us;
+  // Last complete window
+  bool ref_valid;
+  double ref_mean;
+  double ref_sigma;
+
+  // Minute in progress and the rolling window of minute means
+  int64_t minute_sum;
+  uint32_t minute_frames;
+  uint64_t minute_us;
+  int32_t minutes[ANOMALY_MEDIAN_MINUTES];
+  uint8_t minute_count;
+  uint8_t minute_next;
+  int32_t median;
+
+  int64_t cusum_up;      // Micro-units * s
+  int64_t cusum_down;
+  bool drain_latched;
+  uint32_t holdoff_until;
+};
+
+// Copy of the state for anomaly_json(), taken under the spinlock
+struct ChannelSnapshot {
+  uint32_t n;
+  int32_t mean;
+  int32_t sigma;
+  int32_t median;
+  bool median_valid;
+  int64_t cusum_up;
+  int64_t cusum_down;
+  uint8_t last_type;
+  uint32_t last_epoch;   // 0 = no alert yet
+};
+
+struct CusumLimits {
+  int64_t slack;   // k, micro-units
+  int64_t limit;   // h, micro-units * s
+};
+
+static const CusumLimits cusum_limits[] = {
+  { ANOMALY_SHUNT_SLACK, ANOMALY_SHUNT_LIMIT },      // CHANNEL_SHUNT
+  { ANOMALY_DIVIDER_SLACK, ANOMALY_DIVIDER_LIMIT }   // CHANNEL_DIVIDER
+};
+
+static const char *const type_names[NUM_ANOMALY_TYPES] = {
+  "drain", "step_up", "step_down", "outlier"
+};
+
+static ChannelDetector detectors[NUM_CHANNELS];
+static uint64_t quiet_us = 0;
+static RingBuffer<AnomalyAlert, ANOMALY_ALERT_QUEUE> alert_queue;
+static volatile uint32_t alerts_raised = 0;
+static volatile uint32_t alerts_dropped = 0;
+
+static portMUX_TYPE anomaly_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static ChannelSnapshot snapshots[NUM_CHANNELS];
+static bool snapshot_active = false;
+static uint32_t snapshot_quiet_s = 0;
+
+// Forget everything learned during the last park
+static void reset_detector(ChannelDetector &d) {
+  uint32_t holdoff_until = d.holdoff_until;
+  memset(&d, 0, sizeof(d));
+  d.holdoff_until = holdoff_until;
+}
+
+static void raise_alert(uint8_t channel, AnomalyType type, uint32_t epoch,
+                        int32_t value, int32_t baseline) {
+  const ChannelDetector &d = detectors[channel];
+  AnomalyAlert alert;
+  alert.epoch = epoch;
+  alert.channel = channel;
+  alert.type = type;
+  alert.value = value;
+  alert.baseline = baseline;
+  alert.sigma = d.ref_valid ? (int32_t)lround(d.ref_sigma) : 0;
+
+  alerts_raised++;
+  if (!alert_queue.push(alert)) {
+    alerts_dropped++;
+  }
+  portENTER_CRITICAL(&anomaly_spinlock);
+  snapshots[channel].last_type = type;
+  snapshots[channel].last_epoch = epoch;
+  portEXIT_CRITICAL(&anomaly_spinlock);
+}
+
+// Rate-limited alert; false while the channel is held off
+static bool raise_limited(uint8_t channel, AnomalyType type, uint32_t epoch,
+                          int32_t value, int32_t baseline) {
+  ChannelDetector &d = detectors[channel];
+  if (d.holdoff_until && (int32_t)(epoch - d.holdoff_until) < 0) return false;
+  d.holdoff_until = epoch + ANOMALY_HOLDOFF_S;
+  if (d.holdoff_until == 0) d.holdoff_until = 1;
+  raise_alert(channel, type, epoch, value, baseline);
+  return true;
+}
+
+// Median of the minute window; at most ANOMALY_MEDIAN_MINUTES values, once a minute
+static int32_t window_median(const ChannelDetector &d) {
+  int32_t sorted[ANOMALY_MEDIAN_MINUTES];
+  uint8_t count = d.minute_count;
+  for (uint8_t i = 0; i < count; i++) {
+    int32_t v = d.minutes[i];
+    uint8_t j = i;
+    for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+    sorted[j] = v;
+  }
+  if (count & 1) return sorted[count / 2];
+  return (int32_t)(((int64_t)sorted[count / 2 - 1] + sorted[count / 2]) / 2);
+}
+
+// One interval mean of one channel; detection is active
+static void detect(uint8_t channel, int32_t x, uint32_t interval_us, uint32_t epoch) {
+  ChannelDetector &d = detectors[channel];
+  const ChannelDescriptor &desc = channel_table[channel];
+  const CusumLimits &limits = cusum_limits[desc.kind];
+
+  // Outliers against the last complete window
+  if (d.ref_valid) {
+    double sigma = max(d.ref_sigma, (double)limits.slack);
+    if (fabs(x - d.ref_mean) > ANOMALY_Z_LIMIT * sigma) {
+      raise_limited(channel, ANOMALY_OUTLIER, epoch, x, (int32_t)lround(d.ref_mean));
+    }
+  }
+
+  // Welford update, the window rolls over into the reference
+  d.n++;
+  double delta = x - d.mean;
+  d.mean += delta / d.n;
+  d.m2 += delta * (x - d.mean);
+  d.window_us += interval_us;
+  if (d.window_us >= (uint64_t)ANOMALY_WINDOW_S * US_PER_S) {
+    d.ref_valid = d.n >= 2;
+    d.ref_mean = d.mean;
+    d.ref_sigma = d.n >= 2 ? sqrt(d.m2 / (d.n - 1)) : 0;
+    d.n = 0;
+    d.mean = 0;
+    d.m2 = 0;
+    d.window_us = 0;
+  }
+
+  // Minute means into the rolling median
+  d.minute_sum += x;
+  d.minute_frames++;
+  d.minute_us += interval_us;
+  if (d.minute_us >= 60 * US_PER_S) {
+    d.minutes[d.minute_next] = (int32_t)(d.minute_sum / (int64_t)d.minute_frames);
+    d.minute_next = (d.minute_next + 1) % ANOMALY_MEDIAN_MINUTES;
+    if (d.minute_count < ANOMALY_MEDIAN_MINUTES) d.minute_count++;
+    d.minute_sum = 0;
+    d.minute_frames = 0;
+    d.minute_us = 0;
+    d.median = window_median(d);
+
+    if (desc.kind == CHANNEL_SHUNT && d.minute_count >= ANOMALY_MIN_MINUTES) {
+      if (!d.drain_latched && d.median > ANOMALY_DRAIN_LIMIT_UA) {
+        d.drain_latched = true;
+        raise_alert(channel, ANOMALY_DRAIN, epoch, d.median, d.median);
+      } else if (d.drain_latched && d.median < ANOMALY_DRAIN_LIMIT_UA * 4 / 5) {
+        d.drain_latched = false;
+      }
+    }
+  }
+  if (d.minute_count < ANOMALY_MIN_MINUTES) return;
+
+  // CUSUM of the deviation from the median
+  int64_t deviation = (int64_t)x - d.median;
+  int64_t up = d.cusum_up + (deviation - limits.slack) * (int64_t)interval_us / US_PER_S;
+  int64_t down = d.cusum_down + (-deviation - limits.slack) * (int64_t)interval_us / US_PER_S;
+  d.cusum_up = up > 0 ? up : 0;
+  d.cusum_down = down > 0 ? down : 0;
+  if (d.cusum_up > limits.limit || d.cusum_down > limits.limit) {
+    AnomalyType type = d.cusum_up > limits.limit ? ANOMALY_STEP_UP : ANOMALY_STEP_DOWN;
+    raise_limited(channel, type, epoch, x, d.median);
+    d.cusum_up = 0;
+    d.cusum_down = 0;
+  }
+}
+
+static void update_snapshot(bool active) {
+  portENTER_CRITICAL(&anomaly_spinlock);
+  snapshot_active = active;
+  snapshot_quiet_s = quiet_us / US_PER_S;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    const ChannelDetector &d = detectors[ch];
+    ChannelSnapshot &s = snapshots[ch];
+    s.n = d.n;
+    s.mean = (int32_t)lround(d.ref_valid ? d.ref_mean : d.mean);
+    s.sigma = d.ref_valid ? (int32_t)lround(d.ref_sigma) : 0;
+    s.median = d.median;
+    s.median_valid = d.minute_count >= ANOMALY_MIN_MINUTES;
+    s.cusum_up = d.cusum_up;
+    s.cusum_down = d.cusum_down;
+  }
+  portEXIT_CRITICAL(&anomaly_spinlock);
+}
+
+void anomaly_feed(const DecimatedFrame &frame, uint32_t epoch) {
+  const ChannelStats &amps = frame.ch[CH_AMPS];
+  if (amps.count == 0) return;  // No current reading, nothing to gate on
+  int32_t micro_amps = calibration_scaler(CH_AMPS).from_mean(amps.mean);
+  if (abs(micro_amps) > ANOMALY_QUIET_CURRENT_UA) {
+    // In use: start over once the vehicle is parked again
+    if (quiet_us > 0) {
+      quiet_us = 0;
+      for (int ch = 0; ch < NUM_CHANNELS; ch++) reset_detector(detectors[ch]);
+      update_snapshot(false);
+    }
+    return;
+  }
+
+  quiet_us += frame.interval_us;
+  bool active = quiet_us >= (uint64_t)ANOMALY_SETTLE_S * US_PER_S;
+  if (active) {
+    for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+      const ChannelStats &stats = frame.ch[ch];
+      if (stats.count == 0) continue;
+      detect(ch, calibration_scaler(ch).from_mean(stats.mean), frame.interval_us, epoch);
+    }
+  }
+  update_snapshot(active);
+}
+
+bool anomaly_peek(AnomalyAlert &alert) {
+  return alert_queue.peek(alert);
+}
+
+void anomaly_release() {
+  AnomalyAlert alert;
+  alert_queue.pop(alert);
+}
+
+size_t anomaly_pending() {
+  return alert_queue.available();
+}
+
+const char *anomaly_type_name(uint8_t type) {
+  return type < NUM_ANOMALY_TYPES ? type_names[type] : "unknown";
+}
+
+size_t anomaly_alert_json(const AnomalyAlert &alert, char *out, size_t size) {
+  int len = snprintf(out, size,
+                     "{\"t\":%u,\"ch\":\"%s\",\"type\":\"%s\",\"value\":%.4f,\"baseline\":%.4f,\"sigma\":%.4f}",
+                     (unsigned)alert.epoch, channel_table[alert.channel].name, anomaly_type_name(alert.type),
+                     alert.value / 1e6, alert.baseline / 1e6, alert.sigma / 1e6);
+  return len < 0 ? 0 : min((size_t)len, size - 1);
+}
+
+size_t anomaly_json(char *out, size_t size) {
+  ChannelSnapshot copy[NUM_CHANNELS];
+  portENTER_CRITICAL(&anomaly_spinlock);
+  memcpy(copy, snapshots, sizeof(copy));
+  bool active = snapshot_active;
+  uint32_t quiet_s = snapshot_quiet_s;
+  portEXIT_CRITICAL(&anomaly_spinlock);
+
+  size_t len = snprintf(out, size, "{\"active\":%s,\"quiet_s\":%u,\"alerts\":%u,\"dropped\":%u,\"channels\":[",
+                        active ? "true" : "false", (unsigned)quiet_s,
+                        (unsigned)alerts_raised, (unsigned)alerts_dropped);
+  for (int ch = 0; ch < NUM_CHANNELS && len < size; ch++) {
+    const ChannelSnapshot &s = copy[ch];
+    len += snprintf(out + len, size - len,
+                    "%s{\"name\":\"%s\",\"n\":%u,\"mean\":%.4f,\"sigma\":%.4f,",
+                    ch ? "," : "", channel_table[ch].name, (unsigned)s.n, s.mean / 1e6, s.sigma / 1e6);
+    if (len >= size) break;
+    if (s.median_valid) {
+      len += snprintf(out + len, size - len, "\"median\":%.4f,", s.median / 1e6);
+    } else {
+      len += snprintf(out + len, size - len, "\"median\":null,");
+    }
+    if (len >= size) break;
+    len += snprintf(out + len, size - len, "\"cusum_up\":%.3f,\"cusum_down\":%.3f,",
+                    s.cusum_up / 1e6, s.cusum_down / 1e6);
+    if (len >= size) break;
+    if (s.last_epoch) {
+      len += snprintf(out + len, size - len, "\"last\":\"%s\",\"last_t\":%u}",
+                      anomaly_type_name(s.last_type), (unsigned)s.last_epoch);
+    } else {
+      len += snprintf(out + len, size - len, "\"last\":null,\"last_t\":null}");
+    }
+  }
+  if (len < size) len += snprintf(out + len, size - len, "]}");
+  return min(len, size - 1);
+}
+
+uint32_t anomaly_alerts() {
+  return alerts_raised;
+}
+
+uint32_t anomaly_dropped() {
+  return alerts_dropped;
+}
@@ -0,0 +1,119 @@
+// anomaly.h
+#ifndef ANOMALY_H
+#define ANOMALY_H
+
+#include <Arduino.h>
+#include "decimator.h"
+
+/**
+ * Streaming anomaly detection for parasitic drain
+ *
+ * The acquisition task hands every decimated interval to anomaly_feed().
+ * For each channel the interval mean (micro-units) goes through three
+ * detectors, each O(1) in time and memory per interval:
+ * - Welford mean and variance over ANOMALY_WINDOW_S. The last complete
+ *   window is the reference for outliers: an interval further than
+ *   ANOMALY_Z_LIMIT standard deviations (at least the CUSUM slack) from its
+ *   mean raises ANOMALY_OUTLIER.
+ * - Rolling median of the last ANOMALY_MEDIAN_MINUTES minute means. It is
+ *   sorted once a minute over a fixed window, so it follows slow drift but
+ *   not short spikes. On shunt channels a median above
+ *   ANOMALY_DRAIN_LIMIT_UA raises ANOMALY_DRAIN once; it re-arms below 80%
+ *   of the limit.
+ * - Two-sided CUSUM of the deviation from the median, in micro-units * s:
+ *   S+ = max(0, S+ + (x - median - k) * dt), S- likewise downwards. Beyond
+ *   the limit h it raises ANOMALY_STEP_UP or ANOMALY_STEP_DOWN and starts
+ *   over. A step of d above the slack k is reported after h / d seconds.
+ *
+ * Detection only runs while the vehicle is parked: while |Amps| is above
+ * ANOMALY_QUIET_CURRENT_UA every detector is reset, and it resumes
+ * ANOMALY_SETTLE_S after the current last dropped, when the ECUs have gone
+ * to sleep. Drains up to that current are caught.
+ *
+ * A channel raises at most one alert per ANOMALY_HOLDOFF_S (the drain
+ * alert is latched instead). Alerts wait in a small queue until the MQTT
+ * task publishes them to battery/alert, also across reconnects and parked
+ * upload windows; a full queue drops new alerts and counts them:
+ *   {"t":1741363200,"ch":"Amps","type":"step_up","value":0.2312,
+ *    "baseline":0.0208,"sigma":0.0031}
+ * value is the interval mean (the median for "drain"), baseline the rolling
+ * median (the window mean for "outlier"), in channel units.
+ */
+
+// ===== CONFIGURATION =====
+#ifndef ANOMALY_QUIET_CURRENT_UA
+#define ANOMALY_QUIET_CURRENT_UA 5000000   // Above this the vehicle is in use and detection pauses
+#endif
+#define ANOMALY_SETTLE_S 1800              // Quiet time before detection starts
+#ifndef ANOMALY_DRAIN_LIMIT_UA
+#define ANOMALY_DRAIN_LIMIT_UA 100000      // Parked drain alert: median current above 100 mA
+#endif
+#define ANOMALY_MEDIAN_MINUTES 15          // Rolling median window
+#define ANOMALY_MIN_MINUTES 5              // Minute means before the median is used
+#define ANOMALY_WINDOW_S 3600              // Welford window, the last complete one is the outlier reference
+#define ANOMALY_Z_LIMIT 6.0
+#define ANOMALY_SHUNT_SLACK 50000          // CUSUM slack k of shunt channels, uA
+#define ANOMALY_SHUNT_LIMIT 15000000       // CUSUM limit h, uA * s (a 100 mA step within five minutes)
+#define ANOMALY_DIVIDER_SLACK 50000        // Divider channels, uV
+#define ANOMALY_DIVIDER_LIMIT 15000000     // uV * s (a 100 mV step within five minutes)
+#define ANOMALY_HOLDOFF_S 1800             // Minimum time between alerts of one channel
+#define ANOMALY_ALERT_QUEUE 16             // Alerts waiting for MQTT, power of two
+#define ANOMALY_ALERT_JSON_SIZE 160
+#define ANOMALY_JSON_SIZE 768              // Fits anomaly_json() with CHANNELS_MAX channels
+
+enum AnomalyType : uint8_t {
+  ANOMALY_DRAIN,      // Rolling median of a shunt channel above ANOMALY_DRAIN_LIMIT_UA
+  ANOMALY_STEP_UP,    // CUSUM: the mean shifted up from the rolling median
+  ANOMALY_STEP_DOWN,  // CUSUM: the mean shifted down
+  ANOMALY_OUTLIER,    // One interval far from the last window mean
+  NUM_ANOMALY_TYPES
+};
+
+struct AnomalyAlert {
+  uint32_t epoch;     // End of the interval that raised it
+  uint8_t channel;    // SampleChannel
+  uint8_t type;       // AnomalyType
+  int32_t value;      // Interval mean, or the median for ANOMALY_DRAIN, micro-units
+  int32_t baseline;   // Rolling median, or the window mean for ANOMALY_OUTLIER, micro-units
+  int32_t sigma;      // Standard deviation of the last window, micro-units (0 before the first)
+};
+
+/**
+ * Run the detectors on one interval. Called by the acquisition task.
+ * @param epoch Unix time of the end of the interval
+ */
+void anomaly_feed(const DecimatedFrame &frame, uint32_t epoch);
+
+/**
+ * Oldest unpublished alert (MQTT task); it stays queued until anomaly_release()
+ * @return false if there is none
+ */
+bool anomaly_peek(AnomalyAlert &alert);
+
+// Remove the alert returned by anomaly_peek()
+void anomaly_release();
+
+// Alerts waiting to be published
+size_t anomaly_pending();
+
+/**
+ * Format an alert as the battery/alert JSON message
+ * @return Length written
+ */
+size_t anomaly_alert_json(const AnomalyAlert &alert, char *out, size_t size);
+
+/**
+ * Format the detector state as JSON for /api/anomaly:
+ * {"active":true,"quiet_s":..,"alerts":..,"dropped":..,"channels":[{"name":"Amps","n":..,
+ *  "mean":..,"sigma":..,"median":..,"cusum_up":..,"cusum_down":..,"last":"drain","last_t":..},...]}
+ * @return Length written
+ */
+size_t anomaly_json(char *out, size_t size);
+
+// Name of an AnomalyType as used in the messages
+const char *anomaly_type_name(uint8_t type);
+
+uint32_t anomaly_alerts();    // Alerts raised since boot
+uint32_t anomaly_dropped();   // Alerts lost to a full queue
+
+#endif
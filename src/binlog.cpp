@@ -0,0 +1,484 @@
+#include "binlog.h"
+#include "crc32.h"
+#include "file_index.h"
+#include "sd_access.h"
+
+#if LOG_BINARY_PACKED
+#define BINLOG_WRITE_RECORDS BINLOG_PACKED_MAX_RECORDS
+#else
+#define BINLOG_WRITE_RECORDS BINLOG_BLOCK_RECORDS
+#endif
+
+// Gain nibbles and the change count at the start of a packed payload
+#define PACKED_LEAD_SIZE ((NUM_CHANNELS + 1) / 2 + 1)
+#define PACKED_MAX_NIBBLES 6          // A 17-bit zigzag delta in 3-bit groups
+
+static uint32_t date_key(const DateTime &time) {
+  return time.year() * 10000UL + time.month() * 100UL + time.day();
+}
+
+uint32_t binlog_data_end(SdFile &file, uint32_t size) {
+  uint32_t pos = BINLOG_HEADER_SIZE;
+  if (size < pos) return 0;
+
+  // Older versions on the card have shorter records
+  BinLogHeader file_header;
+  file.seekSet(0);
+  if (file.read(&file_header, sizeof(file_header)) != (int)sizeof(file_header) ||
+      memcmp(file_header.magic, BINLOG_MAGIC, 4) != 0) {
+    return 0;
+  }
+  uint32_t record_size = binlog_record_size(file_header.version, file_header.channels);
+  uint16_t block_records = file_header.block_records;
+
+  if (file_header.version >= 3) {
+    BinLogPackedHeader header;
+    while (pos + sizeof(header) <= size) {
+      file.seekSet(pos);
+      if (file.read(&header, sizeof(header)) != (int)sizeof(header)) break;
+      if (header.magic != BINLOG_PACKED_MAGIC || header.count == 0 ||
+          header.count > block_records || header.bytes > BINLOG_PACKED_PAYLOAD) break;
+
+      uint32_t end = pos + sizeof(header) + header.bytes;
+      if (end > size) break;
+      pos = end;
+    }
+    return pos;
+  }
+
+  BinLogBlockHeader header;
+  while (pos + sizeof(header) <= size) {
+    file.seekSet(pos);
+    if (file.read(&header, sizeof(header)) != (int)sizeof(header)) break;
+    if (header.magic != BINLOG_BLOCK_MAGIC || header.count == 0 ||
+        header.count > block_records) break;
+
+    uint32_t end = pos + sizeof(header) + header.count * record_size;
+    if (end > size) break;
+    pos = end;
+  }
+  return pos;
+}
+
+bool binlog_unpack(const uint8_t *payload, uint16_t bytes, uint16_t count, uint8_t channels,
+                   int16_t codes[][BINLOG_MAX_CHANNELS], uint8_t gains[][BINLOG_MAX_CHANNELS]) {
+  uint32_t gain_bytes = (channels + 1) / 2;
+  if (bytes < gain_bytes + 1) return false;
+
+  uint8_t current[BINLOG_MAX_CHANNELS];
+  for (int ch = 0; ch < channels; ch++) {
+    current[ch] = (payload[ch / 2] >> ((ch % 2) * 4)) & 0x0F;
+  }
+  uint8_t change_count = payload[gain_bytes];
+  const uint8_t *changes = payload + gain_bytes + 1;
+  uint32_t pos = gain_bytes + 1 + change_count * 2;
+  if (pos > bytes) return false;
+
+  // Codes fill the rest; an odd count leaves a zero high nibble at the end
+  uint32_t nibbles = (bytes - pos) * 2;
+  uint32_t nibble = 0;
+  int32_t last[BINLOG_MAX_CHANNELS] = { 0 };
+  uint8_t next_change = 0;
+  for (uint16_t r = 0; r < count; r++) {
+    for (; next_change < change_count && changes[next_change * 2] == r; next_change++) {
+      uint8_t change = changes[next_change * 2 + 1];
+      if ((change >> 4) < channels) current[change >> 4] = change & 0x0F;
+    }
+
+    for (int ch = 0; ch < channels; ch++) {
+      uint32_t zigzag = 0;
+      for (uint8_t shift = 0;; shift += 3) {
+        if (nibble >= nibbles || shift > 3 * (PACKED_MAX_NIBBLES - 1)) return false;
+        uint8_t group = (payload[pos + nibble / 2] >> ((nibble % 2) * 4)) & 0x0F;
+        nibble++;
+        zigzag |= (uint32_t)(group & 0x07) << shift;
+        if (!(group & 0x08)) break;
+      }
+      last[ch] += (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+      codes[r][ch] = (int16_t)last[ch];
+      gains[r][ch] = current[ch];
+    }
+  }
+  return (nibble + 1) / 2 == nibbles / 2 &&
+         (nibble % 2 == 0 || (payload[bytes - 1] >> 4) == 0);
+}
+
+/**
+ * Check that an existing log can be appended to
+ * @param version Set to the version of a file in another format
+ * @return true if the file is missing, empty or has the current format
+ */
+static bool current_format(const char *path, uint16_t &version) {
+  SdFile existing;
+  version = 1;
+  if (!existing.open(path, O_READ)) return true;
+
+  BinLogHeader header;
+  int len = existing.read(&header, sizeof(header));
+  existing.close();
+  if (len <= 0) return true;
+  if (len != (int)sizeof(header) || memcmp(header.magic, BINLOG_MAGIC, 4) != 0) return false;
+  version = header.version;
+  return header.version == BINLOG_VERSION && header.channels == NUM_CHANNELS;
+}
+
+void BinaryLog::begin(const BinLogConfig &cfg) {
+  config = cfg;
+  count = 0;
+}
+
+void BinaryLog::set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]) {
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    config.scale[ch] = scale[ch];
+    config.offset[ch] = offset[ch];
+  }
+}
+
+bool BinaryLog::open_for_day(const DateTime &time) {
+  uint32_t key = date_key(time);
+  if (file.is_open() && day == key) return true;
+
+  close();
+
+  char filename[32];
+  snprintf(filename, sizeof(filename), "Raw %04d-%02d-%02d.bin",
+           time.year(), time.month(), time.day());
+  // A file in another format keeps it; start a new one next to it
+  uint16_t old_version;
+  if (!current_format(filename, old_version)) {
+    char old_name[32];
+    snprintf(old_name, sizeof(old_name), "Raw %04d-%02d-%02d v%u.bin",
+             time.year(), time.month(), time.day(), old_version);
+    if (!sd.rename(filename, old_name)) {
+      Serial.print("ERROR: Failed to move old binary log: ");
+      Serial.println(filename);
+      return false;
+    }
+    file_index_remove(filename);
+  }
+
+  if (!file.open(filename, LOG_PREALLOC_BINARY)) {
+    Serial.print("ERROR: Failed to open binary log: ");
+    Serial.println(filename);
+    return false;
+  }
+
+  // New file: write the self-describing header first
+  if (file.size() == 0) {
+    uint8_t header_block[BINLOG_HEADER_SIZE];
+    memset(header_block, 0, sizeof(header_block));
+
+    BinLogHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, BINLOG_MAGIC, 4);
+    header.version = BINLOG_VERSION;
+    header.header_size = BINLOG_HEADER_SIZE;
+    header.start_epoch = time.unixtime();
+    header.interval_ms = config.interval_ms;
+    header.channels = NUM_CHANNELS;
+    header.frac_bits = 0;
+    header.block_records = BINLOG_WRITE_RECORDS;
+    for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+      header.scale[ch] = config.scale[ch];
+      header.offset[ch] = config.offset[ch];
+      header.gain[ch] = sampler_reference_gain(ch);
+    }
+    memcpy(header_block, &header, sizeof(header));
+    file.write(header_block, sizeof(header_block));
+  }
+
+  Serial.print("Logging to file: ");
+  Serial.println(filename);
+  day = key;
+  open_index(time);
+  return true;
+}
+
+/**
+ * Open the block index of the log. A new log starts a new index, like the
+ * text logs' line indexes.
+ */
+void BinaryLog::open_index(const DateTime &time) {
+  char filename[32];
+  snprintf(filename, sizeof(filename), "Raw %04d-%02d-%02d.idx",
+           time.year(), time.month(), time.day());
+  if (file.size() <= BINLOG_HEADER_SIZE) {
+    sd.remove(filename);
+  }
+  if (!index.open(filename)) {
+    Serial.print("ERROR: Failed to open index file: ");
+    Serial.println(filename);
+  }
+}
+
+uint32_t BinaryLog::pending_bytes() const {
+  if (count == 0) return 0;
+#if LOG_BINARY_PACKED
+  return BINLOG_PACKED_HEADER_SIZE + PACKED_LEAD_SIZE + change_count * 2 + (packed_nibbles + 1) / 2;
+#else
+  return BINLOG_BLOCK_HEADER_SIZE + count * BINLOG_RECORD_SIZE;
+#endif
+}
+
+#if LOG_BINARY_PACKED
+bool BinaryLog::fits(const uint8_t gains[NUM_CHANNELS]) const {
+  uint8_t changed = 0;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    if (gains[ch] != last_gains[ch]) changed++;
+  }
+  uint32_t lead = PACKED_LEAD_SIZE + (change_count + changed) * 2;
+  return change_count + changed <= BINLOG_PACKED_MAX_CHANGES &&
+         lead + (packed_nibbles + NUM_CHANNELS * PACKED_MAX_NIBBLES + 1) / 2 <= BINLOG_PACKED_PAYLOAD;
+}
+
+void BinaryLog::pack(const int16_t codes[NUM_CHANNELS], const uint8_t gains[NUM_CHANNELS]) {
+  if (count == 0) {
+    // Every block decodes on its own: deltas start from zero
+    for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+      first_gains[ch] = last_gains[ch] = gains[ch];
+      last_codes[ch] = 0;
+    }
+    change_count = 0;
+    packed_nibbles = 0;
+  }
+
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    if (gains[ch] != last_gains[ch]) {
+      changes[change_count][0] = count;
+      changes[change_count][1] = (ch << 4) | (gains[ch] & 0x0F);
+      change_count++;
+      last_gains[ch] = gains[ch];
+    }
+
+    int32_t delta = (int32_t)codes[ch] - last_codes[ch];
+    uint32_t zigzag = ((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31);
+    do {
+      uint8_t group = zigzag & 0x07;
+      zigzag >>= 3;
+      if (zigzag) group |= 0x08;
+      if (packed_nibbles % 2 == 0) {
+        packed[packed_nibbles / 2] = group;
+      } else {
+        packed[packed_nibbles / 2] |= group << 4;
+      }
+      packed_nibbles++;
+    } while (zigzag);
+    last_codes[ch] = codes[ch];
+  }
+}
+#endif
+
+void BinaryLog::append(const DateTime &time, const int16_t codes[NUM_CHANNELS],
+                       const uint8_t gains[NUM_CHANNELS]) {
+  uint32_t epoch = time.unixtime();
+
+  // A record that does not follow the block's cadence starts a new block
+  if (count > 0) {
+    uint32_t expected = block_epoch + (uint32_t)(((uint64_t)count * config.interval_ms) / 1000);
+    uint32_t tolerance = max(1UL, (unsigned long)(config.interval_ms / 1000));
+    if (epoch + tolerance < expected || epoch > expected + tolerance || date_key(time) != day) {
+      write_block();
+    }
+  }
+
+#if LOG_BINARY_PACKED
+  if (count > 0 && !fits(gains)) {
+    write_block();
+  }
+#endif
+
+  if (!open_for_day(time)) return;
+
+  if (count == 0) block_epoch = epoch;
+#if LOG_BINARY_PACKED
+  pack(codes, gains);
+#else
+  uint8_t *record = &records[count * BINLOG_RECORD_SIZE];
+  memcpy(record, codes, NUM_CHANNELS * sizeof(int16_t));
+  uint8_t *packed = record + NUM_CHANNELS * sizeof(int16_t);
+  memset(packed, 0, (NUM_CHANNELS + 1) / 2);
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    packed[ch / 2] |= (gains[ch] & 0x0F) << ((ch % 2) * 4);
+  }
+#endif
+  count++;
+
+  if (count == BINLOG_WRITE_RECORDS) {
+    write_block();
+  }
+}
+
+void BinaryLog::write_block() {
+  if (count == 0) return;
+
+  if (file.is_open()) {
+    // Index entry first: it points at the block about to be written
+    if (!index.is_open()) open_index(DateTime(block_epoch));
+    LogIndexEntry entry;
+    entry.seconds = block_epoch % 86400UL;
+    entry.offset = file.size();
+    index.write((const uint8_t *)&entry, sizeof(entry));
+    file_index_touch(index.path(), index.size());
+
+#if LOG_BINARY_PACKED
+    uint8_t lead[PACKED_LEAD_SIZE];
+    memset(lead, 0, sizeof(lead));
+    for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+      lead[ch / 2] |= (first_gains[ch] & 0x0F) << ((ch % 2) * 4);
+    }
+    lead[PACKED_LEAD_SIZE - 1] = change_count;
+
+    BinLogPackedHeader header;
+    header.magic = BINLOG_PACKED_MAGIC;
+    header.count = count;
+    header.epoch = block_epoch;
+    uint16_t packed_len = (packed_nibbles + 1) / 2;
+    header.bytes = sizeof(lead) + change_count * 2 + packed_len;
+    header.crc = crc32_update(0, &header, 10);
+    header.crc = crc32_update(header.crc, lead, sizeof(lead));
+    header.crc = crc32_update(header.crc, changes, change_count * 2);
+    header.crc = crc32_update(header.crc, packed, packed_len);
+
+    file.write((const uint8_t *)&header, sizeof(header));
+    file.write(lead, sizeof(lead));
+    file.write((const uint8_t *)changes, change_count * 2);
+    file.write(packed, packed_len);
+#else
+    BinLogBlockHeader header;
+    header.magic = BINLOG_BLOCK_MAGIC;
+    header.count = count;
+    header.epoch = block_epoch;
+    header.crc = crc32_update(0, &header, 8);
+    header.crc = crc32_update(header.crc, records, count * BINLOG_RECORD_SIZE);
+
+    file.write((const uint8_t *)&header, sizeof(header));
+    file.write(records, count * BINLOG_RECORD_SIZE);
+#endif
+    // One block is the unit of loss on power failure
+    file.sync();
+  }
+  count = 0;
+}
+
+void BinaryLog::flush() {
+  write_block();
+  file.sync();
+  index.sync();
+}
+
+void BinaryLog::close() {
+  write_block();
+  file.close();
+  index.close();
+}
+
+// ===== READER =====
+
+bool BinLogReader::open(const char *path) {
+  SdGuard guard;
+  close();
+  if (!file.open(path, O_READ)) return false;
+  length = file.fileSize();
+  sd_logger_active_length(path, &length);  // Pre-allocated while being written
+
+  if (file.read(&file_header, sizeof(file_header)) != (int)sizeof(file_header) ||
+      memcmp(file_header.magic, BINLOG_MAGIC, 4) != 0 ||
+      file_header.channels == 0 || file_header.channels > BINLOG_MAX_CHANNELS) {
+    file.close();
+    return false;
+  }
+  pos = file_header.header_size;
+  skipped = 0;
+
+  size_t len = strlen(path);
+  if (len >= 4 && len < sizeof(index_path)) {
+    strcpy(index_path, path);
+    strcpy(index_path + len - 4, ".idx");
+  } else {
+    index_path[0] = '\0';
+  }
+  return true;
+}
+
+void BinLogReader::close() {
+  if (!file.isOpen()) return;
+  SdGuard guard;
+  file.close();
+}
+
+void BinLogReader::seek(uint32_t seconds) {
+  uint32_t offset = index_path[0] ? log_index_lookup(index_path, seconds) : 0;
+  pos = max(offset, (uint32_t)file_header.header_size);
+}
+
+uint16_t BinLogReader::next_block() {
+  const uint8_t channels = file_header.channels;
+  const bool packed = file_header.version >= 3;
+  const uint32_t header_size = packed ? BINLOG_PACKED_HEADER_SIZE : BINLOG_BLOCK_HEADER_SIZE;
+
+  for (;;) {
+    SdGuard guard;
+    if (!file.isOpen() || pos + header_size > length) return 0;
+    file.seekSet(pos);
+    if (file.read(block, header_size) != (int)header_size) return 0;
+
+    uint16_t count;
+    uint32_t data_size;
+    uint32_t crc_header;
+    uint32_t crc;
+    if (packed) {
+      BinLogPackedHeader header;
+      memcpy(&header, block, sizeof(header));
+      if (header.magic != BINLOG_PACKED_MAGIC) return 0;  // Lost block sync
+      count = header.count;
+      data_size = header.bytes;
+      crc_header = 10;
+      crc = header.crc;
+      epoch = header.epoch;
+    } else {
+      BinLogBlockHeader header;
+      memcpy(&header, block, sizeof(header));
+      if (header.magic != BINLOG_BLOCK_MAGIC) return 0;
+      count = header.count;
+      data_size = count * binlog_record_size(file_header.version, channels);
+      crc_header = 8;
+      crc = header.crc;
+      epoch = header.epoch;
+    }
+    if (count == 0 || count > BINLOG_READER_RECORDS || header_size + data_size > sizeof(block) ||
+        pos + header_size + data_size > length) {
+      return 0;
+    }
+
+    uint8_t *data = block + header_size;
+    if (file.read(data, data_size) != (int)data_size) return 0;
+    pos += header_size + data_size;
+
+    uint32_t actual = crc32_update(crc32_update(0, block, crc_header), data, data_size);
+    if (actual != crc) {
+      skipped++;
+      continue;
+    }
+
+    if (packed) {
+      if (!binlog_unpack(data, data_size, count, channels, codes, gains)) {
+        skipped++;
+        continue;
+      }
+      return count;
+    }
+
+    // Fixed-size records: codes, then gain nibbles since version 2
+    uint32_t record_size = binlog_record_size(file_header.version, channels);
+    for (uint16_t r = 0; r < count; r++) {
+      const uint8_t *record = data + r * record_size;
+      for (int ch = 0; ch < channels; ch++) {
+        memcpy(&codes[r][ch], record + ch * sizeof(int16_t), sizeof(int16_t));
+        gains[r][ch] = file_header.version >= 2
+                           ? (record[channels * sizeof(int16_t) + ch / 2] >> ((ch % 2) * 4)) & 0x0F
+                           : file_header.gain[ch];
+      }
+    }
+    return count;
+  }
+}
@@ -0,0 +1,233 @@
+// binlog.h
+#ifndef BINLOG_H
+#define BINLOG_H
+
+#include <Arduino.h>
+#include <RTClib.h>
+#include "sampler.h"
+#include "sd_logger.h"
+
+/**
+ * Compact binary log format ("Raw YYYY-MM-DD.bin")
+ *
+ * Layout (little endian):
+ *   File header, BINLOG_HEADER_SIZE bytes (BinLogHeader, zero padded)
+ *   Blocks, each:
+ *     BinLogBlockHeader (12 bytes)
+ *     count records: one int16 code per channel, then one 4-bit PGA gain
+ *     per channel (low nibble first, RawSample::gain encoding)
+ *
+ * A full block is exactly 512 bytes, so with the 512-byte header every
+ * full block sits on its own SD sector. Records in a block are spaced
+ * interval_ms apart starting at the block's epoch; a time gap closes the
+ * block. The CRC covers the first 8 bytes of the block header and the
+ * records. scale[ch] applies to codes at the header's gain[ch]; a record
+ * taken in another range is converted with the ratio of the two LSB sizes:
+ *   value = code * scale[ch] * lsb(record gain) / lsb(gain[ch]) + offset[ch]
+ * Version 1 files have no gains (records are codes only, at one gain).
+ *
+ * Version 3 (LOG_BINARY_PACKED) stores the same records delta-coded. Slow
+ * signals such as the leakage current change by a few LSB per record, so
+ * most codes take half a byte instead of two, and gains are only stored
+ * when they change. Its blocks have a BinLogPackedHeader (14 bytes) and
+ *     (channels + 1) / 2 bytes   gain of each channel at the first record
+ *     uint8 n, n x 2 bytes       gain changes: record index, channel << 4 | gain
+ *     count * channels varints   zigzag(code - previous code of the channel)
+ * The codes of record r come after those of record r - 1; the first
+ * record's deltas are from zero, so every block decodes on its own. Varints
+ * are built from nibbles, low nibble of each byte first: 3 value bits (low
+ * bits first) and 0x8 when another nibble follows, so a delta of -4..3
+ * takes one nibble. An odd nibble count is padded with 0. A block holds at most
+ * BINLOG_BLOCK_SIZE bytes and BINLOG_PACKED_MAX_RECORDS records, and the
+ * CRC covers the first 10 header bytes and the payload.
+ *
+ * Packed blocks differ in length, so "Raw YYYY-MM-DD.idx" (LogIndexEntry,
+ * see sd_logger.h) records the time of day and offset of every block of
+ * any version, letting readers seek to a time without walking the file.
+ *
+ * visualization/BinLog.py reads and converts these files; BinLogReader
+ * decodes them on the device (CSV downloads, see file_stream.h).
+ */
+
+#define BINLOG_MAGIC "BMSL"
+#define BINLOG_VERSION (LOG_BINARY_PACKED ? 3 : 2)
+#define BINLOG_HEADER_SIZE 512
+#define BINLOG_MAX_CHANNELS 4
+#define BINLOG_BLOCK_MAGIC 0xB10C
+#define BINLOG_BLOCK_SIZE 512
+#define BINLOG_BLOCK_HEADER_SIZE 12
+#define BINLOG_RECORD_SIZE binlog_record_size(2, NUM_CHANNELS)
+#define BINLOG_BLOCK_RECORDS ((BINLOG_BLOCK_SIZE - BINLOG_BLOCK_HEADER_SIZE) / BINLOG_RECORD_SIZE)
+#define BINLOG_PACKED_MAGIC 0xB10D
+#define BINLOG_PACKED_HEADER_SIZE 14
+#define BINLOG_PACKED_PAYLOAD (BINLOG_BLOCK_SIZE - BINLOG_PACKED_HEADER_SIZE)
+#define BINLOG_PACKED_MAX_RECORDS 255 // Record indexes of gain changes are one byte
+#define BINLOG_PACKED_MAX_CHANGES 16  // Gain changes per block
+#define BINLOG_READER_RECORDS 255     // Largest block BinLogReader decodes (any version)
+
+struct __attribute__((packed)) BinLogHeader {
+  char magic[4];                        // "BMSL"
+  uint16_t version;                     // BINLOG_VERSION
+  uint16_t header_size;                 // Offset of the first block
+  uint32_t start_epoch;                 // RTC unix time when the file was created
+  uint32_t interval_ms;                 // Spacing of records
+  uint8_t channels;                     // Codes per record
+  uint8_t frac_bits;                    // Fractional bits of the stored codes
+  uint16_t block_records;               // Records in a full block
+  float scale[BINLOG_MAX_CHANNELS];     // Physical units per code
+  float offset[BINLOG_MAX_CHANNELS];    // Physical offset
+  uint8_t gain[BINLOG_MAX_CHANNELS];    // PGA gain that scale refers to (version 2)
+};
+
+struct __attribute__((packed)) BinLogBlockHeader {
+  uint16_t magic;        // BINLOG_BLOCK_MAGIC
+  uint16_t count;        // Records in this block
+  uint32_t epoch;        // RTC unix time of the first record
+  uint32_t crc;          // CRC-32 of the 8 bytes above and the records
+};
+
+struct __attribute__((packed)) BinLogPackedHeader {
+  uint16_t magic;        // BINLOG_PACKED_MAGIC
+  uint16_t count;        // Records in this block
+  uint32_t epoch;        // RTC unix time of the first record
+  uint16_t bytes;        // Payload length after this header
+  uint32_t crc;          // CRC-32 of the 10 bytes above and the payload
+};
+
+/**
+ * Calibration written into each file header so files stay self-describing
+ */
+struct BinLogConfig {
+  uint32_t interval_ms;
+  float scale[NUM_CHANNELS];
+  float offset[NUM_CHANNELS];
+};
+
+// Bytes per record of a fixed-size format version (1 and 2)
+constexpr uint32_t binlog_record_size(uint16_t version, uint8_t channels) {
+  return channels * sizeof(int16_t) + (version >= 2 ? (channels + 1) / 2 : 0);
+}
+
+/**
+ * Decode the payload of a packed (version 3) block
+ * @param payload Bytes after the BinLogPackedHeader
+ * @param bytes Payload length
+ * @param count Records in the block (at most BINLOG_READER_RECORDS)
+ * @param channels Codes per record (at most BINLOG_MAX_CHANNELS)
+ * @param codes Set to the code of each record and channel
+ * @param gains Set to the gain of each code (RawSample::gain encoding)
+ * @return false if the payload does not hold exactly count records
+ */
+bool binlog_unpack(const uint8_t *payload, uint16_t bytes, uint16_t count, uint8_t channels,
+                   int16_t codes[][BINLOG_MAX_CHANNELS], uint8_t gains[][BINLOG_MAX_CHANNELS]);
+
+/**
+ * Find the end of valid blocks in a binary log by walking the block headers
+ * @param file Open binary log
+ * @param size Size of the file (or of its pre-allocated extent)
+ * @return Offset just past the last complete block
+ */
+uint32_t binlog_data_end(SdFile &file, uint32_t size);
+
+/**
+ * Writer for one daily binary log
+ */
+class BinaryLog {
+public:
+  void begin(const BinLogConfig &config);
+
+  // Calibration written into the headers of files created from now on
+  void set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]);
+
+  /**
+   * Append one record, rolling over to a new file when the date changes
+   * @param time Timestamp of the record
+   * @param codes ADC code per channel
+   * @param gains PGA gain of each code (RawSample::gain encoding)
+   */
+  void append(const DateTime &time, const int16_t codes[NUM_CHANNELS], const uint8_t gains[NUM_CHANNELS]);
+
+  // Write the (partial) current block and sync the file
+  void flush();
+
+  // Flush and close the file
+  void close();
+
+  // Size including the block still being filled in RAM
+  uint32_t size() const { return file.size() + pending_bytes(); }
+  LogFile &log_file() { return file; }
+  LogFile &index_file() { return index; }
+
+private:
+  bool open_for_day(const DateTime &time);
+  void open_index(const DateTime &time);
+  void write_block();
+  uint32_t pending_bytes() const;
+#if LOG_BINARY_PACKED
+  bool fits(const uint8_t gains[NUM_CHANNELS]) const;
+  void pack(const int16_t codes[NUM_CHANNELS], const uint8_t gains[NUM_CHANNELS]);
+#endif
+
+  BinLogConfig config;
+  LogFile file;
+  LogFile index;         // Block offsets, "Raw YYYY-MM-DD.idx"
+  uint32_t day = 0;
+  uint32_t block_epoch = 0;
+  uint16_t count = 0;
+#if LOG_BINARY_PACKED
+  uint8_t first_gains[NUM_CHANNELS];
+  int16_t last_codes[NUM_CHANNELS];
+  uint8_t last_gains[NUM_CHANNELS];
+  uint8_t changes[BINLOG_PACKED_MAX_CHANGES][2];
+  uint8_t change_count = 0;
+  uint16_t packed_nibbles = 0;
+  uint8_t packed[BINLOG_PACKED_PAYLOAD];   // Code varints of the block, two per byte
+#else
+  uint8_t records[BINLOG_BLOCK_RECORDS * BINLOG_RECORD_SIZE];
+#endif
+};
+
+/**
+ * Reads a binary log of any version block by block, decoding each block
+ * into codes and gains
+ */
+class BinLogReader {
+public:
+  ~BinLogReader() { close(); }
+
+  // Open a log and read its header; false if it is not a binary log
+  bool open(const char *path);
+  void close();
+
+  /**
+   * Continue at the last block that starts at or before a time of day,
+   * looked up in the log's .idx file (from the first block without one)
+   * @param seconds Seconds since midnight
+   */
+  void seek(uint32_t seconds);
+
+  /**
+   * Read and decode the next block; blocks that fail their CRC are skipped
+   * @return Records in codes/gains, 0 at the end of the data
+   */
+  uint16_t next_block();
+
+  const BinLogHeader &header() const { return file_header; }
+  uint32_t block_epoch() const { return epoch; }
+  uint32_t bad_blocks() const { return skipped; }
+
+  int16_t codes[BINLOG_READER_RECORDS][BINLOG_MAX_CHANNELS];
+  uint8_t gains[BINLOG_READER_RECORDS][BINLOG_MAX_CHANNELS];
+
+private:
+  SdFile file;
+  char index_path[32] = "";
+  BinLogHeader file_header;
+  uint32_t pos = 0;
+  uint32_t length = 0;
+  uint32_t epoch = 0;
+  uint32_t skipped = 0;
+  uint8_t block[BINLOG_BLOCK_SIZE];
+};
+
+#endif
@@ -0,0 +1,215 @@
+#include "burst.h"
+#include "crc32.h"
+#include "sd_access.h"
+#include "file_index.h"
+#include <RTClib.h>
+
+static_assert(sizeof(BurstEventHeader) % 4 == 0, "samples must stay aligned");
+
+static BurstEvent events[BURST_BUFFERS];
+static uint8_t pending[BURST_BUFFERS];    // Consumers that still have to see the event
+static portMUX_TYPE burst_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// Owned by the acquisition task
+static RawSample pre_ring[BURST_PRE_SAMPLES];
+static uint32_t pre_pos = 0;              // Conversions pushed into pre_ring
+static BurstEvent *capture = nullptr;     // Event being filled
+static uint32_t capture_t_us = 0;         // micros() of the trigger
+static int32_t level_codes = 0;
+static int32_t slope_codes = 0;
+static int32_t last_amps = 0;    // In LSBs of the reference gain
+static bool have_last_amps = false;
+static uint32_t clock_epoch = 0;
+static uint32_t clock_t_us = 0;
+static float cfg_scale[NUM_CHANNELS];
+static float cfg_offset[NUM_CHANNELS];
+static uint8_t cfg_consumers = 0;
+static uint32_t sequence = 0;
+static uint32_t dropped = 0;
+
+void burst_begin(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS], uint8_t consumers) {
+  cfg_consumers = consumers;
+  burst_set_calibration(scale, offset);
+}
+
+void burst_set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]) {
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    cfg_scale[ch] = scale[ch];
+    cfg_offset[ch] = offset[ch];
+  }
+
+  // Triggers compare codes at the reference gain; the shunt channel has no offset worth converting
+  float amps_per_code = fabsf(scale[CH_AMPS]);
+  level_codes = amps_per_code > 0 ? (int32_t)(BURST_THRESHOLD_A / amps_per_code) : INT32_MAX;
+  slope_codes = amps_per_code > 0 ? (int32_t)(BURST_SLOPE_A / amps_per_code) : INT32_MAX;
+}
+
+void burst_set_clock(uint32_t epoch, uint32_t t_us) {
+  clock_epoch = epoch;
+  clock_t_us = t_us;
+}
+
+static void add_sample(const RawSample &sample) {
+  BurstSample &out = capture->samples[capture->header.count++];
+  out.dt_us = (int32_t)(sample.t_us - capture_t_us);
+  out.code = sample.code;
+  out.channel = sample.channel;
+  out.gain = sample.gain;
+}
+
+/**
+ * Start an event in a free buffer with the pre-trigger window
+ * @return false if all buffers are still in use
+ */
+static bool start_event(const RawSample &sample, BurstTrigger trigger) {
+  BurstEvent *event = nullptr;
+  portENTER_CRITICAL(&burst_spinlock);
+  for (int i = 0; i < BURST_BUFFERS; i++) {
+    if (pending[i] == 0) {
+      event = &events[i];
+      break;
+    }
+  }
+  portEXIT_CRITICAL(&burst_spinlock);
+  if (!event) return false;
+
+  BurstEventHeader &header = event->header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, BURST_MAGIC, 4);
+  header.version = BURST_VERSION;
+  header.trigger = trigger;
+  header.header_size = sizeof(BurstEventHeader);
+  header.channels = NUM_CHANNELS;
+  header.sequence = sequence++;
+  header.trigger_code = sample.code;
+  header.trigger_gain = sample.gain;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    header.scale[ch] = cfg_scale[ch];
+    header.offset[ch] = cfg_offset[ch];
+    header.gains |= (sampler_reference_gain(ch) & 0x0F) << (ch * 4);
+  }
+
+  // RTC time of the trigger from the last (epoch, micros) pair
+  int64_t ms = (int64_t)clock_epoch * 1000 + (int32_t)(sample.t_us - clock_t_us) / 1000;
+  header.epoch = ms / 1000;
+  header.epoch_ms = ms % 1000;
+
+  capture = event;
+  capture_t_us = sample.t_us;
+
+  // The ring holds the conversions before this one, oldest first
+  uint32_t pre = min(pre_pos, (uint32_t)BURST_PRE_SAMPLES);
+  for (uint32_t i = pre_pos - pre; i != pre_pos; i++) {
+    add_sample(pre_ring[i % BURST_PRE_SAMPLES]);
+  }
+  header.pre_count = header.count;
+  return true;
+}
+
+static void finish_event() {
+  BurstEventHeader &header = capture->header;
+  header.crc = crc32_update(0, &header, offsetof(BurstEventHeader, crc));
+  header.crc = crc32_update(header.crc, capture->samples, header.count * sizeof(BurstSample));
+
+  int index = capture - events;
+  portENTER_CRITICAL(&burst_spinlock);
+  pending[index] = cfg_consumers;
+  portEXIT_CRITICAL(&burst_spinlock);
+  capture = nullptr;
+}
+
+void burst_feed(const RawSample &sample) {
+  if (capture) {
+    add_sample(sample);
+    if (capture->header.count == BURST_WINDOW) {
+      finish_event();
+    }
+  } else if (sample.channel == CH_AMPS && cfg_consumers) {
+    // Edge triggers: a current that stays high fires only once
+    int32_t code = sampler_fine_code(sample);
+    int32_t magnitude = abs(code);
+    bool level = magnitude >= level_codes && (!have_last_amps || abs(last_amps) < level_codes);
+    bool slope = have_last_amps && abs(code - last_amps) >= slope_codes;
+    if (level || slope) {
+      if (!start_event(sample, level ? BURST_TRIGGER_LEVEL : BURST_TRIGGER_SLOPE)) {
+        dropped++;
+      } else {
+        add_sample(sample);
+      }
+    }
+  }
+
+  if (sample.channel == CH_AMPS) {
+    last_amps = sampler_fine_code(sample);
+    have_last_amps = true;
+  }
+  pre_ring[pre_pos++ % BURST_PRE_SAMPLES] = sample;
+}
+
+const BurstEvent *burst_peek(BurstConsumer consumer) {
+  const BurstEvent *oldest = nullptr;
+  portENTER_CRITICAL(&burst_spinlock);
+  for (int i = 0; i < BURST_BUFFERS; i++) {
+    if ((pending[i] & consumer) &&
+        (!oldest || (int32_t)(events[i].header.sequence - oldest->header.sequence) < 0)) {
+      oldest = &events[i];
+    }
+  }
+  portEXIT_CRITICAL(&burst_spinlock);
+  return oldest;
+}
+
+void burst_release(BurstConsumer consumer, const BurstEvent *event) {
+  int index = event - events;
+  portENTER_CRITICAL(&burst_spinlock);
+  pending[index] &= ~consumer;
+  portEXIT_CRITICAL(&burst_spinlock);
+}
+
+/**
+ * Trigger current of an event in A, from its own header: the code is
+ * brought to the reference gain like sampler_fine_code() does
+ */
+static float trigger_amps(const BurstEventHeader &header) {
+  uint8_t reference = (header.gains >> (4 * CH_AMPS)) & 0x0F;
+  int32_t code = header.trigger_code;
+  if (header.trigger_gain < reference) code <<= reference - header.trigger_gain;
+  return code * header.scale[CH_AMPS] + header.offset[CH_AMPS];
+}
+
+void burst_write_sd() {
+  const BurstEvent *event;
+  while ((event = burst_peek(BURST_CONSUMER_SD)) != nullptr) {
+    DateTime time(event->header.epoch);
+    char filename[32];
+    snprintf(filename, sizeof(filename), "Events %04d-%02d-%02d.evt",
+             time.year(), time.month(), time.day());
+
+    SdGuard guard;
+    SdFile file;
+    if (file.open(filename, O_RDWR | O_CREAT | O_AT_END)) {
+      size_t len = burst_event_size(event);
+      if (file.write(event, len) != len) {
+        Serial.print("ERROR: Write failed on ");
+        Serial.println(filename);
+      }
+      file_index_touch(filename, file.fileSize());
+      file.close();
+      Serial.printf("Current event #%u (%s, %.2f A) written to %s\n", event->header.sequence,
+                    event->header.trigger == BURST_TRIGGER_LEVEL ? "level" : "slope",
+                    trigger_amps(event->header), filename);
+    } else {
+      Serial.print("ERROR: Failed to open event file: ");
+      Serial.println(filename);
+    }
+    burst_release(BURST_CONSUMER_SD, event);
+  }
+}
+
+uint32_t burst_events() {
+  return sequence;
+}
+
+uint32_t burst_dropped() {
+  return dropped;
+}
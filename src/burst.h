@@ -0,0 +1,136 @@
+// burst.h
+#ifndef BURST_H
+#define BURST_H
+
+#include <Arduino.h>
+#include "sampler.h"
+
+/**
+ * Triggered high-rate capture of current events
+ *
+ * Every raw conversion that the acquisition task takes from the sampler
+ * ring also goes through burst_feed(), which keeps the last
+ * BURST_PRE_SAMPLES conversions (both channels, at the full ADC rate) in a
+ * pre-trigger ring. A shunt sample that crosses BURST_THRESHOLD_A, or that
+ * differs from the previous shunt sample by BURST_SLOPE_A, triggers an
+ * event: the pre-trigger window plus the next BURST_POST_SAMPLES
+ * conversions are captured into one of BURST_BUFFERS event buffers. The
+ * decimated 1 Hz stream is not affected.
+ *
+ * Finished events are appended to "Events YYYY-MM-DD.evt" by the SD writer
+ * and published on the MQTT event topic. Both use the same bytes: a
+ * BurstEventHeader followed by count BurstSamples (little endian). Sample
+ * times are relative to the trigger. scale[ch] applies to codes at the
+ * channel's reference gain (gains, 4 bits per channel); samples keep the
+ * raw code and the gain they were taken with:
+ *   value = code * scale[ch] * lsb(sample gain) / lsb(reference gain) + offset[ch]
+ * When no buffer is free the event is counted as dropped.
+ *
+ * visualization/BurstEvent.py reads event files and payloads.
+ */
+
+// ===== CONFIGURATION =====
+#ifndef BURST_THRESHOLD_A
+#define BURST_THRESHOLD_A 5.0       // Level trigger on |current|
+#endif
+#ifndef BURST_SLOPE_A
+#define BURST_SLOPE_A 2.0           // Slope trigger: change between consecutive shunt samples
+#endif
+#define BURST_PRE_SAMPLES 512       // Conversions kept before the trigger (both channels)
+#define BURST_POST_SAMPLES 1536     // Conversions captured from the trigger on
+#define BURST_WINDOW (BURST_PRE_SAMPLES + BURST_POST_SAMPLES)
+#define BURST_BUFFERS 2             // Events that can wait for SD/MQTT at the same time
+
+#define BURST_MAGIC "BEVT"
+#define BURST_VERSION 2
+
+enum BurstTrigger : uint8_t {
+  BURST_TRIGGER_LEVEL = 1,    // |current| rose above BURST_THRESHOLD_A
+  BURST_TRIGGER_SLOPE = 2     // Current stepped by more than BURST_SLOPE_A
+};
+
+// Consumers that must see an event before its buffer is reused
+enum BurstConsumer : uint8_t {
+  BURST_CONSUMER_SD = 0x01,
+  BURST_CONSUMER_MQTT = 0x02
+};
+
+struct __attribute__((packed)) BurstEventHeader {
+  char magic[4];              // "BEVT"
+  uint8_t version;            // BURST_VERSION
+  uint8_t trigger;            // BurstTrigger
+  uint16_t header_size;       // Offset of the first sample
+  uint32_t epoch;             // RTC unix time of the trigger
+  uint16_t epoch_ms;          // Milliseconds part of the trigger time
+  uint16_t count;             // Samples in the event
+  uint16_t pre_count;         // Samples before the trigger
+  uint8_t channels;           // NUM_CHANNELS
+  uint8_t trigger_gain;       // PGA setting of trigger_code (version 2)
+  uint32_t sequence;          // Event number since boot
+  int16_t trigger_code;       // Shunt code that fired the trigger
+  uint16_t gains;             // Reference gain per channel, low nibble = channel 0 (version 2)
+  float scale[NUM_CHANNELS];  // Physical units per code at the reference gain
+  float offset[NUM_CHANNELS];
+  uint32_t crc;               // CRC-32 of the header up to here and the samples
+};
+
+struct __attribute__((packed)) BurstSample {
+  int32_t dt_us;     // Time relative to the trigger
+  int16_t code;      // Raw ADC code
+  uint8_t channel;   // SampleChannel
+  uint8_t gain;      // PGA setting, as in RawSample
+};
+
+struct BurstEvent {
+  BurstEventHeader header;
+  BurstSample samples[BURST_WINDOW];
+};
+
+/**
+ * Configure the triggers
+ * @param scale Physical units per code of each channel
+ * @param offset Physical offset of each channel
+ * @param consumers BurstConsumer bits that will read events
+ */
+void burst_begin(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS], uint8_t consumers);
+
+/**
+ * Update the calibration used for the triggers and event headers
+ */
+void burst_set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]);
+
+/**
+ * Feed one raw conversion (acquisition task)
+ */
+void burst_feed(const RawSample &sample);
+
+/**
+ * Tell the capture which RTC time a micros() value corresponds to
+ * (acquisition task, once per decimated frame)
+ */
+void burst_set_clock(uint32_t epoch, uint32_t t_us);
+
+/**
+ * Oldest finished event a consumer has not released yet
+ * @return nullptr if there is none
+ */
+const BurstEvent *burst_peek(BurstConsumer consumer);
+
+// Mark an event as handled by a consumer; the buffer is reused once all have
+void burst_release(BurstConsumer consumer, const BurstEvent *event);
+
+// Bytes of an event (header and samples)
+inline size_t burst_event_size(const BurstEvent *event) {
+  return sizeof(BurstEventHeader) + event->header.count * sizeof(BurstSample);
+}
+
+/**
+ * Append all finished events to the daily event file (SD writer task)
+ */
+void burst_write_sd();
+
+// Events captured and events lost because all buffers were busy
+uint32_t burst_events();
+uint32_t burst_dropped();
+
+#endif
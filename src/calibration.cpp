@@ -0,0 +1,353 @@
+#include "calibration.h"
+#include <Preferences.h>
+
+#define CALIBRATION_MAGIC 0xCA11
+#define CALIBRATION_NVS_NAMESPACE "calibration"
+#define CALIBRATION_NVS_KEY "profile"
+
+struct StoredProfile {
+  uint16_t magic;
+  uint16_t size;
+  CalibrationProfile profile;
+};
+
+// Layout saved before the channel table, migrated at boot
+struct LegacyStoredProfile {
+  uint16_t magic;
+  uint16_t size;
+  uint8_t gain[2];
+  uint32_t shunt_amps;
+  uint32_t shunt_mv;
+  uint32_t divider_num;
+  uint32_t divider_den;
+  int32_t current_offset_ua;
+  int32_t voltage_offset_uv;
+};
+
+static CalibrationProfile default_profile;
+static CalibrationProfile active_profile;
+static portMUX_TYPE calibration_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// Two scaler sets; readers use the active one, updates fill the other and flip
+static Scaler scalers[2][NUM_CHANNELS];
+static volatile uint8_t active_set = 0;
+static void (*change_listener)() = nullptr;
+
+// Auto-zero, fed by the acquisition task
+static volatile AutoZeroState zero_state = AUTO_ZERO_IDLE;
+static uint64_t zero_target_us = 0;
+static uint64_t zero_elapsed_us = 0;
+static int64_t zero_sum[NUM_CHANNELS];
+static uint32_t zero_frames[NUM_CHANNELS];
+static volatile bool zero_ready = false;
+
+static const char *const gain_names[] = { "2/3", "1", "2", "4", "8", "16" };
+
+static bool build_scalers(const CalibrationProfile &p, Scaler out[NUM_CHANNELS]) {
+  for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++) {
+    const ChannelCalibration &c = p.ch[ch];
+    if (c.den == 0 || c.gain > ADS_GAIN_16) return false;
+    out[ch] = channel_table[ch].kind == CHANNEL_SHUNT ? shunt_scaler(c.gain, c.num, c.den, c.offset)
+                                                      : divider_scaler(c.gain, c.num, c.den, c.offset);
+    if (out[ch].factor == 0) return false;
+  }
+  return true;
+}
+
+/**
+ * Two-channel profile of older firmware, on top of the table defaults
+ */
+static bool migrate_legacy(const LegacyStoredProfile &legacy, CalibrationProfile &profile) {
+  if (legacy.magic != CALIBRATION_MAGIC || legacy.size != sizeof(LegacyStoredProfile)) return false;
+  profile = calibration_table_defaults();
+  profile.ch[CH_AMPS] = { legacy.gain[0], legacy.shunt_amps, legacy.shunt_mv, legacy.current_offset_ua };
+  profile.ch[CH_VOLTS] = { legacy.gain[1], legacy.divider_num, legacy.divider_den, legacy.voltage_offset_uv };
+  return true;
+}
+
+static void save_profile(const CalibrationProfile &profile) {
+  StoredProfile stored;
+  stored.magic = CALIBRATION_MAGIC;
+  stored.size = sizeof(StoredProfile);
+  stored.profile = profile;
+
+  Preferences prefs;
+  if (prefs.begin(CALIBRATION_NVS_NAMESPACE, false)) {
+    prefs.putBytes(CALIBRATION_NVS_KEY, &stored, sizeof(stored));
+    prefs.end();
+  } else {
+    Serial.println("ERROR: Failed to open NVS for the calibration");
+  }
+}
+
+/**
+ * Switch the conversion path to a profile without saving it
+ */
+static bool activate(const CalibrationProfile &profile) {
+  uint8_t next = active_set ^ 1;
+  if (!build_scalers(profile, scalers[next])) return false;
+
+  portENTER_CRITICAL(&calibration_spinlock);
+  active_profile = profile;
+  active_set = next;
+  portEXIT_CRITICAL(&calibration_spinlock);
+  return true;
+}
+
+CalibrationProfile calibration_table_defaults() {
+  CalibrationProfile profile;
+  for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++) {
+    const ChannelDescriptor &c = channel_table[ch];
+    profile.ch[ch] = { c.gain, c.num, c.den, c.offset };
+  }
+  return profile;
+}
+
+void calibration_begin(const CalibrationProfile &defaults) {
+  default_profile = defaults;
+
+  StoredProfile stored;
+  LegacyStoredProfile legacy;
+  CalibrationProfile migrated;
+  Preferences prefs;
+  prefs.begin(CALIBRATION_NVS_NAMESPACE, true);
+  size_t len = prefs.getBytesLength(CALIBRATION_NVS_KEY);
+  if (len == sizeof(stored)) {
+    prefs.getBytes(CALIBRATION_NVS_KEY, &stored, sizeof(stored));
+  } else if (len == sizeof(legacy)) {
+    prefs.getBytes(CALIBRATION_NVS_KEY, &legacy, sizeof(legacy));
+  }
+  prefs.end();
+
+  if (len == sizeof(stored) && stored.magic == CALIBRATION_MAGIC &&
+      stored.size == sizeof(StoredProfile) && activate(stored.profile)) {
+    Serial.println("Calibration loaded from NVS");
+  } else if (len == sizeof(legacy) && migrate_legacy(legacy, migrated) && activate(migrated)) {
+    save_profile(migrated);
+    Serial.println("Calibration migrated to the channel table");
+  } else {
+    if (!activate(defaults)) {
+      Serial.println("ERROR: Default calibration is invalid!");
+    }
+    Serial.println("Using default calibration");
+  }
+}
+
+void calibration_on_change(void (*listener)()) {
+  change_listener = listener;
+}
+
+CalibrationProfile calibration_profile() {
+  portENTER_CRITICAL(&calibration_spinlock);
+  CalibrationProfile profile = active_profile;
+  portEXIT_CRITICAL(&calibration_spinlock);
+  return profile;
+}
+
+const Scaler &calibration_scaler(uint8_t channel) {
+  return scalers[active_set][channel];
+}
+
+static bool parse_int(const char *text, long min_value, long max_value, long &out) {
+  char *end;
+  long value = strtol(text, &end, 10);
+  if (end == text || *end != '\0' || value < min_value || value > max_value) return false;
+  out = value;
+  return true;
+}
+
+// Legacy key of the two-channel profile -> generic field of a channel
+struct LegacyKey {
+  const char *key;
+  const char *field;
+  uint8_t channel;
+};
+
+static const LegacyKey legacy_keys[] = {
+  { "shunt_amps", "num", CH_AMPS },
+  { "shunt_mv", "den", CH_AMPS },
+  { "current_offset_ua", "offset", CH_AMPS },
+  { "divider_num", "num", CH_VOLTS },
+  { "divider_den", "den", CH_VOLTS },
+  { "voltage_offset_uv", "offset", CH_VOLTS },
+};
+
+bool calibration_parse(CalibrationProfile &profile, const char *key, const char *value) {
+  // Split "<field>_<channel name>", or map a legacy key
+  char field[8];
+  int channel = -1;
+  for (const LegacyKey &legacy : legacy_keys) {
+    if (strcmp(key, legacy.key) == 0) {
+      strcpy(field, legacy.field);
+      channel = legacy.channel;
+    }
+  }
+  if (channel < 0) {
+    const char *name = strchr(key, '_');
+    if (!name || name - key >= (int)sizeof(field)) return false;
+    memcpy(field, key, name - key);
+    field[name - key] = '\0';
+    channel = channel_find(name + 1);
+    if (channel < 0) return false;
+  }
+
+  ChannelCalibration &c = profile.ch[channel];
+  bool shunt = channel_table[channel].kind == CHANNEL_SHUNT;
+  long n;
+  if (strcmp(field, "gain") == 0) {
+    for (uint8_t gain = ADS_GAIN_2_3; gain <= ADS_GAIN_16; gain++) {
+      if (strcmp(value, gain_names[gain]) == 0) {
+        c.gain = gain;
+        return true;
+      }
+    }
+    return false;
+  }
+  if (strcmp(field, "num") == 0 && parse_int(value, 1, shunt ? 100000 : 100000000, n)) {
+    c.num = n;
+  } else if (strcmp(field, "den") == 0 && parse_int(value, 1, shunt ? 1000 : 100000000, n)) {
+    c.den = n;
+  } else if (strcmp(field, "offset") == 0 && parse_int(value, -100000000, 100000000, n)) {
+    c.offset = n;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+bool calibration_apply(const CalibrationProfile &profile) {
+  if (!activate(profile)) return false;
+  save_profile(profile);
+  Serial.println("Calibration updated");
+  if (change_listener) change_listener();
+  return true;
+}
+
+void calibration_reset() {
+  calibration_apply(default_profile);
+}
+
+bool calibration_apply_query(const char *query) {
+  CalibrationProfile profile = calibration_profile();
+  long zero_seconds = -1;
+  bool reset = false;
+
+  char pair[64];
+  while (*query) {
+    size_t len = strcspn(query, "&");
+    if (len >= sizeof(pair)) return false;
+    memcpy(pair, query, len);
+    pair[len] = '\0';
+    query += len + (query[len] == '&');
+
+    char *value = strchr(pair, '=');
+    if (!value) return false;
+    *value++ = '\0';
+    if (strcmp(pair, "zero") == 0) {
+      if (!parse_int(value, 1, CALIBRATION_AUTO_ZERO_MAX_S, zero_seconds)) return false;
+    } else if (strcmp(pair, "reset") == 0) {
+      reset = true;
+    } else if (!calibration_parse(profile, pair, value)) {
+      return false;
+    }
+  }
+
+  if (reset) {
+    calibration_reset();
+  } else if (!calibration_apply(profile)) {
+    return false;
+  }
+  if (zero_seconds > 0) calibration_start_auto_zero(zero_seconds);
+  return true;
+}
+
+bool calibration_start_auto_zero(uint16_t seconds) {
+  if (zero_state == AUTO_ZERO_RUNNING || seconds == 0 || seconds > CALIBRATION_AUTO_ZERO_MAX_S) return false;
+  zero_target_us = seconds * 1000000ULL;
+  zero_elapsed_us = 0;
+  memset(zero_sum, 0, sizeof(zero_sum));
+  memset(zero_frames, 0, sizeof(zero_frames));
+  zero_ready = false;
+  zero_state = AUTO_ZERO_RUNNING;
+  Serial.printf("Auto-zero started for %u s, keep the currents at zero\n", seconds);
+  return true;
+}
+
+void calibration_feed(const DecimatedFrame &frame) {
+  if (zero_state != AUTO_ZERO_RUNNING || zero_ready) return;
+
+  for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++) {
+    const ChannelStats &stats = frame.ch[ch];
+    if (channel_table[ch].kind == CHANNEL_SHUNT && stats.count > 0) {
+      zero_sum[ch] += stats.mean;
+      zero_frames[ch]++;
+    }
+  }
+  zero_elapsed_us += frame.interval_us;
+  if (zero_elapsed_us >= zero_target_us) {
+    zero_ready = true;
+  }
+}
+
+void calibration_loop() {
+  if (!zero_ready) return;
+  zero_ready = false;
+
+  // The measured mean without any offset is what has to be cancelled
+  CalibrationProfile profile = calibration_profile();
+  uint8_t zeroed = 0;
+  for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++) {
+    if (zero_frames[ch] == 0) continue;
+    Scaler raw = calibration_scaler(ch);
+    raw.offset = 0;
+    int32_t mean = (int32_t)(zero_sum[ch] / (int64_t)zero_frames[ch]);
+    profile.ch[ch].offset = -raw.from_mean(mean);
+    zeroed++;
+    Serial.printf("Auto-zero: %s offset %d uA over %u frames\n", channel_table[ch].name,
+                  profile.ch[ch].offset, zero_frames[ch]);
+  }
+
+  if (zeroed == 0) {
+    zero_state = AUTO_ZERO_FAILED;
+    Serial.println("Auto-zero failed: no shunt data");
+    return;
+  }
+  zero_state = calibration_apply(profile) ? AUTO_ZERO_DONE : AUTO_ZERO_FAILED;
+}
+
+uint8_t calibration_min_gain(uint8_t channel) {
+  CalibrationProfile profile = calibration_profile();
+  uint8_t reference = profile.ch[channel].gain;
+  if (channel_table[channel].kind != CHANNEL_SHUNT || reference <= ADS_GAIN_1) return reference;
+
+  const Scaler &scaler = calibration_scaler(channel);
+  for (uint8_t gain = max((uint8_t)ADS_GAIN_1, (uint8_t)CALIBRATION_AMPS_MIN_GAIN); gain < reference; gain++) {
+    int64_t full_scale = ((int64_t)INT16_MAX << (reference - gain)) * scaler.factor >> SCALER_SHIFT;
+    if (full_scale + abs(scaler.offset) < INT32_MAX) return gain;
+  }
+  return reference;
+}
+
+AutoZeroState calibration_auto_zero_state() {
+  return zero_state;
+}
+
+size_t calibration_json(char *out, size_t size) {
+  static const char *const zero_names[] = { "idle", "running", "done", "failed" };
+  CalibrationProfile p = calibration_profile();
+  const ChannelCalibration &amps = p.ch[CH_AMPS];
+  const ChannelCalibration &volts = p.ch[CH_VOLTS];
+  int len = snprintf(out, size,
+                     "{\"gain_amps\":\"%s\",\"gain_volts\":\"%s\",\"shunt_amps\":%u,\"shunt_mv\":%u,"
+                     "\"divider_num\":%u,\"divider_den\":%u,\"current_offset_ua\":%d,"
+                     "\"voltage_offset_uv\":%d,\"auto_zero\":\"%s\",\"channels\":[",
+                     gain_names[amps.gain], gain_names[volts.gain], amps.num, amps.den,
+                     volts.num, volts.den, amps.offset, volts.offset, zero_names[zero_state]);
+  for (uint8_t ch = 0; ch < NUM_CHANNELS && len >= 0 && (size_t)len < size; ch++) {
+    const ChannelCalibration &c = p.ch[ch];
+    len += snprintf(out + len, size - len, "%s{\"name\":\"%s\",\"gain\":\"%s\",\"num\":%u,\"den\":%u,\"offset\":%d}",
+                    ch ? "," : "", channel_table[ch].name, gain_names[c.gain], c.num, c.den, c.offset);
+  }
+  if (len >= 0 && (size_t)len < size) len += snprintf(out + len, size - len, "]}");
+  return len < 0 ? 0 : min((size_t)len, size - 1);
+}
@@ -0,0 +1,136 @@
+// calibration.h
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <Arduino.h>
+#include "sampler.h"
+#include "decimator.h"
+#include "scaler.h"
+
+/**
+ * Per-device calibration profile stored in NVS
+ *
+ * The profile holds the PGA gain and the conversion of each channel of the
+ * channel table (channels.h): the shunt rating or the divider ratio and an
+ * offset. It is loaded at boot (falling back to the defaults of the table)
+ * and turned into one Scaler per channel; the conversion path only ever
+ * reads those precomputed coefficients. Changes swap in a new set of
+ * scalers, are saved to NVS and reported to the registered listener so the
+ * sampler and the file/message headers follow.
+ *
+ * Profiles are edited through key=value pairs, shared by the web API and
+ * the MQTT calibration topic. <name> is a channel name in lower case:
+ *   gain_<name>                PGA setting: 2/3, 1, 2, 4, 8 or 16
+ *   num_<name>, den_<name>     Shunt: num A at den mV. Divider: input : ADC pin voltage
+ *   offset_<name>              Added to the value, in micro-units
+ * The names of the two-channel profile still work for CH_AMPS and CH_VOLTS:
+ *   shunt_amps, shunt_mv, divider_num, divider_den, current_offset_ua,
+ *   voltage_offset_uv
+ *
+ * The gain of a shunt channel is its finest one; the sampler auto-ranges
+ * down from there to calibration_min_gain() for large currents.
+ *
+ * Auto-zero averages the shunt channels for a few seconds while no current
+ * flows and stores the negated means as their offsets.
+ */
+
+#define CALIBRATION_AUTO_ZERO_S 10        // Default averaging time of auto-zero
+#define CALIBRATION_AUTO_ZERO_MAX_S 300
+#define CALIBRATION_JSON_SIZE 640         // Fits calibration_json() with CHANNELS_MAX channels
+#ifndef CALIBRATION_AMPS_MIN_GAIN
+#define CALIBRATION_AMPS_MIN_GAIN ADS_GAIN_1  // Coarsest auto-range gain of the shunt channels
+#endif
+
+struct ChannelCalibration {
+  uint8_t gain;     // ADS_GAIN_*
+  uint32_t num;     // See ChannelDescriptor
+  uint32_t den;
+  int32_t offset;   // Micro-units
+};
+
+struct CalibrationProfile {
+  ChannelCalibration ch[NUM_CHANNELS];
+};
+
+enum AutoZeroState : uint8_t {
+  AUTO_ZERO_IDLE,
+  AUTO_ZERO_RUNNING,
+  AUTO_ZERO_DONE,     // Last run finished and was applied
+  AUTO_ZERO_FAILED    // Last run saw no shunt data
+};
+
+// Profile from the defaults of the channel table
+CalibrationProfile calibration_table_defaults();
+
+/**
+ * Load the profile from NVS or use the defaults
+ * @param defaults Compiled-in profile, also used by calibration_reset()
+ */
+void calibration_begin(const CalibrationProfile &defaults);
+
+// Called after every applied change (from the task that made it)
+void calibration_on_change(void (*listener)());
+
+// Active profile
+CalibrationProfile calibration_profile();
+
+/**
+ * Converter of a channel for the active profile
+ */
+const Scaler &calibration_scaler(uint8_t channel);
+
+/**
+ * Update one field of a profile from text
+ * @return false for an unknown key or an invalid value
+ */
+bool calibration_parse(CalibrationProfile &profile, const char *key, const char *value);
+
+/**
+ * Validate, activate and save a profile
+ * @return false if the profile gives unusable scale factors
+ */
+bool calibration_apply(const CalibrationProfile &profile);
+
+// Go back to the compiled-in defaults
+void calibration_reset();
+
+/**
+ * Apply a "key=value&key=value" string (MQTT payloads). "zero=<seconds>"
+ * starts auto-zero, "reset=1" restores the defaults.
+ * @return false if any pair was rejected (nothing is applied then)
+ */
+bool calibration_apply_query(const char *query);
+
+/**
+ * Start measuring the shunt offsets; the currents must be zero meanwhile
+ * @param seconds Averaging time
+ */
+bool calibration_start_auto_zero(uint16_t seconds);
+
+/**
+ * Feed one decimated frame (acquisition task)
+ */
+void calibration_feed(const DecimatedFrame &frame);
+
+/**
+ * Apply a finished auto-zero (I/O task; writes NVS)
+ */
+void calibration_loop();
+
+/**
+ * Coarsest gain a channel may auto-range to with the active profile. Shunt
+ * channels start at CALIBRATION_AMPS_MIN_GAIN and are raised until their
+ * full scale fits the micro-unit range of the scaler; other channels stay
+ * at their profile gain.
+ */
+uint8_t calibration_min_gain(uint8_t channel);
+
+AutoZeroState calibration_auto_zero_state();
+
+/**
+ * Format the active profile and auto-zero state as JSON
+ * @return Length written
+ */
+size_t calibration_json(char *out, size_t size);
+
+#endif
@@ -0,0 +1,38 @@
+#include "channels.h"
+#include <Adafruit_ADS1X15.h>
+#include "scaler.h"
+
+const ChannelDescriptor channel_table[NUM_CHANNELS] = {
+#define CHANNEL_ROW(id, name, unit, kind, device, mux, gain, num, den, offset) \
+  { name, unit, kind, device, mux, gain, num, den, offset },
+  CHANNEL_TABLE(CHANNEL_ROW)
+#undef CHANNEL_ROW
+};
+
+const AdcDevice adc_devices[NUM_ADC_DEVICES] = {
+#define DEVICE_ROW(address, alert_pin) { address, alert_pin },
+  ADC_DEVICE_TABLE(DEVICE_ROW)
+#undef DEVICE_ROW
+};
+
+int channel_find(const char *name) {
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    if (strcasecmp(name, channel_table[ch].name) == 0) return ch;
+  }
+  char *end;
+  long index = strtol(name, &end, 10);
+  if (end != name && *end == '\0' && index >= 0 && index < NUM_CHANNELS) return index;
+  return -1;
+}
+
+size_t channels_json(char *out, size_t size) {
+  static const char *const kind_names[] = { "shunt", "divider" };
+  size_t len = snprintf(out, size, "[");
+  for (int ch = 0; ch < NUM_CHANNELS && len < size; ch++) {
+    const ChannelDescriptor &c = channel_table[ch];
+    len += snprintf(out + len, size - len, "%s{\"name\":\"%s\",\"unit\":\"%s\",\"kind\":\"%s\",\"device\":%u,\"address\":%u}",
+                    ch ? "," : "", c.name, c.unit, kind_names[c.kind], c.device, adc_devices[c.device].address);
+  }
+  if (len < size) len += snprintf(out + len, size - len, "]");
+  return min(len, size - 1);
+}
@@ -0,0 +1,107 @@
+// channels.h
+#ifndef CHANNELS_H
+#define CHANNELS_H
+
+#include <Arduino.h>
+
+/**
+ * Channel descriptor table
+ *
+ * Every measured quantity is one row of CHANNEL_TABLE: the ADS1115 it is
+ * wired to (a row of ADC_DEVICE_TABLE), its mux input, the default PGA
+ * gain, how codes turn into physical units and the name used for its log
+ * files, the MQTT channel list (battery/channels) and the web API.
+ * SampleChannel, NUM_CHANNELS and channel_table[] are generated from it, so
+ * the sampler, calibration, loggers and message formats all follow the
+ * table.
+ *
+ * CHANNEL(id, name, unit, kind, device, mux, gain, num, den, offset)
+ *   kind CHANNEL_SHUNT: num A at den mV. kind CHANNEL_DIVIDER: input
+ *   : pin voltage = num : den. Offset is in micro-units. These are the
+ *   calibration defaults; a profile saved in NVS overrides them.
+ * DEVICE(address, alert_pin)
+ *   One ADS1115 on the shared I2C bus and the GPIO of its ALERT/RDY output.
+ *
+ * Each ADS1115 converts continuously and cycles through its own channels,
+ * so devices work in parallel and the aggregate rate grows with every
+ * device. CH_AMPS and CH_VOLTS belong to the primary battery; charge
+ * counting, event capture and the parked mode follow CH_AMPS, so these two
+ * rows must stay. For example, a service battery on a second ADS1115 with
+ * ADDR tied to VDD:
+ *   #define CHANNEL_TABLE(CHANNEL) \
+ *     CHANNEL(CH_AMPS, "Amps", "A", CHANNEL_SHUNT, 0, ADS1X15_REG_CONFIG_MUX_DIFF_0_1, ADS_GAIN_16, 100, 75, 0) \
+ *     CHANNEL(CH_VOLTS, "Volts", "V", CHANNEL_DIVIDER, 0, ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS_GAIN_16, 43136, 625, 400000) \
+ *     CHANNEL(CH_SERVICE_AMPS, "ServiceAmps", "A", CHANNEL_SHUNT, 1, ADS1X15_REG_CONFIG_MUX_DIFF_0_1, ADS_GAIN_16, 50, 75, 0) \
+ *     CHANNEL(CH_SERVICE_VOLTS, "ServiceVolts", "V", CHANNEL_DIVIDER, 1, ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS_GAIN_16, 43136, 625, 400000)
+ *   #define ADC_DEVICE_TABLE(DEVICE) DEVICE(0x48, 4) DEVICE(0x49, 5)
+ * Names must be unique, without spaces; files are "<name> YYYY-MM-DD.txt".
+ */
+
+// ===== CONFIGURATION =====
+#ifndef CHANNEL_TABLE
+#define CHANNEL_TABLE(CHANNEL) \
+  CHANNEL(CH_AMPS, "Amps", "A", CHANNEL_SHUNT, 0, ADS1X15_REG_CONFIG_MUX_DIFF_0_1, ADS_GAIN_16, 100, 75, 0) \
+  CHANNEL(CH_VOLTS, "Volts", "V", CHANNEL_DIVIDER, 0, ADS1X15_REG_CONFIG_MUX_SINGLE_2, ADS_GAIN_16, 43136, 625, 400000)
+#endif
+#ifndef ADC_DEVICE_TABLE
+#define ADC_DEVICE_TABLE(DEVICE) \
+  DEVICE(0x48, 4)
+#endif
+#define CHANNELS_MAX 4           // Channels the binary log and event formats hold
+#define ADC_DEVICES_MAX 4        // ADS1115 addresses on one bus
+#define CHANNELS_JSON_SIZE 512   // Fits channels_json() with CHANNELS_MAX channels
+
+// ===== GENERATED =====
+// Logical measurement channels, in table order
+enum SampleChannel : uint8_t {
+#define CHANNEL_ID(id, ...) id,
+  CHANNEL_TABLE(CHANNEL_ID)
+#undef CHANNEL_ID
+  NUM_CHANNELS
+};
+
+#define ADC_DEVICE_ONE(...) +1
+constexpr uint8_t NUM_ADC_DEVICES = 0 ADC_DEVICE_TABLE(ADC_DEVICE_ONE);
+#undef ADC_DEVICE_ONE
+
+static_assert(NUM_CHANNELS <= CHANNELS_MAX, "too many channels for the log formats");
+static_assert(NUM_ADC_DEVICES >= 1 && NUM_ADC_DEVICES <= ADC_DEVICES_MAX, "1 to 4 ADS1115 devices");
+
+enum ChannelKind : uint8_t {
+  CHANNEL_SHUNT,     // Current through a shunt (A)
+  CHANNEL_DIVIDER    // Voltage through a resistor divider (V)
+};
+
+struct ChannelDescriptor {
+  const char *name;   // Log file prefix, topic and API name
+  const char *unit;
+  ChannelKind kind;
+  uint8_t device;     // Index into adc_devices
+  uint16_t mux;       // ADS1X15_REG_CONFIG_MUX_*
+  uint8_t gain;       // Default ADS_GAIN_*
+  uint32_t num;       // Default conversion, see kind
+  uint32_t den;
+  int32_t offset;     // Default offset, micro-units
+};
+
+struct AdcDevice {
+  uint8_t address;
+  uint8_t alert_pin;
+};
+
+extern const ChannelDescriptor channel_table[NUM_CHANNELS];
+extern const AdcDevice adc_devices[NUM_ADC_DEVICES];
+
+/**
+ * Channel by name (case-insensitive) or by index as text
+ * @return SampleChannel, or -1 if there is none
+ */
+int channel_find(const char *name);
+
+/**
+ * Format the table as JSON: [{"name":..,"unit":..,"kind":..,"device":..}, ...]
+ * @return Length written
+ */
+size_t channels_json(char *out, size_t size);
+
+#endif
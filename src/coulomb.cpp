@@ -0,0 +1,146 @@
+#include "coulomb.h"
+#include "crc32.h"
+#include <Preferences.h>
+
+#define COULOMB_MAGIC 0x43C1
+#define UA_MS_PER_AH 3600000000000LL
+static const int64_t capacity_ua_ms = (int64_t)(COULOMB_CAPACITY_AH * UA_MS_PER_AH);
+#define COULOMB_NVS_NAMESPACE "coulomb"
+#define COULOMB_NVS_KEY "state"
+
+// Persisted form of the counter
+struct PersistedState {
+  uint16_t magic;
+  uint16_t size;
+  uint32_t reserved;  // Keeps the counters aligned without padding, so the CRC covers only data
+  int64_t discharged_ua_ms;
+  int64_t charged_ua_ms;
+  int64_t used_ua_ms;
+  float drain_a;
+  uint32_t crc;      // CRC-32 of the fields above
+};
+
+// Survives resets and deep sleep, lost on power off
+RTC_DATA_ATTR static PersistedState rtc_state;
+
+static portMUX_TYPE coulomb_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static PersistedState state;
+static unsigned long last_save = 0;
+
+static uint32_t state_crc(const PersistedState &s) {
+  return crc32_update(0, &s, offsetof(PersistedState, crc));
+}
+
+static bool state_valid(const PersistedState &s) {
+  return s.magic == COULOMB_MAGIC && s.size == sizeof(PersistedState) && s.crc == state_crc(s);
+}
+
+void coulomb_begin() {
+  if (state_valid(rtc_state)) {
+    state = rtc_state;
+    Serial.println("Coulomb counter restored from RTC memory");
+  } else {
+    Preferences prefs;
+    prefs.begin(COULOMB_NVS_NAMESPACE, true);
+    size_t len = prefs.getBytes(COULOMB_NVS_KEY, &state, sizeof(state));
+    prefs.end();
+    if (len == sizeof(state) && state_valid(state)) {
+      Serial.println("Coulomb counter restored from NVS");
+    } else {
+      memset(&state, 0, sizeof(state));
+      state.magic = COULOMB_MAGIC;
+      state.size = sizeof(PersistedState);
+      Serial.println("Coulomb counter starts empty (battery assumed full)");
+    }
+  }
+  state.crc = state_crc(state);
+  rtc_state = state;
+  last_save = millis();
+}
+
+void coulomb_add(int32_t micro_amps, uint32_t interval_us) {
+  int64_t charge = ((int64_t)micro_amps * interval_us + (micro_amps < 0 ? -500 : 500)) / 1000;
+  float seconds = interval_us * 1e-6f;
+  float alpha = seconds / ((float)COULOMB_EWMA_TAU_S + seconds);
+
+  portENTER_CRITICAL(&coulomb_spinlock);
+  if (charge > 0) {
+    state.discharged_ua_ms += charge;
+  } else {
+    state.charged_ua_ms -= charge;
+  }
+  state.used_ua_ms += charge;
+  if (state.used_ua_ms < 0) state.used_ua_ms = 0;
+  state.drain_a += alpha * (micro_amps * 1e-6f - state.drain_a);
+  state.crc = state_crc(state);
+  rtc_state = state;
+  portEXIT_CRITICAL(&coulomb_spinlock);
+}
+
+CoulombState coulomb_state() {
+  PersistedState s;
+  portENTER_CRITICAL(&coulomb_spinlock);
+  s = state;
+  portEXIT_CRITICAL(&coulomb_spinlock);
+
+  CoulombState out;
+  out.discharged_ah = (float)s.discharged_ua_ms / UA_MS_PER_AH;
+  out.charged_ah = (float)s.charged_ua_ms / UA_MS_PER_AH;
+  out.used_ah = (float)s.used_ua_ms / UA_MS_PER_AH;
+  out.drain_a = s.drain_a;
+
+  int64_t remaining = capacity_ua_ms - s.used_ua_ms;
+  if (remaining < 0) remaining = 0;
+  float remaining_ah = (float)remaining / UA_MS_PER_AH;
+  out.soc = (float)remaining / capacity_ua_ms;
+  out.time_to_empty_h = s.drain_a >= (float)COULOMB_MIN_DRAIN_A ? remaining_ah / s.drain_a : NAN;
+  return out;
+}
+
+void coulomb_mark_full() {
+  portENTER_CRITICAL(&coulomb_spinlock);
+  state.used_ua_ms = 0;
+  state.crc = state_crc(state);
+  rtc_state = state;
+  portEXIT_CRITICAL(&coulomb_spinlock);
+  coulomb_save();
+}
+
+void coulomb_persist() {
+  if (millis() - last_save >= COULOMB_SAVE_INTERVAL_MS) {
+    coulomb_save();
+  }
+}
+
+void coulomb_save() {
+  PersistedState s;
+  portENTER_CRITICAL(&coulomb_spinlock);
+  s = state;
+  portEXIT_CRITICAL(&coulomb_spinlock);
+
+  Preferences prefs;
+  if (prefs.begin(COULOMB_NVS_NAMESPACE, false)) {
+    prefs.putBytes(COULOMB_NVS_KEY, &s, sizeof(s));
+    prefs.end();
+  } else {
+    Serial.println("ERROR: Failed to open NVS for the coulomb counter");
+  }
+  last_save = millis();
+}
+
+size_t coulomb_json(char *out, size_t size) {
+  CoulombState s = coulomb_state();
+  int len;
+  if (isnan(s.time_to_empty_h)) {
+    len = snprintf(out, size,
+                   "{\"discharged_ah\":%.4f,\"charged_ah\":%.4f,\"used_ah\":%.4f,\"soc\":%.3f,"
+                   "\"drain_a\":%.4f,\"time_to_empty_h\":null}",
+                   s.discharged_ah, s.charged_ah, s.used_ah, s.soc, s.drain_a);
+  } else {
+    len = snprintf(out, size,
+                   "{\"discharged_ah\":%.4f,\"charged_ah\":%.4f,\"used_ah\":%.4f,\"soc\":%.3f,"
+                   "\"drain_a\":%.4f,\"time_to_empty_h\":%.1f}",
+                   s.discharged_ah, s.charged_ah, s.used_ah, s.soc, s.drain_a, s.time_to_empty_h);
+  }
+  return len < 0 ? 0 : min((size_t)len, size - 1);
+}
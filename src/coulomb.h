@@ -0,0 +1,76 @@
+// coulomb.h
+#ifndef COULOMB_H
+#define COULOMB_H
+
+#include <Arduino.h>
+
+/**
+ * Coulomb counter and drain-rate estimator
+ *
+ * The acquisition task integrates the mean current of every decimated
+ * interval over its exact length in microseconds, in integer uA * ms
+ * (enough for years at 100 A). Charge and discharge are
+ * accumulated separately (positive current = discharge). used_ah is the
+ * charge taken out since the battery was last marked full; it saturates at
+ * zero while charging, so a full battery does not "overfill".
+ *
+ * The drain rate is an exponentially weighted moving average of the current
+ * with time constant COULOMB_EWMA_TAU_S; time to empty is the remaining
+ * capacity (COULOMB_CAPACITY_AH - used_ah) divided by it.
+ *
+ * State is kept in RTC memory, which survives resets and deep sleep, and is
+ * copied to NVS every COULOMB_SAVE_INTERVAL_MS (and before OTA), which
+ * survives power loss. At boot the RTC copy wins if it is valid.
+ */
+
+// ===== CONFIGURATION =====
+#ifndef COULOMB_CAPACITY_AH
+#define COULOMB_CAPACITY_AH 70.0          // Usable battery capacity
+#endif
+#define COULOMB_EWMA_TAU_S 600.0          // Drain rate averaging time constant
+#define COULOMB_MIN_DRAIN_A 0.005         // Below this, time to empty is reported as unknown
+#define COULOMB_SAVE_INTERVAL_MS 900000   // NVS write interval (flash wear: ~100 writes/day)
+
+/**
+ * Snapshot of the counter
+ */
+struct CoulombState {
+  float discharged_ah;    // Total charge taken out since the counter was cleared
+  float charged_ah;       // Total charge put in since the counter was cleared
+  float used_ah;          // Charge taken out since the battery was last full
+  float drain_a;          // EWMA of the current, positive = discharge
+  float time_to_empty_h;  // Hours until used_ah reaches the capacity, NAN if not draining
+  float soc;              // State of charge 0..1 from used_ah and the capacity
+};
+
+/**
+ * Restore the state from RTC memory or NVS
+ */
+void coulomb_begin();
+
+/**
+ * Integrate the mean current of one interval. Called by the acquisition task.
+ * @param micro_amps Mean current of the interval in uA
+ * @param interval_us Length of the interval in microseconds
+ */
+void coulomb_add(int32_t micro_amps, uint32_t interval_us);
+
+// Copy the current state
+CoulombState coulomb_state();
+
+// Mark the battery as full (used_ah = 0)
+void coulomb_mark_full();
+
+// Write the state to NVS if COULOMB_SAVE_INTERVAL_MS has passed. Call from an I/O task.
+void coulomb_persist();
+
+// Write the state to NVS now (e.g. before a restart)
+void coulomb_save();
+
+/**
+ * Format the state as JSON for MQTT and the web API
+ * @return Length written
+ */
+size_t coulomb_json(char *out, size_t size);
+
+#endif
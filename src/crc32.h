@@ -0,0 +1,17 @@
+// crc32.h
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Standard CRC-32 (IEEE 802.3, same as zlib.crc32 in Python)
+ * @param crc CRC of the preceding data, 0 to start
+ * @param data Bytes to add
+ * @param len Number of bytes
+ * @return Updated CRC
+ */
+uint32_t crc32_update(uint32_t crc, const void *data, size_t len);
+
+#endif
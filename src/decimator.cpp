@@ -0,0 +1,94 @@
+#include "decimator.h"
+
+/**
+ * Integer square root (floor) of a 64-bit value
+ */
+static uint32_t isqrt64(uint64_t value) {
+  uint64_t result = 0;
+  uint64_t bit = 1ULL << 62;
+  while (bit > value) bit >>= 2;
+  while (bit != 0) {
+    if (value >= result + bit) {
+      value -= result + bit;
+      result = (result >> 1) + bit;
+    } else {
+      result >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)result;
+}
+
+void Decimator::begin(uint32_t interval) {
+  interval_us = interval;
+  started = false;
+  reset_accumulators();
+}
+
+void Decimator::reset_accumulators() {
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    acc[ch].sum = 0;
+    acc[ch].sum_sq = 0;
+    acc[ch].min = INT32_MAX;
+    acc[ch].max = INT32_MIN;
+    acc[ch].count = 0;
+  }
+}
+
+void Decimator::finish(DecimatedFrame &out) {
+  out.t_us = window_start_us;
+  out.interval_us = interval_us;
+
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    const Accumulator &a = acc[ch];
+    ChannelStats &stats = out.ch[ch];
+    stats.count = a.count > UINT16_MAX ? UINT16_MAX : a.count;
+
+    if (a.count == 0) {
+      stats.mean = 0;
+      stats.rms = 0;
+      stats.min = 0;
+      stats.max = 0;
+      continue;
+    }
+
+    // Round to nearest rather than toward zero
+    int64_t scaled = a.sum * DECIMATOR_SCALE;
+    int64_t half = a.count / 2;
+    stats.mean = (int32_t)((scaled >= 0 ? scaled + half : scaled - half) / (int64_t)a.count);
+    stats.rms = isqrt64((a.sum_sq << (2 * DECIMATOR_FRAC_BITS)) / a.count);
+    stats.min = a.min;
+    stats.max = a.max;
+  }
+}
+
+bool Decimator::add(const RawSample &sample, DecimatedFrame &out) {
+  bool closed = false;
+
+  if (!started) {
+    window_start_us = sample.t_us;
+    started = true;
+  } else if ((uint32_t)(sample.t_us - window_start_us) >= interval_us) {
+    finish(out);
+    reset_accumulators();
+    closed = true;
+
+    // Keep a steady cadence; after a long gap restart at this sample
+    window_start_us += interval_us;
+    if ((uint32_t)(sample.t_us - window_start_us) >= interval_us) {
+      window_start_us = sample.t_us;
+    }
+  }
+
+  if (sample.channel < NUM_CHANNELS) {
+    Accumulator &a = acc[sample.channel];
+    int32_t code = sampler_fine_code(sample);
+    a.sum += code;
+    a.sum_sq += (uint64_t)((int64_t)code * code);
+    if (code < a.min) a.min = code;
+    if (code > a.max) a.max = code;
+    a.count++;
+  }
+
+  return closed;
+}
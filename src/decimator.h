@@ -0,0 +1,109 @@
+// decimator.h
+#ifndef DECIMATOR_H
+#define DECIMATOR_H
+
+#include <stdint.h>
+#include "sampler.h"
+
+/**
+ * Boxcar decimator for oversampled ADC data
+ *
+ * Raw samples from the sampler ring are accumulated per channel over a fixed
+ * output interval. When the interval closes, one frame with min/max/mean/RMS
+ * per channel is produced. Interval boundaries follow the sample timestamps,
+ * so the output cadence is set by the ADC clock and not by how late the
+ * consumer drains the ring.
+ *
+ * Mean and RMS are integers in raw ADC codes with DECIMATOR_FRAC_BITS extra
+ * fractional bits, which keeps the resolution gained from oversampling.
+ * All statistics are in LSBs of the channel's reference gain
+ * (sampler_fine_code), so an auto-ranging channel can exceed int16.
+ */
+
+#define DECIMATOR_FRAC_BITS 4
+#define DECIMATOR_SCALE (1 << DECIMATOR_FRAC_BITS)  // Divide mean/rms by this to get codes
+
+/**
+ * Statistics of one channel over one output interval
+ */
+struct ChannelStats {
+  int32_t mean;    // Mean code * DECIMATOR_SCALE
+  int32_t rms;     // RMS code * DECIMATOR_SCALE
+  int32_t min;     // Smallest code seen
+  int32_t max;     // Largest code seen
+  uint16_t count;  // Number of raw samples reduced (0 = no data this interval)
+};
+
+/**
+ * One decimated output sample covering all channels
+ */
+struct DecimatedFrame {
+  uint32_t t_us;                    // micros() at the start of the interval
+  uint32_t interval_us;             // Interval length
+  ChannelStats ch[NUM_CHANNELS];
+};
+
+/**
+ * Interval mean rounded to a whole ADC code
+ */
+inline int16_t stats_code(const ChannelStats &stats) {
+  int32_t code = (stats.mean + DECIMATOR_SCALE / 2) >> DECIMATOR_FRAC_BITS;
+  if (code > INT16_MAX) code = INT16_MAX;
+  if (code < INT16_MIN) code = INT16_MIN;
+  return (int16_t)code;
+}
+
+/**
+ * Interval mean as an int16 code in the finest range that holds it
+ * @param max_shift Largest allowed shift (reference gain minus coarsest gain)
+ * @param shift Set to the factor-of-two steps the code was shifted down by
+ */
+inline int16_t stats_code_ranged(const ChannelStats &stats, uint8_t max_shift, uint8_t &shift) {
+  shift = 0;
+  for (;;) {
+    int bits = DECIMATOR_FRAC_BITS + shift;
+    int32_t code = (stats.mean + (1 << (bits - 1))) >> bits;
+    if ((code <= INT16_MAX && code >= INT16_MIN) || shift == max_shift) {
+      if (code > INT16_MAX) code = INT16_MAX;
+      if (code < INT16_MIN) code = INT16_MIN;
+      return (int16_t)code;
+    }
+    shift++;
+  }
+}
+
+class Decimator {
+public:
+  /**
+   * Reset the decimator
+   * @param interval_us Output interval in microseconds
+   */
+  void begin(uint32_t interval_us);
+
+  /**
+   * Feed one raw sample
+   * @param sample Raw sample from the sampler ring
+   * @param out Filled with the finished frame when an interval closes
+   * @return true if out holds a new frame (the sample itself starts the next interval)
+   */
+  bool add(const RawSample &sample, DecimatedFrame &out);
+
+private:
+  struct Accumulator {
+    int64_t sum;
+    uint64_t sum_sq;
+    int32_t min;
+    int32_t max;
+    uint32_t count;
+  };
+
+  void reset_accumulators();
+  void finish(DecimatedFrame &out);
+
+  Accumulator acc[NUM_CHANNELS];
+  uint32_t interval_us = 1000000;
+  uint32_t window_start_us = 0;
+  bool started = false;
+};
+
+#endif
@@ -0,0 +1,344 @@
+#include "file_export.h"
+#include "file_index.h"
+#include "sd_access.h"
+#include "sd_logger.h"
+#include "channels.h"
+#include "crc32.h"
+#include <RTClib.h>
+#include <memory>
+
+#define TAR_BLOCK 512
+#define EXPORT_MANIFEST_NAME "manifest.json"
+
+struct ExportFile {
+  char name[FILE_INDEX_NAME_LEN];
+  uint32_t size;          // Bytes in the archive, fixed at the request
+  uint32_t mtime;         // Midnight of the file's date
+  uint32_t crc = 0;       // CRC-32 of the bytes sent
+  bool ok = true;         // All bytes came from the card
+};
+
+enum ExportStage : uint8_t {
+  EXPORT_HEADER,    // Tar header of the current member
+  EXPORT_DATA,
+  EXPORT_PAD,       // Zeros up to the next block
+  EXPORT_END,       // Two zero blocks close the archive
+  EXPORT_DONE
+};
+
+struct ExportContext {
+  ExportFile files[EXPORT_MAX_FILES];
+  uint16_t count = 0;
+  uint32_t from = 0;          // YYYYMMDD
+  uint32_t to = 0;
+  uint32_t manifest_size = 0;
+
+  // Stream position
+  ExportStage stage = EXPORT_HEADER;
+  uint16_t member = 0;        // files[member]; count is the manifest
+  uint32_t pos = 0;           // Data bytes of the member sent
+  SdFile file;
+  uint16_t manifest_line = 0; // Next manifest line to format
+  char line[128];
+  size_t line_len = 0;
+  size_t line_pos = 0;
+  uint8_t block[TAR_BLOCK];
+  size_t block_len = 0;
+  size_t block_pos = 0;
+  uint8_t end_blocks = 0;
+
+  ~ExportContext() {
+    SdGuard guard;
+    file.close();
+  }
+};
+
+/**
+ * "YYYY-MM-DD" or "YYYYMMDD"
+ * @return YYYYMMDD, 0 if the text is not a date
+ */
+static uint32_t parse_date(const String &text) {
+  unsigned y, m, d;
+  char extra;
+  if (sscanf(text.c_str(), "%4u-%2u-%2u%c", &y, &m, &d, &extra) != 3 &&
+      sscanf(text.c_str(), "%4u%2u%2u%c", &y, &m, &d, &extra) != 3) {
+    return 0;
+  }
+  if (y < 2000 || m < 1 || m > 12 || d < 1 || d > 31) return 0;
+  return y * 10000 + m * 100 + d;
+}
+
+static uint32_t date_epoch(uint32_t date) {
+  return DateTime(date / 10000, date / 100 % 100, date % 100).unixtime();
+}
+
+static uint32_t padded(uint32_t size) {
+  return (size + TAR_BLOCK - 1) / TAR_BLOCK * TAR_BLOCK;
+}
+
+/**
+ * Channels of the channels parameter; bit NUM_CHANNELS selects the binary logs
+ * @return false for an unknown name
+ */
+static bool parse_channels(const String &text, uint32_t &mask) {
+  mask = 0;
+  int start = 0;
+  while (start <= (int)text.length()) {
+    int comma = text.indexOf(',', start);
+    if (comma < 0) comma = text.length();
+    String name = text.substring(start, comma);
+    name.trim();
+    start = comma + 1;
+    if (name.length() == 0) continue;
+    if (name.equalsIgnoreCase("raw")) {
+      mask |= 1UL << NUM_CHANNELS;
+      continue;
+    }
+    int channel = channel_find(name.c_str());
+    if (channel < 0) return false;
+    mask |= 1UL << channel;
+  }
+  return mask != 0;
+}
+
+/**
+ * One line of manifest.json; fixed length for a given file, so the size
+ * is known before the CRCs are
+ * @return Length, 0 past the last line
+ */
+static size_t format_manifest_line(const ExportContext &ctx, uint16_t i, char *out, size_t size) {
+  if (i == 0) {
+    return snprintf(out, size, "{\"from\":\"%04u-%02u-%02u\",\"to\":\"%04u-%02u-%02u\",\"files\":[\n",
+                    ctx.from / 10000, ctx.from / 100 % 100, ctx.from % 100,
+                    ctx.to / 10000, ctx.to / 100 % 100, ctx.to % 100);
+  }
+  if (i <= ctx.count) {
+    const ExportFile &f = ctx.files[i - 1];
+    return snprintf(out, size, "{\"name\":\"%s\",\"size\":%u,\"crc32\":\"%08x\",\"ok\":%d}%s\n",
+                    f.name, f.size, f.crc, f.ok ? 1 : 0, i < ctx.count ? "," : "");
+  }
+  if (i == ctx.count + 1) return snprintf(out, size, "]}\n");
+  return 0;
+}
+
+// ustar header of one member
+static void tar_header(uint8_t *out, const char *name, uint32_t size, uint32_t mtime) {
+  memset(out, 0, TAR_BLOCK);
+  strncpy((char *)out, name, 99);
+  memcpy(out + 100, "0000644", 7);       // Mode
+  memcpy(out + 108, "0000000", 7);       // uid
+  memcpy(out + 116, "0000000", 7);       // gid
+  snprintf((char *)out + 124, 12, "%011o", size);
+  snprintf((char *)out + 136, 12, "%011o", mtime);
+  memset(out + 148, ' ', 8);             // Checksum field counts as spaces
+  out[156] = '0';                        // Regular file
+  memcpy(out + 257, "ustar", 6);
+  memcpy(out + 263, "00", 2);
+  strcpy((char *)out + 265, "esp32");
+  strcpy((char *)out + 297, "esp32");
+
+  uint32_t sum = 0;
+  for (int i = 0; i < TAR_BLOCK; i++) sum += out[i];
+  snprintf((char *)out + 148, 7, "%06o", sum);
+  out[155] = ' ';
+}
+
+/**
+ * Copy up to len data bytes of the current member
+ * @return Bytes written
+ */
+static size_t read_member(ExportContext &ctx, uint8_t *buffer, size_t len) {
+  if (ctx.member == ctx.count) {
+    // Manifest, formatted line by line
+    size_t written = 0;
+    while (written < len) {
+      if (ctx.line_pos == ctx.line_len) {
+        ctx.line_len = format_manifest_line(ctx, ctx.manifest_line++, ctx.line, sizeof(ctx.line));
+        ctx.line_pos = 0;
+        if (ctx.line_len == 0) break;
+      }
+      size_t n = min(len - written, ctx.line_len - ctx.line_pos);
+      memcpy(buffer + written, ctx.line + ctx.line_pos, n);
+      ctx.line_pos += n;
+      written += n;
+    }
+    return written;
+  }
+
+  ExportFile &f = ctx.files[ctx.member];
+  len = min(len, (size_t)(f.size - ctx.pos));
+  int read = -1;
+  if (f.ok) {
+    SdGuard guard;
+    if (ctx.pos == 0) {
+      char path[FILE_INDEX_NAME_LEN + 1];
+      snprintf(path, sizeof(path), "/%s", f.name);
+      f.ok = ctx.file.open(path, O_READ);
+    }
+    if (f.ok) read = ctx.file.read(buffer, len);
+  }
+  if (read <= 0) {
+    // Gone or shorter than indexed: keep the archive length with zeros
+    f.ok = false;
+    memset(buffer, 0, len);
+    read = len;
+  }
+  f.crc = crc32_update(f.crc, buffer, read);
+  return read;
+}
+
+/**
+ * Fill the response buffer with the next part of the archive
+ */
+static size_t fill_export(ExportContext &ctx, uint8_t *buffer, size_t max_len) {
+  size_t written = 0;
+  while (written < max_len) {
+    if (ctx.block_pos < ctx.block_len) {
+      size_t n = min(max_len - written, ctx.block_len - ctx.block_pos);
+      memcpy(buffer + written, ctx.block + ctx.block_pos, n);
+      ctx.block_pos += n;
+      written += n;
+      continue;
+    }
+
+    bool manifest = ctx.member == ctx.count;
+    uint32_t size = manifest ? ctx.manifest_size : ctx.files[ctx.member].size;
+    switch (ctx.stage) {
+      case EXPORT_HEADER:
+        if (manifest) {
+          tar_header(ctx.block, EXPORT_MANIFEST_NAME, size, ctx.files[ctx.count - 1].mtime);
+        } else {
+          tar_header(ctx.block, ctx.files[ctx.member].name, size, ctx.files[ctx.member].mtime);
+        }
+        ctx.block_len = TAR_BLOCK;
+        ctx.block_pos = 0;
+        ctx.pos = 0;
+        ctx.stage = size > 0 ? EXPORT_DATA : EXPORT_PAD;
+        break;
+
+      case EXPORT_DATA: {
+        size_t n = read_member(ctx, buffer + written, min(max_len - written, (size_t)(size - ctx.pos)));
+        ctx.pos += n;
+        written += n;
+        if (ctx.pos >= size || n == 0) {
+          SdGuard guard;
+          ctx.file.close();
+          ctx.stage = EXPORT_PAD;
+        }
+        break;
+      }
+
+      case EXPORT_PAD:
+        memset(ctx.block, 0, TAR_BLOCK);
+        ctx.block_len = padded(size) - size;
+        ctx.block_pos = 0;
+        ctx.member++;
+        ctx.stage = ctx.member > ctx.count ? EXPORT_END : EXPORT_HEADER;
+        break;
+
+      case EXPORT_END:
+        memset(ctx.block, 0, TAR_BLOCK);
+        ctx.block_len = TAR_BLOCK;
+        ctx.block_pos = 0;
+        if (++ctx.end_blocks == 2) ctx.stage = EXPORT_DONE;
+        break;
+
+      case EXPORT_DONE:
+        return written;
+    }
+  }
+  return written;
+}
+
+/**
+ * Pick the logs of the request from the file index, sorted by date and name
+ * @return false if there are more than EXPORT_MAX_FILES
+ */
+static bool select_files(ExportContext &ctx, uint32_t mask) {
+  SdGuard guard;
+  for (size_t i = 0; i < file_index_count(); i++) {
+    FileIndexEntry entry;
+    if (!file_index_get(i, entry) || entry.date < ctx.from || entry.date > ctx.to) continue;
+    bool wanted = (entry.kind == FILE_KIND_TEXT_LOG && entry.channel < NUM_CHANNELS &&
+                   (mask & (1UL << entry.channel))) ||
+                  (entry.kind == FILE_KIND_BINARY_LOG && (mask & (1UL << NUM_CHANNELS)));
+    if (!wanted) continue;
+    if (ctx.count == EXPORT_MAX_FILES) return false;
+
+    ExportFile &f = ctx.files[ctx.count++];
+    strlcpy(f.name, entry.name, sizeof(f.name));
+    f.size = entry.size;
+    sd_logger_active_length(f.name, &f.size);
+    f.mtime = date_epoch(entry.date);
+  }
+
+  // Insertion sort, the index is in directory order
+  for (uint16_t i = 1; i < ctx.count; i++) {
+    for (uint16_t j = i; j > 0; j--) {
+      ExportFile &a = ctx.files[j - 1];
+      ExportFile &b = ctx.files[j];
+      int32_t order = (int32_t)(a.mtime - b.mtime);
+      if (order < 0 || (order == 0 && strcmp(a.name, b.name) <= 0)) break;
+      ExportFile swap = a;
+      a = b;
+      b = swap;
+    }
+  }
+  return true;
+}
+
+void send_export(AsyncWebServerRequest *request) {
+  std::shared_ptr<ExportContext> ctx = std::make_shared<ExportContext>();
+  ctx->from = request->hasParam("from") ? parse_date(request->getParam("from")->value()) : 0;
+  ctx->to = request->hasParam("to") ? parse_date(request->getParam("to")->value()) : ctx->from;
+  if (ctx->from == 0 || ctx->to < ctx->from) {
+    request->send(400, "text/plain", "from (and to) must be dates, YYYY-MM-DD");
+    return;
+  }
+  if ((date_epoch(ctx->to) - date_epoch(ctx->from)) / 86400 >= EXPORT_MAX_DAYS) {
+    request->send(400, "text/plain", "At most " + String(EXPORT_MAX_DAYS) + " days per export");
+    return;
+  }
+
+  uint32_t mask = (1UL << (NUM_CHANNELS + 1)) - 1;
+  if (request->hasParam("channels") && !parse_channels(request->getParam("channels")->value(), mask)) {
+    request->send(400, "text/plain", "Unknown channel in channels");
+    return;
+  }
+  if (!file_index_complete()) {
+    request->send(503, "text/plain", "File index incomplete, download files one by one");
+    return;
+  }
+  if (!select_files(*ctx, mask)) {
+    request->send(400, "text/plain", "More than " + String(EXPORT_MAX_FILES) + " files, shorten the range");
+    return;
+  }
+  if (ctx->count == 0) {
+    request->send(404, "text/plain", "No logs in that range");
+    return;
+  }
+
+  // Manifest lines have a fixed length, so the archive length is known now
+  uint32_t length = 2 * TAR_BLOCK;
+  for (uint16_t i = 0; i < ctx->count; i++) {
+    length += TAR_BLOCK + padded(ctx->files[i].size);
+  }
+  char line[sizeof(ctx->line)];
+  for (uint16_t i = 0;; i++) {
+    size_t n = format_manifest_line(*ctx, i, line, sizeof(line));
+    if (n == 0) break;
+    ctx->manifest_size += n;
+  }
+  length += TAR_BLOCK + padded(ctx->manifest_size);
+
+  // The lambda owns the context; the open file closes when the response is freed
+  AsyncWebServerResponse *response = request->beginResponse("application/x-tar", length,
+    [ctx](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      return fill_export(*ctx, buffer, max_len);
+    });
+
+  char disposition[80];
+  snprintf(disposition, sizeof(disposition), "attachment; filename=\"battery %u-%u.tar\"", ctx->from, ctx->to);
+  response->addHeader("Content-Disposition", disposition);
+  request->send(response);
+}
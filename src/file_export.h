@@ -0,0 +1,44 @@
+// file_export.h
+#ifndef FILE_EXPORT_H
+#define FILE_EXPORT_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+/**
+ * Multi-day archive export for fleet collection
+ *
+ * GET /export?from=2025-03-07&to=2025-03-13&channels=Amps,Volts,Raw
+ * answers one uncompressed POSIX tar archive with every daily log of those
+ * days: the text logs of the listed channels and, for "Raw", the binary
+ * logs. Without channels all of them are included; to defaults to from.
+ * The last member, manifest.json, lists name, size and CRC-32 of every
+ * file in the archive:
+ *   {"from":"2025-03-07","to":"2025-03-13","files":[
+ *   {"name":"Amps 2025-03-07.txt","size":86400,"crc32":"1c291ca3","ok":1},
+ *   ...]}
+ * "ok":0 marks a file that could not be read to its end; its missing bytes
+ * are zeros.
+ *
+ * The files are picked from the in-RAM file index (file_index.h), so no
+ * directory is read. Sizes are fixed when the request arrives, which makes
+ * the archive length known up front: the response has a Content-Length
+ * and data written afterwards is left for the next export. The body is
+ * read from the card as the client pulls it, one SD access per chunk, like
+ * /download.
+ *
+ * Nothing is compressed on the device: deflate needs far more RAM than is
+ * free next to the logger. The delta-coded binary logs ("Raw") are the
+ * compact form of the same data.
+ */
+
+#define EXPORT_MAX_FILES 96           // Files in one archive (31 days of two text logs and the binary log)
+#define EXPORT_MAX_DAYS 31
+
+/**
+ * Send the archive
+ * @param request Web request with from, to and channels parameters
+ */
+void send_export(AsyncWebServerRequest *request);
+
+#endif
@@ -0,0 +1,395 @@
+#include "file_index.h"
+#include "sd_access.h"
+#include "sd_logger.h"
+
+// ===== DAILY RECORDS =====
+
+// Daily files of a record, in listing order
+static const uint8_t SLOT_TEXT_LOG = 0;                     // + channel
+static const uint8_t SLOT_TEXT_INDEX = NUM_CHANNELS;        // + channel
+static const uint8_t SLOT_RAW_LOG = 2 * NUM_CHANNELS;
+static const uint8_t SLOT_RAW_INDEX = SLOT_RAW_LOG + 1;
+static const uint8_t SLOT_MINUTE_ROLLUP = SLOT_RAW_LOG + 2;
+static const uint8_t SLOT_EVENTS = SLOT_RAW_LOG + 3;
+static const uint8_t SLOT_HOUR_ROLLUP = SLOT_RAW_LOG + 4;   // Monthly, kept on the 1st
+static const uint8_t NUM_SLOTS = SLOT_RAW_LOG + 5;
+static_assert(NUM_SLOTS <= 32, "daily slots must fit the presence mask");
+
+// Slots that make a date show up in file_index_days()
+static const uint32_t LOG_SLOTS = ((1UL << NUM_CHANNELS) - 1) | (1UL << SLOT_RAW_LOG);
+
+// The daily files of one date; names are rebuilt from the date
+struct DayRecord {
+  uint32_t date;                        // YYYYMMDD
+  uint32_t present;                     // Bit per slot
+  uint32_t partial;                     // Slots whose stats miss data written before boot
+  uint32_t size[NUM_SLOTS];
+  uint32_t samples[NUM_CHANNELS + 1];   // Text logs, then the raw log
+  float min[NUM_CHANNELS];
+  float max[NUM_CHANNELS];
+};
+
+static DayRecord days[FILE_INDEX_DAYS];         // Ascending by date
+static size_t day_count = 0;
+static FileIndexEntry others[FILE_INDEX_OTHER_ENTRIES];
+static size_t other_count = 0;
+static size_t file_count = 0;
+static bool complete = true;
+
+// The logger, the web server and the MQTT task use the index from different tasks
+static SemaphoreHandle_t index_mutex = NULL;
+
+struct IndexLock {
+  IndexLock() { xSemaphoreTake(index_mutex, portMAX_DELAY); }
+  ~IndexLock() { xSemaphoreGive(index_mutex); }
+};
+
+// A file of the index: a slot of a day record or an other entry
+struct FileRef {
+  DayRecord *day;
+  uint8_t slot;
+  FileIndexEntry *other;
+};
+
+static const char *base_name(const char *name) {
+  return name[0] == '/' ? name + 1 : name;
+}
+
+/**
+ * Parse "YYYY-MM-DD" (or "YYYY-MM" without a day) at the given position
+ * @return YYYYMMDD (the 1st for a month) or 0 if the text is not a date
+ */
+static uint32_t parse_date(const char *text, bool with_day) {
+  int length = with_day ? 10 : 7;
+  for (int i = 0; i < length; i++) {
+    bool dash = i == 4 || i == 7;
+    if (dash ? text[i] != '-' : !isdigit((unsigned char)text[i])) return 0;
+  }
+  uint32_t year = atoi(text);
+  uint32_t month = atoi(text + 5);
+  uint32_t day = with_day ? atoi(text + 8) : 1;
+  return year * 10000 + month * 100 + day;
+}
+
+static void slot_affixes(uint8_t slot, const char *&prefix, const char *&suffix) {
+  if (slot < SLOT_TEXT_INDEX) {
+    prefix = sd_logger_channel_prefix(slot - SLOT_TEXT_LOG);
+    suffix = ".txt";
+  } else if (slot < SLOT_RAW_LOG) {
+    prefix = sd_logger_channel_prefix(slot - SLOT_TEXT_INDEX);
+    suffix = ".idx";
+  } else if (slot == SLOT_RAW_LOG || slot == SLOT_RAW_INDEX) {
+    prefix = "Raw ";
+    suffix = slot == SLOT_RAW_LOG ? ".bin" : ".idx";
+  } else if (slot == SLOT_MINUTE_ROLLUP || slot == SLOT_HOUR_ROLLUP) {
+    prefix = slot == SLOT_MINUTE_ROLLUP ? "Minute " : "Hour ";
+    suffix = ".rol";
+  } else {
+    prefix = "Events ";
+    suffix = ".evt";
+  }
+}
+
+/**
+ * Recognise the name of a daily file
+ * @return false for any other file
+ */
+static bool parse_daily(const char *name, uint32_t &date, uint8_t &slot) {
+  size_t len = strlen(name);
+  for (uint8_t s = 0; s < NUM_SLOTS; s++) {
+    const char *prefix, *suffix;
+    slot_affixes(s, prefix, suffix);
+    size_t prefix_len = strlen(prefix);
+    size_t date_len = s == SLOT_HOUR_ROLLUP ? 7 : 10;
+    if (len != prefix_len + date_len + strlen(suffix) ||
+        strncmp(name, prefix, prefix_len) != 0 ||
+        strcmp(name + prefix_len + date_len, suffix) != 0) {
+      continue;
+    }
+    date = parse_date(name + prefix_len, s != SLOT_HOUR_ROLLUP);
+    slot = s;
+    return date != 0;
+  }
+  return false;
+}
+
+static void format_daily(uint32_t date, uint8_t slot, char *out, size_t size) {
+  const char *prefix, *suffix;
+  slot_affixes(slot, prefix, suffix);
+  unsigned year = date / 10000, month = date / 100 % 100, day = date % 100;
+  if (slot == SLOT_HOUR_ROLLUP) {
+    snprintf(out, size, "%s%04u-%02u%s", prefix, year, month, suffix);
+  } else {
+    snprintf(out, size, "%s%04u-%02u-%02u%s", prefix, year, month, day, suffix);
+  }
+}
+
+// Call with the index locked; fills an entry the way the listing reports it
+static void fill_daily(const DayRecord &day, uint8_t slot, FileIndexEntry &out) {
+  memset(&out, 0, sizeof(out));
+  format_daily(day.date, slot, out.name, sizeof(out.name));
+  out.size = day.size[slot];
+  out.flags = (day.partial >> slot) & 1 ? FILE_INDEX_PARTIAL : 0;
+  out.kind = FILE_KIND_OTHER;
+  out.channel = FILE_INDEX_NO_CHANNEL;
+  if (slot < SLOT_TEXT_INDEX) {
+    uint8_t ch = slot - SLOT_TEXT_LOG;
+    out.kind = FILE_KIND_TEXT_LOG;
+    out.date = day.date;
+    out.channel = ch;
+    out.samples = day.samples[ch];
+    out.min = day.min[ch];
+    out.max = day.max[ch];
+  } else if (slot == SLOT_RAW_LOG) {
+    out.kind = FILE_KIND_BINARY_LOG;
+    out.date = day.date;
+    out.samples = day.samples[NUM_CHANNELS];
+  }
+}
+
+// ===== LOOKUP =====
+
+/**
+ * Find a file and optionally create its entry (call with the index locked)
+ * @param created Set when the entry was added
+ * @return false if it is not indexed (and, with create, did not fit)
+ */
+static bool lookup_locked(const char *name, bool is_dir, bool create, FileRef &ref, bool &created) {
+  created = false;
+  ref.day = NULL;
+  ref.other = NULL;
+
+  uint32_t date;
+  uint8_t slot;
+  if (!is_dir && parse_daily(name, date, slot)) {
+    size_t pos = 0;
+    while (pos < day_count && days[pos].date < date) pos++;
+    if (pos == day_count || days[pos].date != date) {
+      if (!create) return false;
+      if (day_count >= FILE_INDEX_DAYS) {
+        complete = false;
+        return false;
+      }
+      memmove(&days[pos + 1], &days[pos], (day_count - pos) * sizeof(DayRecord));
+      memset(&days[pos], 0, sizeof(DayRecord));
+      days[pos].date = date;
+      day_count++;
+    }
+    DayRecord &day = days[pos];
+    uint32_t bit = 1UL << slot;
+    if (!(day.present & bit)) {
+      if (!create) return false;
+      day.present |= bit;
+      day.partial &= ~bit;
+      day.size[slot] = 0;
+      if (slot < SLOT_TEXT_INDEX) day.samples[slot - SLOT_TEXT_LOG] = 0;
+      if (slot == SLOT_RAW_LOG) day.samples[NUM_CHANNELS] = 0;
+      file_count++;
+      created = true;
+    }
+    ref.day = &day;
+    ref.slot = slot;
+    return true;
+  }
+
+  for (size_t i = 0; i < other_count; i++) {
+    if (strcmp(others[i].name, name) == 0) {
+      ref.other = &others[i];
+      return true;
+    }
+  }
+  if (!create) return false;
+  if (other_count >= FILE_INDEX_OTHER_ENTRIES || strlen(name) >= FILE_INDEX_NAME_LEN) {
+    complete = false;
+    return false;
+  }
+  FileIndexEntry &entry = others[other_count++];
+  memset(&entry, 0, sizeof(entry));
+  strcpy(entry.name, name);
+  entry.kind = is_dir ? FILE_KIND_DIR : FILE_KIND_OTHER;
+  entry.channel = FILE_INDEX_NO_CHANNEL;
+  file_count++;
+  created = true;
+  ref.other = &entry;
+  return true;
+}
+
+static void set_size(FileRef &ref, uint32_t size) {
+  if (ref.day) {
+    ref.day->size[ref.slot] = size;
+  } else {
+    ref.other->size = size;
+  }
+}
+
+static void set_partial(FileRef &ref) {
+  if (ref.day) {
+    ref.day->partial |= 1UL << ref.slot;
+  } else {
+    ref.other->flags |= FILE_INDEX_PARTIAL;
+  }
+}
+
+static void add_sample(FileRef &ref, float value) {
+  if (ref.other) {
+    ref.other->samples++;
+    return;
+  }
+  DayRecord &day = *ref.day;
+  if (ref.slot == SLOT_RAW_LOG) {
+    day.samples[NUM_CHANNELS]++;
+  } else if (ref.slot < SLOT_TEXT_INDEX) {
+    uint8_t ch = ref.slot - SLOT_TEXT_LOG;
+    if (!isnan(value)) {
+      if (day.samples[ch] == 0 || value < day.min[ch]) day.min[ch] = value;
+      if (day.samples[ch] == 0 || value > day.max[ch]) day.max[ch] = value;
+    }
+    day.samples[ch]++;
+  }
+}
+
+/**
+ * Read the root directory into the index
+ * @param rebuild Drop all entries first; otherwise only files missing from
+ *                the index are added and the others keep their stats
+ */
+static void scan_directory(bool rebuild) {
+  SdGuard guard;
+  IndexLock lock;
+  if (rebuild) {
+    day_count = 0;
+    other_count = 0;
+    file_count = 0;
+  }
+  complete = true;
+
+  SdFile dir;
+  if (!dir.open("/", O_READ)) {
+    complete = false;
+    return;
+  }
+
+  SdFile file;
+  while (file.openNext(&dir, O_READ)) {
+    char name[64];
+    file.getName(name, sizeof(name));
+    bool is_dir = file.isDir();
+    uint32_t size = is_dir ? 0 : file.fileSize();
+    file.close();
+
+    FileRef ref;
+    bool created;
+    if (lookup_locked(name, is_dir, true, ref, created) && created) {
+      sd_logger_active_length(name, &size);  // Pre-allocated logs
+      set_size(ref, size);
+      set_partial(ref);
+    }
+  }
+  dir.close();
+}
+
+// ===== PUBLIC =====
+
+void file_index_begin() {
+  if (index_mutex == NULL) {
+    index_mutex = xSemaphoreCreateMutex();
+  }
+  scan_directory(true);
+  Serial.printf("File index: %u files on %u days%s\n", (unsigned)file_count, (unsigned)day_count,
+                complete ? "" : " (incomplete)");
+}
+
+void file_index_touch(const char *name, uint32_t size) {
+  name = base_name(name);
+  if (index_mutex == NULL) return;
+  IndexLock lock;
+  FileRef ref;
+  bool created;
+  if (lookup_locked(name, false, true, ref, created)) {
+    set_size(ref, size);
+  }
+}
+
+void file_index_sample(const char *name, uint32_t size, float value) {
+  name = base_name(name);
+  if (index_mutex == NULL) return;
+  IndexLock lock;
+  FileRef ref;
+  bool created;
+  if (lookup_locked(name, false, true, ref, created)) {
+    set_size(ref, size);
+    add_sample(ref, value);
+  }
+}
+
+void file_index_remove(const char *name) {
+  name = base_name(name);
+  if (index_mutex == NULL) return;
+  bool rescan;
+  {
+    IndexLock lock;
+    FileRef ref;
+    bool created;
+    if (lookup_locked(name, false, false, ref, created)) {
+      if (ref.day) {
+        ref.day->present &= ~(1UL << ref.slot);
+        if (ref.day->present == 0) {
+          size_t pos = ref.day - days;
+          memmove(&days[pos], &days[pos + 1], (day_count - pos - 1) * sizeof(DayRecord));
+          day_count--;
+        }
+      } else {
+        // Keep the directory order of the remaining entries
+        size_t pos = ref.other - others;
+        memmove(&others[pos], &others[pos + 1], (other_count - pos - 1) * sizeof(FileIndexEntry));
+        other_count--;
+      }
+      file_count--;
+    }
+    rescan = !complete;
+  }
+  // Files that did not fit may have room now
+  if (rescan) scan_directory(false);
+}
+
+bool file_index_complete() {
+  return complete;
+}
+
+size_t file_index_count() {
+  return file_count;
+}
+
+bool file_index_get(size_t i, FileIndexEntry &out) {
+  if (index_mutex == NULL) return false;
+  IndexLock lock;
+  for (size_t d = 0; d < day_count; d++) {
+    const DayRecord &day = days[d];
+    size_t n = __builtin_popcount(day.present);
+    if (i >= n) {
+      i -= n;
+      continue;
+    }
+    for (uint8_t slot = 0; slot < NUM_SLOTS; slot++) {
+      if (!((day.present >> slot) & 1)) continue;
+      if (i-- == 0) {
+        fill_daily(day, slot, out);
+        return true;
+      }
+    }
+  }
+  if (i >= other_count) return false;
+  out = others[i];
+  return true;
+}
+
+size_t file_index_days(uint32_t *dates, size_t max) {
+  size_t count = 0;
+  if (index_mutex == NULL) return 0;
+  IndexLock lock;
+  // Records are ascending; past max the newest are dropped
+  for (size_t d = 0; d < day_count && count < max; d++) {
+    if (days[d].present & LOG_SLOTS) dates[count++] = days[d].date;
+  }
+  return count;
+}
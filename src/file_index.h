@@ -0,0 +1,108 @@
+// file_index.h
+#ifndef FILE_INDEX_H
+#define FILE_INDEX_H
+
+#include <Arduino.h>
+
+/**
+ * In-RAM index of the files in the SD card root
+ *
+ * Built once at boot with a single directory walk, then kept current by the
+ * writers: the logger reports every append (size and value), deletions go
+ * through file_index_remove(). Listings and "which days have data" queries
+ * are answered from RAM without touching the card.
+ *
+ * Log file names are parsed into date and channel ("Amps 2025-03-07.txt",
+ * "Raw 2025-03-07.bin", ...). Min/max/sample count are collected from the
+ * logger, so they only cover what was written since boot; files that
+ * already existed at boot are flagged FILE_INDEX_PARTIAL.
+ *
+ * The daily files of one date (text logs and their .idx, the raw log and
+ * its .idx, the minute rollup, the events file, and the monthly hour
+ * rollup on the 1st) share one compact record without names, which are
+ * rebuilt from the date. FILE_INDEX_DAYS such records cover a year of
+ * logging; anything else goes into FILE_INDEX_OTHER_ENTRIES named entries.
+ * Entries are listed by date, then the other files.
+ *
+ * If the root holds more than that the index is marked incomplete and
+ * callers fall back to reading the directory. Deleting files rescans the
+ * directory, so the index recovers once old days are removed.
+ */
+
+#ifndef FILE_INDEX_DAYS
+#define FILE_INDEX_DAYS 366           // Days with log files
+#endif
+#define FILE_INDEX_OTHER_ENTRIES 32   // Directories and files that are not daily logs
+#define FILE_INDEX_NAME_LEN 32
+
+enum FileKind : uint8_t {
+  FILE_KIND_OTHER,
+  FILE_KIND_DIR,
+  FILE_KIND_TEXT_LOG,     // "<Channel> YYYY-MM-DD.txt"
+  FILE_KIND_BINARY_LOG    // "Raw YYYY-MM-DD.bin"
+};
+
+#define FILE_INDEX_NO_CHANNEL 0xFF
+#define FILE_INDEX_PARTIAL 0x01       // Stats do not cover data written before boot
+
+struct FileIndexEntry {
+  char name[FILE_INDEX_NAME_LEN];
+  uint32_t date;          // YYYYMMDD parsed from the name, 0 if none
+  uint32_t size;          // Bytes of data (real length for pre-allocated logs)
+  uint32_t samples;       // Values appended since boot
+  float min;              // Smallest value appended since boot
+  float max;              // Largest value appended since boot
+  FileKind kind;
+  uint8_t channel;        // SampleChannel of text logs, FILE_INDEX_NO_CHANNEL otherwise
+  uint8_t flags;          // FILE_INDEX_*
+};
+
+/**
+ * Build the index from the root directory. Call after the SD card is up.
+ */
+void file_index_begin();
+
+/**
+ * Create or update the entry of a file
+ * @param name File name in the root directory (a leading '/' is ignored)
+ * @param size Current data length
+ */
+void file_index_touch(const char *name, uint32_t size);
+
+/**
+ * Record one appended value
+ * @param name File name in the root directory
+ * @param size Data length after the append
+ * @param value Appended value, NAN to only count the sample
+ */
+void file_index_sample(const char *name, uint32_t size, float value);
+
+/**
+ * Drop a deleted file. If the index was incomplete the directory is read
+ * again to pick up files that did not fit before.
+ */
+void file_index_remove(const char *name);
+
+// False if the root has more files than the index holds
+bool file_index_complete();
+
+// Number of entries
+size_t file_index_count();
+
+/**
+ * Copy one entry
+ * @param i Position, 0..file_index_count()-1
+ * @param out Filled with the entry
+ * @return false if i is out of range
+ */
+bool file_index_get(size_t i, FileIndexEntry &out);
+
+/**
+ * Distinct dates that have log files, ascending
+ * @param dates Output array of YYYYMMDD values
+ * @param max Capacity of dates
+ * @return Number of dates written
+ */
+size_t file_index_days(uint32_t *dates, size_t max);
+
+#endif
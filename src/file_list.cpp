@@ -0,0 +1,199 @@
+#include "file_list.h"
+#include "sd_access.h"
+#include "sd_logger.h"
+#include "file_index.h"
+#include <memory>
+#include <stdarg.h>
+
+struct FileListContext {
+  SdFile dir;             // Directory being read (card listings only)
+  bool from_index = false;  // Root listing served from the file index
+  uint32_t index_pos = 0;   // Next file index entry
+  String path;            // Directory path ending with '/'
+  uint32_t offset = 0;
+  uint32_t limit = 0;
+  uint32_t sent = 0;      // Entries written so far
+  bool started = false;   // Opening part written
+  bool finished = false;  // Closing part queued
+  char line[256];         // Formatted text not yet copied out
+  size_t line_len = 0;
+  size_t line_pos = 0;
+
+  ~FileListContext() {
+    SdGuard guard;
+    dir.close();
+  }
+};
+
+/**
+ * Append a JSON string with quotes and escapes
+ */
+static size_t json_string(char *out, size_t size, const char *text) {
+  size_t len = 0;
+  if (len < size) out[len++] = '"';
+  for (; *text && len + 7 < size; text++) {
+    unsigned char c = *text;
+    if (c == '"' || c == '\\') {
+      out[len++] = '\\';
+      out[len++] = c;
+    } else if (c < 0x20) {
+      len += snprintf(out + len, size - len, "\\u%04x", c);
+    } else {
+      out[len++] = c;
+    }
+  }
+  if (len < size) out[len++] = '"';
+  return len;
+}
+
+/**
+ * Append formatted text to the line buffer, never past its end
+ */
+static void line_printf(FileListContext &ctx, const char *format, ...) {
+  if (ctx.line_len >= sizeof(ctx.line) - 1) return;
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(ctx.line + ctx.line_len, sizeof(ctx.line) - ctx.line_len, format, args);
+  va_end(args);
+  if (n > 0) ctx.line_len = min(ctx.line_len + n, sizeof(ctx.line) - 1);
+}
+
+/**
+ * Fetch the next entry from the file index or the card
+ * @param name Receives the full file name (index names may be shorter than card names)
+ * @return false when the directory has no more entries
+ */
+static bool next_entry(FileListContext &ctx, FileIndexEntry &entry, char (&name)[64]) {
+  if (ctx.from_index) {
+    if (!file_index_get(ctx.index_pos++, entry)) return false;
+    strcpy(name, entry.name);
+    return true;
+  }
+
+  SdGuard guard;
+  SdFile file;
+  if (!file.openNext(&ctx.dir, O_READ)) return false;
+
+  memset(&entry, 0, sizeof(entry));
+  file.getName(name, sizeof(name));
+  entry.kind = file.isDir() ? FILE_KIND_DIR : FILE_KIND_OTHER;
+  entry.channel = FILE_INDEX_NO_CHANNEL;
+  entry.size = file.fileSize();
+  file.close();
+
+  if (entry.kind != FILE_KIND_DIR) {
+    char full_path[96];
+    snprintf(full_path, sizeof(full_path), "%s%s", ctx.path.c_str(), name);
+    sd_logger_active_length(full_path, &entry.size);  // Pre-allocated logs
+  }
+  return true;
+}
+
+/**
+ * Read the next directory entry into the context's line buffer
+ * @return false when the listing is complete
+ */
+static bool next_line(FileListContext &ctx) {
+  ctx.line_len = 0;
+  ctx.line_pos = 0;
+
+  if (!ctx.started) {
+    ctx.started = true;
+    line_printf(ctx, "{\"dir\":");
+    ctx.line_len += json_string(ctx.line + ctx.line_len, sizeof(ctx.line) - ctx.line_len, ctx.path.c_str());
+    line_printf(ctx, ",\"offset\":%u,\"entries\":[", ctx.offset);
+    return true;
+  }
+  if (ctx.finished) return false;
+
+  FileIndexEntry entry;
+  char name[64];
+  bool have_entry = next_entry(ctx, entry, name);
+  if (!have_entry || ctx.sent >= ctx.limit) {
+    // One entry past the page tells whether there is more
+    ctx.finished = true;
+    line_printf(ctx, "],\"more\":%s}\n", have_entry ? "true" : "false");
+    return true;
+  }
+
+  bool is_dir = entry.kind == FILE_KIND_DIR;
+  line_printf(ctx, "%s{\"name\":", ctx.sent > 0 ? "," : "");
+  ctx.line_len += json_string(ctx.line + ctx.line_len, sizeof(ctx.line) - ctx.line_len, name);
+  line_printf(ctx, ",\"dir\":%s,\"size\":%u", is_dir ? "true" : "false", entry.size);
+
+  // Log metadata is only known for entries from the index
+  if (entry.date) {
+    line_printf(ctx, ",\"date\":\"%04u-%02u-%02u\"",
+                entry.date / 10000, entry.date / 100 % 100, entry.date % 100);
+  }
+  if (entry.channel < NUM_CHANNELS) {
+    line_printf(ctx, ",\"channel\":\"%s\"", channel_table[entry.channel].name);
+  }
+  if (entry.samples > 0) {
+    line_printf(ctx, ",\"samples\":%u", entry.samples);
+    if (entry.kind == FILE_KIND_TEXT_LOG) {
+      line_printf(ctx, ",\"min\":%.3f,\"max\":%.3f", entry.min, entry.max);
+    }
+    if (entry.flags & FILE_INDEX_PARTIAL) {
+      line_printf(ctx, ",\"partial\":true");
+    }
+  }
+  line_printf(ctx, "}");
+  ctx.sent++;
+  return true;
+}
+
+void send_file_list(AsyncWebServerRequest *request) {
+  std::shared_ptr<FileListContext> ctx = std::make_shared<FileListContext>();
+  ctx->path = request->hasParam("dir") ? request->getParam("dir")->value() : String("/");
+  if (!ctx->path.endsWith("/")) ctx->path += "/";
+  ctx->offset = request->hasParam("offset") ? request->getParam("offset")->value().toInt() : 0;
+  ctx->limit = request->hasParam("limit") ? request->getParam("limit")->value().toInt() : FILE_LIST_DEFAULT_LIMIT;
+  if (ctx->limit == 0 || ctx->limit > FILE_LIST_MAX_LIMIT) ctx->limit = FILE_LIST_MAX_LIMIT;
+
+  if (ctx->path == "/" && file_index_complete()) {
+    // The root is indexed in RAM, no card access needed
+    ctx->from_index = true;
+    ctx->index_pos = ctx->offset;
+  } else {
+    SdGuard guard;
+    if (!ctx->dir.open(ctx->path.c_str(), O_READ) || !ctx->dir.isDir()) {
+      request->send(404, "application/json", "{\"error\":\"Failed to open directory\"}");
+      return;
+    }
+    // Skip to the requested page
+    SdFile entry;
+    for (uint32_t i = 0; i < ctx->offset && entry.openNext(&ctx->dir, O_READ); i++) {
+      entry.close();
+    }
+  }
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+    [ctx](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      size_t len = 0;
+      while (len < max_len) {
+        if (ctx->line_pos == ctx->line_len && !next_line(*ctx)) break;
+        size_t n = min(ctx->line_len - ctx->line_pos, max_len - len);
+        memcpy(buffer + len, ctx->line + ctx->line_pos, n);
+        ctx->line_pos += n;
+        len += n;
+      }
+      return len;
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
+
+void send_day_list(AsyncWebServerRequest *request) {
+  std::unique_ptr<uint32_t[]> dates(new uint32_t[FILE_INDEX_DAYS]);
+  size_t count = file_index_days(dates.get(), FILE_INDEX_DAYS);
+
+  AsyncResponseStream *response = request->beginResponseStream("application/json");
+  response->print("{\"days\":[");
+  for (size_t i = 0; i < count; i++) {
+    response->printf("%s\"%04u-%02u-%02u\"", i ? "," : "",
+                     dates[i] / 10000, dates[i] / 100 % 100, dates[i] % 100);
+  }
+  response->printf("],\"complete\":%s}", file_index_complete() ? "true" : "false");
+  request->send(response);
+}
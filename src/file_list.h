@@ -0,0 +1,39 @@
+// file_list.h
+#ifndef FILE_LIST_H
+#define FILE_LIST_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+/**
+ * JSON directory listing for the web UI
+ *
+ * GET /api/files?dir=/&offset=0&limit=100 answers
+ *   {"dir":"/","offset":0,"entries":[{"name":"...","dir":false,"size":123},...],"more":true}
+ *
+ * The root directory is served from the in-RAM file index (file_index.h),
+ * which adds date, channel and min/max/samples for log files. Other
+ * directories are read from the card with openNext() while the chunked
+ * response is sent, one entry at a time, so memory use is the same for any
+ * number of files. "more" tells the client to ask for the next page.
+ *
+ * GET /api/days answers {"days":["2025-03-07",...],"complete":true} from
+ * the file index.
+ */
+
+#define FILE_LIST_DEFAULT_LIMIT 100
+#define FILE_LIST_MAX_LIMIT 500
+
+/**
+ * Send one page of a directory listing
+ * @param request Web request with dir, offset and limit parameters
+ */
+void send_file_list(AsyncWebServerRequest *request);
+
+/**
+ * Send the dates that have log files
+ * @param request Web request
+ */
+void send_day_list(AsyncWebServerRequest *request);
+
+#endif
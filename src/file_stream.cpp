@@ -0,0 +1,227 @@
+#include "file_stream.h"
+#include "binlog.h"
+#include "scaler.h"
+#include "sd_access.h"
+#include "sd_logger.h"
+#include <memory>
+
+struct FileStreamContext {
+  SdFile file;
+  uint32_t start = 0;   // First byte sent
+  uint32_t length = 0;  // Bytes in the response body
+
+  ~FileStreamContext() {
+    SdGuard guard;
+    file.close();
+  }
+};
+
+const char *file_content_type(const String &filename) {
+  if (filename.endsWith(".csv")) return "text/csv";
+  if (filename.endsWith(".json")) return "application/json";
+  if (filename.endsWith(".bin")) return "application/octet-stream";
+  return "text/plain";
+}
+
+/**
+ * Parse a single "bytes=first-last" range
+ * @param header Value of the Range header
+ * @param size File size
+ * @param start Set to the first byte
+ * @param end Set to one past the last byte
+ * @return 1 for a valid range, 0 to ignore the header, -1 if unsatisfiable
+ */
+static int parse_range(const String &header, uint32_t size, uint32_t &start, uint32_t &end) {
+  if (!header.startsWith("bytes=") || header.indexOf(',') >= 0) {
+    return 0;  // Other units and multipart ranges: send the whole file
+  }
+
+  String spec = header.substring(6);
+  spec.trim();
+  int dash = spec.indexOf('-');
+  if (dash < 0) return 0;
+
+  String first = spec.substring(0, dash);
+  String last = spec.substring(dash + 1);
+  first.trim();
+  last.trim();
+
+  if (first.length() == 0) {
+    // Suffix range: the last N bytes
+    uint32_t suffix = strtoul(last.c_str(), nullptr, 10);
+    if (suffix == 0 || size == 0) return -1;
+    start = suffix >= size ? 0 : size - suffix;
+    end = size;
+    return 1;
+  }
+
+  start = strtoul(first.c_str(), nullptr, 10);
+  end = size;
+  if (last.length() > 0) {
+    uint32_t last_byte = strtoul(last.c_str(), nullptr, 10);
+    if (last_byte < start) return 0;
+    if (last_byte + 1 < end) end = last_byte + 1;
+  }
+  return start < size ? 1 : -1;
+}
+
+bool send_file_stream(AsyncWebServerRequest *request, const String &path, const char *content_type) {
+  std::shared_ptr<FileStreamContext> ctx = std::make_shared<FileStreamContext>();
+  uint32_t size;
+  {
+    SdGuard guard;
+    if (!ctx->file.open(path.c_str(), O_READ)) {
+      return false;
+    }
+    // Active logs are pre-allocated: stop at the data on the card
+    size = ctx->file.fileSize();
+    sd_logger_active_length(path.c_str(), &size);
+  }
+
+  uint32_t start = 0;
+  uint32_t end = size;
+  int range = 0;
+  if (request->hasHeader("Range")) {
+    range = parse_range(request->getHeader("Range")->value(), size, start, end);
+  }
+
+  if (range < 0) {
+    AsyncWebServerResponse *response = request->beginResponse(416, "text/plain", "Range not satisfiable");
+    response->addHeader("Content-Range", "bytes */" + String(size));
+    request->send(response);
+    return true;
+  }
+
+  ctx->start = start;
+  ctx->length = end - start;
+
+  // The lambda owns the context; the file closes when the response is freed
+  AsyncWebServerResponse *response = request->beginResponse(content_type, ctx->length,
+    [ctx](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      if (index >= ctx->length) return 0;
+      size_t len = min((size_t)(ctx->length - index), max_len);
+
+      SdGuard guard;
+      if (!ctx->file.seekSet(ctx->start + index)) return 0;
+      int read = ctx->file.read(buffer, len);
+      return read > 0 ? read : 0;
+    });
+
+  response->addHeader("Accept-Ranges", "bytes");
+  if (range > 0) {
+    response->setCode(206);
+    response->addHeader("Content-Range",
+                        "bytes " + String(start) + "-" + String(end - 1) + "/" + String(size));
+  }
+  request->send(response);
+  return true;
+}
+
+// ===== DECODED BINARY LOGS =====
+
+struct BinLogCsvContext {
+  BinLogReader reader;
+  uint32_t from = 0;
+  uint32_t to = 0;
+  uint16_t records = 0;   // Decoded records in the reader
+  uint16_t next = 0;      // Next record to format
+  bool header_sent = false;
+  bool done = false;
+  char line[96];
+  size_t line_len = 0;
+  size_t line_pos = 0;
+};
+
+/**
+ * Format the next CSV line into ctx.line
+ * @return false when there is nothing left to send
+ */
+static bool next_csv_line(BinLogCsvContext &ctx) {
+  const BinLogHeader &header = ctx.reader.header();
+  ctx.line_pos = 0;
+
+  if (!ctx.header_sent) {
+    ctx.header_sent = true;
+    int len = snprintf(ctx.line, sizeof(ctx.line), "time");
+    for (int ch = 0; ch < header.channels; ch++) {
+      const char *prefix = sd_logger_channel_prefix(ch);
+      len += *prefix ? snprintf(ctx.line + len, sizeof(ctx.line) - len, ",%.*s", (int)strlen(prefix) - 1, prefix)
+                     : snprintf(ctx.line + len, sizeof(ctx.line) - len, ",ch%d", ch);
+    }
+    len += snprintf(ctx.line + len, sizeof(ctx.line) - len, "\n");
+    ctx.line_len = len;
+    return true;
+  }
+
+  while (!ctx.done) {
+    if (ctx.next == ctx.records) {
+      ctx.records = ctx.reader.next_block();
+      ctx.next = 0;
+      if (ctx.records == 0) {
+        ctx.done = true;
+        break;
+      }
+    }
+
+    uint16_t r = ctx.next++;
+    uint64_t t_ms = (uint64_t)ctx.reader.block_epoch() * 1000 + (uint64_t)r * header.interval_ms;
+    uint32_t seconds = (t_ms / 1000) % 86400;
+    if (seconds < ctx.from) continue;
+    if (seconds >= ctx.to) {
+      ctx.done = true;  // Blocks are in time order within a day
+      break;
+    }
+
+    int len = header.interval_ms % 1000
+                  ? snprintf(ctx.line, sizeof(ctx.line), "%02u:%02u:%02u.%03u", seconds / 3600,
+                             seconds / 60 % 60, seconds % 60, (unsigned)(t_ms % 1000))
+                  : snprintf(ctx.line, sizeof(ctx.line), "%02u:%02u:%02u", seconds / 3600,
+                             seconds / 60 % 60, seconds % 60);
+    for (int ch = 0; ch < header.channels; ch++) {
+      // scale refers to the header gain; other ranges scale by their LSB size
+      double range = (double)ads_lsb_pv(ctx.reader.gains[r][ch]) / ads_lsb_pv(header.gain[ch]);
+      double value = ctx.reader.codes[r][ch] * header.scale[ch] * range + header.offset[ch];
+      len += snprintf(ctx.line + len, sizeof(ctx.line) - len, ",%.4f", value);
+    }
+    len += snprintf(ctx.line + len, sizeof(ctx.line) - len, "\n");
+    ctx.line_len = min((size_t)len, sizeof(ctx.line) - 1);
+    return true;
+  }
+  return false;
+}
+
+uint32_t parse_time_of_day(const String &text) {
+  unsigned hours = 0, minutes = 0, seconds = 0;
+  sscanf(text.c_str(), "%u:%u:%u", &hours, &minutes, &seconds);
+  uint32_t total = hours * 3600UL + minutes * 60UL + seconds;
+  return min(total, (uint32_t)86400);
+}
+
+bool send_binlog_csv(AsyncWebServerRequest *request, const String &path, uint32_t from, uint32_t to) {
+  std::shared_ptr<BinLogCsvContext> ctx = std::make_shared<BinLogCsvContext>();
+  {
+    SdGuard guard;
+    if (!ctx->reader.open(path.c_str())) {
+      return false;
+    }
+  }
+  ctx->from = from;
+  ctx->to = to;
+  if (from > 0) ctx->reader.seek(from);
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse("text/csv",
+    [ctx](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      size_t len = 0;
+      while (len < max_len) {
+        if (ctx->line_pos == ctx->line_len && !next_csv_line(*ctx)) break;
+        size_t n = min(ctx->line_len - ctx->line_pos, max_len - len);
+        memcpy(buffer + len, ctx->line + ctx->line_pos, n);
+        ctx->line_pos += n;
+        len += n;
+      }
+      return len;
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+  return true;
+}
@@ -0,0 +1,55 @@
+// file_stream.h
+#ifndef FILE_STREAM_H
+#define FILE_STREAM_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+
+/**
+ * Streaming file responses for the web server
+ *
+ * The file stays open in a small context object while AsyncWebServer pulls
+ * the body through a fill callback, so data goes straight from SdFat into
+ * the TCP buffer and memory use does not depend on the file size. The
+ * context closes the file when the response is destroyed (finished or
+ * client gone). Every read takes the SD mutex on its own, so the logger is
+ * never blocked for the length of a download.
+ *
+ * Single "Range: bytes=..." requests are answered with 206 Partial Content
+ * so interrupted downloads can be resumed.
+ */
+
+/**
+ * Content type for a file name, based on its extension
+ */
+const char *file_content_type(const String &filename);
+
+/**
+ * Send a file from the SD card, honouring a Range header
+ * @param request Web request
+ * @param path Path of the file on the SD card
+ * @param content_type Content-Type of the response
+ * @return false if the file could not be opened (nothing was sent)
+ */
+bool send_file_stream(AsyncWebServerRequest *request, const String &path, const char *content_type);
+
+/**
+ * Parse a time of day "HH[:MM[:SS]]" from a query parameter
+ * @return Seconds since midnight (clamped to 86400)
+ */
+uint32_t parse_time_of_day(const String &text);
+
+/**
+ * Send a binary log (any version, see binlog.h) decoded to CSV, one row
+ * "HH:MM:SS[.mmm],<value per channel>" per record in physical units.
+ * Blocks are read and decoded as the client pulls the body; the start is
+ * found through the log's block index.
+ * @param request Web request
+ * @param path Path of the "Raw YYYY-MM-DD.bin" file
+ * @param from First time of day to send, seconds since midnight
+ * @param to End of the time of day range (exclusive)
+ * @return false if the file is not a binary log (nothing was sent)
+ */
+bool send_binlog_csv(AsyncWebServerRequest *request, const String &path, uint32_t from, uint32_t to);
+
+#endif
@@ -0,0 +1,257 @@
+#include "live_stream.h"
+#include "ring_buffer.h"
+#include "metrics.h"
+
+static AsyncWebSocket live_ws(LIVE_STREAM_PATH);
+static RingBuffer<RawSample, LIVE_RING_SIZE> live_ring;
+static portMUX_TYPE live_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t live_sps = 0;
+
+// Set by the WebSocket events (async_tcp task), read by the network task
+struct LiveClientConfig {
+  uint32_t id;
+  bool active;
+  bool fresh;            // Connected since the network task last looked
+  bool hello_pending;
+  uint16_t decimate;
+};
+
+// Owned by the network task
+struct LiveClientState {
+  uint32_t sequence;
+  uint32_t dropped;
+  int64_t sum[NUM_CHANNELS];    // Decimation accumulators, reference-gain LSBs
+  uint16_t count[NUM_CHANNELS];
+};
+
+static LiveClientConfig client_config[LIVE_MAX_CLIENTS];
+static LiveClientState client_state[LIVE_MAX_CLIENTS];
+static volatile uint8_t client_count = 0;
+static float live_scale[NUM_CHANNELS];
+static float live_offset[NUM_CHANNELS];
+
+// Network task buffers
+static RawSample batch[LIVE_FRAME_SAMPLES];
+static uint8_t frame[sizeof(LiveFrameHeader) + LIVE_FRAME_SAMPLES * sizeof(LiveSample)];
+static char hello[LIVE_HELLO_SIZE];
+static uint32_t last_frame_ms = 0;
+
+static void on_connect(AsyncWebSocketClient *client) {
+  portENTER_CRITICAL(&live_spinlock);
+  int slot = -1;
+  for (int i = 0; i < LIVE_MAX_CLIENTS && slot < 0; i++) {
+    if (!client_config[i].active) slot = i;
+  }
+  if (slot >= 0) {
+    client_config[slot] = { client->id(), true, true, true, 1 };
+    client_count++;
+  }
+  portEXIT_CRITICAL(&live_spinlock);
+
+  if (slot < 0) {
+    client->close(1013, "too many live clients");
+  }
+}
+
+static void on_disconnect(AsyncWebSocketClient *client) {
+  portENTER_CRITICAL(&live_spinlock);
+  for (int i = 0; i < LIVE_MAX_CLIENTS; i++) {
+    if (client_config[i].active && client_config[i].id == client->id()) {
+      client_config[i].active = false;
+      client_count--;
+    }
+  }
+  portEXIT_CRITICAL(&live_spinlock);
+}
+
+// "decimate=<n>" from a client
+static void on_text(AsyncWebSocketClient *client, const uint8_t *data, size_t len) {
+  char text[32];
+  if (len >= sizeof(text)) return;
+  memcpy(text, data, len);
+  text[len] = '\0';
+  if (strncmp(text, "decimate=", 9) != 0) return;
+  long decimate = strtol(text + 9, NULL, 10);
+  if (decimate < 1 || decimate > LIVE_MAX_DECIMATE) return;
+
+  portENTER_CRITICAL(&live_spinlock);
+  for (int i = 0; i < LIVE_MAX_CLIENTS; i++) {
+    if (client_config[i].active && client_config[i].id == client->id()) {
+      client_config[i].decimate = decimate;
+      client_config[i].fresh = true;       // Restart the accumulators
+      client_config[i].hello_pending = true;
+    }
+  }
+  portEXIT_CRITICAL(&live_spinlock);
+}
+
+static void on_event(AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                     void *arg, uint8_t *data, size_t len) {
+  if (type == WS_EVT_CONNECT) {
+    on_connect(client);
+  } else if (type == WS_EVT_DISCONNECT) {
+    on_disconnect(client);
+  } else if (type == WS_EVT_DATA) {
+    const AwsFrameInfo *info = (const AwsFrameInfo *)arg;
+    // Commands are short, so only unfragmented text frames are accepted
+    if (info->final && info->index == 0 && info->len == len && info->opcode == WS_TEXT) {
+      on_text(client, data, len);
+    }
+  }
+}
+
+static size_t format_hello(uint16_t decimate) {
+  float scale[NUM_CHANNELS], offset[NUM_CHANNELS];
+  portENTER_CRITICAL(&live_spinlock);
+  memcpy(scale, live_scale, sizeof(scale));
+  memcpy(offset, live_offset, sizeof(offset));
+  portEXIT_CRITICAL(&live_spinlock);
+
+  size_t len = snprintf(hello, sizeof(hello), "{\"type\":\"hello\",\"sps\":%u,\"decimate\":%u,\"channels\":[",
+                        live_sps, decimate);
+  for (int ch = 0; ch < NUM_CHANNELS && len < sizeof(hello); ch++) {
+    len += snprintf(hello + len, sizeof(hello) - len,
+                    "%s{\"name\":\"%s\",\"unit\":\"%s\",\"scale\":%.9g,\"offset\":%.9g,\"gain\":%u}",
+                    ch ? "," : "", channel_table[ch].name, channel_table[ch].unit,
+                    scale[ch], offset[ch], sampler_reference_gain(ch));
+  }
+  if (len < sizeof(hello)) len += snprintf(hello + len, sizeof(hello) - len, "]}");
+  return min(len, sizeof(hello) - 1);
+}
+
+/**
+ * Mean of reference-gain codes as an int16 code in the finest range that holds it
+ */
+static LiveSample mean_sample(uint32_t t_us, uint8_t channel, int64_t sum, uint16_t count) {
+  uint8_t reference = sampler_reference_gain(channel);
+  int32_t code = (int32_t)((sum + (sum >= 0 ? count / 2 : -(count / 2))) / count);
+  uint8_t shift = 0;
+  while ((code > INT16_MAX || code < INT16_MIN) && shift < reference) {
+    code >>= 1;
+    shift++;
+  }
+  LiveSample sample;
+  sample.t_us = t_us;
+  sample.code = (int16_t)constrain(code, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+  sample.channel = channel;
+  sample.gain = reference - shift;
+  return sample;
+}
+
+/**
+ * Encode the batch for one client
+ * @return Frame length
+ */
+static size_t encode_frame(LiveClientState &state, uint16_t decimate, size_t batch_count) {
+  LiveFrameHeader header;
+  header.version = LIVE_VERSION;
+  header.flags = decimate > 1 ? LIVE_FLAG_MEANS : 0;
+  header.count = 0;
+  header.sequence = state.sequence;
+  header.dropped = state.dropped;
+
+  LiveSample *out = (LiveSample *)(frame + sizeof(header));
+  for (size_t i = 0; i < batch_count; i++) {
+    const RawSample &raw = batch[i];
+    if (decimate == 1) {
+      LiveSample &sample = out[header.count++];
+      sample.t_us = raw.t_us;
+      sample.code = raw.code;
+      sample.channel = raw.channel;
+      sample.gain = raw.gain;
+      continue;
+    }
+    state.sum[raw.channel] += sampler_fine_code(raw);
+    if (++state.count[raw.channel] == decimate) {
+      out[header.count++] = mean_sample(raw.t_us, raw.channel, state.sum[raw.channel], decimate);
+      state.sum[raw.channel] = 0;
+      state.count[raw.channel] = 0;
+    }
+  }
+  memcpy(frame, &header, sizeof(header));
+  return sizeof(header) + header.count * sizeof(LiveSample);
+}
+
+// Hand the batch to every client that has room for it
+static void send_batch(size_t batch_count) {
+  for (int i = 0; i < LIVE_MAX_CLIENTS; i++) {
+    portENTER_CRITICAL(&live_spinlock);
+    LiveClientConfig config = client_config[i];
+    client_config[i].fresh = false;
+    client_config[i].hello_pending = false;
+    portEXIT_CRITICAL(&live_spinlock);
+    if (!config.active) continue;
+
+    LiveClientState &state = client_state[i];
+    if (config.fresh) {
+      memset(&state, 0, sizeof(state));
+    }
+    if (config.hello_pending) {
+      live_ws.text(config.id, hello, format_hello(config.decimate));
+    }
+
+    if (!live_ws.availableForWrite(config.id)) {
+      // Slow client: skip this frame and restart its means after the gap
+      state.sequence++;
+      state.dropped++;
+      memset(state.sum, 0, sizeof(state.sum));
+      memset(state.count, 0, sizeof(state.count));
+      metrics_count(COUNTER_LIVE_DROPS);
+      continue;
+    }
+    size_t len = encode_frame(state, config.decimate, batch_count);
+    if (len > sizeof(LiveFrameHeader)) {
+      live_ws.binary(config.id, frame, len);
+      state.sequence++;
+    }
+  }
+}
+
+void live_stream_begin(AsyncWebServer &server, uint16_t data_rate,
+                       const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]) {
+  static const uint16_t rates[] = { 8, 16, 32, 64, 128, 250, 475, 860 };
+  live_sps = rates[(data_rate >> 5) & 7];
+  live_stream_set_calibration(scale, offset);
+  live_ws.onEvent(on_event);
+  server.addHandler(&live_ws);
+}
+
+void live_stream_set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]) {
+  portENTER_CRITICAL(&live_spinlock);
+  memcpy(live_scale, scale, sizeof(live_scale));
+  memcpy(live_offset, offset, sizeof(live_offset));
+  for (int i = 0; i < LIVE_MAX_CLIENTS; i++) {
+    client_config[i].hello_pending = client_config[i].active;
+  }
+  portEXIT_CRITICAL(&live_spinlock);
+}
+
+void live_stream_feed(const RawSample &sample) {
+  if (client_count == 0) return;
+  live_ring.push(sample);  // A full ring drops the sample; clients see the gap in t_us
+}
+
+void live_stream_loop() {
+  RawSample sample;
+  if (client_count == 0) {
+    // Nobody listens: discard what was left from the last client
+    while (live_ring.pop(sample)) {}
+    return;
+  }
+
+  uint32_t now = millis();
+  if (now - last_frame_ms < LIVE_FRAME_MS && live_ring.available() < LIVE_FRAME_SAMPLES) return;
+  last_frame_ms = now;
+
+  // A backlog goes out as several frames
+  do {
+    size_t count = 0;
+    while (count < LIVE_FRAME_SAMPLES && live_ring.pop(batch[count])) count++;
+    send_batch(count);
+  } while (live_ring.available() >= LIVE_FRAME_SAMPLES);
+  live_ws.cleanupClients(LIVE_MAX_CLIENTS);
+}
+
+uint8_t live_stream_clients() {
+  return client_count;
+}
@@ -0,0 +1,89 @@
+// live_stream.h
+#ifndef LIVE_STREAM_H
+#define LIVE_STREAM_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include "sampler.h"
+
+/**
+ * Raw sample stream over a WebSocket, for live dashboards
+ *
+ * While at least one client is connected to ws://<device>/ws/live, every
+ * conversion that the acquisition task takes from the sampler ring also
+ * goes through live_stream_feed() into a second ring; nothing is copied
+ * while nobody listens. The network task (live_stream_loop()) drains that
+ * ring every LIVE_FRAME_MS and sends each client one binary frame:
+ *   LiveFrameHeader, then count LiveSample (little endian)
+ * LiveSample codes are raw ADC codes with the gain they were taken with:
+ *   value = code * scale[ch] * lsb(gain) / lsb(reference gain) + offset[ch]
+ * Scale, offset, reference gain, name and unit of each channel arrive as a
+ * JSON text message right after connecting, and again after every
+ * calibration change:
+ *   {"type":"hello","sps":860,"decimate":1,"channels":[{"name":"Amps",
+ *    "unit":"A","scale":..,"offset":..,"gain":5},...]}
+ *
+ * A client can ask for fewer samples by sending the text message
+ * "decimate=<n>": it then gets the mean of every n conversions of each
+ * channel (LIVE_FLAG_MEANS), timestamped with the last of them.
+ *
+ * Backpressure is per client: a frame is only queued while the client's
+ * send queue has room, otherwise that client's frame is dropped and
+ * counted (LiveFrameHeader::dropped, COUNTER_LIVE_DROPS). A slow phone
+ * loses frames; the other clients, the logger and MQTT are not affected.
+ * A full live ring (network task stalled) drops samples for everyone.
+ */
+
+// ===== CONFIGURATION =====
+#define LIVE_STREAM_PATH "/ws/live"
+#define LIVE_MAX_CLIENTS 4
+#define LIVE_RING_SIZE 2048           // Samples between acquisition and network task (~1.2 s at 1720 SPS)
+#define LIVE_FRAME_MS 100             // Frame period
+#define LIVE_FRAME_SAMPLES 256        // Largest frame; a longer backlog goes out as several
+#define LIVE_MAX_DECIMATE 1000
+#define LIVE_HELLO_SIZE 768
+
+#define LIVE_VERSION 1
+#define LIVE_FLAG_MEANS 0x01          // Samples are means of decimate conversions
+
+struct __attribute__((packed)) LiveFrameHeader {
+  uint8_t version;      // LIVE_VERSION
+  uint8_t flags;        // LIVE_FLAG_*
+  uint16_t count;       // Samples in this frame
+  uint32_t sequence;    // Frame number of this client, including dropped frames
+  uint32_t dropped;     // Frames this client lost to backpressure so far
+};
+
+struct __attribute__((packed)) LiveSample {
+  uint32_t t_us;        // Sampler micros() of the RDY edge
+  int16_t code;         // ADC code at gain
+  uint8_t channel;      // SampleChannel
+  uint8_t gain;         // PGA setting (RawSample::gain encoding)
+};
+
+/**
+ * Register the WebSocket handler with the web server
+ * @param data_rate ADS1115 data rate (RATE_ADS1115_xxxSPS) given to the sampler
+ */
+void live_stream_begin(AsyncWebServer &server, uint16_t data_rate,
+                       const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]);
+
+/**
+ * New calibration for the hello message; resent to every client
+ */
+void live_stream_set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]);
+
+/**
+ * Copy one raw conversion for the clients (acquisition task)
+ */
+void live_stream_feed(const RawSample &sample);
+
+/**
+ * Send pending frames and hello messages (network task)
+ */
+void live_stream_loop();
+
+// Connected clients
+uint8_t live_stream_clients();
+
+#endif
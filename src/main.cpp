@@ -27,14 +27,21 @@
 #define ENABLE_DISPLAY 0
 // Set to 1 to enable MQTT data upload, 0 to disable
 #define ENABLE_MQTT 1
+// Set to 1 to capture high-rate windows around current spikes (burst.h)
+#define ENABLE_BURST_CAPTURE 1
+// Set to 1 to discipline the clock (and correct the RTC) with SNTP while WiFi is up
+#define ENABLE_NTP 1
+// Set to 1 to duty-cycle sampling, light-sleep and switch WiFi off while parked (power.h)
+#define ENABLE_LOW_POWER 0
+// Set to 1 to stream raw samples to WebSocket clients at /ws/live (live_stream.h)
+#define ENABLE_LIVE_STREAM 1
+// Set to 1 to watch parked drain for anomalies and publish alerts on battery/alert (anomaly.h)
+#define ENABLE_ANOMALY 1
 // Set to 1 to enable SD card testing mode (writes test data every second)
 #define SD_CARD_TEST_MODE 0
 
 #define UPDATE_RTC_TIME 0
 
-#define VOLTAGE_OFFSET 0.4
-#define CURRENT_OFFSET 0.0
-
 // Define LED_BUILTIN for ESP32 (usually GPIO2)
 #define LED_BUILTIN 2
 
@@ -49,17 +56,41 @@
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
 #include <ElegantOTA.h>     // OTA update functionality
+#include "file_stream.h"    // Streaming file downloads with Range support
+#include "file_list.h"      // Paginated JSON directory listing
+#include "file_index.h"     // In-RAM index of the files on the card
+#include "file_export.h"    // Multi-day tar export
+#include "series_query.h"   // Downsampled /api/series queries
+#include "live_stream.h"    // Raw samples for live dashboards over a WebSocket
+#include "anomaly.h"        // Streaming drain anomaly detection
+#include "web_index.h"      // Gzipped file browser page (generated from web/index.html)
+#include "net_manager.h"    // Non-blocking WiFi/MQTT reconnects
+#include "metrics.h"        // Stage latency histograms and error counters
+#include "text_format.h"    // Allocation-free serial lines
 
 #if ENABLE_MQTT
 #include <PubSubClient.h>   // MQTT client
+#include "mqtt_batch.h"     // Batched binary MQTT payloads
+#include "mqtt_spool.h"     // Offline store-and-forward on the SD card
 #endif
 
 // Sensor and storage libraries
 #include <SPI.h>
 #include <SdFat.h>          // SD card file system
+#include "sd_access.h"      // SD mutex shared between tasks
+#include "sd_logger.h"      // Buffered daily log files
+#include "binlog.h"         // Optional binary log format
 #include <RTClib.h>         // Real-time clock
+#include "time_service.h"   // Wall clock disciplined by RTC and SNTP
 #include <string.h>
 #include <Adafruit_ADS1X15.h> // High-precision ADC
+#include "sampler.h"          // Interrupt-driven continuous ADC sampling
+#include "decimator.h"        // Oversampling reduction to the output rate
+#include "scaler.h"           // Fixed-point code to uA/uV conversion
+#include "calibration.h"      // Calibration profile in NVS
+#include "coulomb.h"          // Charge integration and time-to-empty estimate
+#include "burst.h"            // Triggered high-rate capture of current events
+#include "power.h"            // Parked mode: duty-cycled sampling and light sleep
 
 // Optional display libraries
 #if ENABLE_DISPLAY
@@ -77,18 +108,26 @@
 #define SCREEN_ADDRESS 0x3C // See datasheet for Address; 0x3D for 128x64, 0x3C for 128x32
 #endif
 
-// Calibration values
-#define SHUNT_SIZE 100.000  // Current shunt rating: 100A / 75mV
-
 // Direction constants
 #define LEFT 1
 #define RIGHT 0
 
 // ADC settings
 #define INPUT_PIN 32        // Analog input pin (if using ESP32 ADC)
+// Channels, ADS1115 addresses, ALERT/RDY pins and default calibration: channels.h
+// Continuous conversion rate of each ADS1115, shared by its channels (the mux
+// cycles through them). RATE_ADS1115_128SPS, _250SPS, _475SPS or _860SPS.
+// Burst capture needs the full rate to resolve millisecond events.
+#if ENABLE_BURST_CAPTURE
+#define ADS_DATA_RATE RATE_ADS1115_860SPS
+#else
+#define ADS_DATA_RATE RATE_ADS1115_128SPS
+#endif
+#define OUTPUT_INTERVAL_MS 1000 // Decimated output period written to SD/MQTT
 
 // SD card settings
 const int chipSelect = 15;  // SD card chip select pin
+#define SD_SPI_SPEED SPI_FULL_SPEED  // Log files are contiguous, so the full clock is safe to use
 
 // MQTT settings
 #if ENABLE_MQTT
@@ -97,17 +136,31 @@ const int mqtt_port = MQTT_PORT;         // From secrets.h
 const char* mqtt_user = MQTT_USER;       // From secrets.h
 const char* mqtt_pass = MQTT_PASS;       // From secrets.h
 const char* mqtt_client_id = "ESP32_BatteryMonitor";
-const char* mqtt_topic_current = "battery/data/current";
-const char* mqtt_topic_voltage = "battery/data/voltage";
+const char* mqtt_topic_data = "battery/data";   // Batched binary measurements (mqtt_batch.h)
 const char* mqtt_topic_status = "battery/status";
+const char* mqtt_topic_charge = "battery/charge"; // Coulomb counter state (JSON, retained)
+const char* mqtt_topic_event = "battery/event";   // Captured current events (burst.h)
+const char* mqtt_topic_calibration = "battery/calibration";         // Active profile (JSON, retained)
+const char* mqtt_topic_calibration_set = "battery/calibration/set"; // key=value&... updates
+const char* mqtt_topic_metrics = "battery/metrics";  // Stage latencies and error counters (JSON)
+const char* mqtt_topic_channels = "battery/channels";  // Channel table (JSON, retained)
+const char* mqtt_topic_alert = "battery/alert";        // Drain anomaly alerts (anomaly.h, JSON)
 #endif
 
 // Timing settings
-const unsigned long WIFI_RETRY_INTERVAL = 60000;  // Try to reconnect WiFi every minute
-const unsigned long WIFI_CONNECT_TIMEOUT = 10000; // 10 seconds timeout for WiFi connection
+
+// Task settings - acquisition runs on core 1, all I/O on core 0
+#define ACQ_CORE 1
+#define IO_CORE 0
+#define ACQ_TASK_PRIORITY (configMAX_PRIORITIES - 3) // Below the sampler, above all I/O
+#define SD_TASK_PRIORITY 3
+#define MQTT_TASK_PRIORITY 2
+#define NET_TASK_PRIORITY 1
+#define SD_QUEUE_LENGTH 120   // Measurements buffered for the SD writer (2 minutes at 1 Hz)
+#define MQTT_QUEUE_LENGTH 60  // Measurements buffered for the MQTT publisher
 
 // ===== OBJECT INITIALIZATION =====
-Adafruit_ADS1115 ads;       // 16-bit ADC object
+Adafruit_ADS1115 ads[NUM_ADC_DEVICES];  // 16-bit ADCs, one per adc_devices row
 RTC_DS3231 rtc;             // Real-time clock object
 SdFat sd;                   // SD card filesystem
 SdFile file;                // File object for writing
@@ -128,15 +181,34 @@ unsigned long ota_progress_millis = 0;
 
 // Battery monitoring variables
 float current = 0.0;
+Decimator decimator;        // Reduces oversampled raw codes to one frame per output interval
 int direction = RIGHT;
 int direction_before = LEFT;
 int direct_log = 0;
 int count = 0;
 int i = 1;
 
+// One decimated, timestamped output sample passed from acquisition to the I/O tasks
+struct Measurement {
+  DateTime timestamp;     // Wall time when the interval closed (time_service.h)
+  DecimatedFrame frame;   // Per-channel statistics of the interval
+};
+
+// Task queues
+QueueHandle_t sd_queue = NULL;
+QueueHandle_t mqtt_queue = NULL;
+
+#if ENABLE_MQTT
+// MQTT batching
+MqttBatch mqtt_batch;                           // Batch being filled
+volatile bool calibration_changed = false;      // mqtt_task picks up a new calibration
+uint8_t mqtt_payload[MQTT_BATCH_MAX_PAYLOAD];   // Finished batch waiting to be published
+size_t mqtt_payload_len = 0;                    // 0 = nothing pending
+uint32_t mqtt_batches_dropped = 0;              // Finished batches that could not be sent or spooled
+uint8_t spool_payload[MQTT_BATCH_MAX_PAYLOAD];  // Backlog batch being replayed
+#endif
+
 // Connection state variables
-bool wifi_connected = false;
-unsigned long last_wifi_attempt = 0;
 
 // SD card monitoring
 unsigned long last_sd_check = 0;
@@ -150,25 +222,27 @@ void onOTAProgress(size_t current, size_t final);
 void onOTAEnd(bool success);
 
 // Data collection and storage functions
-float get_adc_data_in_A();    // Get current reading in Amperes
-float get_adc_data_in_V();    // Get voltage reading in Volts
-void write_file(float data, int count, String filename); // Log data to SD card
+bool next_frame(DecimatedFrame &frame);   // Reduce sampler output to the next decimated frame
 #if SD_CARD_TEST_MODE
 void test_sd_card_write();    // Test function for basic SD card writing
 #endif
 
-// WiFi and MQTT functions
-void check_wifi_connection();            // Check and attempt to reconnect WiFi
-
+// MQTT functions
 #if ENABLE_MQTT
-bool connect_mqtt();                     // Connect to MQTT broker
-void publish_data_point(float current, float voltage, DateTime timestamp); // Publish single data point
+bool connect_mqtt();                     // One broker connect attempt
+void finish_mqtt_batch();                // Move the current batch to the publish buffer
+bool publish_batch();                    // Publish the pending batch
+void publish_charge();                   // Publish the coulomb counter state
+void publish_event();                    // Publish one captured current event
+void publish_alert();                    // Publish one anomaly alert
+void publish_calibration();              // Publish the active calibration profile
+void publish_metrics();                  // Publish the stage latency summary
+void on_mqtt_message(char *topic, uint8_t *payload, unsigned int length);
+void drain_spool();                      // Replay one spooled batch
 #endif
 
 // Web server functions
 void setup_web_server();                 // Setup web server routes
-String list_files(String path);          // List all files in directory
-String get_file_size(size_t bytes);   // Get file size as string
 
 // Display functions
 #if ENABLE_DISPLAY
@@ -176,10 +250,23 @@ void interface(float amps, int dir);  // Update display interface
 void move_arrow(int dir, float amps); // Animate the direction arrow
 #endif
 
+// Calibration functions
+void apply_calibration();                // Push the active calibration to sampler and headers
+void calibration_headers(float scale[NUM_CHANNELS], float offset[NUM_CHANNELS]);
+
 // SD card functions
 bool init_sd_card();
 bool check_sd_card();
 
+// Task functions
+void start_tasks();                      // Create queues and I/O tasks
+void acquisition_task(void *arg);        // Decimate and timestamp samples (core 1)
+void sd_writer_task(void *arg);          // Write measurements to SD card (core 0)
+#if ENABLE_MQTT
+void mqtt_task(void *arg);               // Publish measurements over MQTT (core 0)
+#endif
+void network_task(void *arg);            // WiFi reconnects and OTA (core 0)
+
 // ===== OTA CALLBACK IMPLEMENTATIONS =====
 /**
  * Called when OTA update begins
@@ -205,6 +292,13 @@ void onOTAProgress(size_t current, size_t final) {
  */
 void onOTAEnd(bool success) {
   if (success) {
+    // The device restarts into the new firmware: flush the buffered logs and
+    // trim pre-allocated files, which are otherwise only synced once a minute
+    coulomb_save();
+    sd_logger_close();
+#if ENABLE_MQTT
+    mqtt_spool_close();
+#endif
     Serial.println("OTA update completed successfully!");
   } else {
     Serial.println("Error during OTA update!");
@@ -224,6 +318,7 @@ void test_sd_card_write() {
   if (millis() - lastWrite >= 1000) {
     lastWrite = millis();
     counter++;
+    SdGuard guard;
     
     // Create a simple test file
     const char* testFileName = "SDTEST.TXT";
@@ -289,23 +384,22 @@ void setup() {
   // Set up built-in LED for write indication
   pinMode(LED_BUILTIN, OUTPUT);
 
-  // Initialize WiFi connection
-  WiFi.mode(WIFI_STA);
-  WiFi.setHostname("VolvoESP32");  // Set custom device name
-  check_wifi_connection();         // Initial WiFi connection attempt
+  // Start connecting to WiFi in the background
+  net_manager_begin(WIFI_SSID, WIFI_PASS, "VolvoESP32");
 
-  // Initialize ADS1115 ADC
+  // Initialize the ADS1115 ADCs; the sampler sets gain and mux per channel
   Serial.println("Initializing ADC...");
-  // Set ADC gain for highest precision in our voltage range
-  // GAIN_SIXTEEN: +/- 0.256V range with 0.0078125mV per bit
-  ads.setGain(GAIN_SIXTEEN);
-
-  if (!ads.begin()) {
-    Serial.println("ERROR: Failed to initialize ADS1115!");
-    while (1) {
-      delay(100); // Halt system if ADC initialization fails
+  for (uint8_t d = 0; d < NUM_ADC_DEVICES; d++) {
+    if (!ads[d].begin(adc_devices[d].address)) {
+      Serial.printf("ERROR: Failed to initialize ADS1115 at 0x%02X!\n", adc_devices[d].address);
+      while (1) {
+        delay(100); // Halt system if ADC initialization fails
+      }
     }
   }
+  // Three I2C transfers per conversion and device; 100 kHz is too slow for 860 SPS.
+  // Faster modes need the high-speed master code, which the Arduino core does not send.
+  Wire.setClock(400000);
   Serial.println("ADC initialized successfully");
 
   // Initialize RTC module
@@ -326,13 +420,15 @@ void setup() {
     // rtc.adjust(DateTime(F(__DATE__), F(__TIME__)));
   #endif
 
-  DateTime time = rtc.now();
+  // The RTC is read once here and then only every few minutes (time_service.h)
+  time_service_begin(&rtc);
+  DateTime time = time_now();
   Serial.print("Current time: ");
   Serial.printf("%02d:%02d:%02d\n", time.hour(), time.minute(), time.second());
 
   // Initialize SD card
   Serial.println("Initializing SD card...");
-  if (!sd.begin(chipSelect, SPI_HALF_SPEED)) {
+  if (!sd.begin(chipSelect, SD_SPI_SPEED)) {
     Serial.println("ERROR: SD card initialization failed!");
     while (1) {
       // Flash LED to indicate SD card error
@@ -343,6 +439,24 @@ void setup() {
     }
   }
   Serial.println("SD card initialized successfully");
+  sd_access_begin();
+
+  // Calibration from NVS, the defaults of the channel table otherwise
+  calibration_begin(calibration_table_defaults());
+  calibration_on_change(apply_calibration);
+  CalibrationProfile calibration = calibration_profile();
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    sampler_set_gain_range(ch, calibration_min_gain(ch), calibration.ch[ch].gain);
+  }
+
+  BinLogConfig binlog_config;
+  binlog_config.interval_ms = OUTPUT_INTERVAL_MS;
+  calibration_headers(binlog_config.scale, binlog_config.offset);
+  sd_logger_begin(chipSelect, SD_SPI_SPEED, binlog_config);
+#if ENABLE_BURST_CAPTURE
+  burst_begin(binlog_config.scale, binlog_config.offset,
+              BURST_CONSUMER_SD | (ENABLE_MQTT ? BURST_CONSUMER_MQTT : 0));
+#endif
 
   // Check if the SD card is writable by creating a test file
   SdFile testFile;
@@ -392,15 +506,21 @@ void setup() {
     }
   }
 
+  // Index the card for the file browser before anything is served
+  file_index_begin();
+
   // Setup web server for file browsing and OTA updates
   setup_web_server();
 
 #if ENABLE_MQTT
   // Setup MQTT client
+  mqtt_spool_begin();
   mqtt.setServer(mqtt_server, mqtt_port);
-  if (wifi_connected) {
-    connect_mqtt();
-  }
+  mqtt.setBufferSize(MQTT_BATCH_MAX_PAYLOAD + 64);  // Room for a full batch plus topic and header
+  mqtt.setSocketTimeout(2);  // Bound the wait for a dead broker in connect()
+  mqtt.setCallback(on_mqtt_message);
+  mqtt_batch.begin(OUTPUT_INTERVAL_MS, binlog_config.scale, binlog_config.offset);
+  calibration_changed = true;  // Publish the profile on the first connect
 #endif
 
 #if ENABLE_DISPLAY
@@ -420,15 +540,29 @@ void setup() {
   }
 #endif
 
+#if !SD_CARD_TEST_MODE
+  // Start continuous sampling last so the ring does not fill up during setup
+  Serial.println("Starting ADC sampler...");
+  decimator.begin(OUTPUT_INTERVAL_MS * 1000UL);
+  coulomb_begin();
+#if ENABLE_LOW_POWER
+  power_begin(adc_devices[channel_table[CH_AMPS].device].alert_pin, OUTPUT_INTERVAL_MS);
+#endif
+  if (!sampler_begin(ads, ADS_DATA_RATE)) {
+    Serial.println("ERROR: Failed to start ADC sampler task!");
+    while (1) {
+      delay(100); // Halt system if sampling cannot run
+    }
+  }
+  start_tasks();
+#endif
+
   Serial.println("Setup complete!");
 #if SD_CARD_TEST_MODE
   Serial.println("RUNNING IN TEST MODE - Writing to test file every second");
 #endif
 }
 
-int previous_time = 0;
-int time_now = 0;
-
 // ===== MAIN LOOP =====
 void loop() {
 #if SD_CARD_TEST_MODE
@@ -436,348 +570,523 @@ void loop() {
   test_sd_card_write();
   
   // Handle OTA updates if WiFi connected
-  if (wifi_connected) {
+  net_manager_loop();
+  if (net_wifi_connected()) {
     ElegantOTA.loop();
   }
-  
-  // Try to reconnect WiFi periodically if disconnected
-  if (millis() - last_wifi_attempt > WIFI_RETRY_INTERVAL) {
-    check_wifi_connection();
-  }
 
   // A short delay to avoid hammering the loop
   delay(10);
 #else
-  // Handle OTA updates if WiFi connected
-  if (wifi_connected) {
-    ElegantOTA.loop();
+  // All work is done by the FreeRTOS tasks created in start_tasks()
+  vTaskDelete(NULL);
+#endif
+}
+
+// ===== TASKS =====
+
+/**
+ * Create the measurement queues and start the acquisition and I/O tasks.
+ * The sampler task itself is started by sampler_begin().
+ */
+void start_tasks() {
+  sd_queue = xQueueCreate(SD_QUEUE_LENGTH, sizeof(Measurement));
+#if ENABLE_MQTT
+  mqtt_queue = xQueueCreate(MQTT_QUEUE_LENGTH, sizeof(Measurement));
+#endif
+
+#if ENABLE_LOW_POWER
+  power_watch_queue(sd_queue);
+  power_watch_queue(mqtt_queue);
+#endif
+
+  xTaskCreatePinnedToCore(acquisition_task, "acquisition", 4096, NULL, ACQ_TASK_PRIORITY, NULL, ACQ_CORE);
+  xTaskCreatePinnedToCore(sd_writer_task, "sd_writer", 6144, NULL, SD_TASK_PRIORITY, NULL, IO_CORE);
+#if ENABLE_MQTT
+  xTaskCreatePinnedToCore(mqtt_task, "mqtt", 6144, NULL, MQTT_TASK_PRIORITY, NULL, IO_CORE);
+#endif
+  xTaskCreatePinnedToCore(network_task, "network", 4096, NULL, NET_TASK_PRIORITY, NULL, IO_CORE);
+  series_begin(OUTPUT_INTERVAL_MS);
+  Serial.println("Tasks started");
+}
+
+/**
+ * Acquisition task (core 1)
+ * Reduces raw samples to decimated frames, timestamps them and hands them to
+ * the I/O tasks. Queues are never waited on, so a stalled SD card or network
+ * drops measurements downstream instead of stopping acquisition.
+ */
+void acquisition_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    DecimatedFrame frame;
+    if (!next_frame(frame)) {
+      vTaskDelay(pdMS_TO_TICKS(5));
+      continue;
+    }
+    uint32_t start = metrics_now();
+
+    // Integrate charge over the exact interval length
+    const ChannelStats &amps = frame.ch[CH_AMPS];
+    if (amps.count > 0) {
+      int32_t micro_amps = calibration_scaler(CH_AMPS).from_mean(amps.mean);
+      coulomb_add(micro_amps, frame.interval_us);
+#if ENABLE_LOW_POWER
+      power_feed(micro_amps);
+#endif
+    }
+    calibration_feed(frame);
+
+    // Timestamp the end of the interval from the disciplined clock, no I2C
+    uint32_t end_us = frame.t_us + frame.interval_us;
+    int64_t wall_us = time_at_us(end_us);
+    Measurement measurement;
+    measurement.timestamp = DateTime((uint32_t)(wall_us / 1000000));
+    measurement.frame = frame;
+#if ENABLE_BURST_CAPTURE
+    burst_set_clock(wall_us / 1000000, end_us - (uint32_t)(wall_us % 1000000));
+#endif
+#if ENABLE_ANOMALY
+    anomaly_feed(frame, measurement.timestamp.unixtime());
+#endif
+
+    if (xQueueSend(sd_queue, &measurement, 0) != pdTRUE) {
+      metrics_count(COUNTER_SD_QUEUE_DROPS);
+    }
+#if ENABLE_MQTT
+    if (xQueueSend(mqtt_queue, &measurement, 0) != pdTRUE) {
+      metrics_count(COUNTER_MQTT_QUEUE_DROPS);
+    }
+#endif
+    metrics_record_since(STAGE_ACQUIRE, start);
   }
+}
 
-  // Get current date/time
-  DateTime now = rtc.now();
-  
-  // Try to reconnect WiFi periodically if disconnected
-  if (millis() - last_wifi_attempt > WIFI_RETRY_INTERVAL) {
-    check_wifi_connection();
+/**
+ * SD writer task (core 0)
+ * Logs measurements to the daily per-channel files and updates the display.
+ */
+void sd_writer_task(void *arg) {
+  (void)arg;
+  static TextLine line;  // Serial output of this task, see text_format.h
+  for (;;) {
+    Measurement measurement;
+    if (xQueueReceive(sd_queue, &measurement, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+
+    const DecimatedFrame &frame = measurement.frame;
+    const ChannelStats &amps = frame.ch[CH_AMPS];
+
+    // Convert the interval means of current and voltage to uA / uV
+    const Scaler &amps_scaler = calibration_scaler(CH_AMPS);
+    int32_t micro_amps = amps_scaler.from_mean(amps.mean);
+    int32_t micro_volts = calibration_scaler(CH_VOLTS).from_mean(frame.ch[CH_VOLTS].mean);
+
+    // Display readings on serial monitor
+    line.clear();
+    line.add("Volts: ").add_micro(micro_volts, 3).add("V | Amps: ").add_micro(micro_amps, 3)
+        .add("A (min ").add_micro(amps_scaler.from_code(amps.min), 3)
+        .add(", max ").add_micro(amps_scaler.from_code(amps.max), 3)
+        .add(", rms ").add_micro(amps_scaler.from_mean(amps.rms), 3)
+        .add(", n=").add_uint(amps.count)
+        .add(")");
+    for (int ch = CH_VOLTS + 1; ch < NUM_CHANNELS; ch++) {
+      line.add(" | ").add(channel_table[ch].name).add(": ")
+          .add_micro(calibration_scaler(ch).from_mean(frame.ch[ch].mean), 3).add(channel_table[ch].unit);
+    }
+    line.add(" | WiFi: ").add(net_wifi_connected() ? "Connected" : "Disconnected").add('\n');
+    line.print_to(Serial);
+
+    // Write data to SD card files
+    // Files are named "<channel name> YYYY-MM-DD.txt", e.g. "Amps 2025-03-07.txt"
+    int32_t values[NUM_CHANNELS];
+    int16_t codes[NUM_CHANNELS];
+    uint8_t gains[NUM_CHANNELS];
+    for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+      values[ch] = calibration_scaler(ch).from_mean(frame.ch[ch].mean);
+      // Auto-ranged means can exceed int16 at the reference gain
+      uint8_t reference = sampler_reference_gain(ch);
+      uint8_t shift;
+      codes[ch] = stats_code_ranged(frame.ch[ch], reference > ADS_GAIN_1 ? reference - ADS_GAIN_1 : 0, shift);
+      gains[ch] = reference - shift;
+    }
+    uint32_t start = metrics_now();
+    sd_logger_log(measurement.timestamp, values, codes, gains);
+    metrics_record_since(STAGE_SD_LOG, start);
+    coulomb_persist();
+#if ENABLE_BURST_CAPTURE
+    burst_write_sd();
+#endif
+
+    #if ENABLE_DISPLAY
+    // Update the display with current readings
+    // Determine current direction (charging or discharging)
+    if (micro_amps < 0) {
+      direction = RIGHT; // Charging
+    } else {
+      direction = LEFT;  // Discharging
+    }
+
+    // Update display interface with current values and direction
+    interface(micro_amps / 1e6f, direction);
+    #endif
+
+    count++;
+    if (count >= 60) {
+      // Log completion of one minute cycle
+      const DateTime &now = measurement.timestamp;
+      Serial.println("One minute cycle completed");
+      line.clear();
+      line.add("Date: ").add_date(now).add("  Time: ").add_time(now).add('\n');
+      line.print_to(Serial);
+      line.clear();
+      line.add("Sampler: ").add_uint(sampler_dropped_samples()).add(" dropped, ")
+          .add_uint(sampler_missed_conversions()).add(" missed conversions, ")
+          .add_uint(sampler_range_switches()).add(" range switches | Queue drops: SD ")
+          .add_uint(metrics_counter(COUNTER_SD_QUEUE_DROPS)).add(", MQTT ")
+          .add_uint(metrics_counter(COUNTER_MQTT_QUEUE_DROPS)).add('\n');
+      line.print_to(Serial);
+      const NetStats &net = net_stats();
+      line.clear();
+      line.add("WiFi ").add(net_wifi_state_name(net.wifi_state)).add(": ")
+          .add_uint(net.wifi_attempts).add(" attempts, ").add_uint(net.wifi_connects).add(" connects, ")
+          .add_uint(net.wifi_disconnects).add(" drops | MQTT: ").add_uint(net.mqtt_attempts).add(" attempts, ")
+          .add_uint(net.mqtt_connects).add(" connects, last rc ").add_int(net.mqtt_last_error).add('\n');
+      line.print_to(Serial);
+#if ENABLE_MQTT
+      line.clear();
+      line.add("MQTT: ").add_uint(mqtt_spool_count()).add(" batches spooled, ")
+          .add_uint(mqtt_spool_overwritten()).add(" overwritten, ")
+          .add_uint(mqtt_batches_dropped).add(" dropped\n");
+      line.print_to(Serial);
+#endif
+      CoulombState charge = coulomb_state();
+      line.clear();
+      line.add("Charge: ").add_float(charge.used_ah, 3).add(" Ah used (").add_float(charge.soc * 100, 1)
+          .add("%), drain ").add_float(charge.drain_a, 3).add(" A, ").add_float(charge.time_to_empty_h, 1)
+          .add(" h to empty | Total out ").add_float(charge.discharged_ah, 3).add(" Ah, in ")
+          .add_float(charge.charged_ah, 3).add(" Ah\n");
+      line.print_to(Serial);
+#if ENABLE_BURST_CAPTURE
+      line.clear();
+      line.add("Current events: ").add_uint(burst_events()).add(" captured, ")
+          .add_uint(burst_dropped()).add(" dropped\n");
+      line.print_to(Serial);
+#endif
+#if ENABLE_ANOMALY
+      line.clear();
+      line.add("Anomaly: ").add_uint(anomaly_alerts()).add(" alerts, ")
+          .add_uint(anomaly_pending()).add(" pending, ").add_uint(anomaly_dropped()).add(" dropped\n");
+      line.print_to(Serial);
+#endif
+#if ENABLE_LOW_POWER
+      PowerStats power = power_stats();
+      line.clear();
+      line.add("Power: ").add(power.state == POWER_PARKED ? "parked" : "active").add(", ")
+          .add_uint(power.parks).add(" parks, ").add_uint(power.comparator_wakes).add(" comparator wakes, ")
+          .add_uint(power.sleeps).add(" sleeps (").add_uint(power.sleep_us / 1000000).add(" s), ")
+          .add_uint(power.uploads).add(" uploads\n");
+      line.print_to(Serial);
+#endif
+      line.clear();
+      line.add("File size:");
+      for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+        line.add(ch ? ", " : " ").add(channel_table[ch].name).add(' ')
+            .add_uint(sd_logger_file_size(ch)).add(" bytes");
+      }
+      line.add('\n');
+      line.print_to(Serial);
+
+      // Reset counter for the next minute
+      count = 0;
+    }
   }
-  
-  // Collect and log data every minute (60 samples at ~1 second intervals)
-  while (count < 60) {
-    //if one seconds passed then run the data logging, else wait until one second
-    time_now = millis();
-    if((time_now - previous_time) >= 1000){
-      previous_time = millis();
-
-      // Read voltage and current values
-      float data_in_amps = get_adc_data_in_A();
-      float data_in_volts = get_adc_data_in_V();
-              
-      // Get current time
-      DateTime timestamp = rtc.now();
-              
-      // Display readings on serial monitor
-      Serial.printf("Volts: %.2fV | Amps: %.2fA | WiFi: %s\n", 
-                  data_in_volts, data_in_amps, wifi_connected ? "Connected" : "Disconnected");
-              
-      // Write data to SD card files
-      // Files are named "Amps YYYY-MM-DD.txt" and "Volts YYYY-MM-DD.txt"
-      write_file(data_in_amps, count, "Amps ");
-      write_file(data_in_volts, count, "Volts ");
-              
-      // Send data to MQTT if connected
-      #if ENABLE_MQTT
-      if (wifi_connected && mqtt.connected()) {
-        publish_data_point(data_in_amps, data_in_volts, timestamp);
-      } else if (wifi_connected && !mqtt.connected()) {
-        // Try to reconnect to MQTT if WiFi is connected but MQTT is not
+}
+
+#if ENABLE_MQTT
+/**
+ * MQTT publisher task (core 0)
+ * Collects queued measurements into batches, publishes finished batches and
+ * keeps the broker connection alive. Reconnect attempts may block here
+ * without affecting acquisition.
+ */
+void mqtt_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    // The batch in progress was measured with the old calibration
+    if (calibration_changed) {
+      calibration_changed = false;
+      finish_mqtt_batch();
+      float scale[NUM_CHANNELS], offset[NUM_CHANNELS];
+      calibration_headers(scale, offset);
+      mqtt_batch.set_calibration(scale, offset);
+      if (mqtt.connected()) publish_calibration();
+    }
+
+    Measurement measurement;
+    if (xQueueReceive(mqtt_queue, &measurement, pdMS_TO_TICKS(100)) == pdTRUE) {
+      uint32_t epoch = measurement.timestamp.unixtime();
+      if (!mqtt_batch.accepts(epoch)) {
+        finish_mqtt_batch();
+      }
+
+      int16_t codes[NUM_CHANNELS];
+      for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+        const ChannelStats &stats = measurement.frame.ch[ch];
+        codes[ch] = stats.count ? stats_code(stats) : MQTT_BATCH_NO_DATA;
+      }
+      mqtt_batch.add(epoch, codes);
+
+      if (mqtt_batch.full()) {
+        finish_mqtt_batch();
+      }
+    }
+
+    if (mqtt_payload_len > 0 || mqtt_spool_count() > 0) {
+      if (!mqtt.connected() && net_mqtt_attempt_due()) {
+        // Try to reconnect to MQTT if WiFi is up and the backoff allows it
         connect_mqtt();
       }
-      // Keep MQTT client connection alive
       if (mqtt.connected()) {
-        mqtt.loop();
-      }
-      #endif
-              
-      #if ENABLE_DISPLAY
-      // Update the display with current readings
-      // Determine current direction (charging or discharging)
-      if (data_in_amps < 0) {
-        direction = RIGHT; // Charging
-      } else {
-        direction = LEFT;  // Discharging
+        // Live data first, the backlog only when nothing live is waiting
+        if (mqtt_payload_len > 0) {
+          publish_batch();
+        } else {
+          drain_spool();
+        }
       }
-                  
-      // Update display interface with current values and direction
-      interface(data_in_amps, direction);
-      #endif
-              
-      count++;
     }
-  }
+#if ENABLE_ANOMALY
+    publish_alert();
+#endif
+#if ENABLE_LOW_POWER
+    if (mqtt_payload_len == 0 && mqtt_spool_count() == 0 && mqtt.connected() &&
+        (!ENABLE_ANOMALY || anomaly_pending() == 0)) {
+      power_upload_done();  // Parked: the radio may go off until the next window
+    }
+#endif
 
-  // Log completion of one minute cycle
-  Serial.println("One minute cycle completed");
-  Serial.printf("Date: %02d-%02d-%04d  Time: %02d:%02d:%02d\n", 
-    now.day(), now.month(), now.year(), 
-    now.hour(), now.minute(), now.second());
-  
-  // Reset counter for the next minute
-  count = 0;
+#if ENABLE_BURST_CAPTURE
+    publish_event();
 #endif
-}
+    publish_metrics();
 
-// ===== DATA COLLECTION FUNCTIONS =====
+    // Keep MQTT client connection alive
+    if (mqtt.connected()) {
+      StageTimer timer(STAGE_MQTT_LOOP);
+      mqtt.loop();
+    }
+  }
+}
+#endif
 
 /**
- * Read current from ADS1115 differential input
- * @return Current in Amperes
+ * Network task (core 0)
+ * Advances the WiFi connection state machine, keeps the clock disciplined
+ * and services OTA.
  */
-float get_adc_data_in_A() {
-  int16_t results;
-  
-  // Conversion factor for ADS1115 with GAIN_SIXTEEN (0.0078125 mV per bit)
-  const double Ampmultiplier = 0.0078125;
-  
-  // Read differential voltage across shunt
-  results = ads.readADC_Differential_0_1();
-  
-  // Convert to amperes based on shunt rating (100A/75mV)
-  float amps = float((results * Ampmultiplier * (SHUNT_SIZE / 75.000)));
-  return amps;
+void network_task(void *arg) {
+  (void)arg;
+  for (;;) {
+#if ENABLE_LOW_POWER
+    net_set_radio(power_radio_wanted());
+#endif
+    uint32_t start = metrics_now();
+    net_manager_loop();
+    metrics_record_since(STAGE_NET_LOOP, start);
+    calibration_loop();
+#if ENABLE_LIVE_STREAM
+    live_stream_loop();
+#endif
+#if ENABLE_NTP
+    if (net_wifi_connected()) time_service_start_ntp();
+#endif
+    time_service_loop();
+
+    // Handle OTA updates if WiFi connected
+    if (net_wifi_connected()) {
+      StageTimer timer(STAGE_OTA_LOOP);
+      ElegantOTA.loop();
+    }
+
+    vTaskDelay(pdMS_TO_TICKS(10));
+  }
 }
 
+// ===== CALIBRATION FUNCTIONS =====
+
 /**
- * Read voltage from ADS1115 single-ended input
- * @return Voltage in Volts
+ * Float calibration of the active profile, as stored in binary log,
+ * MQTT batch and event headers (physical = code * scale + offset)
  */
-float get_adc_data_in_V() {
-  int16_t results;
-  
-  // Conversion factor for voltage divider
-  const double Voltmultiplier = 0.0002696;
-  
-  // Read from single-ended input (A2)
-  results = ads.readADC_SingleEnded(2);
-  
-  // Convert to volts (includes voltage divider factor of 2)
-  float volts_ = float(2 * Voltmultiplier * results) + VOLTAGE_OFFSET;
-  float volts = round(volts_*10)/10;
-  return volts;
+void calibration_headers(float scale[NUM_CHANNELS], float offset[NUM_CHANNELS]) {
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    const Scaler &scaler = calibration_scaler(ch);
+    scale[ch] = scaler.scale();
+    offset[ch] = scaler.offset_units();
+  }
 }
 
 /**
- * Write data to a file on the SD card
- * @param data The data value to write
- * @param count Current sample count (0-59)
- * @param filnamn Prefix for the filename
+ * Calibration listener: runs in the task that applied the change
  */
-void write_file(float data, int count, String filnamn) {
-  // Get current date/time
-  DateTime time = rtc.now();
-   
-  // Create filename with date: "Prefix YYYY-MM-DD.txt"
-  String date = time.timestamp(DateTime::TIMESTAMP_DATE);
-  String txt = ".txt";
-  String filename_merged = filnamn + date + txt;
-  
-  // Convert to char array for SD library
-  char filename[filename_merged.length() + 1];
-  filename_merged.toCharArray(filename, sizeof(filename));
-  
-  // Debug output with filename and count
-  Serial.print("Writing to file: ");
-  Serial.print(filename);
-  Serial.print(" | Value: ");
-  Serial.print(data);
-  Serial.print(" | Count: ");
-  Serial.println(count);
-  
-  // Open file for append - if fails, halt with error
-  if (!file.open(filename, O_RDWR | O_CREAT | O_AT_END)) {
-    Serial.print("ERROR: Failed to open file for writing: ");
-    Serial.println(filename);
-    
-    // Try again once
-    if (!sd.begin(chipSelect, SPI_HALF_SPEED)) {
-      Serial.println("ERROR: SD card reinit failed!");
-      return;
-    }
-    
-    // Second attempt after reinitializing
-    if (!file.open(filename, O_RDWR | O_CREAT | O_AT_END)) {
-      Serial.println("ERROR: Still failed to open file after SD reinit!");
-      return;
-    }
-    
-    Serial.println("File opened successfully after SD reinit");
-  }
-  
-  // Start a new line with timestamp at the beginning of each minute
-  if (count == 0) {
-    // Use time format HH:MM:SS
-    char timestamp[9]; // HH:MM:SS + null terminator
-    sprintf(timestamp, "%02d:%02d:%02d", 
-            time.hour(), time.minute(), time.second());
-    
-    file.println(); // Start on a new line
-    file.print(timestamp);
-    file.print(" --> ");
-    
-    Serial.print("Wrote timestamp: ");
-    Serial.println(timestamp);
-  }
-
-  // Write data value with comma separator (except for last value)
-  file.print(data);
-  if (count < 59) {
-    file.print(", ");
-  } else {
-    // End the line on the last sample of the minute
-    file.println(); // Important - ensures the line ends properly
+void apply_calibration() {
+  CalibrationProfile profile = calibration_profile();
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    sampler_set_gain_range(ch, calibration_min_gain(ch), profile.ch[ch].gain);
   }
 
-  // Close the file to ensure data is saved
-  file.close();
-  
-  // Verify file exists with size check (only do once per minute to save performance)
-  if (count == 59) {
-    SdFile checkFile;
-    if (checkFile.open(filename, O_READ)) {
-      Serial.print("File size: ");
-      Serial.print(checkFile.fileSize());
-      Serial.println(" bytes");
-      checkFile.close();
-    }
-  }
+  float scale[NUM_CHANNELS], offset[NUM_CHANNELS];
+  calibration_headers(scale, offset);
+  sd_logger_set_calibration(scale, offset);
+#if ENABLE_BURST_CAPTURE
+  burst_set_calibration(scale, offset);
+#endif
+#if ENABLE_LIVE_STREAM
+  live_stream_set_calibration(scale, offset);
+#endif
+  calibration_changed = true;
+  Serial.println("Calibration updated");
 }
 
+// ===== DATA COLLECTION FUNCTIONS =====
+
 /**
- * Check WiFi connection and attempt to reconnect if needed
+ * Feed raw samples from the sampler ring into the decimator
+ * @param frame Filled with the next finished output interval
+ * @return true if a frame was produced, false if the ring ran empty first
  */
-void check_wifi_connection() {
-  last_wifi_attempt = millis();
-  
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.print("Attempting to connect to WiFi... ");
-    
-    // Make sure we're in station mode
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(WIFI_SSID, WIFI_PASS);
-    
-    // Wait up to 10 seconds for connection
-    unsigned long startAttempt = millis();
-    while (WiFi.status() != WL_CONNECTED && millis() - startAttempt < WIFI_CONNECT_TIMEOUT) {
-      delay(500);
-      Serial.print(".");
-    }
-    
-    if (WiFi.status() == WL_CONNECTED) {
-      wifi_connected = true;
-      Serial.println("Connected!");
-      Serial.print("IP address: ");
-      Serial.println(WiFi.localIP());
-      
-      // Connect to MQTT broker if enabled
-      #if ENABLE_MQTT
-      connect_mqtt();
-      #endif
-    } else {
-      wifi_connected = false;
-      Serial.println("Failed. Will retry later.");
-      WiFi.disconnect(true);
+bool next_frame(DecimatedFrame &frame) {
+  RawSample sample;
+  while (sample_ring.pop(sample)) {
+#if ENABLE_BURST_CAPTURE
+    burst_feed(sample);
+#endif
+#if ENABLE_LIVE_STREAM
+    live_stream_feed(sample);
+#endif
+    if (decimator.add(sample, frame)) {
+      return true;
     }
-  } else {
-    wifi_connected = true;
   }
+  return false;
 }
 
 /**
  * Setup web server routes for file browsing and download
  */
 void setup_web_server() {
-  // Root page - serve file browser directly instead of redirecting
+  // Root page - the file browser is a static gzip asset (web/index.html)
   server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-    String html = "<!DOCTYPE html><html><head><meta name='viewport' content='width=device-width, initial-scale=1'>";
-    html += "<title>Battery Monitor Data Files</title>";
-    html += "<style>";
-    html += "body{font-family:Arial,sans-serif;margin:20px;background-color:#f5f5f5;}";
-    html += "h1,h2{color:#333;text-align:center;}";
-    html += "ul{list-style-type:none;padding:0;max-width:800px;margin:0 auto;}";
-    html += "li{margin:10px 0;padding:15px;border-radius:8px;background-color:#fff;box-shadow:0 2px 4px rgba(0,0,0,0.1);display:flex;justify-content:space-between;align-items:center;}";
-    html += "a{text-decoration:none;color:#0066cc;display:block;}";
-    html += "a:hover{text-decoration:underline;}";
-    html += ".file-actions{display:flex;gap:10px;}";
-    html += ".btn{border:none;border-radius:4px;padding:6px 12px;cursor:pointer;font-weight:bold;text-align:center;text-decoration:none;}";
-    html += ".btn-view{background-color:#28a745;color:white;}";
-    html += ".btn-delete{background-color:#dc3545;color:white;}";
-    html += ".btn-update{background-color:#007bff;color:white;margin:0 auto;display:block;width:200px;}";
-    html += ".btn:hover{opacity:0.9;}";
-    html += ".header{background-color:#343a40;color:white;padding:20px;border-radius:8px;margin-bottom:20px;}";
-    html += "hr{border:0;height:1px;background-color:#ddd;margin:20px 0;}";
-    html += ".footer{text-align:center;padding:10px;color:#666;font-size:0.9em;}";
-    html += ".path-nav{background-color:#e9ecef;padding:10px;border-radius:6px;margin-bottom:15px;text-align:center;}";
-    html += ".confirm-modal{display:none;position:fixed;top:0;left:0;width:100%;height:100%;background-color:rgba(0,0,0,0.5);align-items:center;justify-content:center;}";
-    html += ".modal-content{background-color:white;padding:20px;border-radius:8px;max-width:400px;text-align:center;}";
-    html += ".modal-buttons{display:flex;justify-content:center;gap:10px;margin-top:20px;}";
-    html += "</style>";
-    
-    // Add JavaScript for delete confirmation
-    html += "<script>";
-    html += "function confirmDelete(filename) {";
-    html += "  document.getElementById('file-to-delete').textContent = filename;";
-    html += "  document.getElementById('delete-form').action = '/delete';"; // Changed to use form input instead of URL parameter
-    html += "  document.getElementById('file-input').value = filename;";
-    html += "  document.getElementById('delete-modal').style.display = 'flex';";
-    html += "}";
-    html += "function closeModal() {";
-    html += "  document.getElementById('delete-modal').style.display = 'none';";
-    html += "}";
-    html += "</script>";
-    
-    html += "</head><body>";
-    
-    html += "<div class='header'>";
-    html += "<h1>Battery Management System</h1>";
-    html += "<p>Data File Browser</p>";
-    html += "</div>";
-    
-    // Get directory path from query parameter or use root
-    String path = "/";
-    if(request->hasParam("dir")) {
-      path = request->getParam("dir")->value();
+    if(request->hasHeader("If-None-Match") &&
+       request->getHeader("If-None-Match")->value() == INDEX_HTML_ETAG) {
+      request->send(304);
+      return;
     }
-    
-    html += "<div class='path-nav'>";
-    html += "<a href='/?dir=/'>[Root Directory]</a> | Current Path: " + path;
-    html += "</div>";
-    
-    html += "<h2>Files</h2>";
-    html += list_files(path);
-    
-    html += "<hr>";
-    html += "<div class='footer'>";
-    html += "<a href='/update' class='btn btn-update'>OTA Update</a>";
-    html += "<p>ESP32 Battery Management System | IP: " + WiFi.localIP().toString() + "</p>";
-    html += "</div>";
-    
-    // Add delete confirmation modal
-    html += "<div id='delete-modal' class='confirm-modal'>";
-    html += "<div class='modal-content'>";
-    html += "<h3>Confirm Delete</h3>";
-    html += "<p>Are you sure you want to delete the file:</p>";
-    html += "<p><strong id='file-to-delete'></strong>?</p>";
-    html += "<p>This action cannot be undone.</p>";
-    html += "<div class='modal-buttons'>";
-    html += "<form id='delete-form' method='post' action='/delete'>";
-    html += "<input type='hidden' id='file-input' name='file' value=''>";
-    html += "<button type='submit' class='btn btn-delete'>Delete</button>";
-    html += "</form>";
-    html += "<button onclick='closeModal()' class='btn'>Cancel</button>";
-    html += "</div></div></div>";
-    
-    html += "</body></html>";
-    
-    request->send(200, "text/html", html);
+    AsyncWebServerResponse *response =
+      request->beginResponse(200, "text/html", index_html_gz, index_html_gz_len);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("Cache-Control", "public, max-age=604800");
+    response->addHeader("ETag", INDEX_HTML_ETAG);
+    request->send(response);
+  });
+
+  // Directory listing as paginated JSON, used by the file browser
+  server.on("/api/files", HTTP_GET, [](AsyncWebServerRequest *request){
+    send_file_list(request);
+  });
+
+  // Dates that have log files, answered from the in-RAM file index
+  server.on("/api/days", HTTP_GET, [](AsyncWebServerRequest *request){
+    send_day_list(request);
+  });
+
+  // Tar archive of the logs of several days with a checksum manifest
+  server.on("/export", HTTP_GET, [](AsyncWebServerRequest *request){
+    send_export(request);
+  });
+
+  // Min/max/mean buckets of one channel over a time range, for plotting
+  server.on("/api/series", HTTP_GET, [](AsyncWebServerRequest *request){
+    send_series(request);
+  });
+
+  // Coulomb counter state; POST /api/charge/full marks the battery as full
+  server.on("/api/charge", HTTP_GET, [](AsyncWebServerRequest *request){
+    char json[192];
+    coulomb_json(json, sizeof(json));
+    request->send(200, "application/json", json);
+  });
+#if ENABLE_ANOMALY
+  // Drain anomaly detector state and alert counts (anomaly.h)
+  server.on("/api/anomaly", HTTP_GET, [](AsyncWebServerRequest *request){
+    char json[ANOMALY_JSON_SIZE];
+    anomaly_json(json, sizeof(json));
+    request->send(200, "application/json", json);
+  });
+#endif
+  // Channel names, units and ADC devices (channels.h)
+  server.on("/api/channels", HTTP_GET, [](AsyncWebServerRequest *request){
+    char json[CHANNELS_JSON_SIZE];
+    channels_json(json, sizeof(json));
+    request->send(200, "application/json", json);
+  });
+  server.on("/api/time", HTTP_GET, [](AsyncWebServerRequest *request){
+    char json[256];
+    time_json(json, sizeof(json));
+    request->send(200, "application/json", json);
+  });
+  server.on("/api/charge/full", HTTP_POST, [](AsyncWebServerRequest *request){
+    coulomb_mark_full();
+    request->send(200, "application/json", "{\"status\":\"ok\"}");
+  });
+
+  // Stage latencies, error counters and heap in the Prometheus text format
+  server.on("/metrics", HTTP_GET, [](AsyncWebServerRequest *request){
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+    metrics_prometheus(*response);
+    request->send(response);
+  });
+
+  // Calibration profile; POST takes the same keys as form or query parameters
+  server.on("/api/calibration", HTTP_GET, [](AsyncWebServerRequest *request){
+    char json[CALIBRATION_JSON_SIZE];
+    calibration_json(json, sizeof(json));
+    request->send(200, "application/json", json);
+  });
+  server.on("/api/calibration", HTTP_POST, [](AsyncWebServerRequest *request){
+    CalibrationProfile profile = calibration_profile();
+    for (size_t i = 0; i < request->params(); i++) {
+      const AsyncWebParameter *param = request->getParam(i);
+      if (!calibration_parse(profile, param->name().c_str(), param->value().c_str())) {
+        request->send(400, "text/plain", "Invalid calibration parameter: " + param->name());
+        return;
+      }
+    }
+    if (!calibration_apply(profile)) {
+      request->send(400, "text/plain", "Calibration gives no usable scale");
+      return;
+    }
+    char json[CALIBRATION_JSON_SIZE];
+    calibration_json(json, sizeof(json));
+    request->send(200, "application/json", json);
+  });
+  server.on("/api/calibration/zero", HTTP_POST, [](AsyncWebServerRequest *request){
+    long seconds = CALIBRATION_AUTO_ZERO_S;
+    if (request->hasParam("seconds")) {
+      seconds = request->getParam("seconds")->value().toInt();
+    }
+    if (seconds <= 0 || seconds > CALIBRATION_AUTO_ZERO_MAX_S ||
+        !calibration_start_auto_zero((uint16_t)seconds)) {
+      request->send(400, "text/plain", "Invalid auto-zero time");
+      return;
+    }
+    request->send(202, "application/json", "{\"status\":\"running\"}");
+  });
+  server.on("/api/calibration/reset", HTTP_POST, [](AsyncWebServerRequest *request){
+    calibration_reset();
+    request->send(200, "application/json", "{\"status\":\"ok\"}");
   });
 
   // Old path /getdata now redirects to root
@@ -790,50 +1099,30 @@ void setup_web_server() {
     request->redirect("/" + queryString);
   });
 
-  // File view/download handler
+  // File view/download handler, streamed from the card with Range support
   server.on("/download", HTTP_GET, [](AsyncWebServerRequest *request){
     if(request->hasParam("file")) {
       String filepath = request->getParam("file")->value();
-      
-      // Check if file exists
-      SdFile downloadFile;
-      if(downloadFile.open(filepath.c_str(), O_READ)) {
-        downloadFile.close();  // Close it immediately so that AsyncWebServer can handle it
-        
-        // Get file name from path
-        String filename = filepath;
-        int lastSlash = filepath.lastIndexOf('/');
-        if(lastSlash >= 0) {
-          filename = filepath.substring(lastSlash + 1);
-        }
-        
-        // Send file - read the file contents and send them
-        SdFile dataFile;
-        if (dataFile.open(filepath.c_str(), O_READ)) {
-          // Read file and send its contents
-          String fileContent = "";
-          char buffer[64];
-          int bytesRead;
-          
-          while ((bytesRead = dataFile.read(buffer, sizeof(buffer))) > 0) {
-            // Add read bytes to the string
-            for (int i = 0; i < bytesRead; i++) {
-              fileContent += buffer[i];
-            }
-          }
-          dataFile.close();
-          
-          // Set appropriate content type based on file extension
-          String contentType = "text/plain";
-          if (filename.endsWith(".txt")) contentType = "text/plain";
-          else if (filename.endsWith(".csv")) contentType = "text/csv";
-          else if (filename.endsWith(".json")) contentType = "application/json";
-          
-          request->send(200, contentType, fileContent);
-        } else {
-          request->send(404, "text/plain", "File not found");
+
+      // Get file name from path
+      String filename = filepath;
+      int lastSlash = filepath.lastIndexOf('/');
+      if(lastSlash >= 0) {
+        filename = filepath.substring(lastSlash + 1);
+      }
+
+      // Binary logs can be decoded on the fly: &format=csv[&from=HH:MM[:SS]][&to=HH:MM[:SS]]
+      if(filename.endsWith(".bin") && request->hasParam("format") &&
+         request->getParam("format")->value() == "csv") {
+        uint32_t from = request->hasParam("from") ? parse_time_of_day(request->getParam("from")->value()) : 0;
+        uint32_t to = request->hasParam("to") ? parse_time_of_day(request->getParam("to")->value()) : 86400;
+        if(!send_binlog_csv(request, filepath, from, to)) {
+          request->send(404, "text/plain", "Binary log not found");
         }
-      } else {
+        return;
+      }
+
+      if(!send_file_stream(request, filepath, file_content_type(filename))) {
         request->send(404, "text/plain", "File not found");
       }
     } else {
@@ -845,6 +1134,7 @@ void setup_web_server() {
   server.on("/delete", HTTP_POST, [](AsyncWebServerRequest *request){
     if(request->hasParam("file", true)) { // true indicates POST parameter
       String filepath = request->getParam("file", true)->value();
+      SdGuard guard;
       
       // Check if file exists
       SdFile deleteFile;
@@ -864,8 +1154,13 @@ void setup_web_server() {
           path = filepath.substring(0, lastSlash + 1);
         }
         
-        // Delete the file
+        // Delete the file (closing it first if it is one of today's logs)
+        sd_logger_release(filepath.c_str());
+#if ENABLE_MQTT
+        if (filename == MQTT_SPOOL_FILE) mqtt_spool_close();
+#endif
         if(sd.remove(filepath.c_str())) {
+          file_index_remove(filepath.c_str());
           // Redirect to the directory view with success message
           request->redirect("/?dir=" + path + "&msg=File+" + filename + "+deleted+successfully");
         } else {
@@ -880,6 +1175,13 @@ void setup_web_server() {
     }
   });
 
+#if ENABLE_LIVE_STREAM
+  // Raw samples at the full ADC rate, or decimated per client (ws://<ip>/ws/live)
+  float scale[NUM_CHANNELS], offset[NUM_CHANNELS];
+  calibration_headers(scale, offset);
+  live_stream_begin(server, ADS_DATA_RATE, scale, offset);
+#endif
+
   // Setup ElegantOTA
   ElegantOTA.begin(&server);
   
@@ -888,193 +1190,195 @@ void setup_web_server() {
   Serial.println("Web server started");
 }
 
+#if ENABLE_MQTT
 /**
- * List all files in the given directory
- * @param path Directory path on SD card
- * @return HTML formatted file list
+ * Make one attempt to connect to the MQTT broker.
+ * Retries are paced by the connection manager's backoff.
+ * @return true if successfully connected, false otherwise
  */
-String list_files(String path) {
-  String output = "<ul>";
-  
-  // End path with a slash if missing
-  if(!path.endsWith("/")) path += "/";
-  
-  // Try to open the directory
-  SdFile dir;
-  if(!dir.open(path.c_str(), O_READ)) {
-    return "<div style='text-align:center;padding:20px;background-color:#f8d7da;color:#721c24;border-radius:8px;'>Failed to open directory</div>";
+bool connect_mqtt() {
+  Serial.print("Attempting MQTT connection...");
+
+  // Attempt to connect with last will message for status
+  bool connected = mqtt.connect(mqtt_client_id, mqtt_user, mqtt_pass,
+                                mqtt_topic_status, 0, false, "{\"status\":\"offline\"}");
+  net_mqtt_attempt_result(connected, mqtt.state());
+
+  if (connected) {
+    Serial.println("connected");
+
+    // Once connected, publish an online status message
+    const NetStats &stats = net_stats();
+    IPAddress ip = WiFi.localIP();
+    char status_message[128];
+    snprintf(status_message, sizeof(status_message),
+             "{\"status\":\"online\",\"ip\":\"%u.%u.%u.%u\",\"wifi_connects\":%u,\"mqtt_connects\":%u}",
+             ip[0], ip[1], ip[2], ip[3], stats.wifi_connects, stats.mqtt_connects);
+    mqtt.publish(mqtt_topic_status, status_message, true);
+
+    char channels[CHANNELS_JSON_SIZE];
+    channels_json(channels, sizeof(channels));
+    mqtt.publish(mqtt_topic_channels, channels, true);
+
+    publish_calibration();
+    mqtt.subscribe(mqtt_topic_calibration_set);
+  } else {
+    Serial.print("failed, rc=");
+    Serial.print(mqtt.state());
+    Serial.printf(" retry in %u ms\n", net_stats().mqtt_retry_ms);
   }
-  
-  // Add parent directory link if not in root
-  if(path != "/") {
-    // Get parent directory path
-    String parentPath = path;
-    // Remove trailing slash
-    parentPath.remove(parentPath.length() - 1);
-    // Find last slash
-    int lastSlash = parentPath.lastIndexOf('/');
-    if(lastSlash > 0) {
-      parentPath = parentPath.substring(0, lastSlash + 1);
-    } else {
-      parentPath = "/";
-    }
-    
-    output += "<li>";
-    output += "<div><a href='/?dir=" + parentPath + "'><strong>[Parent Directory]</strong></a></div>";
-    output += "<div class='file-actions'></div>"; // Empty actions for parent dir
-    output += "</li>";
+  return connected;
+}
+
+/**
+ * Finish the current batch into the publish buffer.
+ * A previous batch that is still unsent moves to the offline spool.
+ */
+void finish_mqtt_batch() {
+  static uint32_t seen_queue_drops = 0;
+  if (mqtt_batch.empty()) return;
+
+  uint8_t flags = 0;
+  uint32_t queue_drops = metrics_counter(COUNTER_MQTT_QUEUE_DROPS);
+  if (queue_drops != seen_queue_drops) {
+    flags |= MQTT_FLAG_GAP_BEFORE;
+    seen_queue_drops = queue_drops;
   }
-  
-  // Count of files and directories
-  int fileCount = 0;
-  int dirCount = 0;
-  
-  // Loop through files and directories
-  SdFile entry;
-  while(entry.openNext(&dir, O_READ)) {
-    char fileName[64];
-    entry.getName(fileName, sizeof(fileName));
-    String name = String(fileName);
-    
-    if(entry.isDir()) {
-      // Directory entry
-      dirCount++;
-      output += "<li>";
-      output += "<div><a href='/?dir=" + path + name + "'><strong>[DIR] " + name + "</strong></a></div>";
-      output += "<div class='file-actions'></div>"; // Empty actions for directories
-      output += "</li>";
-    } else {
-      // File entry with download link and delete button
-      fileCount++;
-      size_t fileSize = entry.fileSize();
-      String sizeStr = get_file_size(fileSize);
-      
-      output += "<li>";
-      output += "<div>" + name + " <span style='color:#666;font-size:0.9em;'>(" + sizeStr + ")</span></div>";
-      output += "<div class='file-actions'>";
-      output += "<a href='/download?file=" + path + name + "' class='btn btn-view'>View</a>"; // Changed from Download to View
-      output += "<a href='javascript:void(0)' onclick='confirmDelete(\"" + path + name + "\")' class='btn btn-delete'>Delete</a>";
-      output += "</div>";
-      output += "</li>";
-    }
-    
-    entry.close();
+  if (mqtt_payload_len > 0 && !mqtt_spool_push(mqtt_payload, mqtt_payload_len)) {
+    mqtt_batches_dropped++;
   }
-  
-  dir.close();
-  output += "</ul>";
-  
-  // Add summary of files and directories
-  if (fileCount == 0 && dirCount == 0) {
-    output = "<div style='text-align:center;padding:20px;background-color:#fff3cd;color:#856404;border-radius:8px;margin-bottom:20px;'>Directory is empty</div>" + output;
-  } else {
-    String summary = "<div style='text-align:center;margin-bottom:15px;'>";
-    summary += String(dirCount) + " " + (dirCount == 1 ? "directory" : "directories") + ", ";
-    summary += String(fileCount) + " " + (fileCount == 1 ? "file" : "files");
-    summary += "</div>";
-    output = summary + output;
+  mqtt_payload_len = mqtt_batch.finish(mqtt_payload, flags);
+}
+
+/**
+ * Publish the pending batch to the data topic
+ * @return true if the batch was handed to the broker
+ */
+bool publish_batch() {
+  uint32_t start = metrics_now();
+  bool published = mqtt.publish(mqtt_topic_data, mqtt_payload, mqtt_payload_len, false);
+  metrics_record_since(STAGE_MQTT_PUBLISH, start);
+  if (!published) {
+    Serial.println("Failed to publish MQTT batch, will retry");
+    metrics_count(COUNTER_MQTT_PUBLISH_FAILURES);
+    return false;
   }
-  
-  return output;
+  mqtt_payload_len = 0;
+  publish_charge();
+  return true;
 }
 
 /**
- * Format file size in human readable format
- * @param bytes File size in bytes
- * @return Formatted size string (e.g. "1.2 MB")
+ * Publish the coulomb counter state as a retained JSON message,
+ * once per published batch
  */
-String get_file_size(size_t bytes) {
-  if(bytes < 1024) {
-    return String(bytes) + " B";
-  } else if(bytes < 1048576) { // 1MB
-    float kb = bytes / 1024.0;
-    return String(kb, 1) + " KB";
-  } else if(bytes < 1073741824) { // 1GB
-    float mb = bytes / 1048576.0;
-    return String(mb, 1) + " MB";
-  } else { 
-    float gb = bytes / 1073741824.0;
-    return String(gb, 1) + " GB";
+void publish_charge() {
+  char message[192];
+  coulomb_json(message, sizeof(message));
+  mqtt.publish(mqtt_topic_charge, message, true);
+}
+
+/**
+ * Publish the active calibration profile as a retained JSON message
+ */
+void publish_calibration() {
+  char message[CALIBRATION_JSON_SIZE];
+  calibration_json(message, sizeof(message));
+  mqtt.publish(mqtt_topic_calibration, message, true);
+}
+
+/**
+ * Incoming MQTT messages; only the calibration topic is subscribed.
+ * The payload is a "key=value&..." string as accepted by /api/calibration.
+ */
+void on_mqtt_message(char *topic, uint8_t *payload, unsigned int length) {
+  if (strcmp(topic, mqtt_topic_calibration_set) != 0) return;
+
+  char query[128];
+  if (length >= sizeof(query)) {
+    Serial.println("ERROR: Calibration message too long");
+    return;
+  }
+  memcpy(query, payload, length);
+  query[length] = '\0';
+  if (!calibration_apply_query(query)) {
+    Serial.print("ERROR: Rejected calibration update: ");
+    Serial.println(query);
   }
 }
 
-#if ENABLE_MQTT
 /**
- * Connect to MQTT broker
- * @return true if successfully connected, false otherwise
+ * Publish the stage latency summary every METRICS_PUBLISH_INTERVAL_MS
  */
-bool connect_mqtt() {
-  if (!wifi_connected) return false;
-  
-  // Loop until we're connected
-  int attempts = 0;
-  while (!mqtt.connected() && attempts < 3) {
-    Serial.print("Attempting MQTT connection...");
-    
-    // Attempt to connect with last will message for status
-    if (mqtt.connect(mqtt_client_id, mqtt_user, mqtt_pass, 
-                    mqtt_topic_status, 0, false, "{\"status\":\"offline\"}")) {
-      Serial.println("connected");
-      
-      // Once connected, publish an online status message
-      String status_message = "{\"status\":\"online\",\"ip\":\"" + WiFi.localIP().toString() + "\"}";
-      mqtt.publish(mqtt_topic_status, status_message.c_str(), true);
-      return true;
-    } else {
-      Serial.print("failed, rc=");
-      Serial.print(mqtt.state());
-      Serial.println(" try again in 2 seconds");
-      delay(2000);
-      attempts++;
-    }
+void publish_metrics() {
+  static unsigned long last_publish = 0;
+  if (!mqtt.connected() || millis() - last_publish < METRICS_PUBLISH_INTERVAL_MS) return;
+  last_publish = millis();
+
+  char message[640];
+  metrics_json(message, sizeof(message));
+  if (!mqtt.publish(mqtt_topic_metrics, message, false)) {
+    metrics_count(COUNTER_MQTT_PUBLISH_FAILURES);
   }
-  
-  return false;
 }
 
+#if ENABLE_BURST_CAPTURE
 /**
- * Publish a single data point to MQTT
- * @param current Current measurement in Amperes
- * @param voltage Voltage measurement in Volts
- * @param timestamp Timestamp of the measurement
+ * Publish the oldest captured event that MQTT has not seen yet. Events are
+ * larger than the client buffer, so the payload is streamed. While offline
+ * the event is skipped; it is still in the event file on the card.
  */
-void publish_data_point(float current, float voltage, DateTime timestamp) {
-  if (!mqtt.connected()) return;
-  
-  // Create JSON-like message with timestamp and values
-  char buffer[150];
-  sprintf(buffer, 
-          "{\"timestamp\":\"%04d-%02d-%02d %02d:%02d:%02d\",\"current\":%.3f,\"voltage\":%.2f}", 
-          timestamp.year(), timestamp.month(), timestamp.day(),
-          timestamp.hour(), timestamp.minute(), timestamp.second(),
-          current, voltage);
-  
-  // Publish current value to current topic
-  int retries = 0;
-  while (!mqtt.publish(mqtt_topic_current, buffer) && retries < 3) {
-    Serial.println("Failed to publish current data, retrying...");
-    delay(100);
-    mqtt.loop();
-    retries++;
+void publish_event() {
+  const BurstEvent *event = burst_peek(BURST_CONSUMER_MQTT);
+  if (!event) return;
+
+  if (mqtt.connected()) {
+    size_t len = burst_event_size(event);
+    if (!mqtt.beginPublish(mqtt_topic_event, len, false) ||
+        mqtt.write((const uint8_t *)event, len) != len || !mqtt.endPublish()) {
+      Serial.println("Failed to publish current event");
+      metrics_count(COUNTER_MQTT_PUBLISH_FAILURES);
+    }
   }
-  
-  // Publish voltage to voltage topic (use the same message for simplicity)
-  retries = 0;
-  while (!mqtt.publish(mqtt_topic_voltage, buffer) && retries < 3) {
-    Serial.println("Failed to publish voltage data, retrying...");
-    delay(100);
-    mqtt.loop();
-    retries++;
+  burst_release(BURST_CONSUMER_MQTT, event);
+}
+#endif
+
+#if ENABLE_ANOMALY
+/**
+ * Publish the oldest anomaly alert. It stays queued while the broker is
+ * unreachable, so alerts raised while parked go out in the next upload window.
+ */
+void publish_alert() {
+  AnomalyAlert alert;
+  if (!mqtt.connected() || !anomaly_peek(alert)) return;
+
+  char message[ANOMALY_ALERT_JSON_SIZE];
+  anomaly_alert_json(alert, message, sizeof(message));
+  if (!mqtt.publish(mqtt_topic_alert, message, false)) {
+    metrics_count(COUNTER_MQTT_PUBLISH_FAILURES);
+    return;
   }
-  
-  if (retries >= 3) {
-    Serial.println("Failed to publish one or more data points");
-  } else {
-    Serial.println("Data published to MQTT successfully");
+  anomaly_release();
+}
+#endif
+
+/**
+ * Replay the oldest spooled batch, at most once per MQTT_SPOOL_DRAIN_INTERVAL_MS.
+ * The batch leaves the spool only after the broker accepted it.
+ */
+void drain_spool() {
+  static unsigned long last_drain = 0;
+  if (millis() - last_drain < MQTT_SPOOL_DRAIN_INTERVAL_MS) return;
+  last_drain = millis();
+
+  size_t len = mqtt_spool_peek(spool_payload);
+  if (len == 0) return;
+
+  spool_payload[offsetof(MqttBatchHeader, flags)] |= MQTT_FLAG_BACKLOG;
+  if (mqtt.publish(mqtt_topic_data, spool_payload, len, false)) {
+    mqtt_spool_pop();
   }
-  
-  // Process any incoming messages
-  mqtt.loop();
 }
 #endif
 
@@ -1104,7 +1408,7 @@ void interface(float amps, int dir) {
   // Add WiFi status indicator
   display.setCursor(0, 0);
   display.print("WiFi:");
-  display.print(wifi_connected ? "Connected" : "Disconnected");
+  display.print(net_wifi_connected() ? "Connected" : "Disconnected");
   
   // Call animation function for arrow
   move_arrow(dir, amps);
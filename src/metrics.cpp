@@ -0,0 +1,183 @@
+#include "metrics.h"
+#include "sampler.h"
+#include "net_manager.h"
+
+struct StageHistogram {
+  uint32_t buckets[METRICS_BUCKETS];
+  uint32_t count;
+  uint64_t sum_us;
+  uint32_t max_us;
+};
+
+static StageHistogram histograms[NUM_STAGES];
+static uint32_t counters[NUM_COUNTERS];
+static portMUX_TYPE counter_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *const stage_names[NUM_STAGES] = {
+  "sample_latency", "sampler", "acquire", "sd_log",
+  "mqtt_publish", "mqtt_loop", "ota_loop", "net_loop"
+};
+
+static const char *const counter_names[NUM_COUNTERS] = {
+  "sd_write_errors", "sd_reinits", "sd_queue_drops",
+  "mqtt_queue_drops", "mqtt_publish_failures", "live_drops"
+};
+
+static const char *const counter_help[NUM_COUNTERS] = {
+  "Failed SD card writes", "SD card reinitializations",
+  "Measurements lost because the SD writer fell behind",
+  "Measurements lost because the MQTT publisher fell behind",
+  "MQTT messages the broker did not accept",
+  "Live stream frames skipped for slow WebSocket clients"
+};
+
+/**
+ * Bucket of a duration: exact below METRICS_SUB_BUCKETS, then
+ * METRICS_SUB_BUCKETS linear steps per power of two
+ */
+static uint32_t bucket_index(uint32_t us) {
+  if (us < METRICS_SUB_BUCKETS) return us;
+  uint32_t msb = 31 - __builtin_clz(us);
+  uint32_t sub = (us >> (msb - 2)) & (METRICS_SUB_BUCKETS - 1);
+  uint32_t index = (msb - 1) * METRICS_SUB_BUCKETS + sub;
+  return index < METRICS_BUCKETS ? index : METRICS_BUCKETS - 1;
+}
+
+// Largest duration that falls into a bucket
+static uint32_t bucket_upper_us(uint32_t index) {
+  if (index < METRICS_SUB_BUCKETS) return index;
+  uint32_t msb = index / METRICS_SUB_BUCKETS + 1;
+  uint32_t sub = index % METRICS_SUB_BUCKETS;
+  return ((METRICS_SUB_BUCKETS + sub + 1) << (msb - 2)) - 1;
+}
+
+void metrics_record_since(MetricStage stage, uint32_t start) {
+  uint32_t cycles = metrics_now() - start;
+  metrics_record_us(stage, cycles / ESP.getCpuFreqMHz());
+}
+
+void metrics_record_us(MetricStage stage, uint32_t us) {
+  if (stage >= NUM_STAGES) return;
+  StageHistogram &h = histograms[stage];
+  h.buckets[bucket_index(us)]++;
+  h.count++;
+  h.sum_us += us;
+  if (us > h.max_us) h.max_us = us;
+}
+
+void metrics_count(MetricCounter counter) {
+  if (counter >= NUM_COUNTERS) return;
+  portENTER_CRITICAL(&counter_spinlock);
+  counters[counter]++;
+  portEXIT_CRITICAL(&counter_spinlock);
+}
+
+uint32_t metrics_counter(MetricCounter counter) {
+  return counter < NUM_COUNTERS ? counters[counter] : 0;
+}
+
+/**
+ * Upper bound of the bucket holding the q-th fraction of the samples
+ */
+static uint32_t quantile_us(const StageHistogram &h, uint32_t count, uint32_t per_mille) {
+  if (count == 0) return 0;
+  uint64_t rank = ((uint64_t)count * per_mille + 999) / 1000;
+  uint64_t seen = 0;
+  for (uint32_t i = 0; i < METRICS_BUCKETS; i++) {
+    seen += h.buckets[i];
+    if (seen >= rank) return min(bucket_upper_us(i), h.max_us);
+  }
+  return h.max_us;
+}
+
+StageSummary metrics_stage(MetricStage stage) {
+  StageSummary summary = { 0, 0, 0, 0 };
+  if (stage >= NUM_STAGES) return summary;
+  const StageHistogram &h = histograms[stage];
+  summary.count = h.count;
+  summary.p50_us = quantile_us(h, h.count, 500);
+  summary.p99_us = quantile_us(h, h.count, 990);
+  summary.max_us = h.max_us;
+  return summary;
+}
+
+const char *metrics_stage_name(MetricStage stage) {
+  return stage < NUM_STAGES ? stage_names[stage] : "unknown";
+}
+
+// Microseconds as seconds without floating point
+static void print_seconds(Print &out, uint64_t us) {
+  out.printf("%llu.%06llu", (unsigned long long)(us / 1000000), (unsigned long long)(us % 1000000));
+}
+
+static void print_metric(Print &out, const char *type, const char *name, const char *help, uint32_t value) {
+  out.printf("# HELP bms_%s %s\n# TYPE bms_%s %s\nbms_%s %u\n", name, help, name, type, name, value);
+}
+
+void metrics_prometheus(Print &out) {
+  out.print("# HELP bms_stage_duration_seconds Time spent in each pipeline stage\n"
+            "# TYPE bms_stage_duration_seconds summary\n");
+  for (int stage = 0; stage < NUM_STAGES; stage++) {
+    const char *name = stage_names[stage];
+    StageSummary summary = metrics_stage((MetricStage)stage);
+    out.printf("bms_stage_duration_seconds{stage=\"%s\",quantile=\"0.5\"} ", name);
+    print_seconds(out, summary.p50_us);
+    out.printf("\nbms_stage_duration_seconds{stage=\"%s\",quantile=\"0.99\"} ", name);
+    print_seconds(out, summary.p99_us);
+    out.printf("\nbms_stage_duration_seconds_sum{stage=\"%s\"} ", name);
+    print_seconds(out, histograms[stage].sum_us);
+    out.printf("\nbms_stage_duration_seconds_count{stage=\"%s\"} %u\n", name, summary.count);
+  }
+  out.print("# HELP bms_stage_duration_max_seconds Longest run of each stage since boot\n"
+            "# TYPE bms_stage_duration_max_seconds gauge\n");
+  for (int stage = 0; stage < NUM_STAGES; stage++) {
+    out.printf("bms_stage_duration_max_seconds{stage=\"%s\"} ", stage_names[stage]);
+    print_seconds(out, histograms[stage].max_us);
+    out.print("\n");
+  }
+
+  char name[48];
+  for (int counter = 0; counter < NUM_COUNTERS; counter++) {
+    snprintf(name, sizeof(name), "%s_total", counter_names[counter]);
+    print_metric(out, "counter", name, counter_help[counter], counters[counter]);
+  }
+  print_metric(out, "counter", "sampler_missed_conversions_total",
+               "Conversions overwritten before the sampler read them (missed deadlines)",
+               sampler_missed_conversions());
+  print_metric(out, "counter", "sampler_dropped_samples_total",
+               "Samples lost because the ring was full", sampler_dropped_samples());
+  print_metric(out, "counter", "sampler_range_switches_total",
+               "PGA gain changes made by auto-ranging", sampler_range_switches());
+
+  const NetStats &net = net_stats();
+  print_metric(out, "counter", "wifi_connects_total", "WiFi connections", net.wifi_connects);
+  print_metric(out, "counter", "wifi_disconnects_total", "WiFi connections lost", net.wifi_disconnects);
+  print_metric(out, "counter", "mqtt_connect_attempts_total", "Broker connect attempts", net.mqtt_attempts);
+  print_metric(out, "counter", "mqtt_connects_total", "Broker connections", net.mqtt_connects);
+
+  print_metric(out, "gauge", "heap_free_bytes", "Free heap", ESP.getFreeHeap());
+  print_metric(out, "gauge", "heap_min_free_bytes", "Lowest free heap since boot", ESP.getMinFreeHeap());
+  print_metric(out, "gauge", "heap_largest_free_block_bytes", "Largest allocatable block", ESP.getMaxAllocHeap());
+  print_metric(out, "gauge", "uptime_seconds", "Time since boot", millis() / 1000);
+}
+
+size_t metrics_json(char *out, size_t size) {
+  size_t len = snprintf(out, size, "{\"uptime_s\":%lu,\"stages\":{", millis() / 1000);
+  for (int stage = 0; stage < NUM_STAGES && len < size; stage++) {
+    StageSummary summary = metrics_stage((MetricStage)stage);
+    len += snprintf(out + len, size - len, "%s\"%s\":[%u,%u,%u,%u]", stage ? "," : "",
+                    stage_names[stage], summary.count, summary.p50_us, summary.p99_us, summary.max_us);
+  }
+  for (int counter = 0; counter < NUM_COUNTERS && len < size; counter++) {
+    len += snprintf(out + len, size - len, "%s\"%s\":%u", counter ? "," : "},",
+                    counter_names[counter], counters[counter]);
+  }
+  if (len < size) {
+    len += snprintf(out + len, size - len,
+                    ",\"missed_conversions\":%u,\"dropped_samples\":%u,"
+                    "\"heap_free\":%u,\"heap_min_free\":%u,\"heap_largest_block\":%u}",
+                    sampler_missed_conversions(), sampler_dropped_samples(),
+                    ESP.getFreeHeap(), ESP.getMinFreeHeap(), ESP.getMaxAllocHeap());
+  }
+  return len < size ? len : size - 1;
+}
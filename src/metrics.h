@@ -0,0 +1,115 @@
+// metrics.h
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <Arduino.h>
+
+/**
+ * Latency histograms and error counters for the data path
+ *
+ * Each pipeline stage is timed with the CPU cycle counter and recorded in
+ * a log-linear histogram of microseconds (METRICS_SUB_BUCKETS buckets per
+ * power of two, so quantiles are within ~20%). A stage must always be
+ * recorded from the same task: that task is the only writer of its
+ * histogram, so recording is a few increments without locks. Readers may
+ * see a histogram mid-update, which only skews one sample.
+ *
+ * The cycle counter is per core and wraps after ~17 s at 240 MHz; all
+ * timed tasks are pinned, and longer stages are clamped to one wrap.
+ *
+ * metrics_prometheus() renders everything in the Prometheus text format
+ * for /metrics, metrics_json() a compact summary for MQTT.
+ */
+
+// ===== CONFIGURATION =====
+#define METRICS_SUB_BUCKETS 4             // Buckets per power of two
+#define METRICS_BUCKETS 96                // Covers up to 2^25 us (~33 s)
+#ifndef METRICS_PUBLISH_INTERVAL_MS
+#define METRICS_PUBLISH_INTERVAL_MS 60000 // MQTT summary period
+#endif
+
+enum MetricStage : uint8_t {
+  STAGE_SAMPLE_LATENCY,   // RDY edge to sample in the ring (sampler task)
+  STAGE_SAMPLER,          // One sampler_service() call, I2C read and mux switch
+  STAGE_ACQUIRE,          // Handling one decimated frame (acquisition task)
+  STAGE_SD_LOG,           // sd_logger_log(), including block writes and syncs
+  STAGE_MQTT_PUBLISH,     // Publishing one batch to the broker
+  STAGE_MQTT_LOOP,        // mqtt.loop()
+  STAGE_OTA_LOOP,         // ElegantOTA.loop()
+  STAGE_NET_LOOP,         // net_manager_loop()
+  NUM_STAGES
+};
+
+enum MetricCounter : uint8_t {
+  COUNTER_SD_WRITE_ERRORS,      // Failed card writes (buffer dropped, file reopened)
+  COUNTER_SD_REINITS,           // Card reinitialized to reopen a log
+  COUNTER_SD_QUEUE_DROPS,       // Measurements lost because the SD writer fell behind
+  COUNTER_MQTT_QUEUE_DROPS,     // Measurements lost because the publisher fell behind
+  COUNTER_MQTT_PUBLISH_FAILURES,// Batches or events the broker did not accept
+  COUNTER_LIVE_DROPS,           // Live stream frames skipped for slow WebSocket clients
+  NUM_COUNTERS
+};
+
+/**
+ * Quantiles of one stage
+ */
+struct StageSummary {
+  uint32_t count;
+  uint32_t p50_us;
+  uint32_t p99_us;
+  uint32_t max_us;
+};
+
+// Current cycle counter, the start of a timed section
+inline uint32_t metrics_now() {
+  return ESP.getCycleCount();
+}
+
+/**
+ * Record a stage that started at metrics_now() value start
+ */
+void metrics_record_since(MetricStage stage, uint32_t start);
+
+/**
+ * Record a duration measured some other way
+ */
+void metrics_record_us(MetricStage stage, uint32_t us);
+
+// Increment an error counter (any task)
+void metrics_count(MetricCounter counter);
+
+uint32_t metrics_counter(MetricCounter counter);
+
+StageSummary metrics_stage(MetricStage stage);
+
+// Name of a stage as used in the exported metrics
+const char *metrics_stage_name(MetricStage stage);
+
+// Write all metrics in the Prometheus text exposition format
+void metrics_prometheus(Print &out);
+
+/**
+ * Format a one-line JSON summary (p50/p99/max per stage, counters, heap)
+ * @return Length written
+ */
+size_t metrics_json(char *out, size_t size);
+
+/**
+ * Times a scope as one stage
+ *
+ *   { StageTimer timer(STAGE_SD_LOG); sd_logger_log(...); }
+ */
+class StageTimer {
+public:
+  explicit StageTimer(MetricStage stage) : stage(stage), start(metrics_now()) {}
+  ~StageTimer() { metrics_record_since(stage, start); }
+
+  StageTimer(const StageTimer &) = delete;
+  StageTimer &operator=(const StageTimer &) = delete;
+
+private:
+  MetricStage stage;
+  uint32_t start;
+};
+
+#endif
@@ -0,0 +1,55 @@
+#include "mqtt_batch.h"
+
+void MqttBatch::begin(uint16_t interval_ms, const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]) {
+  memset(&header, 0, sizeof(header));
+  header.version = MQTT_SCHEMA_VERSION;
+  header.channels = NUM_CHANNELS;
+  header.header_size = sizeof(MqttBatchHeader);
+  header.interval_ms = interval_ms;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    header.scale[ch] = scale[ch];
+    header.offset[ch] = offset[ch];
+  }
+
+  uint32_t records = MQTT_BATCH_INTERVAL_MS / (interval_ms ? interval_ms : 1);
+  if (records < 1) records = 1;
+  if (records > MQTT_BATCH_MAX_RECORDS) records = MQTT_BATCH_MAX_RECORDS;
+  capacity = records;
+  count = 0;
+}
+
+void MqttBatch::set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]) {
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    header.scale[ch] = scale[ch];
+    header.offset[ch] = offset[ch];
+  }
+}
+
+bool MqttBatch::accepts(uint32_t epoch) const {
+  if (count == 0) return true;
+  if (count >= capacity) return false;
+
+  // Same cadence check as the binary log: allow one interval (or second) of jitter
+  uint32_t expected = header.epoch + (uint32_t)(((uint64_t)count * header.interval_ms) / 1000);
+  uint32_t tolerance = max(1UL, (unsigned long)(header.interval_ms / 1000));
+  return epoch + tolerance >= expected && epoch <= expected + tolerance;
+}
+
+void MqttBatch::add(uint32_t epoch, const int16_t codes[NUM_CHANNELS]) {
+  if (count >= MQTT_BATCH_MAX_RECORDS) return;
+  if (count == 0) header.epoch = epoch;
+  memcpy(&data[count * NUM_CHANNELS], codes, MQTT_BATCH_RECORD_SIZE);
+  count++;
+}
+
+size_t MqttBatch::finish(uint8_t *out, uint8_t flags) {
+  header.flags = flags;
+  header.count = count;
+  header.sequence = sequence++;
+  memcpy(out, &header, sizeof(header));
+  memcpy(out + sizeof(header), data, count * MQTT_BATCH_RECORD_SIZE);
+
+  size_t len = sizeof(header) + count * MQTT_BATCH_RECORD_SIZE;
+  count = 0;
+  return len;
+}
@@ -0,0 +1,103 @@
+// mqtt_batch.h
+#ifndef MQTT_BATCH_H
+#define MQTT_BATCH_H
+
+#include <Arduino.h>
+#include "sampler.h"
+
+/**
+ * Batched MQTT payloads
+ *
+ * Measurements are collected for MQTT_BATCH_INTERVAL_MS and published as one
+ * packed binary message on a single topic instead of one JSON message per
+ * sample and channel. Layout (little endian):
+ *   MqttBatchHeader (32 bytes for two channels)
+ *   count records of int16 ADC codes, one per channel
+ *
+ * Records are spaced interval_ms apart starting at epoch; a time gap ends
+ * the batch early. A channel without data in an interval is stored as
+ * MQTT_BATCH_NO_DATA. Physical value = code * scale[ch] + offset[ch], the
+ * same convention as the binary SD log (binlog.h).
+ *
+ * visualization/MqttBatch.py decodes these messages.
+ */
+
+#ifndef MQTT_BATCH_INTERVAL_MS
+#define MQTT_BATCH_INTERVAL_MS 60000    // Time covered by one message
+#endif
+#define MQTT_BATCH_MAX_RECORDS 300      // Upper bound on records per message
+#define MQTT_SCHEMA_VERSION 1
+#define MQTT_BATCH_NO_DATA INT16_MIN
+
+// Header flags
+#define MQTT_FLAG_GAP_BEFORE 0x01       // Records were lost just before this batch
+#define MQTT_FLAG_BACKLOG 0x02          // Replayed from the offline spool, not live
+
+struct __attribute__((packed)) MqttBatchHeader {
+  uint8_t version;                // MQTT_SCHEMA_VERSION
+  uint8_t flags;                  // MQTT_FLAG_*
+  uint8_t channels;               // Codes per record
+  uint8_t header_size;            // Offset of the first record
+  uint16_t interval_ms;           // Spacing of records
+  uint16_t count;                 // Records in this message
+  uint32_t epoch;                 // RTC unix time of the first record
+  uint32_t sequence;              // Message counter since boot, exposes lost messages
+  float scale[NUM_CHANNELS];      // Physical units per code
+  float offset[NUM_CHANNELS];     // Physical offset
+};
+
+#define MQTT_BATCH_RECORD_SIZE (NUM_CHANNELS * sizeof(int16_t))
+#define MQTT_BATCH_MAX_PAYLOAD (sizeof(MqttBatchHeader) + MQTT_BATCH_MAX_RECORDS * MQTT_BATCH_RECORD_SIZE)
+
+/**
+ * Builds one batch message in a fixed buffer
+ */
+class MqttBatch {
+public:
+  /**
+   * Configure the batch
+   * @param interval_ms Spacing of the measurements
+   * @param scale Physical units per code for each channel
+   * @param offset Physical offset for each channel
+   */
+  void begin(uint16_t interval_ms, const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]);
+
+  // Calibration for the header of the current and later batches
+  void set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]);
+
+  /**
+   * Check whether a record can join the current batch
+   * @param epoch RTC unix time of the record
+   * @return false if the batch is full or the record does not follow its cadence
+   */
+  bool accepts(uint32_t epoch) const;
+
+  /**
+   * Append one record
+   * @param epoch RTC unix time of the record
+   * @param codes ADC code per channel (MQTT_BATCH_NO_DATA if missing)
+   */
+  void add(uint32_t epoch, const int16_t codes[NUM_CHANNELS]);
+
+  // True once the batch covers MQTT_BATCH_INTERVAL_MS
+  bool full() const { return count >= capacity; }
+  bool empty() const { return count == 0; }
+  uint16_t records() const { return count; }
+
+  /**
+   * Finish the batch into a payload and start a new one
+   * @param out Buffer of at least MQTT_BATCH_MAX_PAYLOAD bytes
+   * @param flags MQTT_FLAG_* for the header
+   * @return Payload length
+   */
+  size_t finish(uint8_t *out, uint8_t flags);
+
+private:
+  MqttBatchHeader header;
+  int16_t data[MQTT_BATCH_MAX_RECORDS * NUM_CHANNELS];
+  uint16_t count = 0;
+  uint16_t capacity = 1;
+  uint32_t sequence = 0;
+};
+
+#endif
@@ -0,0 +1,238 @@
+#include "mqtt_spool.h"
+#include "sd_access.h"
+#include "crc32.h"
+#include "file_index.h"
+
+#define SPOOL_MAGIC "SPOL"
+#define SPOOL_VERSION 2
+#define SPOOL_SLOT_MAGIC 0x5B01
+#define SPOOL_DATA_OFFSET 512
+
+struct __attribute__((packed)) SpoolHeader {
+  char magic[4];          // "SPOL"
+  uint16_t version;       // SPOOL_VERSION
+  uint16_t slot_size;     // MQTT_SPOOL_SLOT_SIZE when written
+  uint32_t slots;         // MQTT_SPOOL_SLOTS when written
+  uint32_t head;          // Batches ever written
+  uint32_t tail;          // Batches ever consumed
+  uint32_t overwritten;   // Batches lost to a full ring
+  uint32_t crc;           // CRC-32 of the fields above
+};
+
+struct __attribute__((packed)) SpoolSlotHeader {
+  uint16_t magic;         // SPOOL_SLOT_MAGIC
+  uint16_t length;        // Payload bytes
+  uint32_t counter;       // head counter the slot was written for
+  uint32_t crc;           // CRC-32 of the payload
+};
+
+static SpoolHeader state;
+static bool spool_ready = false;
+static SdFile spool_file;
+static bool spool_open = false;
+static uint16_t unsaved = 0;   // Pushes and pops since the header was written
+
+static uint32_t slot_offset(uint32_t counter) {
+  return SPOOL_DATA_OFFSET + (counter % MQTT_SPOOL_SLOTS) * (uint32_t)MQTT_SPOOL_SLOT_SIZE;
+}
+
+static void reset_state() {
+  memset(&state, 0, sizeof(state));
+  memcpy(state.magic, SPOOL_MAGIC, 4);
+  state.version = SPOOL_VERSION;
+  state.slot_size = MQTT_SPOOL_SLOT_SIZE;
+  state.slots = MQTT_SPOOL_SLOTS;
+}
+
+static bool write_state() {
+  state.crc = crc32_update(0, &state, offsetof(SpoolHeader, crc));
+
+  uint8_t sector[SPOOL_DATA_OFFSET];
+  memset(sector, 0, sizeof(sector));
+  memcpy(sector, &state, sizeof(state));
+  if (!spool_file.seekSet(0) || spool_file.write(sector, sizeof(sector)) != sizeof(sector)) {
+    return false;
+  }
+  unsaved = 0;
+  return spool_file.sync();
+}
+
+/**
+ * Open the spool file unless it is open, creating it (pre-allocated if
+ * possible) when missing. A file that was deleted behind our back starts
+ * over empty. The extent is erased, so slots of an earlier file in the
+ * same clusters cannot be mistaken for pushes at boot.
+ */
+static bool open_spool() {
+  if (spool_open) return true;
+  if (!spool_file.open(MQTT_SPOOL_FILE, O_RDWR | O_CREAT)) {
+    return false;
+  }
+  spool_open = true;
+  if (spool_file.fileSize() == 0) {
+    reset_state();
+    uint32_t first_sector, last_sector;
+    if (spool_file.preAllocate(SPOOL_DATA_OFFSET + (uint32_t)MQTT_SPOOL_SLOTS * MQTT_SPOOL_SLOT_SIZE) &&
+        (!spool_file.contiguousRange(&first_sector, &last_sector) ||
+         !sd.card()->erase(first_sector, last_sector))) {
+      spool_file.truncate(0);  // Grow slot by slot instead
+    }
+    return write_state();
+  }
+  return true;
+}
+
+// Write the header once enough changes piled up, or when the spool ran empty
+static void cursor_moved() {
+  if (++unsaved >= MQTT_SPOOL_SAVE_EVERY || state.tail == state.head) {
+    write_state();
+  }
+}
+
+/**
+ * Advance head over the slots pushed after the header was last written.
+ * Each was written for its own counter, so old slots of an earlier lap
+ * end the search.
+ */
+static uint32_t recover_pushes() {
+  uint32_t found = 0;
+  while (found < MQTT_SPOOL_SLOTS) {
+    SpoolSlotHeader slot;
+    if (!spool_file.seekSet(slot_offset(state.head)) ||
+        spool_file.read(&slot, sizeof(slot)) != (int)sizeof(slot) ||
+        slot.magic != SPOOL_SLOT_MAGIC || slot.length > MQTT_BATCH_MAX_PAYLOAD ||
+        slot.counter != state.head) {
+      break;
+    }
+    state.head++;
+    if (state.head - state.tail > MQTT_SPOOL_SLOTS) {
+      state.tail++;
+      state.overwritten++;
+    }
+    found++;
+  }
+  return found;
+}
+
+bool mqtt_spool_begin() {
+  SdGuard guard;
+  if (!open_spool()) {
+    Serial.println("ERROR: Cannot open MQTT spool file");
+    return false;
+  }
+
+  SpoolHeader stored;
+  bool valid = spool_file.seekSet(0) &&
+               spool_file.read(&stored, sizeof(stored)) == (int)sizeof(stored) &&
+               memcmp(stored.magic, SPOOL_MAGIC, 4) == 0 &&
+               stored.version == SPOOL_VERSION &&
+               stored.slot_size == MQTT_SPOOL_SLOT_SIZE &&
+               stored.slots == MQTT_SPOOL_SLOTS &&
+               stored.crc == crc32_update(0, &stored, offsetof(SpoolHeader, crc)) &&
+               stored.head - stored.tail <= MQTT_SPOOL_SLOTS;
+
+  uint32_t recovered = 0;
+  if (valid) {
+    state = stored;
+    recovered = recover_pushes();
+  } else {
+    // New file or a different configuration: start with an empty spool
+    reset_state();
+  }
+  spool_ready = write_state();
+  file_index_touch(MQTT_SPOOL_FILE, spool_file.fileSize());
+
+  Serial.printf("MQTT spool: %u batches waiting (%u recovered)\n",
+                (unsigned)mqtt_spool_count(), (unsigned)recovered);
+  return spool_ready;
+}
+
+bool mqtt_spool_push(const uint8_t *data, size_t len) {
+  if (!spool_ready || len > MQTT_BATCH_MAX_PAYLOAD) return false;
+
+  SdGuard guard;
+  if (!open_spool()) return false;
+
+  SpoolSlotHeader slot;
+  slot.magic = SPOOL_SLOT_MAGIC;
+  slot.length = len;
+  slot.counter = state.head;
+  slot.crc = crc32_update(0, data, len);
+
+  // Without the pre-allocated extent, slots before the first wrap are
+  // appended and padded to full size
+  bool ok = spool_file.seekSet(slot_offset(state.head)) &&
+            spool_file.write(&slot, sizeof(slot)) == sizeof(slot) &&
+            spool_file.write(data, len) == len;
+  if (ok && spool_file.curPosition() < slot_offset(state.head) + MQTT_SPOOL_SLOT_SIZE &&
+      spool_file.curPosition() >= spool_file.fileSize()) {
+    static const uint8_t padding[64] = {0};
+    uint32_t pad = slot_offset(state.head) + MQTT_SPOOL_SLOT_SIZE - spool_file.curPosition();
+    while (ok && pad > 0) {
+      size_t n = min(pad, (uint32_t)sizeof(padding));
+      ok = spool_file.write(padding, n) == n;
+      pad -= n;
+    }
+  }
+  if (!ok) return false;
+
+  state.head++;
+  if (state.head - state.tail > MQTT_SPOOL_SLOTS) {
+    state.tail++;        // Ring full: drop the oldest batch
+    state.overwritten++;
+  }
+  cursor_moved();
+  return true;
+}
+
+size_t mqtt_spool_peek(uint8_t *out) {
+  if (!spool_ready) return 0;
+
+  SdGuard guard;
+  if (!open_spool()) return 0;
+
+  size_t len = 0;
+  while (len == 0 && state.tail != state.head) {
+    SpoolSlotHeader slot;
+    bool ok = spool_file.seekSet(slot_offset(state.tail)) &&
+              spool_file.read(&slot, sizeof(slot)) == (int)sizeof(slot) &&
+              slot.magic == SPOOL_SLOT_MAGIC &&
+              slot.length <= MQTT_BATCH_MAX_PAYLOAD &&
+              slot.counter == state.tail &&
+              spool_file.read(out, slot.length) == (int)slot.length &&
+              crc32_update(0, out, slot.length) == slot.crc;
+    if (ok) {
+      len = slot.length;
+    } else {
+      Serial.println("WARNING: Skipping corrupt MQTT spool slot");
+      state.tail++;
+      cursor_moved();
+    }
+  }
+  return len;
+}
+
+void mqtt_spool_pop() {
+  if (!spool_ready || state.tail == state.head) return;
+
+  SdGuard guard;
+  if (!open_spool()) return;
+  state.tail++;
+  cursor_moved();
+}
+
+void mqtt_spool_close() {
+  SdGuard guard;
+  if (!spool_open) return;
+  if (unsaved > 0) write_state();
+  spool_file.close();
+  spool_open = false;
+}
+
+uint32_t mqtt_spool_count() {
+  return state.head - state.tail;
+}
+
+uint32_t mqtt_spool_overwritten() {
+  return state.overwritten;
+}
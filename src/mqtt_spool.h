@@ -0,0 +1,76 @@
+// mqtt_spool.h
+#ifndef MQTT_SPOOL_H
+#define MQTT_SPOOL_H
+
+#include <Arduino.h>
+#include "mqtt_batch.h"
+
+/**
+ * Store-and-forward spool for MQTT batches
+ *
+ * Batches that cannot be published (WiFi or broker down) are written to a
+ * fixed-size ring file on the SD card. Once the broker is back, the MQTT
+ * task replays them oldest first at a limited rate, after any live batch.
+ * Replayed messages carry MQTT_FLAG_BACKLOG and their original timestamps.
+ *
+ * Layout of MQTT_SPOOL_FILE:
+ *   Sector 0: SpoolHeader with the write (head) and read (tail) counters
+ *   MQTT_SPOOL_SLOTS slots of MQTT_SPOOL_SLOT_SIZE bytes, each a
+ *   SpoolSlotHeader followed by one batch payload
+ *
+ * The counters only grow; slot = counter % MQTT_SPOOL_SLOTS. When the ring
+ * is full the oldest batch is overwritten. The file is pre-allocated at
+ * creation and stays open; the header is only rewritten (and the file
+ * synced) every MQTT_SPOOL_SAVE_EVERY pushes and pops, or when the spool
+ * runs empty. Every slot carries the counter it was written for, so at
+ * boot the batches pushed after the last save are found again. Batches
+ * popped after it are replayed a second time.
+ */
+
+#define MQTT_SPOOL_FILE "mqtt_spool.bin"
+#ifndef MQTT_SPOOL_SLOTS
+#define MQTT_SPOOL_SLOTS 4096                 // Batches kept (~2.8 days at one batch per minute)
+#endif
+#ifndef MQTT_SPOOL_DRAIN_INTERVAL_MS
+#define MQTT_SPOOL_DRAIN_INTERVAL_MS 250      // Minimum time between replayed messages
+#endif
+#define MQTT_SPOOL_SAVE_EVERY 16               // Pushes and pops between header writes
+#define MQTT_SPOOL_SLOT_SIZE (((MQTT_BATCH_MAX_PAYLOAD + 12) + 511) / 512 * 512)
+
+/**
+ * Open the spool file and restore the cursors
+ * @return true if the spool is usable
+ */
+bool mqtt_spool_begin();
+
+/**
+ * Append a batch to the spool, overwriting the oldest one when full
+ * @param data Batch payload
+ * @param len Payload length (at most MQTT_BATCH_MAX_PAYLOAD)
+ * @return true if the batch was written
+ */
+bool mqtt_spool_push(const uint8_t *data, size_t len);
+
+/**
+ * Read the oldest spooled batch without removing it. Corrupt slots are skipped.
+ * @param out Buffer of at least MQTT_BATCH_MAX_PAYLOAD bytes
+ * @return Payload length, 0 if the spool is empty
+ */
+size_t mqtt_spool_peek(uint8_t *out);
+
+// Remove the batch returned by the last mqtt_spool_peek()
+void mqtt_spool_pop();
+
+/**
+ * Save the cursors and close the spool file (before OTA or deleting it).
+ * The next push or peek opens it again.
+ */
+void mqtt_spool_close();
+
+// Batches waiting in the spool
+uint32_t mqtt_spool_count();
+
+// Batches lost because the spool was full
+uint32_t mqtt_spool_overwritten();
+
+#endif
@@ -0,0 +1,186 @@
+#include "net_manager.h"
+#include <WiFi.h>
+#include <atomic>
+
+/**
+ * Exponential backoff with +-25% jitter, so many units that lost the same
+ * access point or broker do not retry in lockstep
+ */
+struct Backoff {
+  uint32_t min_ms;
+  uint32_t max_ms;
+  uint32_t base_ms;       // Doubles on every consecutive failure
+  uint32_t delay_ms = 0;  // base_ms with jitter, the wait before the next attempt
+  uint32_t last_ms = 0;
+  bool waiting = false;
+
+  Backoff(uint32_t min_delay, uint32_t max_delay) : min_ms(min_delay), max_ms(max_delay), base_ms(min_delay) {}
+
+  bool due(uint32_t now) const { return !waiting || now - last_ms >= delay_ms; }
+
+  void fail(uint32_t now) {
+    if (waiting) {
+      base_ms = min(base_ms * 2, max_ms);
+    }
+    uint32_t jitter = base_ms / 4;
+    delay_ms = base_ms - jitter + random(2 * jitter + 1);
+    last_ms = now;
+    waiting = true;
+  }
+
+  void reset() {
+    base_ms = min_ms;
+    delay_ms = 0;
+    waiting = false;
+  }
+};
+
+static const char *wifi_ssid;
+static const char *wifi_password;
+static NetStats stats;
+static Backoff wifi_backoff(WIFI_BACKOFF_MIN_MS, WIFI_BACKOFF_MAX_MS);
+static Backoff mqtt_backoff(MQTT_BACKOFF_MIN_MS, MQTT_BACKOFF_MAX_MS);
+static uint32_t attempt_start_ms = 0;
+
+// Set from the WiFi event task, taken (read and cleared at once) by net_manager_loop()
+static std::atomic<bool> event_got_ip(false);
+static std::atomic<bool> event_disconnected(false);
+static volatile NetWifiState wifi_state = NET_WIFI_DOWN;
+
+static void on_wifi_event(arduino_event_id_t event, arduino_event_info_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      event_got_ip = true;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      // Our own WiFi.disconnect() before a new attempt; the state machine
+      // already knows, and the event may arrive after WiFi.begin()
+      if (info.wifi_sta_disconnected.reason == WIFI_REASON_ASSOC_LEAVE) break;
+      event_disconnected = true;
+      break;
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      event_disconnected = true;
+      break;
+    default:
+      break;
+  }
+}
+
+void net_manager_begin(const char *ssid, const char *password, const char *hostname) {
+  wifi_ssid = ssid;
+  wifi_password = password;
+  memset(&stats, 0, sizeof(stats));
+
+  WiFi.mode(WIFI_STA);
+  WiFi.setHostname(hostname);
+  WiFi.setAutoReconnect(false);  // Reconnects are paced by the backoff below
+  WiFi.onEvent(on_wifi_event);
+  wifi_state = NET_WIFI_DOWN;    // First attempt on the next loop call
+}
+
+void net_manager_loop() {
+  uint32_t now = millis();
+  bool got_ip = event_got_ip.exchange(false);
+  bool disconnected = event_disconnected.exchange(false);
+
+  switch (wifi_state) {
+    case NET_WIFI_DOWN:
+      if (wifi_backoff.due(now)) {
+        Serial.println("Attempting to connect to WiFi...");
+        WiFi.disconnect();
+        // Events of the old connection must not end the new attempt
+        event_got_ip = false;
+        event_disconnected = false;
+        WiFi.begin(wifi_ssid, wifi_password);
+        stats.wifi_attempts++;
+        attempt_start_ms = now;
+        wifi_state = NET_WIFI_CONNECTING;
+      }
+      break;
+
+    case NET_WIFI_CONNECTING:
+      if (got_ip) {
+        wifi_state = NET_WIFI_UP;
+        stats.wifi_connects++;
+        stats.wifi_up_since_ms = now ? now : 1;
+        wifi_backoff.reset();
+        mqtt_backoff.reset();
+        Serial.print("WiFi connected, IP address: ");
+        Serial.println(WiFi.localIP());
+      } else if (disconnected || now - attempt_start_ms > WIFI_CONNECT_TIMEOUT_MS) {
+        wifi_state = NET_WIFI_DOWN;
+        wifi_backoff.fail(now);
+        Serial.printf("WiFi connection failed, retry in %u ms\n", wifi_backoff.delay_ms);
+      }
+      break;
+
+    case NET_WIFI_OFF:
+      break;
+
+    case NET_WIFI_UP:
+      if (disconnected) {
+        wifi_state = NET_WIFI_DOWN;
+        stats.wifi_disconnects++;
+        stats.wifi_up_since_ms = 0;
+        // First retry right away, back off only if it fails
+        wifi_backoff.reset();
+        Serial.println("WiFi connection lost");
+      }
+      break;
+  }
+
+  stats.wifi_state = wifi_state;
+  stats.wifi_retry_ms = wifi_backoff.delay_ms;
+  stats.mqtt_retry_ms = mqtt_backoff.delay_ms;
+}
+
+void net_set_radio(bool on) {
+  if (on == (wifi_state != NET_WIFI_OFF)) return;
+  if (on) {
+    WiFi.mode(WIFI_STA);
+    wifi_backoff.reset();
+    event_disconnected = false;
+    wifi_state = NET_WIFI_DOWN;
+    Serial.println("WiFi radio on");
+  } else {
+    wifi_state = NET_WIFI_OFF;
+    stats.wifi_up_since_ms = 0;
+    WiFi.disconnect(true);
+    WiFi.mode(WIFI_OFF);
+    Serial.println("WiFi radio off");
+  }
+  stats.wifi_state = wifi_state;
+}
+
+bool net_wifi_connected() {
+  return wifi_state == NET_WIFI_UP;
+}
+
+bool net_mqtt_attempt_due() {
+  return net_wifi_connected() && mqtt_backoff.due(millis());
+}
+
+void net_mqtt_attempt_result(bool connected, int error) {
+  stats.mqtt_attempts++;
+  if (connected) {
+    stats.mqtt_connects++;
+    mqtt_backoff.reset();
+  } else {
+    stats.mqtt_last_error = error;
+    mqtt_backoff.fail(millis());
+  }
+}
+
+const NetStats &net_stats() {
+  return stats;
+}
+
+const char *net_wifi_state_name(NetWifiState state) {
+  switch (state) {
+    case NET_WIFI_DOWN: return "down";
+    case NET_WIFI_CONNECTING: return "connecting";
+    case NET_WIFI_UP: return "up";
+    case NET_WIFI_OFF: return "off";
+  }
+  return "?";
+}
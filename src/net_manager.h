@@ -0,0 +1,97 @@
+// net_manager.h
+#ifndef NET_MANAGER_H
+#define NET_MANAGER_H
+
+#include <Arduino.h>
+
+/**
+ * Non-blocking WiFi and MQTT connection management
+ *
+ * WiFi is driven by WiFi.onEvent() callbacks and a small state machine that
+ * net_manager_loop() advances without waiting: it starts a connection
+ * attempt, checks for the result on later calls and backs off exponentially
+ * (with jitter) after failures, so a dead access point never stalls the
+ * caller. The broker connection uses the same backoff; the MQTT task asks
+ * net_mqtt_attempt_due() before each single connect attempt and reports the
+ * result.
+ *
+ * Connection state and reconnect statistics are available through
+ * net_stats() for the serial log and status reports.
+ *
+ * The radio can be switched off between uploads (net_set_radio()); the
+ * state machine then rests in NET_WIFI_OFF until it is switched back on.
+ */
+
+// ===== CONFIGURATION =====
+#ifndef WIFI_CONNECT_TIMEOUT_MS
+#define WIFI_CONNECT_TIMEOUT_MS 10000   // Give up on one WiFi attempt after this
+#endif
+#define WIFI_BACKOFF_MIN_MS 1000        // First retry delay after a failure
+#define WIFI_BACKOFF_MAX_MS 60000       // Retry delay ceiling
+#define MQTT_BACKOFF_MIN_MS 1000
+#define MQTT_BACKOFF_MAX_MS 60000
+
+enum NetWifiState {
+  NET_WIFI_DOWN,         // Waiting for the next attempt
+  NET_WIFI_CONNECTING,   // WiFi.begin() issued, waiting for an IP
+  NET_WIFI_UP,           // Connected with an IP address
+  NET_WIFI_OFF           // Radio switched off by net_set_radio()
+};
+
+/**
+ * Connection counters since boot
+ */
+struct NetStats {
+  NetWifiState wifi_state;
+  uint32_t wifi_attempts;       // WiFi.begin() calls
+  uint32_t wifi_connects;       // Successful connections
+  uint32_t wifi_disconnects;    // Connections lost after being up
+  uint32_t mqtt_attempts;       // Broker connect attempts
+  uint32_t mqtt_connects;       // Successful broker connections
+  int mqtt_last_error;          // PubSubClient state() of the last failure
+  uint32_t wifi_up_since_ms;    // millis() when WiFi came up (0 if down)
+  uint32_t wifi_retry_ms;       // Current WiFi backoff delay
+  uint32_t mqtt_retry_ms;       // Current broker backoff delay
+};
+
+/**
+ * Register WiFi events and schedule the first connection attempt
+ * @param ssid Network name
+ * @param password Network password
+ * @param hostname DHCP host name
+ */
+void net_manager_begin(const char *ssid, const char *password, const char *hostname);
+
+// Advance the WiFi state machine; never blocks. Call every few milliseconds.
+void net_manager_loop();
+
+/**
+ * Switch the WiFi radio on or off. Switching on starts a connection attempt
+ * on the next loop call; switching off drops the connection without counting
+ * it as lost. Repeated calls with the same state do nothing.
+ */
+void net_set_radio(bool on);
+
+// True when WiFi is connected and has an IP address
+bool net_wifi_connected();
+
+/**
+ * Check whether the broker backoff allows a connect attempt now
+ * @return true if WiFi is up and the retry delay has passed
+ */
+bool net_mqtt_attempt_due();
+
+/**
+ * Record the result of a broker connect attempt
+ * @param connected true if the attempt succeeded
+ * @param error PubSubClient state() on failure
+ */
+void net_mqtt_attempt_result(bool connected, int error);
+
+// Current state and counters
+const NetStats &net_stats();
+
+// Short name of a WiFi state for logs
+const char *net_wifi_state_name(NetWifiState state);
+
+#endif
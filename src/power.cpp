@@ -0,0 +1,174 @@
+#include "power.h"
+#include "sampler.h"
+#include "scaler.h"
+#include "calibration.h"
+#include "net_manager.h"
+#include "sd_access.h"
+#include <esp_sleep.h>
+#include <esp_timer.h>
+#include <driver/gpio.h>
+
+static uint8_t power_alert_pin = 0;
+static uint32_t period_ms = 1000;
+static uint32_t park_frames = 0;       // Quiet frames before parking
+static QueueHandle_t watched_queues[POWER_MAX_QUEUES];
+static uint8_t watched_count = 0;
+static PowerStats stats = { POWER_ACTIVE, 0, 0, 0, 0, 0 };
+
+// Owned by the acquisition task
+static volatile PowerState state = POWER_ACTIVE;
+static uint32_t quiet_frames = 0;
+static uint32_t active_cpu_mhz = 240;
+
+// Owned by the network task
+static bool window_open = false;
+static uint32_t window_start_ms = 0;   // Start of the current or last upload window
+static volatile bool uploads_done = false;
+
+/**
+ * Shunt code (reference gain) of a current, inverse of the active scaler
+ */
+static int32_t shunt_code(int32_t ua) {
+  const Scaler &scaler = calibration_scaler(CH_AMPS);
+  if (scaler.factor == 0) return 0;
+  return (int32_t)(((int64_t)(ua - scaler.offset) << SCALER_SHIFT) / scaler.factor);
+}
+
+static void park() {
+  int32_t low = shunt_code(-POWER_WAKE_CURRENT_UA);
+  int32_t high = shunt_code(POWER_WAKE_CURRENT_UA);
+  if (low > high) {
+    int32_t swap = low;
+    low = high;
+    high = swap;
+  }
+  active_cpu_mhz = getCpuFrequencyMhz();
+  setCpuFrequencyMhz(POWER_PARK_CPU_MHZ);
+  sampler_park(period_ms * 1000, low, high);
+  window_start_ms = millis();
+  uploads_done = false;
+  state = POWER_PARKED;
+  stats.parks++;
+  Serial.printf("Parked: comparator window %d..%d, radio every %u s\n", low, high, POWER_UPLOAD_INTERVAL_S);
+}
+
+static void wake(bool comparator) {
+  sampler_unpark();
+  setCpuFrequencyMhz(active_cpu_mhz);
+  quiet_frames = 0;
+  state = POWER_ACTIVE;
+  if (comparator) stats.comparator_wakes++;
+  Serial.printf("Woken by %s\n", comparator ? "comparator" : "current");
+}
+
+// Nothing would be cut short by stopping both cores now
+static bool sleep_ready() {
+  if (net_stats().wifi_state != NET_WIFI_OFF) return false;
+  if (sample_ring.available() > 0) return false;
+  for (uint8_t i = 0; i < watched_count; i++) {
+    if (uxQueueMessagesWaiting(watched_queues[i]) > 0) return false;
+  }
+  return true;
+}
+
+/**
+ * Light-sleep for up to us microseconds, or until ALERT/RDY goes low.
+ * The GPIO interrupt is off meanwhile: a level wakeup would otherwise keep
+ * firing the edge ISR.
+ * @return false if the SD card was busy
+ */
+static bool light_sleep(uint32_t us) {
+  if (!sd_try_lock()) return false;
+  Serial.flush();
+
+  gpio_num_t pin = (gpio_num_t)power_alert_pin;
+  gpio_intr_disable(pin);
+  gpio_wakeup_enable(pin, GPIO_INTR_LOW_LEVEL);
+  esp_sleep_enable_gpio_wakeup();
+  esp_sleep_enable_timer_wakeup(us);
+
+  int64_t start = esp_timer_get_time();
+  esp_light_sleep_start();
+  stats.sleep_us += esp_timer_get_time() - start;
+  stats.sleeps++;
+
+  gpio_wakeup_disable(pin);
+  gpio_set_intr_type(pin, GPIO_INTR_NEGEDGE);
+  gpio_intr_enable(pin);
+  sd_unlock();
+  return true;
+}
+
+// Sampler idle hook between parked conversion rounds (sampler task)
+static void park_idle(uint32_t until_us) {
+  for (;;) {
+    int32_t left = (int32_t)(until_us - micros());
+    if (left <= 0 || digitalRead(power_alert_pin) == LOW || !sampler_parked()) return;
+    if (left >= POWER_SLEEP_MIN_US && sleep_ready() && light_sleep(left)) continue;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(min(left / 1000 + 1, (int32_t)POWER_BUSY_POLL_MS)));
+  }
+}
+
+void power_begin(uint8_t alert_pin, uint32_t interval_ms) {
+  power_alert_pin = alert_pin;
+  period_ms = interval_ms;
+  park_frames = (uint32_t)POWER_PARK_AFTER_S * 1000 / interval_ms;
+  sampler_on_idle(park_idle);
+}
+
+void power_watch_queue(QueueHandle_t queue) {
+  if (queue && watched_count < POWER_MAX_QUEUES) {
+    watched_queues[watched_count++] = queue;
+  }
+}
+
+void power_feed(int32_t amps_ua) {
+  uint32_t magnitude = abs(amps_ua);
+  if (state == POWER_PARKED) {
+    if (!sampler_parked()) {
+      wake(true);
+    } else if (magnitude > POWER_WAKE_CURRENT_UA) {
+      wake(false);
+    }
+    return;
+  }
+
+  if (magnitude >= POWER_PARK_CURRENT_UA) {
+    quiet_frames = 0;
+  } else if (++quiet_frames >= park_frames) {
+    park();
+  }
+}
+
+bool power_radio_wanted() {
+  if (state != POWER_PARKED) {
+    window_open = false;
+    return true;
+  }
+
+  uint32_t now = millis();
+  if (!window_open) {
+    if (now - window_start_ms < (uint32_t)POWER_UPLOAD_INTERVAL_S * 1000) return false;
+    window_open = true;
+    window_start_ms = now;
+    uploads_done = false;
+    stats.uploads++;
+  } else if (uploads_done || now - window_start_ms >= (uint32_t)POWER_UPLOAD_WINDOW_S * 1000) {
+    window_open = false;
+  }
+  return window_open;
+}
+
+void power_upload_done() {
+  if (window_open) uploads_done = true;
+}
+
+bool power_parked() {
+  return state == POWER_PARKED;
+}
+
+PowerStats power_stats() {
+  PowerStats copy = stats;
+  copy.state = state;
+  return copy;
+}
@@ -0,0 +1,98 @@
+// power.h
+#ifndef POWER_H
+#define POWER_H
+
+#include <Arduino.h>
+
+/**
+ * Low-power acquisition while the vehicle is parked
+ *
+ * The acquisition task passes every frame's mean current to power_feed().
+ * After POWER_PARK_AFTER_S of |current| below POWER_PARK_CURRENT_UA the
+ * monitor parks:
+ *  - the sampler is duty-cycled (sampler_park()): one conversion per
+ *    channel per output interval, and in between the ADS1115 watches the
+ *    shunt in window-comparator mode at +-POWER_WAKE_CURRENT_UA
+ *  - the CPU drops to POWER_PARK_CPU_MHZ and light-sleeps between
+ *    conversion rounds, woken by the timer or by ALERT/RDY going low
+ *  - the WiFi radio is off, except for an upload window every
+ *    POWER_UPLOAD_INTERVAL_S; MQTT batches finished meanwhile wait in the
+ *    spool (mqtt_spool.h)
+ *
+ * Light sleep keeps RAM, so the sample ring, the decimator and the log
+ * buffers carry over as they are. The CPU only sleeps when the sample ring
+ * and the watched queues are empty, the SD mutex is free and the radio is
+ * off, so no task is stopped half way through a frame or an SD transfer.
+ *
+ * A comparator wake, or a frame above POWER_WAKE_CURRENT_UA, returns to
+ * continuous sampling at the full rate with the radio on.
+ */
+
+// ===== CONFIGURATION =====
+#ifndef POWER_PARK_CURRENT_UA
+#define POWER_PARK_CURRENT_UA 1000000     // |current| below this counts as parked (1 A)
+#endif
+#ifndef POWER_PARK_AFTER_S
+#define POWER_PARK_AFTER_S 600            // Quiet time before parking
+#endif
+#ifndef POWER_WAKE_CURRENT_UA
+#define POWER_WAKE_CURRENT_UA 2000000     // Comparator window and wake level (2 A)
+#endif
+#ifndef POWER_UPLOAD_INTERVAL_S
+#define POWER_UPLOAD_INTERVAL_S 900       // Radio wakes this often while parked
+#endif
+#define POWER_UPLOAD_WINDOW_S 60          // Longest radio-on time per upload
+#define POWER_PARK_CPU_MHZ 80             // Lowest clock that still runs WiFi
+#define POWER_SLEEP_MIN_US 2000           // Shorter waits stay awake
+#define POWER_BUSY_POLL_MS 2              // Recheck interval while another task is busy
+#define POWER_MAX_QUEUES 4
+
+enum PowerState : uint8_t {
+  POWER_ACTIVE,   // Continuous sampling, radio on
+  POWER_PARKED    // Duty-cycled sampling and light sleep
+};
+
+/**
+ * Counters since boot
+ */
+struct PowerStats {
+  PowerState state;
+  uint32_t parks;               // Switches to POWER_PARKED
+  uint32_t comparator_wakes;    // Parks ended by the ADS1115 comparator
+  uint32_t sleeps;              // Light sleeps entered
+  uint64_t sleep_us;            // Time spent in light sleep
+  uint32_t uploads;             // Radio windows opened while parked
+};
+
+/**
+ * Register the light-sleep idle hook with the sampler
+ * @param alert_pin GPIO connected to the ADS1115 ALERT/RDY output
+ * @param interval_ms Output interval; parked conversion rounds are this far apart
+ */
+void power_begin(uint8_t alert_pin, uint32_t interval_ms);
+
+/**
+ * Only sleep while this queue is empty (up to POWER_MAX_QUEUES)
+ */
+void power_watch_queue(QueueHandle_t queue);
+
+/**
+ * Park or wake on a frame's mean current (acquisition task)
+ * @param amps_ua Mean current of the interval
+ */
+void power_feed(int32_t amps_ua);
+
+/**
+ * Whether the radio should be on now (network task). Opens and closes the
+ * upload windows while parked.
+ */
+bool power_radio_wanted();
+
+// Nothing is waiting for upload; closes the current window early (MQTT task)
+void power_upload_done();
+
+bool power_parked();
+
+PowerStats power_stats();
+
+#endif
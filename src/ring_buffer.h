@@ -0,0 +1,82 @@
+// ring_buffer.h
+#ifndef RING_BUFFER_H
+#define RING_BUFFER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <atomic>
+
+/**
+ * Lock-free single-producer / single-consumer ring buffer.
+ *
+ * One task (or ISR) may call push() while exactly one other task calls pop().
+ * No mutex is taken, so the producer never waits on the consumer.
+ * When the buffer is full, push() fails and the caller counts the drop.
+ *
+ * @tparam T    Element type (copied by value, keep it small)
+ * @tparam SIZE Capacity, must be a power of two
+ */
+template <typename T, size_t SIZE>
+class RingBuffer {
+  static_assert(SIZE >= 2 && (SIZE & (SIZE - 1)) == 0, "RingBuffer SIZE must be a power of two");
+
+public:
+  RingBuffer() : head(0), tail(0) {}
+
+  /**
+   * Add an element (producer side)
+   * @return false if the buffer is full
+   */
+  bool push(const T &item) {
+    uint32_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) >= SIZE) {
+      return false;
+    }
+    items[h & (SIZE - 1)] = item;
+    head.store(h + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Remove the oldest element (consumer side)
+   * @return false if the buffer is empty
+   */
+  bool pop(T &item) {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[t & (SIZE - 1)];
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+  }
+
+  /**
+   * Copy the oldest element without removing it (consumer side)
+   * @return false if the buffer is empty
+   */
+  bool peek(T &item) const {
+    uint32_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+    item = items[t & (SIZE - 1)];
+    return true;
+  }
+
+  /**
+   * Number of elements waiting to be popped
+   */
+  size_t available() const {
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const { return SIZE; }
+
+private:
+  T items[SIZE];
+  std::atomic<uint32_t> head;  // Written only by the producer
+  std::atomic<uint32_t> tail;  // Written only by the consumer
+};
+
+#endif
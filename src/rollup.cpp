@@ -0,0 +1,173 @@
+#include "rollup.h"
+#include "sd_access.h"
+#include "file_index.h"
+
+static const uint32_t periods[ROLLUP_LEVELS] = { 60, 3600 };
+
+uint32_t rollup_period(uint8_t level) {
+  return periods[level];
+}
+
+static uint32_t file_key(uint8_t level, const DateTime &time) {
+  uint32_t month = time.year() * 100UL + time.month();
+  return level == ROLLUP_MINUTE ? month * 100UL + time.day() : month;
+}
+
+void rollup_file_name(uint8_t level, const DateTime &time, char *name, size_t size) {
+  if (level == ROLLUP_MINUTE) {
+    snprintf(name, size, "Minute %04d-%02d-%02d.rol", time.year(), time.month(), time.day());
+  } else {
+    snprintf(name, size, "Hour %04d-%02d.rol", time.year(), time.month());
+  }
+}
+
+// uA * ms per Ah
+#define UA_MS_PER_AH 3.6e12f
+
+void RollupLog::begin(uint32_t interval) {
+  interval_ms = interval;
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    levels[level].count = 0;
+    levels[level].file_key = 0;
+  }
+}
+
+void RollupLog::add(const DateTime &time, const int32_t values[NUM_CHANNELS]) {
+  uint32_t epoch = time.unixtime();
+  int64_t sum[NUM_CHANNELS];
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) sum[ch] = values[ch];
+  fold(ROLLUP_MINUTE, epoch - epoch % periods[ROLLUP_MINUTE], 1, values, values, sum,
+       (int64_t)values[CH_AMPS] * interval_ms);
+}
+
+/**
+ * Merge values into a level's current period, finishing the period first if
+ * the values belong to a different one
+ */
+void RollupLog::fold(uint8_t level, uint32_t start, uint32_t count, const int32_t min[NUM_CHANNELS],
+                     const int32_t max[NUM_CHANNELS], const int64_t sum[NUM_CHANNELS], int64_t charge_ua_ms) {
+  Level &lv = levels[level];
+  if (lv.count > 0 && lv.start != start) {
+    finish(level);
+  }
+
+  if (lv.count == 0) {
+    lv.start = start;
+    lv.charge_ua_ms = 0;
+    for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+      lv.min[ch] = min[ch];
+      lv.max[ch] = max[ch];
+      lv.sum[ch] = 0;
+    }
+  }
+
+  lv.count += count;
+  lv.charge_ua_ms += charge_ua_ms;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    if (min[ch] < lv.min[ch]) lv.min[ch] = min[ch];
+    if (max[ch] > lv.max[ch]) lv.max[ch] = max[ch];
+    lv.sum[ch] += sum[ch];
+  }
+}
+
+void RollupLog::to_record(const Level &lv, RollupRecord &record) const {
+  record.epoch = lv.start;
+  record.count = lv.count;
+  // Floats only in the file record
+  record.charge_ah = lv.charge_ua_ms / UA_MS_PER_AH;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    record.min[ch] = lv.min[ch] / 1e6f;
+    record.max[ch] = lv.max[ch] / 1e6f;
+    record.mean[ch] = (int32_t)(lv.sum[ch] / (int64_t)lv.count) / 1e6f;
+  }
+}
+
+/**
+ * Write a level's current period and pass it up to the next level
+ */
+void RollupLog::finish(uint8_t level) {
+  Level &lv = levels[level];
+  if (lv.count == 0) return;
+
+  RollupRecord record;
+  to_record(lv, record);
+  if (open_for(level, lv.start)) {
+    lv.file.write((const uint8_t *)&record, sizeof(record));
+    file_index_touch(lv.file.path(), lv.file.size());
+  }
+
+  lv.count = 0;
+  if (level + 1 < ROLLUP_LEVELS) {
+    uint32_t period = periods[level + 1];
+    fold(level + 1, lv.start - lv.start % period, record.count, lv.min, lv.max, lv.sum, lv.charge_ua_ms);
+  }
+}
+
+bool RollupLog::pending(uint8_t level, RollupRecord &record) const {
+  const Level &lv = levels[level];
+  if (lv.count == 0) return false;
+  to_record(lv, record);
+  return true;
+}
+
+bool RollupLog::open_for(uint8_t level, uint32_t epoch) {
+  Level &lv = levels[level];
+  DateTime time(epoch);
+  uint32_t key = file_key(level, time);
+  if (lv.file.is_open() && lv.file_key == key) return true;
+
+  lv.file.close();
+
+  char filename[32];
+  rollup_file_name(level, time, filename, sizeof(filename));
+
+  // A record torn by a power loss would misalign all later ones: cut it off
+  SdFile existing;
+  if (existing.open(filename, O_RDWR)) {
+    uint32_t size = existing.fileSize();
+    if (size > ROLLUP_HEADER_SIZE) {
+      uint32_t torn = (size - ROLLUP_HEADER_SIZE) % sizeof(RollupRecord);
+      if (torn) existing.truncate(size - torn);
+    }
+    existing.close();
+  }
+
+  if (!lv.file.open(filename)) {
+    Serial.print("ERROR: Failed to open rollup file: ");
+    Serial.println(filename);
+    return false;
+  }
+
+  if (lv.file.size() == 0) {
+    RollupHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, ROLLUP_MAGIC, 4);
+    header.version = ROLLUP_VERSION;
+    header.header_size = ROLLUP_HEADER_SIZE;
+    header.period_s = periods[level];
+    header.channels = NUM_CHANNELS;
+    header.record_size = sizeof(RollupRecord);
+    header.start_epoch = epoch;
+    lv.file.write((const uint8_t *)&header, sizeof(header));
+  }
+  lv.file_key = key;
+  return true;
+}
+
+void RollupLog::sync() {
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    levels[level].file.sync();
+  }
+}
+
+void RollupLog::close() {
+  // Unfinished periods are written as they are; a restart within the same
+  // period adds a second record that readers merge
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    finish(level);
+  }
+  for (int level = 0; level < ROLLUP_LEVELS; level++) {
+    levels[level].file.close();
+    levels[level].file_key = 0;
+  }
+}
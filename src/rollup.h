@@ -0,0 +1,122 @@
+// rollup.h
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <Arduino.h>
+#include <RTClib.h>
+#include "sampler.h"
+#include "sd_logger.h"
+
+/**
+ * Per-minute and per-hour aggregates of the logged values
+ *
+ * While the logger writes the 1 Hz data, every value is folded into the
+ * current minute; each finished minute is written as one RollupRecord and
+ * folded into the current hour. Long-range plots read these files (a month
+ * of hours is ~26 KB) instead of the raw history.
+ *
+ *   "Minute YYYY-MM-DD.rol"  one file per day, 1440 records
+ *   "Hour YYYY-MM.rol"       one file per month, ~720 records
+ *
+ * Layout (little endian): RollupHeader (ROLLUP_HEADER_SIZE bytes), then
+ * fixed-size RollupRecords in time order. Records cover the period starting
+ * at their epoch; count is the number of values folded in. A period that
+ * was interrupted by a restart can appear twice, readers merge records with
+ * the same epoch. charge_ah integrates the current channel (positive =
+ * discharge) over the values' spacing.
+ *
+ * visualization/Rollup.py reads these files.
+ */
+
+#define ROLLUP_MAGIC "BMSR"
+#define ROLLUP_VERSION 1
+#define ROLLUP_HEADER_SIZE 32
+#define ROLLUP_MINUTE 0
+#define ROLLUP_HOUR 1
+#define ROLLUP_LEVELS 2
+
+struct __attribute__((packed)) RollupHeader {
+  char magic[4];          // "BMSR"
+  uint16_t version;       // ROLLUP_VERSION
+  uint16_t header_size;   // Offset of the first record
+  uint32_t period_s;      // 60 or 3600
+  uint8_t channels;       // Values per min/max/mean array
+  uint8_t reserved;
+  uint16_t record_size;   // sizeof(RollupRecord)
+  uint32_t start_epoch;   // RTC unix time when the file was created
+  uint8_t padding[12];
+};
+
+struct __attribute__((packed)) RollupRecord {
+  uint32_t epoch;              // Start of the period, RTC unix time
+  uint32_t count;              // Values folded into the record
+  float min[NUM_CHANNELS];
+  float max[NUM_CHANNELS];
+  float mean[NUM_CHANNELS];
+  float charge_ah;             // Integrated current over the period
+};
+
+/**
+ * Build the file name of a rollup file
+ * @param level ROLLUP_MINUTE or ROLLUP_HOUR
+ * @param time Any time covered by the file
+ */
+void rollup_file_name(uint8_t level, const DateTime &time, char *name, size_t size);
+
+// Period of a rollup level in seconds
+uint32_t rollup_period(uint8_t level);
+
+/**
+ * Writer for the minute and hour rollup files
+ */
+class RollupLog {
+public:
+  /**
+   * @param interval_ms Spacing of the values passed to add(), used for charge
+   */
+  void begin(uint32_t interval_ms);
+
+  /**
+   * Fold one logged value set into the current minute
+   * @param time Timestamp of the values
+   * @param values Value of each channel in micro-units (uA / uV)
+   */
+  void add(const DateTime &time, const int32_t values[NUM_CHANNELS]);
+
+  /**
+   * Copy the unfinished record of a level
+   * @return false if the level has no data yet
+   */
+  bool pending(uint8_t level, RollupRecord &record) const;
+
+  // Write buffered records to the card
+  void sync();
+
+  // Write the unfinished records and close the files
+  void close();
+
+  LogFile &log_file(uint8_t level) { return levels[level].file; }
+
+private:
+  struct Level {
+    LogFile file;
+    uint32_t file_key;     // YYYYMMDD (minutes) or YYYYMM (hours) of the open file
+    uint32_t start;        // Epoch of the current period
+    uint32_t count;        // 0 = no period started
+    int32_t min[NUM_CHANNELS];   // Micro-units
+    int32_t max[NUM_CHANNELS];
+    int64_t sum[NUM_CHANNELS];
+    int64_t charge_ua_ms;        // Integrated current in uA * ms
+  };
+
+  void fold(uint8_t level, uint32_t start, uint32_t count, const int32_t min[NUM_CHANNELS],
+            const int32_t max[NUM_CHANNELS], const int64_t sum[NUM_CHANNELS], int64_t charge_ua_ms);
+  void finish(uint8_t level);
+  void to_record(const Level &lv, RollupRecord &record) const;
+  bool open_for(uint8_t level, uint32_t epoch);
+
+  Level levels[ROLLUP_LEVELS];
+  uint32_t interval_ms = 1000;
+};
+
+#endif
@@ -0,0 +1,443 @@
+#include "sampler.h"
+#include "scaler.h"
+#include "metrics.h"
+#include <Wire.h>
+
+RingBuffer<RawSample, SAMPLE_RING_SIZE> sample_ring;
+
+// Mux and gain used for each logical channel
+struct ChannelConfig {
+  uint16_t mux;
+  adsGain_t gain;      // Gain of the next conversion
+  uint8_t min_gain;    // Auto-range span, RawSample::gain encoding
+  uint8_t max_gain;
+  uint8_t low_count;   // Consecutive codes below SAMPLER_RANGE_LOW
+};
+
+// Gains can be changed by the calibration (sampler_set_gain_range)
+static ChannelConfig channel_config[NUM_CHANNELS] = {
+#define CHANNEL_CONFIG(id, name, unit, kind, device, mux, gain, ...) \
+  { mux, (adsGain_t)((gain) << 9), gain, gain, 0 },
+  CHANNEL_TABLE(CHANNEL_CONFIG)
+#undef CHANNEL_CONFIG
+};
+
+// Channel and gain one conversion was started with
+struct Conversion {
+  uint8_t channel;
+  uint8_t gain;        // RawSample::gain encoding
+};
+
+/**
+ * One ADS1115 and the channels it cycles through. In continuous mode a
+ * config write does not touch the conversion already running; it applies
+ * from the next one. So the device works one conversion behind the
+ * register: "running" is what the next result belongs to, "written" what
+ * the conversion after it will use.
+ */
+struct DeviceState {
+  Adafruit_ADS1115 *adc;
+  uint8_t address;
+  uint8_t alert_pin;
+  uint8_t channels[NUM_CHANNELS];  // Its channels, in table order
+  uint8_t channel_count;
+  uint8_t position;                // Index into channels of the last config written
+  bool idle;                       // Powered down; the next start converts at once
+  Conversion running;
+  Conversion written;
+  uint32_t handled_count;          // ready_count right after the last config write
+};
+
+static DeviceState devices[NUM_ADC_DEVICES];
+static uint16_t sampler_rate = 0;
+static TaskHandle_t sampler_task_handle = NULL;
+static portMUX_TYPE sampler_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// Written by the ISRs, read by the sampler task
+static volatile uint32_t ready_count[NUM_ADC_DEVICES];
+static volatile uint32_t ready_t_us[NUM_ADC_DEVICES];
+
+// Owned by the sampler task
+static uint32_t dropped_samples = 0;
+static uint32_t missed_conversions = 0;
+static uint32_t range_switches = 0;
+
+// Duty cycle while parked (sampler_park)
+static volatile bool park_requested = false;
+static uint32_t park_period_us = 0;
+static int32_t park_wake_low = 0;     // Comparator window, reference-gain LSBs
+static int32_t park_wake_high = 0;
+static uint32_t park_next_us = 0;     // Start of the next conversion round
+static uint32_t comparator_wakes = 0;
+static SamplerIdleHook idle_hook = NULL;
+
+/**
+ * ALERT/RDY falling edge of a device: a conversion has finished.
+ * I2C is not allowed here, so just timestamp the edge and wake the task.
+ */
+template <uint8_t D>
+static void IRAM_ATTR sampler_alert_isr() {
+  portENTER_CRITICAL_ISR(&sampler_spinlock);
+  ready_t_us[D] = micros();
+  ready_count[D]++;
+  portEXIT_CRITICAL_ISR(&sampler_spinlock);
+
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(sampler_task_handle, &woken);
+  if (woken) {
+    portYIELD_FROM_ISR();
+  }
+}
+
+static void (*const alert_isrs[ADC_DEVICES_MAX])() = {
+  sampler_alert_isr<0 % NUM_ADC_DEVICES>, sampler_alert_isr<1 % NUM_ADC_DEVICES>,
+  sampler_alert_isr<2 % NUM_ADC_DEVICES>, sampler_alert_isr<3 % NUM_ADC_DEVICES>,
+};
+
+// The device that watches CH_AMPS while parked
+static DeviceState &shunt_device() {
+  return devices[channel_table[CH_AMPS].device];
+}
+
+/**
+ * Pick the gain for a channel's next conversion from the code just read
+ * (sampler task, with sampler_spinlock held)
+ * @param code_gain Gain the code was taken with
+ */
+static void auto_range(ChannelConfig &config, int16_t code, uint8_t code_gain) {
+  if (config.min_gain == config.max_gain) return;
+
+  uint8_t gain = config.gain >> 9;
+  int32_t magnitude = abs((int32_t)code);
+  if (code_gain != gain) {
+    // A switch is still in the pipeline; only clipping overrides it
+    if (magnitude >= SAMPLER_CLIP_CODE && gain != config.min_gain) {
+      config.gain = (adsGain_t)(config.min_gain << 9);
+      config.low_count = 0;
+      range_switches++;
+    }
+    return;
+  }
+  uint8_t next = gain;
+  if (magnitude >= SAMPLER_CLIP_CODE) {
+    next = config.min_gain;
+  } else if (magnitude > SAMPLER_RANGE_HIGH) {
+    next = gain > config.min_gain ? gain - 1 : gain;
+  } else if (magnitude < SAMPLER_RANGE_LOW && gain < config.max_gain) {
+    if (++config.low_count >= SAMPLER_RANGE_HOLD) next = gain + 1;
+  } else {
+    config.low_count = 0;
+  }
+
+  if (next != gain) {
+    config.gain = (adsGain_t)(next << 9);
+    config.low_count = 0;
+    range_switches++;
+  }
+}
+
+static void write_register(uint8_t address, uint8_t reg, uint16_t value) {
+  Wire.beginTransmission(address);
+  Wire.write(reg);
+  Wire.write((uint8_t)(value >> 8));
+  Wire.write((uint8_t)value);
+  Wire.endTransmission();
+}
+
+/**
+ * Point a device's mux at a channel in continuous mode with its gain, for
+ * the conversion after the running one. Only the config register is
+ * written; the RDY thresholds from the last restart_device() stay in place.
+ */
+static void start_channel(DeviceState &dev, uint8_t channel) {
+  portENTER_CRITICAL(&sampler_spinlock);
+  ChannelConfig config = channel_config[channel];
+  portEXIT_CRITICAL(&sampler_spinlock);
+  write_register(dev.address, ADS1X15_REG_POINTER_CONFIG,
+                 config.mux | config.gain | ADS1X15_REG_CONFIG_MODE_CONTIN | sampler_rate |
+                 ADS1X15_REG_CONFIG_CMODE_TRAD | ADS1X15_REG_CONFIG_CPOL_ACTVLOW |
+                 ADS1X15_REG_CONFIG_CLAT_NONLAT | ADS1X15_REG_CONFIG_CQUE_1CONV);
+  dev.written = { channel, (uint8_t)(config.gain >> 9) };
+}
+
+/**
+ * Restart continuous sampling on a device's first channel. startADCReading()
+ * also programs the threshold registers so ALERT/RDY pulses once per
+ * conversion; older edges are ignored. A powered-down device starts with
+ * the new settings, a converting one (the comparator) finishes its running
+ * conversion first.
+ */
+static void restart_device(uint8_t d) {
+  DeviceState &dev = devices[d];
+  dev.position = 0;
+  uint8_t channel = dev.channels[0];
+  portENTER_CRITICAL(&sampler_spinlock);
+  ChannelConfig config = channel_config[channel];
+  portEXIT_CRITICAL(&sampler_spinlock);
+  dev.adc->setGain(config.gain);
+  dev.adc->startADCReading(config.mux, true);
+  dev.written = { channel, (uint8_t)(config.gain >> 9) };
+  if (dev.idle) {
+    dev.running = dev.written;
+    dev.idle = false;
+  }
+  portENTER_CRITICAL(&sampler_spinlock);
+  dev.handled_count = ready_count[d];
+  portEXIT_CRITICAL(&sampler_spinlock);
+}
+
+static void restart_sampling() {
+  for (uint8_t d = 0; d < NUM_ADC_DEVICES; d++) {
+    if (devices[d].channel_count) restart_device(d);
+  }
+}
+
+/**
+ * Read and hand on one device's finished conversion, then start its next
+ * channel
+ */
+static void service_device(uint8_t d) {
+  DeviceState &dev = devices[d];
+  portENTER_CRITICAL(&sampler_spinlock);
+  uint32_t pending = ready_count[d];
+  uint32_t t_us = ready_t_us[d];
+  portEXIT_CRITICAL(&sampler_spinlock);
+
+  if (pending == dev.handled_count || dev.channel_count == 0) return;
+  uint32_t start = metrics_now();
+
+  // The first edge after a config write ends the conversion that was running
+  // during the write; any later one ends a conversion with the written
+  // settings. More than one edge means conversions were overwritten.
+  Conversion conversion = dev.running;
+  if (pending - dev.handled_count > 1) {
+    missed_conversions += pending - dev.handled_count - 1;
+    conversion = dev.written;
+  }
+  // The conversion started at this edge uses the written settings
+  dev.running = dev.written;
+
+  RawSample sample;
+  sample.t_us = t_us;
+  sample.code = dev.adc->getLastConversionResults();
+  sample.channel = conversion.channel;
+  sample.gain = conversion.gain;
+  portENTER_CRITICAL(&sampler_spinlock);
+  auto_range(channel_config[conversion.channel], sample.code, conversion.gain);
+  portEXIT_CRITICAL(&sampler_spinlock);
+  if (!sample_ring.push(sample)) {
+    dropped_samples++;
+  }
+  metrics_record_us(STAGE_SAMPLE_LATENCY, micros() - t_us);
+
+  // Cycle through the device's channels
+  dev.position = (dev.position + 1) % dev.channel_count;
+  start_channel(dev, dev.channels[dev.position]);
+
+  // An edge that arrived while reconfiguring ended a conversion that was
+  // already running; its result is gone, and the next one is still "running"
+  portENTER_CRITICAL(&sampler_spinlock);
+  dev.handled_count = ready_count[d];
+  portEXIT_CRITICAL(&sampler_spinlock);
+  metrics_record_since(STAGE_SAMPLER, start);
+}
+
+/**
+ * Leave the CH_AMPS device converting the shunt in window-comparator mode
+ * and power the other devices down. ALERT/RDY goes low after the first code
+ * outside the window and stays low until the conversion register is read.
+ */
+static void arm_comparator() {
+  DeviceState &watch = shunt_device();
+  for (uint8_t d = 0; d < NUM_ADC_DEVICES; d++) {
+    if (&devices[d] != &watch && devices[d].channel_count) {
+      // Single-shot mode without a start: the device idles at ~0.5 uA
+      write_register(devices[d].address, ADS1X15_REG_POINTER_CONFIG, ADS1X15_REG_CONFIG_MODE_SINGLE);
+      devices[d].idle = true;
+    }
+  }
+
+  portENTER_CRITICAL(&sampler_spinlock);
+  ChannelConfig config = channel_config[CH_AMPS];
+  portEXIT_CRITICAL(&sampler_spinlock);
+
+  // The window is given at the reference gain; auto-ranging may have left a coarser one
+  uint8_t shift = config.max_gain - (config.gain >> 9);
+  int32_t low = constrain(park_wake_low >> shift, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+  int32_t high = constrain(park_wake_high >> shift, (int32_t)INT16_MIN, (int32_t)INT16_MAX);
+  write_register(watch.address, ADS1X15_REG_POINTER_LOWTHRESH, (uint16_t)low);
+  write_register(watch.address, ADS1X15_REG_POINTER_HITHRESH, (uint16_t)high);
+  write_register(watch.address, ADS1X15_REG_POINTER_CONFIG,
+                 config.mux | config.gain | ADS1X15_REG_CONFIG_MODE_CONTIN | SAMPLER_PARK_RATE |
+                 ADS1X15_REG_CONFIG_CMODE_WINDOW | ADS1X15_REG_CONFIG_CPOL_ACTVLOW |
+                 ADS1X15_REG_CONFIG_CLAT_LATCH | ADS1X15_REG_CONFIG_CQUE_1CONV);
+  // The comparator conversions are the shunt's; the first one after restart_device() is kept
+  watch.written = { CH_AMPS, (uint8_t)(config.gain >> 9) };
+}
+
+// Default idle hook: stay awake and wait for the deadline or an ALERT edge
+static void idle_wait(uint32_t until_us) {
+  for (;;) {
+    int32_t left = (int32_t)(until_us - micros());
+    if (left <= 0 || digitalRead(shunt_device().alert_pin) == LOW || !park_requested) return;
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(left / 1000 + 1));
+  }
+}
+
+/**
+ * One parked period: a conversion of every channel, then the comparator
+ * until the next round. A level still low afterwards is the comparator
+ * (RDY pulses are a few microseconds long).
+ */
+static void park_cycle() {
+  uint8_t rounds = 0;
+  for (uint8_t d = 0; d < NUM_ADC_DEVICES; d++) {
+    rounds = max(rounds, devices[d].channel_count);
+  }
+  restart_sampling();
+  for (uint8_t n = 0; n < rounds; n++) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    sampler_service();
+  }
+  arm_comparator();
+
+  uint32_t now = micros();
+  park_next_us += park_period_us;
+  if ((int32_t)(park_next_us - now) <= 0 || (int32_t)(park_next_us - now) > (int32_t)park_period_us) {
+    park_next_us = now + park_period_us;  // Fell behind, or the period changed
+  }
+  (idle_hook ? idle_hook : idle_wait)(park_next_us);
+
+  if (digitalRead(shunt_device().alert_pin) == LOW) {
+    comparator_wakes++;
+    park_requested = false;
+  }
+  if (!park_requested) {
+    shunt_device().adc->getLastConversionResults();  // Releases the latched ALERT
+    restart_sampling();
+  }
+}
+
+static void sampler_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    if (park_requested) {
+      park_cycle();
+      continue;
+    }
+    // Timeout keeps the task alive even if an edge is lost
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+    sampler_service();
+  }
+}
+
+bool sampler_begin(Adafruit_ADS1115 adcs[NUM_ADC_DEVICES], uint16_t data_rate) {
+  sampler_rate = data_rate;
+  for (uint8_t d = 0; d < NUM_ADC_DEVICES; d++) {
+    DeviceState &dev = devices[d];
+    dev.adc = &adcs[d];
+    dev.address = adc_devices[d].address;
+    dev.alert_pin = adc_devices[d].alert_pin;
+    dev.channel_count = 0;
+    dev.idle = true;  // Single-shot and powered down after reset
+    for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++) {
+      if (channel_table[ch].device == d) dev.channels[dev.channel_count++] = ch;
+    }
+    dev.adc->setDataRate(data_rate);
+  }
+  for (uint8_t ch = 0; ch < NUM_CHANNELS; ch++) {
+    if (channel_table[ch].device >= NUM_ADC_DEVICES) {
+      Serial.printf("ERROR: Channel %s is on ADC device %u, which does not exist\n",
+                    channel_table[ch].name, channel_table[ch].device);
+      return false;
+    }
+  }
+
+  if (xTaskCreatePinnedToCore(sampler_task, "sampler", SAMPLER_TASK_STACK, NULL,
+                              SAMPLER_TASK_PRIORITY, &sampler_task_handle,
+                              SAMPLER_TASK_CORE) != pdPASS) {
+    return false;
+  }
+
+  restart_sampling();
+
+  // ALERT/RDY is open drain and pulses low when a conversion completes
+  for (uint8_t d = 0; d < NUM_ADC_DEVICES; d++) {
+    if (devices[d].channel_count == 0) continue;
+    pinMode(devices[d].alert_pin, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(devices[d].alert_pin), alert_isrs[d], FALLING);
+  }
+  return true;
+}
+
+void sampler_service() {
+  for (uint8_t d = 0; d < NUM_ADC_DEVICES; d++) {
+    service_device(d);
+  }
+}
+
+void sampler_park(uint32_t period_us, int32_t wake_low, int32_t wake_high) {
+  park_period_us = period_us;
+  park_wake_low = wake_low;
+  park_wake_high = wake_high;
+  park_next_us = micros();
+  park_requested = true;
+}
+
+void sampler_unpark() {
+  park_requested = false;
+  xTaskNotifyGive(sampler_task_handle);
+}
+
+bool sampler_parked() {
+  return park_requested;
+}
+
+void sampler_on_idle(SamplerIdleHook hook) {
+  idle_hook = hook;
+}
+
+uint32_t sampler_comparator_wakes() {
+  return comparator_wakes;
+}
+
+void sampler_set_gain(uint8_t channel, uint8_t gain) {
+  sampler_set_gain_range(channel, gain, gain);
+}
+
+void sampler_set_gain_range(uint8_t channel, uint8_t min_gain, uint8_t max_gain) {
+  if (channel >= NUM_CHANNELS) return;
+  // 2/3x is 1.5 LSBs of 1x, so it can only be used on its own
+  if (min_gain < 1 && max_gain > 0) min_gain = 1;
+  if (min_gain > max_gain) min_gain = max_gain;
+
+  portENTER_CRITICAL(&sampler_spinlock);
+  ChannelConfig &config = channel_config[channel];
+  config.min_gain = min_gain;
+  config.max_gain = max_gain;
+  config.gain = (adsGain_t)(max_gain << 9);
+  config.low_count = 0;
+  portEXIT_CRITICAL(&sampler_spinlock);
+}
+
+uint8_t sampler_reference_gain(uint8_t channel) {
+  return channel < NUM_CHANNELS ? channel_config[channel].max_gain : 0;
+}
+
+int32_t sampler_fine_code(const RawSample &sample) {
+  uint8_t reference = sampler_reference_gain(sample.channel);
+  if (sample.gain >= reference) return sample.code;
+  return (int32_t)sample.code << (reference - sample.gain);
+}
+
+uint32_t sampler_range_switches() {
+  return range_switches;
+}
+
+uint32_t sampler_dropped_samples() {
+  return dropped_samples;
+}
+
+uint32_t sampler_missed_conversions() {
+  return missed_conversions;
+}
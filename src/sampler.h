@@ -0,0 +1,145 @@
+// sampler.h
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <Arduino.h>
+#include <Adafruit_ADS1X15.h>
+#include "ring_buffer.h"
+#include "channels.h"
+
+/**
+ * Interrupt-driven ADS1115 sampling engine
+ *
+ * Each ADS1115 of the channel table (channels.h) runs in continuous-
+ * conversion mode with its ALERT/RDY pin configured as a conversion-ready
+ * output. Every RDY pulse wakes a sampler task which reads the finished
+ * conversion, switches that device's mux to its next channel and pushes the
+ * raw code into a lock-free ring buffer. Consumers (logging, MQTT, display)
+ * drain the ring at their own pace.
+ *
+ * Devices convert in parallel: while one is busy, the bus serves the
+ * others, so the aggregate rate is the data rate times the number of
+ * devices as long as the I2C bus keeps up. A mux switch writes only the
+ * config register (the RDY thresholds stay set), which leaves three bus
+ * transactions per conversion; at 400 kHz that takes about 0.35 ms, enough
+ * for two devices at 860 SPS.
+ *
+ * A channel can auto-range over a span of PGA settings. The gain for its
+ * next conversion is picked from the code just read: a code near full scale
+ * steps down (a clipped one goes straight to the coarsest gain), and after
+ * SAMPLER_RANGE_HOLD quiet codes the gain steps back up. The mux alternates
+ * channels on every conversion anyway, so a gain change costs no samples.
+ * Each RawSample carries the gain it was taken with; sampler_fine_code()
+ * expresses it in LSBs of the channel's finest gain (its reference) so
+ * samples from different ranges can be combined.
+ *
+ * While the vehicle is parked the sampler can be duty-cycled
+ * (sampler_park()): once per period it converts every channel at the normal
+ * rate, then leaves the CH_AMPS device converting the shunt at
+ * SAMPLER_PARK_RATE in window-comparator mode until the next period; other
+ * devices power down. ALERT/RDY then only asserts (latched) if the current
+ * leaves the wake window, which brings the sampler straight back to
+ * continuous sampling. What the CPU does in between is up
+ * to the idle hook (sampler_on_idle()), e.g. light sleep.
+ */
+
+// ===== CONFIGURATION =====
+#define SAMPLE_RING_SIZE 2048        // Raw samples buffered between sampler and consumers (power of two)
+#define SAMPLER_TASK_STACK 4096      // Stack size of the sampler task in bytes
+#define SAMPLER_TASK_PRIORITY (configMAX_PRIORITIES - 2)
+#define SAMPLER_TASK_CORE 1          // Acquisition core; WiFi and I/O run on core 0
+#define SAMPLER_RANGE_HIGH 30000     // |code| above this switches to the next coarser gain (~92% of full scale)
+#define SAMPLER_RANGE_LOW 12000      // |code| below this may switch to the next finer gain (24000 there)
+#define SAMPLER_RANGE_HOLD 4         // Consecutive low codes before stepping to a finer gain
+#define SAMPLER_CLIP_CODE 32767      // ADS1115 output at (or beyond) full scale
+#define SAMPLER_PARK_RATE RATE_ADS1115_8SPS  // Shunt conversions watched by the comparator while parked
+
+/**
+ * One raw conversion result as delivered by the ADC
+ */
+struct RawSample {
+  uint32_t t_us;     // micros() at the RDY edge that completed this conversion
+  int16_t code;      // Signed ADC code
+  uint8_t channel;   // SampleChannel
+  uint8_t gain;      // PGA setting used, as adsGain_t >> 9 (0 = 2/3x ... 5 = 16x)
+};
+
+extern RingBuffer<RawSample, SAMPLE_RING_SIZE> sample_ring;
+
+/**
+ * Start continuous sampling on every device
+ * @param adcs One ADS1115 per adc_devices row, already initialized with begin()
+ * @param data_rate ADS1115 data rate (RATE_ADS1115_xxxSPS), shared by the
+ *                  channels of a device
+ * @return true if the sampler task was started
+ */
+bool sampler_begin(Adafruit_ADS1115 adcs[NUM_ADC_DEVICES], uint16_t data_rate);
+
+/**
+ * Read the completed conversions (if any) and start the next channel on
+ * each device that finished one. Called by the sampler task on every RDY
+ * notification.
+ */
+void sampler_service();
+
+/**
+ * Fix the PGA gain of a channel; takes effect at its next conversion
+ * @param channel SampleChannel
+ * @param gain RawSample::gain encoding (adsGain_t >> 9)
+ */
+void sampler_set_gain(uint8_t channel, uint8_t gain);
+
+/**
+ * Let a channel auto-range between two gains (min_gain == max_gain fixes it).
+ * The span must be whole factors of two apart, so min_gain is raised to 1x
+ * unless the channel is fixed at 2/3x.
+ * @param channel SampleChannel
+ * @param min_gain Coarsest gain, used for the largest signals
+ * @param max_gain Finest gain, the reference of sampler_fine_code()
+ */
+void sampler_set_gain_range(uint8_t channel, uint8_t min_gain, uint8_t max_gain);
+
+// Finest gain of a channel's range
+uint8_t sampler_reference_gain(uint8_t channel);
+
+/**
+ * Code of a sample in LSBs of its channel's reference gain
+ */
+int32_t sampler_fine_code(const RawSample &sample);
+
+/**
+ * Waits between parked periods (sampler task)
+ * @param until_us micros() of the next period; return then at the latest,
+ *                 or early once ALERT/RDY is low or the sampler is unparked
+ */
+typedef void (*SamplerIdleHook)(uint32_t until_us);
+
+/**
+ * Switch to duty-cycled sampling; takes effect after the current conversion
+ * @param period_us Time between conversion rounds (one sample per channel)
+ * @param wake_low Lower edge of the comparator window, in LSBs of the shunt's reference gain
+ * @param wake_high Upper edge of the window
+ */
+void sampler_park(uint32_t period_us, int32_t wake_low, int32_t wake_high);
+
+// Return to continuous sampling
+void sampler_unpark();
+
+// True while duty-cycled; false again once the comparator has woken the sampler
+bool sampler_parked();
+
+// Replace the default idle wait (task notifications) between parked periods
+void sampler_on_idle(SamplerIdleHook hook);
+
+// Parked periods ended early by the comparator
+uint32_t sampler_comparator_wakes();
+
+// Gain changes made by auto-ranging
+uint32_t sampler_range_switches();
+
+// Samples lost because the ring buffer was full
+uint32_t sampler_dropped_samples();
+// RDY pulses that were not serviced before the next conversion finished
+uint32_t sampler_missed_conversions();
+
+#endif
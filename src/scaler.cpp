@@ -0,0 +1,32 @@
+#include "scaler.h"
+
+size_t format_micro(char *out, int32_t micro, uint8_t decimals) {
+  static const uint32_t powers[] = { 1, 10, 100, 1000, 10000, 100000, 1000000 };
+  if (decimals > 6) decimals = 6;
+
+  bool negative = micro < 0;
+  uint32_t magnitude = negative ? 0u - (uint32_t)micro : (uint32_t)micro;
+  uint32_t step = powers[6 - decimals];
+  uint32_t rounded = (magnitude + step / 2) / step;   // In units of the last decimal
+  uint32_t whole = rounded / powers[decimals];
+  uint32_t fraction = rounded % powers[decimals];
+
+  // Digits are produced backwards into a scratch buffer
+  char digits[16];
+  size_t n = 0;
+  for (uint8_t i = 0; i < decimals; i++) {
+    digits[n++] = '0' + fraction % 10;
+    fraction /= 10;
+  }
+  if (decimals) digits[n++] = '.';
+  do {
+    digits[n++] = '0' + whole % 10;
+    whole /= 10;
+  } while (whole);
+
+  size_t len = 0;
+  if (negative && rounded != 0) out[len++] = '-';
+  while (n) out[len++] = digits[--n];
+  out[len] = '\0';
+  return len;
+}
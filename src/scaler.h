@@ -0,0 +1,107 @@
+// scaler.h
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "decimator.h"
+
+/**
+ * Fixed-point conversion from ADC codes to physical units
+ *
+ * The pipeline carries raw int16 codes (and Q4 means from the decimator)
+ * end to end. A Scaler holds a Q16 factor precomputed from the ADC gain
+ * and the shunt or divider, so a conversion is a 32x32->64 bit multiply
+ * and a shift, no soft-float doubles. Results are integers in micro-units
+ * (uA, uV); floats appear only when values are formatted for output.
+ * Scalers are rebuilt only when the calibration changes (calibration.h).
+ *
+ *   Scaler amps = shunt_scaler(ADS_GAIN_16, 100, 75, 0);   // 100 A / 75 mV shunt
+ *   int32_t ua = amps.from_mean(stats.mean);
+ */
+
+// RawSample::gain values (adsGain_t >> 9)
+#define ADS_GAIN_2_3 0
+#define ADS_GAIN_1 1
+#define ADS_GAIN_2 2
+#define ADS_GAIN_4 3
+#define ADS_GAIN_8 4
+#define ADS_GAIN_16 5
+
+#define SCALER_SHIFT 16
+
+/**
+ * ADS1115 LSB size in picovolts for a PGA setting (6.144 V ... 0.256 V full scale)
+ */
+constexpr int64_t ads_lsb_pv(uint8_t gain) {
+  return gain == ADS_GAIN_2_3 ? 187500000LL :
+         gain == ADS_GAIN_1   ? 125000000LL :
+         gain == ADS_GAIN_2   ?  62500000LL :
+         gain == ADS_GAIN_4   ?  31250000LL :
+         gain == ADS_GAIN_8   ?  15625000LL : 7812500LL;
+}
+
+/**
+ * Linear code-to-unit conversion: micro = code * factor / 2^16 + offset
+ */
+struct Scaler {
+  int32_t factor;   // Micro-units per code in Q16
+  int32_t offset;   // Micro-units
+
+  /**
+   * @param code Raw ADC code
+   * @return Value in micro-units
+   */
+  inline int32_t from_code(int32_t code) const {
+    return (int32_t)(((int64_t)code * factor + (1LL << (SCALER_SHIFT - 1))) >> SCALER_SHIFT) + offset;
+  }
+
+  /**
+   * @param mean Q4 code from the decimator (mean, rms or code * DECIMATOR_SCALE)
+   * @return Value in micro-units
+   */
+  inline int32_t from_mean(int32_t mean) const {
+    const int shift = SCALER_SHIFT + DECIMATOR_FRAC_BITS;
+    return (int32_t)(((int64_t)mean * factor + (1LL << (shift - 1))) >> shift) + offset;
+  }
+
+  // Physical units per code and offset, for self-describing file and message headers
+  float scale() const { return factor / (float)(1L << SCALER_SHIFT) / 1e6f; }
+  float offset_units() const { return offset / 1e6f; }
+};
+
+/**
+ * Scaler for micro-units per code given as an exact fraction
+ * @return Scaler with factor 0 if the fraction does not fit 32 bits in Q16
+ */
+constexpr Scaler ratio_scaler(int64_t num, int64_t den, int32_t offset) {
+  return den <= 0 || (num * (1LL << SCALER_SHIFT) + den / 2) / den >= (1LL << 31)
+         ? Scaler{ 0, offset }
+         : Scaler{ (int32_t)((num * (1LL << SCALER_SHIFT) + den / 2) / den), offset };
+}
+
+/**
+ * Current through a shunt rated shunt_amps at shunt_mv, in uA
+ */
+constexpr Scaler shunt_scaler(uint8_t gain, uint32_t shunt_amps, uint32_t shunt_mv, int32_t offset_ua) {
+  return ratio_scaler(ads_lsb_pv(gain) * shunt_amps, shunt_mv * 1000LL, offset_ua);
+}
+
+/**
+ * Voltage behind a divider with ratio ratio_num / ratio_den (input / ADC pin), in uV
+ */
+constexpr Scaler divider_scaler(uint8_t gain, uint32_t ratio_num, uint32_t ratio_den, int32_t offset_uv) {
+  return ratio_scaler(ads_lsb_pv(gain) * ratio_num, ratio_den * 1000000LL, offset_uv);
+}
+
+/**
+ * Format a micro-unit value with a fixed number of decimals, rounded half
+ * away from zero, without floating point
+ * @param out Buffer, at least 16 bytes
+ * @param micro Value in micro-units
+ * @param decimals 0..6
+ * @return Characters written (excluding the terminator)
+ */
+size_t format_micro(char *out, int32_t micro, uint8_t decimals);
+
+#endif
@@ -0,0 +1,21 @@
+#include "sd_access.h"
+
+static SemaphoreHandle_t sd_mutex = NULL;
+
+void sd_access_begin() {
+  if (sd_mutex == NULL) {
+    sd_mutex = xSemaphoreCreateRecursiveMutex();
+  }
+}
+
+void sd_lock() {
+  xSemaphoreTakeRecursive(sd_mutex, portMAX_DELAY);
+}
+
+void sd_unlock() {
+  xSemaphoreGiveRecursive(sd_mutex);
+}
+
+bool sd_try_lock() {
+  return xSemaphoreTakeRecursive(sd_mutex, 0) == pdTRUE;
+}
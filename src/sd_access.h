@@ -0,0 +1,39 @@
+// sd_access.h
+#ifndef SD_ACCESS_H
+#define SD_ACCESS_H
+
+#include <Arduino.h>
+#include <SdFat.h>
+
+/**
+ * Shared SD card access
+ *
+ * SdFat is not thread safe. The SD writer task and the web server (which runs
+ * in the AsyncTCP task) both touch the card, so every access must hold the
+ * SD mutex. The mutex is recursive so helpers can nest guards.
+ */
+
+extern SdFat sd;   // Defined in main.cpp
+
+/**
+ * Create the SD mutex. Call once in setup() before any task starts.
+ */
+void sd_access_begin();
+
+void sd_lock();
+void sd_unlock();
+
+// Take the SD mutex only if it is free; sd_unlock() it after a true return
+bool sd_try_lock();
+
+/**
+ * Holds the SD mutex for the lifetime of the object
+ */
+struct SdGuard {
+  SdGuard() { sd_lock(); }
+  ~SdGuard() { sd_unlock(); }
+  SdGuard(const SdGuard &) = delete;
+  SdGuard &operator=(const SdGuard &) = delete;
+};
+
+#endif
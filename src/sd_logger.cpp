@@ -0,0 +1,507 @@
+#include "sd_logger.h"
+#include "sd_access.h"
+#include "binlog.h"
+#include "rollup.h"
+#include "file_index.h"
+#include "scaler.h"
+#include "text_format.h"
+#include "metrics.h"
+
+// ===== LOG FILE =====
+
+bool LogFile::open(const char *path, uint32_t prealloc_bytes) {
+  close();
+  strncpy(file_path, path, sizeof(file_path) - 1);
+  file_path[sizeof(file_path) - 1] = '\0';
+
+  if (!file.open(file_path, O_RDWR | O_CREAT | O_AT_END)) {
+    return false;
+  }
+  file_pos = file.fileSize();
+  used = 0;
+  preallocated = false;
+  if (file_pos == 0 && prealloc_bytes > 0) {
+    preallocated = preallocate(prealloc_bytes);
+  }
+  opened = true;
+  return true;
+}
+
+/**
+ * Reserve a contiguous extent for a new, empty file and erase it, so the
+ * unwritten tail reads back as 0x00/0xFF and the real end can be found
+ * after a power loss. Falls back to a normal file if either step fails.
+ */
+bool LogFile::preallocate(uint32_t length) {
+  if (!file.preAllocate(length)) {
+    return false;  // Not enough contiguous free space
+  }
+
+  uint32_t first_sector, last_sector;
+  if (!file.contiguousRange(&first_sector, &last_sector) ||
+      !sd.card()->erase(first_sector, last_sector)) {
+    file.truncate(0);
+    return false;
+  }
+
+  // preAllocate() sets the file size to the extent, writing starts at 0
+  file.seekSet(0);
+  return true;
+}
+
+void LogFile::close() {
+  if (!opened) return;
+  sync();
+  if (preallocated) {
+    // Cut the file at the real data length and free the unused clusters
+    file.truncate();
+  }
+  file.close();
+  opened = false;
+  preallocated = false;
+}
+
+bool LogFile::sync() {
+  if (!opened) return false;
+  if (used > 0 && !write_out(used)) return false;
+  return file.sync();
+}
+
+size_t LogFile::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+size_t LogFile::write(const uint8_t *data, size_t len) {
+  if (!opened) return 0;
+
+  size_t written = 0;
+  while (written < len) {
+    if (used == LOG_BUFFER_SIZE && !flush_blocks()) {
+      return written;
+    }
+    size_t chunk = min(len - written, LOG_BUFFER_SIZE - used);
+    memcpy(buffer + used, data + written, chunk);
+    used += chunk;
+    written += chunk;
+  }
+  return written;
+}
+
+/**
+ * Write as many complete blocks as possible. The first write after opening
+ * an existing file may be shorter so that later writes start on a block
+ * boundary of the file.
+ */
+bool LogFile::flush_blocks() {
+  size_t to_boundary = (LOG_BLOCK_SIZE - file_pos % LOG_BLOCK_SIZE) % LOG_BLOCK_SIZE;
+  if (used < to_boundary) return true;
+
+  size_t len = to_boundary + ((used - to_boundary) / LOG_BLOCK_SIZE) * LOG_BLOCK_SIZE;
+  if (len == 0) return true;
+  return write_out(len);
+}
+
+bool LogFile::write_out(size_t len) {
+  if (file.write(buffer, len) != len) {
+    Serial.print("ERROR: Write failed on ");
+    Serial.println(file_path);
+    metrics_count(COUNTER_SD_WRITE_ERRORS);
+    // Drop the buffer and reopen on the next sample. Like close(), cut a
+    // pre-allocated file at the data written so far, or the reopen would
+    // append after the whole extent.
+    if (preallocated) {
+      file.truncate(file_pos);
+    }
+    file.close();
+    opened = false;
+    preallocated = false;
+    used = 0;
+    return false;
+  }
+  file_pos += len;
+  used -= len;
+  if (used > 0) {
+    memmove(buffer, buffer + len, used);
+  }
+  return true;
+}
+
+// ===== DAILY CHANNEL LOGS =====
+
+// One text log per channel, files named "<prefix>YYYY-MM-DD.txt",
+// with a line offset index "<prefix>YYYY-MM-DD.idx" next to it
+struct ChannelLog {
+  const char *prefix;
+  LogFile file;
+  LogFile index;
+  uint32_t day;    // Date of the open file as YYYYMMDD
+  int count;       // Values written on the current line
+};
+
+// Prefixes are the channel names of the table (channels.h)
+static ChannelLog channel_logs[NUM_CHANNELS] = {
+#define CHANNEL_LOG(id, name, ...) { name " ", {}, {}, 0, 0 },
+  CHANNEL_TABLE(CHANNEL_LOG)
+#undef CHANNEL_LOG
+};
+
+#if LOG_BINARY
+static BinaryLog binary_log;
+#endif
+#if LOG_ROLLUP
+static RollupLog rollup_log;
+#endif
+
+static uint8_t sd_cs_pin = 0;
+static uint32_t sd_spi_speed = 0;
+static unsigned long last_sync = 0;
+
+static uint32_t date_key(const DateTime &time) {
+  return time.year() * 10000UL + time.month() * 100UL + time.day();
+}
+
+/**
+ * Open the line index of a channel's text log. An index left over from a
+ * deleted text file would point into the wrong data, so a new text file
+ * always starts a new index.
+ */
+static void open_index(ChannelLog &log, const DateTime &time) {
+  char filename[32];
+  snprintf(filename, sizeof(filename), "%s%04d-%02d-%02d.idx",
+           log.prefix, time.year(), time.month(), time.day());
+  if (log.file.size() == 0) {
+    sd.remove(filename);
+  }
+  if (!log.index.open(filename)) {
+    Serial.print("ERROR: Failed to open index file: ");
+    Serial.println(filename);
+  }
+}
+
+/**
+ * Record where a new "HH:MM:SS --> " line starts in the text log
+ */
+static void index_line(ChannelLog &log, const DateTime &time) {
+  if (!log.index.is_open()) {
+    open_index(log, time);  // Index was released (deleted) since the file was opened
+  }
+  LogIndexEntry entry;
+  entry.seconds = time.hour() * 3600UL + time.minute() * 60UL + time.second();
+  entry.offset = log.file.size();
+  log.index.write((const uint8_t *)&entry, sizeof(entry));
+  file_index_touch(log.index.path(), log.index.size());
+}
+
+/**
+ * Make sure the channel's file for the given date is open,
+ * closing the previous day's file if the date changed.
+ */
+static bool open_for_day(ChannelLog &log, const DateTime &time) {
+  uint32_t day = date_key(time);
+  if (log.file.is_open() && log.day == day) return true;
+
+  if (log.file.is_open()) {
+    // Terminate the unfinished line of the previous day
+    if (log.count > 0) log.file.println();
+    log.file.close();
+    log.index.close();
+    Serial.print("Closed log file: ");
+    Serial.println(log.file.path());
+  }
+
+  char filename[32];
+  snprintf(filename, sizeof(filename), "%s%04d-%02d-%02d.txt",
+           log.prefix, time.year(), time.month(), time.day());
+
+  if (!log.file.open(filename, LOG_PREALLOC_TEXT)) {
+    Serial.print("ERROR: Failed to open file for writing: ");
+    Serial.println(filename);
+
+    // Try again once after reinitializing the card
+    metrics_count(COUNTER_SD_REINITS);
+    if (!sd.begin(sd_cs_pin, sd_spi_speed)) {
+      Serial.println("ERROR: SD card reinit failed!");
+      return false;
+    }
+    if (!log.file.open(filename, LOG_PREALLOC_TEXT)) {
+      Serial.println("ERROR: Still failed to open file after SD reinit!");
+      return false;
+    }
+    Serial.println("File opened successfully after SD reinit");
+  }
+
+  Serial.print("Logging to file: ");
+  Serial.print(filename);
+  Serial.println(log.file.is_preallocated() ? " (pre-allocated)" : "");
+  log.day = day;
+  open_index(log, time);
+  log.count = 0;   // Always start the new file with a timestamped line
+  return true;
+}
+
+/**
+ * Find the end of text in a pre-allocated file. Text never contains 0x00 or
+ * 0xFF while the erased tail consists of one of them, so the boundary can
+ * be found with a binary search.
+ */
+static uint32_t text_data_end(SdFile &file, uint32_t size) {
+  uint32_t lo = 0;
+  uint32_t hi = size;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    file.seekSet(mid);
+    int c = file.read();
+    if (c < 0 || c == 0x00 || c == 0xFF) {
+      hi = mid;
+    } else {
+      lo = mid + 1;
+    }
+  }
+  return lo;
+}
+
+/**
+ * Truncate log files that were still pre-allocated when power was lost.
+ * Such files have exactly the size of the extent.
+ */
+static void repair_preallocated_files() {
+  SdFile dir;
+  if (!dir.open("/", O_READ)) return;
+
+  SdFile entry;
+  while (entry.openNext(&dir, O_READ)) {
+    char name[64];
+    entry.getName(name, sizeof(name));
+    uint32_t size = entry.fileSize();
+    bool is_dir = entry.isDir();
+    entry.close();
+    if (is_dir) continue;
+
+    size_t len = strlen(name);
+    bool text = len > 4 && strcmp(name + len - 4, ".txt") == 0 && size == LOG_PREALLOC_TEXT;
+    bool binary = len > 4 && strcmp(name + len - 4, ".bin") == 0 && size == LOG_PREALLOC_BINARY;
+    if (!text && !binary) continue;
+
+    SdFile log_file;
+    if (!log_file.open(name, O_RDWR)) continue;
+    uint32_t end = text ? text_data_end(log_file, size) : binlog_data_end(log_file, size);
+    log_file.truncate(end);
+    log_file.close();
+
+    Serial.printf("Repaired pre-allocated log %s: %u of %u bytes used\n", name, end, size);
+  }
+  dir.close();
+}
+
+void sd_logger_begin(uint8_t cs_pin, uint32_t spi_speed, const BinLogConfig &binlog_config) {
+  sd_cs_pin = cs_pin;
+  sd_spi_speed = spi_speed;
+  last_sync = millis();
+  {
+    SdGuard guard;
+    repair_preallocated_files();
+  }
+#if LOG_BINARY
+  binary_log.begin(binlog_config);
+#endif
+#if LOG_ROLLUP
+  rollup_log.begin(binlog_config.interval_ms);
+#endif
+}
+
+void sd_logger_log(const DateTime &time, const int32_t values[NUM_CHANNELS],
+                   const int16_t codes[NUM_CHANNELS], const uint8_t gains[NUM_CHANNELS]) {
+  SdGuard guard;
+
+#if LOG_BINARY
+  binary_log.append(time, codes, gains);
+  if (binary_log.log_file().is_open()) {
+    file_index_sample(binary_log.log_file().path(), binary_log.size(), NAN);
+  }
+#else
+  (void)codes;
+  (void)gains;
+#endif
+
+#if LOG_TEXT
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    ChannelLog &log = channel_logs[ch];
+    if (!open_for_day(log, time)) continue;
+
+    // Start a new line with timestamp at the beginning of each minute
+    if (log.count == 0) {
+      char timestamp[9]; // HH:MM:SS + null terminator
+      format_clock(timestamp, time.hour() * 3600UL + time.minute() * 60UL + time.second());
+      log.file.println(); // Start on a new line
+      index_line(log, time);
+      log.file.print(timestamp);
+      log.file.print(" --> ");
+    }
+
+    // Write data value with comma separator (except for last value)
+    char text[16];
+    log.file.write((const uint8_t *)text, format_micro(text, values[ch], LOG_TEXT_DECIMALS));
+    log.count++;
+    if (log.count < LOG_VALUES_PER_LINE) {
+      log.file.print(", ");
+    } else {
+      // End the line on the last sample of the minute
+      log.file.println();
+      log.count = 0;
+    }
+    file_index_sample(log.file.path(), log.file.size(), values[ch] / 1e6f);
+  }
+#endif
+
+#if LOG_ROLLUP
+  rollup_log.add(time, values);
+#endif
+
+  if (millis() - last_sync >= LOG_SYNC_INTERVAL_MS) {
+    sd_logger_sync();
+  }
+}
+
+void sd_logger_set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]) {
+#if LOG_BINARY
+  SdGuard guard;
+  binary_log.set_calibration(scale, offset);
+#else
+  (void)scale;
+  (void)offset;
+#endif
+}
+
+void sd_logger_sync() {
+  SdGuard guard;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    channel_logs[ch].file.sync();
+    channel_logs[ch].index.sync();
+  }
+#if LOG_BINARY
+  // Binary blocks are only written whole; they sync themselves
+  binary_log.log_file().sync();
+  binary_log.index_file().sync();
+#endif
+#if LOG_ROLLUP
+  rollup_log.sync();
+#endif
+  last_sync = millis();
+}
+
+void sd_logger_close() {
+  SdGuard guard;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    ChannelLog &log = channel_logs[ch];
+    if (log.file.is_open() && log.count > 0) log.file.println();
+    log.file.close();
+    log.index.close();
+    log.count = 0;
+  }
+#if LOG_BINARY
+  binary_log.close();
+#endif
+#if LOG_ROLLUP
+  rollup_log.close();
+#endif
+}
+
+void sd_logger_release(const char *path) {
+  SdGuard guard;
+  if (path[0] == '/') path++;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    ChannelLog &log = channel_logs[ch];
+    if (log.file.is_open() && strcmp(log.file.path(), path) == 0) {
+      // The index belongs to the text file and is restarted with it
+      log.file.close();
+      log.index.close();
+    }
+    if (log.index.is_open() && strcmp(log.index.path(), path) == 0) {
+      log.index.close();
+    }
+  }
+#if LOG_BINARY
+  if (binary_log.log_file().is_open() && strcmp(binary_log.log_file().path(), path) == 0) {
+    binary_log.close();
+  }
+  if (binary_log.index_file().is_open() && strcmp(binary_log.index_file().path(), path) == 0) {
+    binary_log.index_file().close();  // Reopened with the next block
+  }
+#endif
+#if LOG_ROLLUP
+  for (uint8_t level = 0; level < ROLLUP_LEVELS; level++) {
+    LogFile &file = rollup_log.log_file(level);
+    if (file.is_open() && strcmp(file.path(), path) == 0) {
+      file.close();  // Reopened (with a new header) on the next record
+    }
+  }
+#endif
+}
+
+bool sd_logger_active_length(const char *path, uint32_t *length) {
+  SdGuard guard;
+  if (path[0] == '/') path++;
+  for (int ch = 0; ch < NUM_CHANNELS; ch++) {
+    LogFile &file = channel_logs[ch].file;
+    if (file.is_open() && strcmp(file.path(), path) == 0) {
+      *length = min(*length, file.written());
+      return true;
+    }
+  }
+#if LOG_BINARY
+  // The block still being filled is not on the card yet
+  LogFile &file = binary_log.log_file();
+  if (file.is_open() && strcmp(file.path(), path) == 0) {
+    *length = min(*length, file.written());
+    return true;
+  }
+#endif
+  return false;
+}
+
+uint32_t log_index_lookup(const char *index_path, uint32_t seconds) {
+  SdGuard guard;
+  SdFile file;
+  if (!file.open(index_path, O_READ)) return 0;
+
+  uint32_t offset = 0;
+  LogIndexEntry entries[32];
+  int n;
+  while ((n = file.read(entries, sizeof(entries))) >= (int)sizeof(LogIndexEntry)) {
+    for (int i = 0; i < n / (int)sizeof(LogIndexEntry); i++) {
+      if (entries[i].seconds > seconds) {
+        file.close();
+        return offset;
+      }
+      offset = entries[i].offset;
+    }
+  }
+  file.close();
+  return offset;
+}
+
+const char *sd_logger_channel_prefix(uint8_t channel) {
+  return channel < NUM_CHANNELS ? channel_logs[channel].prefix : "";
+}
+
+uint32_t sd_logger_file_size(uint8_t channel) {
+  if (channel >= NUM_CHANNELS) return 0;
+  return channel_logs[channel].file.size();
+}
+
+bool sd_logger_rollup_pending(uint8_t level, RollupRecord &record) {
+#if LOG_ROLLUP
+  SdGuard guard;
+  return level < ROLLUP_LEVELS && rollup_log.pending(level, record);
+#else
+  return false;
+#endif
+}
+
+uint32_t sd_logger_binary_size() {
+#if LOG_BINARY
+  return binary_log.size();
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,204 @@
+// sd_logger.h
+#ifndef SD_LOGGER_H
+#define SD_LOGGER_H
+
+#include <Arduino.h>
+#include <SdFat.h>
+#include <RTClib.h>
+#include "sampler.h"
+
+/**
+ * Buffered SD card logger
+ *
+ * Keeps the daily per-channel files ("Amps YYYY-MM-DD.txt", ...) open
+ * instead of opening and closing them for every value. Text is collected in
+ * a RAM buffer per file and written to the card in whole 512-byte blocks
+ * aligned to the file offset, so every card write covers complete sectors.
+ * A periodic sync() commits the partial tail and the directory entry.
+ *
+ * Files roll over to a new name when the date of the incoming sample
+ * changes; the line of the old day is terminated first and the new file
+ * starts with a fresh "HH:MM:SS --> " line.
+ *
+ * Next to each text file, "<Channel> YYYY-MM-DD.idx" records where every
+ * "HH:MM:SS --> " line starts (LogIndexEntry), so readers can seek to a
+ * time of day without parsing the file from the beginning.
+ *
+ * New daily files are pre-allocated as one contiguous extent so that
+ * appends never have to grow the FAT cluster chain. The unused part of the
+ * extent is erased up front and given back with truncate() when the file
+ * is closed; after an unclean shutdown sd_logger_begin() finds the real end
+ * of such files and truncates them.
+ *
+ * Besides the text files, a compact binary log with raw ADC codes can be
+ * written (see binlog.h). Select the formats with LOG_TEXT / LOG_BINARY,
+ * e.g. "-D LOG_BINARY=1" in platformio.ini build_flags; LOG_BINARY_PACKED
+ * delta-codes its blocks.
+ *
+ * LOG_ROLLUP keeps per-minute and per-hour aggregates in their own small
+ * files (see rollup.h) for long-range plots.
+ */
+
+// ===== CONFIGURATION =====
+#define LOG_BLOCK_SIZE 512            // SD sector size, writes are aligned to this
+#define LOG_BUFFER_SIZE 1024          // RAM buffer per open file (multiple of LOG_BLOCK_SIZE)
+#define LOG_SYNC_INTERVAL_MS 60000    // Max time buffered text may stay in RAM
+#define LOG_VALUES_PER_LINE 60        // Samples per "HH:MM:SS --> ..." line
+#define LOG_TEXT_DECIMALS 2           // Decimals of text log values (A / V)
+
+#ifndef LOG_PREALLOC_TEXT
+#define LOG_PREALLOC_TEXT 786432      // Contiguous extent per text file, 0 = off (a day at 1 Hz is ~630 KB)
+#endif
+#ifndef LOG_PREALLOC_BINARY
+#define LOG_PREALLOC_BINARY 393216    // Contiguous extent per binary file, 0 = off (a day at 1 Hz is ~354 KB)
+#endif
+
+#ifndef LOG_TEXT
+#define LOG_TEXT 1                    // Human readable "Amps/Volts YYYY-MM-DD.txt" files
+#endif
+#ifndef LOG_BINARY
+#define LOG_BINARY 0                  // Packed raw codes in "Raw YYYY-MM-DD.bin"
+#endif
+#ifndef LOG_BINARY_PACKED
+#define LOG_BINARY_PACKED 0           // Delta/varint-coded binary blocks (format version 3, ~1 byte per code)
+#endif
+#ifndef LOG_ROLLUP
+#define LOG_ROLLUP 1                  // Minute/hour aggregates in "Minute ....rol" / "Hour ....rol"
+#endif
+
+struct BinLogConfig;
+struct RollupRecord;
+
+/**
+ * One record of a text log's line index
+ */
+struct __attribute__((packed)) LogIndexEntry {
+  uint32_t seconds;   // Time of day of the line, seconds since midnight
+  uint32_t offset;    // Byte offset of the line's "HH:MM:SS" in the text file
+};
+
+/**
+ * An append-only file with a block-aligned write buffer
+ */
+class LogFile : public Print {
+public:
+  /**
+   * Open (or create) a file and position at its end
+   * @param path File path on the SD card
+   * @param prealloc_bytes Contiguous extent to reserve if the file is new (0 = none)
+   * @return true if the file is open
+   */
+  bool open(const char *path, uint32_t prealloc_bytes = 0);
+
+  // Write all buffered data, release the unused extent and close the file
+  void close();
+
+  // Write buffered data (including the partial tail) and update the directory entry
+  bool sync();
+
+  bool is_open() const { return opened; }
+  bool is_preallocated() const { return preallocated; }
+  const char *path() const { return file_path; }
+
+  // Size including data still in the RAM buffer
+  uint32_t size() const { return file_pos + used; }
+
+  // Bytes already written to the card; other handles can read them without a sync
+  uint32_t written() const { return file_pos; }
+
+  size_t write(uint8_t b) override;
+  size_t write(const uint8_t *data, size_t len) override;
+
+private:
+  bool preallocate(uint32_t length);
+  bool flush_blocks();
+  bool write_out(size_t len);
+
+  SdFile file;
+  char file_path[32] = "";
+  uint8_t buffer[LOG_BUFFER_SIZE];
+  size_t used = 0;         // Bytes waiting in buffer
+  uint32_t file_pos = 0;   // Bytes already on the card
+  bool opened = false;
+  bool preallocated = false;
+};
+
+/**
+ * Initialize the logger
+ * @param cs_pin SD card chip select, used to reinitialize the card after errors
+ * @param spi_speed SPI speed passed to sd.begin() on reinit
+ * @param binlog_config Interval and calibration stored in binary log headers
+ */
+void sd_logger_begin(uint8_t cs_pin, uint32_t spi_speed, const BinLogConfig &binlog_config);
+
+/**
+ * Append one value per channel to the daily log files
+ * @param time Timestamp of the sample, selects the daily file
+ * @param values Value of each channel in micro-units, uA / uV (text log, rollups)
+ * @param codes ADC code of each channel (binary log)
+ * @param gains PGA gain each code is expressed in (binary log)
+ */
+void sd_logger_log(const DateTime &time, const int32_t values[NUM_CHANNELS],
+                   const int16_t codes[NUM_CHANNELS], const uint8_t gains[NUM_CHANNELS]);
+
+/**
+ * Update the calibration stored in new binary log headers
+ */
+void sd_logger_set_calibration(const float scale[NUM_CHANNELS], const float offset[NUM_CHANNELS]);
+
+// Write all buffered data to the card
+void sd_logger_sync();
+
+// Close all log files (e.g. before OTA or power down)
+void sd_logger_close();
+
+/**
+ * Release a file that is about to be deleted or replaced.
+ * If the logger has it open, it is closed and reopened on the next sample.
+ * @param path Path of the file on the SD card
+ */
+void sd_logger_release(const char *path);
+
+/**
+ * Readable data length of a file the logger is writing.
+ * Pre-allocated files report their full extent as size until they are
+ * closed, so readers must not rely on fileSize() for active logs. Data
+ * still in the RAM buffer is not counted; it reaches the card with the
+ * next periodic sync, so readers never force one.
+ * @param path Path of the file on the SD card
+ * @param length The reader's fileSize() on entry, set to the number of
+ *               bytes it can read
+ * @return true if the logger has the file open
+ */
+bool sd_logger_active_length(const char *path, uint32_t *length);
+
+/**
+ * Find the offset of the last indexed line (or binary block) that starts at
+ * or before a time of day
+ * @param index_path Path of a ".idx" file of LogIndexEntry records
+ * @param seconds Seconds since midnight
+ * @return File offset, 0 if the index is missing or has no earlier entry
+ */
+uint32_t log_index_lookup(const char *index_path, uint32_t seconds);
+
+/**
+ * File name prefix of a channel's text logs: its name and a space ("Amps ")
+ */
+const char *sd_logger_channel_prefix(uint8_t channel);
+
+/**
+ * Size of the current text log file of a channel, including buffered data
+ */
+uint32_t sd_logger_file_size(uint8_t channel);
+
+/**
+ * Copy the unfinished rollup record of a level (not yet in its file)
+ * @param level ROLLUP_MINUTE or ROLLUP_HOUR
+ * @return false if rollups are disabled or the level has no data yet
+ */
+bool sd_logger_rollup_pending(uint8_t level, RollupRecord &record);
+
+// Size of the current binary log file, including buffered data
+uint32_t sd_logger_binary_size();
+
+#endif
@@ -0,0 +1,416 @@
+#include "series_query.h"
+#include "sd_access.h"
+#include "sd_logger.h"
+#include "rollup.h"
+#include <RTClib.h>
+#include <memory>
+
+#define SERIES_LINE_SIZE 768          // Longest text log line that is parsed
+#define SERIES_READ_SIZE 512
+#define SERIES_ROLLUP_RECORDS 14      // Rollup records read per SD access
+
+static QueueHandle_t series_queue = NULL;
+static uint32_t series_interval_ms = 1000;
+
+// Queue items own a reference to the job; the response holds the other one
+typedef std::shared_ptr<SeriesJob> SeriesJobRef;
+
+/**
+ * Line reader over one text log, reading SERIES_READ_SIZE blocks and taking
+ * the SD mutex only for each block
+ */
+class TextLogReader {
+public:
+  ~TextLogReader() { close(); }
+
+  bool open(const char *path) {
+    SdGuard guard;
+    if (!file.open(path, O_READ)) return false;
+    length = file.fileSize();
+    sd_logger_active_length(path, &length);  // Pre-allocated while being written
+    return true;
+  }
+
+  void close() {
+    if (!file.isOpen()) return;
+    SdGuard guard;
+    file.close();
+  }
+
+  void seek(uint32_t offset) {
+    pos = offset;
+    buffered = 0;
+    next = 0;
+  }
+
+  /**
+   * Read the next line without its newline
+   * @return Line length, -1 at the end of the file
+   */
+  int read_line(char *out, size_t size) {
+    size_t len = 0;
+    bool overflow = false;
+    for (;;) {
+      if (next == buffered && !fill()) {
+        return len > 0 ? (int)len : -1;
+      }
+      char c = block[next++];
+      if (c == '\n') break;
+      if (c == '\r') continue;
+      if (len + 1 < size) {
+        out[len++] = c;
+      } else {
+        overflow = true;
+      }
+    }
+    out[len] = '\0';
+    return overflow ? 0 : (int)len;  // Overlong lines are skipped as empty
+  }
+
+private:
+  bool fill() {
+    if (pos >= length) return false;
+    SdGuard guard;
+    size_t want = min((uint32_t)SERIES_READ_SIZE, length - pos);
+    if (!file.seekSet(pos)) return false;
+    int n = file.read(block, want);
+    if (n <= 0) return false;
+    pos += n;
+    buffered = n;
+    next = 0;
+    return true;
+  }
+
+  SdFile file;
+  uint32_t length = 0;   // Bytes of valid data
+  uint32_t pos = 0;      // File offset of the next block
+  char block[SERIES_READ_SIZE];
+  size_t buffered = 0;
+  size_t next = 0;
+};
+
+/**
+ * Parse a decimal number with up to two decimals into hundredths
+ * @param p Text position, advanced past the number
+ * @return false if no number was found
+ */
+static bool parse_centi(const char *&p, int32_t &out) {
+  while (*p == ' ' || *p == ',') p++;
+  bool negative = *p == '-';
+  if (negative) p++;
+  if (!isdigit((unsigned char)*p)) return false;
+
+  int32_t value = 0;
+  while (isdigit((unsigned char)*p)) value = value * 10 + (*p++ - '0');
+  int decimals = 0;
+  if (*p == '.') {
+    p++;
+    while (isdigit((unsigned char)*p)) {
+      if (decimals < 2) {
+        value = value * 10 + (*p - '0');
+        decimals++;
+      }
+      p++;
+    }
+  }
+  for (; decimals < 2; decimals++) value *= 10;
+  out = negative ? -value : value;
+  return true;
+}
+
+/**
+ * Parse "HH:MM:SS --> " at the start of a line
+ * @return Seconds since midnight, or -1 if the line has no timestamp
+ */
+static int32_t parse_line_time(const char *line, const char *&values) {
+  if (strlen(line) < 13 || line[2] != ':' || line[5] != ':' || strncmp(line + 8, " --> ", 5) != 0) {
+    return -1;
+  }
+  values = line + 13;
+  return atoi(line) * 3600 + atoi(line + 3) * 60 + atoi(line + 6);
+}
+
+static void add_to_bucket(SeriesJob &job, uint32_t bucket, int32_t min, int32_t max,
+                          int64_t sum, uint32_t count) {
+  SeriesBucket &b = job.buckets[bucket];
+  if (min < b.min) b.min = min;
+  if (max > b.max) b.max = max;
+  b.sum += sum;
+  b.count += count;
+}
+
+/**
+ * Fill the buckets from the raw text logs
+ */
+static void scan_text_logs(SeriesJob &job, const std::atomic<bool> *cancelled) {
+  const uint64_t span_ms = (uint64_t)(job.to - job.from) * 1000;
+  std::unique_ptr<char[]> line(new char[SERIES_LINE_SIZE]);
+
+  for (uint32_t day = job.from - job.from % 86400; day < job.to; day += 86400) {
+    DateTime date(day);
+    char path[32];
+    snprintf(path, sizeof(path), "%s%04d-%02d-%02d.txt", sd_logger_channel_prefix(job.channel),
+             date.year(), date.month(), date.day());
+
+    TextLogReader reader;
+    if (!reader.open(path)) continue;
+
+    // Start at the line index entry just before the range, if the range starts this day
+    if (job.from > day) {
+      char index_path[32];
+      strcpy(index_path, path);
+      strcpy(index_path + strlen(index_path) - 4, ".idx");
+      reader.seek(log_index_lookup(index_path, job.from - day));
+    }
+
+    int len;
+    while ((len = reader.read_line(line.get(), SERIES_LINE_SIZE)) >= 0) {
+      if (cancelled && cancelled->load()) return;
+
+      const char *p;
+      int32_t seconds = parse_line_time(line.get(), p);
+      if (seconds < 0) continue;
+
+      // Milliseconds since job.from of the line's first value
+      int64_t t_ms = ((int64_t)day + seconds - job.from) * 1000;
+      if (t_ms >= (int64_t)span_ms) break;  // Lines are in time order within a day
+
+      int32_t value;
+      for (; parse_centi(p, value); t_ms += job.interval_ms) {
+        if (t_ms < 0) continue;
+        if (t_ms >= (int64_t)span_ms) break;
+        add_to_bucket(job, (t_ms * job.points) / span_ms, value, value, value, 1);
+      }
+    }
+  }
+}
+
+static int32_t to_centi(float value) {
+  return (int32_t)lroundf(value * 100.0f);
+}
+
+static void add_rollup_record(SeriesJob &job, const RollupRecord &record) {
+  if (record.epoch < job.from || record.epoch >= job.to || record.count == 0) return;
+  uint32_t bucket = ((uint64_t)(record.epoch - job.from) * job.points) / (job.to - job.from);
+  add_to_bucket(job, bucket, to_centi(record.min[job.channel]), to_centi(record.max[job.channel]),
+                (int64_t)to_centi(record.mean[job.channel]) * record.count, record.count);
+}
+
+/**
+ * Fill the buckets from one rollup file
+ */
+static void scan_rollup_file(SeriesJob &job, const char *path, const std::atomic<bool> *cancelled) {
+  SdFile file;
+  uint32_t records;
+  {
+    SdGuard guard;
+    if (!file.open(path, O_READ)) return;
+    uint32_t size = file.fileSize();
+    records = size > ROLLUP_HEADER_SIZE ? (size - ROLLUP_HEADER_SIZE) / sizeof(RollupRecord) : 0;
+  }
+
+  // Records are in time order: binary search for the first one in range
+  uint32_t lo = 0;
+  uint32_t hi = records;
+  while (lo < hi) {
+    uint32_t mid = lo + (hi - lo) / 2;
+    uint32_t epoch = 0;
+    SdGuard guard;
+    file.seekSet(ROLLUP_HEADER_SIZE + mid * sizeof(RollupRecord));
+    file.read(&epoch, sizeof(epoch));
+    if (epoch < job.from) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+
+  RollupRecord chunk[SERIES_ROLLUP_RECORDS];
+  for (uint32_t pos = lo; pos < records && !(cancelled && cancelled->load());) {
+    int n;
+    {
+      SdGuard guard;
+      file.seekSet(ROLLUP_HEADER_SIZE + pos * sizeof(RollupRecord));
+      n = file.read(chunk, sizeof(chunk)) / (int)sizeof(RollupRecord);
+    }
+    if (n <= 0) break;
+    for (int i = 0; i < n; i++) {
+      if (chunk[i].epoch >= job.to) {
+        pos = records;
+        break;
+      }
+      add_rollup_record(job, chunk[i]);
+    }
+    if (pos < records) pos += n;
+  }
+
+  SdGuard guard;
+  file.close();
+}
+
+/**
+ * Fill the buckets from the minute or hour rollups, including the periods
+ * the logger is still accumulating
+ */
+static void scan_rollups(SeriesJob &job, uint8_t level, const std::atomic<bool> *cancelled) {
+  char path[32];
+  if (level == ROLLUP_MINUTE) {
+    for (uint32_t day = job.from - job.from % 86400; day < job.to; day += 86400) {
+      rollup_file_name(level, DateTime(day), path, sizeof(path));
+      scan_rollup_file(job, path, cancelled);
+    }
+  } else {
+    DateTime first(job.from);
+    int year = first.year();
+    int month = first.month();
+    while (DateTime(year, month, 1).unixtime() < job.to) {
+      rollup_file_name(level, DateTime(year, month, 1), path, sizeof(path));
+      scan_rollup_file(job, path, cancelled);
+      if (++month > 12) {
+        month = 1;
+        year++;
+      }
+    }
+  }
+
+  // Unfinished periods of this level and the finer ones have not been written yet
+  for (int l = level; l >= 0; l--) {
+    RollupRecord record;
+    if (sd_logger_rollup_pending(l, record)) add_rollup_record(job, record);
+  }
+}
+
+void series_compute(SeriesJob &job, const std::atomic<bool> *cancelled) {
+  for (int i = 0; i < job.points; i++) {
+    job.buckets[i] = { INT32_MAX, INT32_MIN, 0, 0 };
+  }
+  if (job.to <= job.from || job.points == 0) return;
+
+#if LOG_ROLLUP
+  // Coarse buckets are answered from the aggregates instead of the raw data
+  uint32_t bucket_s = (job.to - job.from) / job.points;
+  if (bucket_s >= SERIES_ROLLUP_MIN_RECORDS * rollup_period(ROLLUP_HOUR)) {
+    scan_rollups(job, ROLLUP_HOUR, cancelled);
+    return;
+  }
+  if (bucket_s >= SERIES_ROLLUP_MIN_RECORDS * rollup_period(ROLLUP_MINUTE)) {
+    scan_rollups(job, ROLLUP_MINUTE, cancelled);
+    return;
+  }
+#endif
+  scan_text_logs(job, cancelled);
+}
+
+static void series_task(void *arg) {
+  (void)arg;
+  for (;;) {
+    SeriesJobRef *item;
+    if (xQueueReceive(series_queue, &item, portMAX_DELAY) != pdTRUE) continue;
+
+    SeriesJobRef job = *item;
+    delete item;
+
+    if (!job->cancelled) {
+      series_compute(*job, &job->cancelled);
+    }
+    job->done = true;
+  }
+}
+
+void series_begin(uint32_t interval_ms) {
+  series_interval_ms = interval_ms;
+  series_queue = xQueueCreate(SERIES_QUEUE_LENGTH, sizeof(SeriesJobRef *));
+  xTaskCreatePinnedToCore(series_task, "series", SERIES_TASK_STACK, NULL,
+                          SERIES_TASK_PRIORITY, NULL, SERIES_TASK_CORE);
+}
+
+/**
+ * Format the next part of the JSON answer into the job's line buffer
+ * @return false when everything was written
+ */
+static bool next_series_line(SeriesJob &job) {
+  job.line_pos = 0;
+  job.line_len = 0;
+
+  if (job.emit_stage == 0) {
+    job.emit_stage = 1;
+    job.line_len = snprintf(job.line, sizeof(job.line),
+                            "{\"channel\":\"%s\",\"from\":%u,\"to\":%u,\"bucket_s\":%.3f,\"buckets\":[",
+                            channel_table[job.channel].name, job.from, job.to,
+                            (double)(job.to - job.from) / job.points);
+    return true;
+  }
+
+  while (job.emit_stage == 1 && job.emit_pos < job.points) {
+    uint16_t i = job.emit_pos++;
+    const SeriesBucket &bucket = job.buckets[i];
+    if (bucket.count == 0) continue;
+
+    double t = job.from + (double)(job.to - job.from) * i / job.points;
+    job.line_len = snprintf(job.line, sizeof(job.line), "%s[%.1f,%.2f,%.2f,%.3f,%u]",
+                            job.emitted ? "," : "",
+                            t, bucket.min / 100.0, bucket.max / 100.0,
+                            (double)bucket.sum / bucket.count / 100.0, bucket.count);
+    job.emitted = true;
+    return true;
+  }
+
+  if (job.emit_stage == 1) {
+    job.emit_stage = 2;
+    job.line_len = snprintf(job.line, sizeof(job.line), "]}\n");
+    return true;
+  }
+  return false;
+}
+
+void send_series(AsyncWebServerRequest *request) {
+  int channel = -1;
+  if (request->hasParam("channel")) {
+    channel = channel_find(request->getParam("channel")->value().c_str());
+  }
+  if (channel < 0 || !request->hasParam("from") || !request->hasParam("to")) {
+    request->send(400, "application/json", "{\"error\":\"channel, from and to are required\"}");
+    return;
+  }
+
+  SeriesJobRef job = std::make_shared<SeriesJob>();
+  job->channel = channel;
+  job->from = strtoul(request->getParam("from")->value().c_str(), nullptr, 10);
+  job->to = strtoul(request->getParam("to")->value().c_str(), nullptr, 10);
+  long points = request->hasParam("points") ? request->getParam("points")->value().toInt() : SERIES_DEFAULT_POINTS;
+  if (points < 1) points = 1;
+  if (points > SERIES_MAX_POINTS) points = SERIES_MAX_POINTS;
+  job->points = points;
+  job->interval_ms = series_interval_ms;
+  if (job->to <= job->from) {
+    request->send(400, "application/json", "{\"error\":\"to must be after from\"}");
+    return;
+  }
+
+  SeriesJobRef *item = new SeriesJobRef(job);
+  if (series_queue == NULL || xQueueSend(series_queue, &item, 0) != pdTRUE) {
+    delete item;
+    request->send(503, "application/json", "{\"error\":\"query worker busy\"}");
+    return;
+  }
+
+  // A client that goes away stops the scan at the next line or record
+  request->onDisconnect([job]() { job->cancelled = true; });
+
+  AsyncWebServerResponse *response = request->beginChunkedResponse("application/json",
+    [job](uint8_t *buffer, size_t max_len, size_t index) -> size_t {
+      if (!job->done) return RESPONSE_TRY_AGAIN;
+
+      size_t len = 0;
+      while (len < max_len) {
+        if (job->line_pos == job->line_len && !next_series_line(*job)) break;
+        size_t n = min(job->line_len - job->line_pos, max_len - len);
+        memcpy(buffer + len, job->line + job->line_pos, n);
+        job->line_pos += n;
+        len += n;
+      }
+      return len;
+    });
+  response->addHeader("Cache-Control", "no-store");
+  request->send(response);
+}
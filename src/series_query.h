@@ -0,0 +1,85 @@
+// series_query.h
+#ifndef SERIES_QUERY_H
+#define SERIES_QUERY_H
+
+#include <Arduino.h>
+#include <ESPAsyncWebServer.h>
+#include <atomic>
+#include "sampler.h"
+
+/**
+ * Downsampled time-series queries over the daily text logs
+ *
+ * GET /api/series?channel=Amps&from=<epoch>&to=<epoch>&points=200 answers
+ *   {"channel":"Amps","from":..,"to":..,"bucket_s":..,
+ *    "buckets":[[t,min,max,mean,count],...]}
+ * with one entry per non-empty bucket (min-max decimation, so spikes
+ * survive any zoom level). Times are RTC unix time, like the log files.
+ *
+ * Buckets of at least SERIES_ROLLUP_MIN_RECORDS minutes (or hours) are
+ * built from the rollup files (rollup.h), so a month-long plot reads a few
+ * KB. Finer queries read the text logs through their line index (.idx, see
+ * sd_logger.h), starting close to the requested time. Scanning can take a while for long
+ * ranges, so queries run in their own low-priority task; the web server
+ * keeps polling the response until the result is ready.
+ */
+
+// ===== CONFIGURATION =====
+#define SERIES_MAX_POINTS 500         // Upper bound on buckets per query
+#define SERIES_DEFAULT_POINTS 200
+#define SERIES_QUEUE_LENGTH 2         // Queries waiting for the worker
+#define SERIES_TASK_STACK 6144
+#define SERIES_TASK_PRIORITY 1        // Below the logger and MQTT tasks
+#define SERIES_TASK_CORE 0
+#define SERIES_ROLLUP_MIN_RECORDS 4   // Rollup records per bucket before they replace raw data
+
+/**
+ * Min/max/mean accumulator of one bucket, in hundredths of the channel's
+ * unit (the text logs store two decimals)
+ */
+struct SeriesBucket {
+  int32_t min;
+  int32_t max;
+  int64_t sum;
+  uint32_t count;
+};
+
+struct SeriesJob {
+  uint8_t channel;
+  uint32_t from;              // First second included
+  uint32_t to;                // First second excluded
+  uint16_t points;            // Number of buckets
+  uint32_t interval_ms;       // Spacing of values on a log line
+  SeriesBucket buckets[SERIES_MAX_POINTS];
+  volatile bool done = false;
+  std::atomic<bool> cancelled{false};   // Set when the client disconnects
+
+  // Response formatting state
+  uint16_t emit_pos = 0;
+  uint8_t emit_stage = 0;
+  bool emitted = false;       // A bucket was written (next one needs a comma)
+  char line[96];
+  size_t line_len = 0;
+  size_t line_pos = 0;
+};
+
+/**
+ * Start the query worker task
+ * @param interval_ms Spacing of logged values (OUTPUT_INTERVAL_MS)
+ */
+void series_begin(uint32_t interval_ms);
+
+/**
+ * Scan the logs and fill the job's buckets. Runs in the worker task.
+ * @param job Query with channel, range and points set
+ * @param cancelled Polled between lines; true stops the scan early
+ */
+void series_compute(SeriesJob &job, const std::atomic<bool> *cancelled = nullptr);
+
+/**
+ * Handle GET /api/series
+ * @param request Web request with channel, from, to and points parameters
+ */
+void send_series(AsyncWebServerRequest *request);
+
+#endif
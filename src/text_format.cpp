@@ -0,0 +1,82 @@
+#include "text_format.h"
+#include "scaler.h"
+
+// Two digits of 0..99
+static void two_digits(char *out, uint32_t value) {
+  out[0] = '0' + value / 10 % 10;
+  out[1] = '0' + value % 10;
+}
+
+size_t format_clock(char *out, uint32_t seconds) {
+  two_digits(out, seconds / 3600 % 100);
+  out[2] = ':';
+  two_digits(out + 3, seconds / 60 % 60);
+  out[5] = ':';
+  two_digits(out + 6, seconds % 60);
+  out[8] = '\0';
+  return 8;
+}
+
+TextLine &TextLine::add(const char *s) {
+  while (*s && len < TEXT_LINE_SIZE - 1) text[len++] = *s++;
+  text[len] = '\0';
+  return *this;
+}
+
+TextLine &TextLine::add(char c) {
+  if (len < TEXT_LINE_SIZE - 1) text[len++] = c;
+  text[len] = '\0';
+  return *this;
+}
+
+TextLine &TextLine::add_uint(uint32_t value) {
+  char digits[11];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  while (n && len < TEXT_LINE_SIZE - 1) text[len++] = digits[--n];
+  text[len] = '\0';
+  return *this;
+}
+
+TextLine &TextLine::add_int(int32_t value) {
+  if (value < 0) add('-');
+  return add_uint(value < 0 ? 0u - (uint32_t)value : (uint32_t)value);
+}
+
+TextLine &TextLine::add_micro(int32_t micro, uint8_t decimals) {
+  char number[16];
+  format_micro(number, micro, decimals);
+  return add(number);
+}
+
+TextLine &TextLine::add_float(float value, uint8_t decimals) {
+  if (isnan(value)) return add("nan");
+  if (isinf(value)) return add(value < 0 ? "-inf" : "inf");
+  if (fabsf(value) < 2000.0f) return add_micro((int32_t)lroundf(value * 1e6f), decimals);
+  return add_int((int32_t)constrain(lroundf(value), -2147483647L, 2147483647L));
+}
+
+TextLine &TextLine::add_time(const DateTime &time) {
+  char clock[9];
+  format_clock(clock, time.hour() * 3600UL + time.minute() * 60UL + time.second());
+  return add(clock);
+}
+
+TextLine &TextLine::add_date(const DateTime &time) {
+  uint32_t key = time.year() * 10000UL + time.month() * 100UL + time.day();
+  if (key != date_key) {
+    uint32_t year = time.year();
+    two_digits(date_text, year / 100);
+    two_digits(date_text + 2, year);
+    date_text[4] = '-';
+    two_digits(date_text + 5, time.month());
+    date_text[7] = '-';
+    two_digits(date_text + 8, time.day());
+    date_text[10] = '\0';
+    date_key = key;
+  }
+  return add(date_text);
+}
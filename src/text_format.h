@@ -0,0 +1,58 @@
+// text_format.h
+#ifndef TEXT_FORMAT_H
+#define TEXT_FORMAT_H
+
+#include <Arduino.h>
+#include <RTClib.h>
+
+/**
+ * Allocation-free text formatting for periodic output
+ *
+ * Print::printf() formats into a 64-byte stack buffer and mallocs a larger
+ * one for every longer line, and String concatenation allocates on every
+ * step. Over months of uptime that churn fragments the heap the web server
+ * needs. Lines that are printed every second or minute are built in a
+ * TextLine instead: a fixed buffer that the owning task keeps (static),
+ * filled by integer-only appenders. Fixed-point values go through
+ * format_micro() (scaler.h); the date text is cached until the day changes.
+ * Output beyond TEXT_LINE_SIZE is cut off.
+ */
+
+// ===== CONFIGURATION =====
+#define TEXT_LINE_SIZE 192    // Longest line, including the terminator
+
+/**
+ * "HH:MM:SS" of a second of the day
+ * @param out Buffer, at least 9 bytes
+ * @return Characters written (8)
+ */
+size_t format_clock(char *out, uint32_t seconds);
+
+struct TextLine {
+  char text[TEXT_LINE_SIZE];
+  size_t len = 0;
+
+  void clear() { len = 0; text[0] = '\0'; }
+
+  TextLine &add(const char *s);
+  TextLine &add(char c);
+  TextLine &add_uint(uint32_t value);
+  TextLine &add_int(int32_t value);
+  // Micro-units with a fixed number of decimals (format_micro())
+  TextLine &add_micro(int32_t micro, uint8_t decimals);
+  // Float via add_micro(); values beyond +-2000 are printed without decimals
+  TextLine &add_float(float value, uint8_t decimals);
+  // "HH:MM:SS"
+  TextLine &add_time(const DateTime &time);
+  // "YYYY-MM-DD", formatted once per day
+  TextLine &add_date(const DateTime &time);
+
+  // Write the line in one piece
+  size_t print_to(Print &out) const { return out.write((const uint8_t *)text, len); }
+
+private:
+  uint32_t date_key = 0;
+  char date_text[11];
+};
+
+#endif
@@ -0,0 +1,251 @@
+#include "time_service.h"
+#include <esp_timer.h>
+#include <esp_sntp.h>
+#include <sys/time.h>
+#include <time.h>
+
+static RTC_DS3231 *time_rtc = nullptr;
+static portMUX_TYPE time_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+// wall = base_epoch_us + elapsed + elapsed * drift_ppb / 1e9, elapsed = mono - base_mono
+static int64_t base_mono = 0;
+static int64_t base_epoch_us = 0;
+static int32_t drift_ppb = 0;
+static TimeStatus status = { TIME_SOURCE_NONE, 0, 0, 0, 0, 0, 0, 0 };
+
+static int64_t last_rtc_sync = 0;    // esp_timer time of the last RTC resync
+static int64_t last_ntp_sync = 0;
+static bool ntp_started = false;
+static bool ntp_valid = false;
+
+// Latest SNTP result, handed over from the lwIP task
+static bool ntp_pending = false;
+static int64_t ntp_epoch_us = 0;
+static int64_t ntp_mono = 0;
+
+// Wall time of an esp_timer value (time_spinlock held)
+static int64_t extrapolate(int64_t mono) {
+  int64_t elapsed = mono - base_mono;
+  return base_epoch_us + elapsed + elapsed * drift_ppb / 1000000000;
+}
+
+/**
+ * Move the clock onto a reference time. The clock was exact at the last
+ * sync from the same source, so the error accumulated since is the rate
+ * error of the local clock; half of it is added to drift_ppb.
+ * @param measure_drift false when the previous sync was only approximate
+ */
+static void correct(int64_t epoch_us, int64_t mono, TimeSource source, bool measure_drift) {
+  portENTER_CRITICAL(&time_spinlock);
+  int64_t error = epoch_us - extrapolate(mono);
+  int64_t span = mono - base_mono;
+  if (measure_drift && status.source == source &&
+      span >= (int64_t)TIME_DRIFT_MIN_SPAN_MS * 1000 && llabs(error) < 1000000) {
+    int64_t drift = drift_ppb + error * 1000000000 / span / 2;
+    drift_ppb = constrain(drift, (int64_t)-TIME_MAX_DRIFT_PPB, (int64_t)TIME_MAX_DRIFT_PPB);
+  }
+  base_mono = mono;
+  base_epoch_us = epoch_us;
+
+  status.source = source;
+  status.drift_ppb = drift_ppb;
+  status.last_error_us = constrain(error, (int64_t)INT32_MIN, (int64_t)INT32_MAX);
+  status.last_sync = epoch_us / 1000000;
+  status.resyncs++;
+  portEXIT_CRITICAL(&time_spinlock);
+}
+
+/**
+ * One RTC read
+ * @param mono Set to the esp_timer time halfway through the transaction
+ * @return RTC time in whole seconds
+ */
+static uint32_t read_rtc(int64_t &mono) {
+  int64_t start = esp_timer_get_time();
+  uint32_t epoch = time_rtc->now().unixtime();
+  mono = (start + esp_timer_get_time()) / 2;
+  status.rtc_reads++;
+  return epoch;
+}
+
+/**
+ * Poll the RTC until its seconds change
+ * @param max_wait_ms Give up after this long
+ * @param edge_mono Set to the esp_timer time of the change
+ * @param edge_epoch Set to the second that began there
+ */
+static bool find_edge(uint32_t max_wait_ms, int64_t &edge_mono, uint32_t &edge_epoch) {
+  int64_t before;
+  uint32_t first = read_rtc(before);
+  int64_t deadline = before + (int64_t)max_wait_ms * 1000;
+  for (;;) {
+    delay(TIME_EDGE_POLL_MS);
+    int64_t after;
+    uint32_t epoch = read_rtc(after);
+    if (epoch != first) {
+      edge_mono = (before + after) / 2;
+      edge_epoch = epoch;
+      return true;
+    }
+    if (after > deadline) return false;
+    before = after;
+  }
+}
+
+/**
+ * Sleep until shortly before the second edge the clock expects, then poll
+ * for it. Falls back to a full search if the clock is off by more than
+ * the window.
+ */
+static bool resync_edge(int64_t &edge_mono, uint32_t &edge_epoch) {
+  int64_t into_second = time_now_us() % 1000000;
+  int32_t wait_ms = (1000000 - into_second) / 1000 - TIME_EDGE_WINDOW_MS / 2;
+  if (wait_ms < 0) wait_ms += 1000;
+  delay(wait_ms);
+  return find_edge(TIME_EDGE_WINDOW_MS, edge_mono, edge_epoch) ||
+         find_edge(1100, edge_mono, edge_epoch);
+}
+
+/**
+ * Shift a UTC time into the TIME_TZ wall time the clock and the RTC count
+ * (configTzTime() has set the zone)
+ */
+static int64_t local_from_utc(int64_t utc_us) {
+  time_t seconds = utc_us / 1000000;
+  struct tm local;
+  localtime_r(&seconds, &local);
+  DateTime wall(local.tm_year + 1900, local.tm_mon + 1, local.tm_mday,
+                local.tm_hour, local.tm_min, local.tm_sec);
+  return (int64_t)wall.unixtime() * 1000000 + utc_us % 1000000;
+}
+
+// Set the RTC on the next second boundary of the (NTP-disciplined) clock
+static void adjust_rtc() {
+  int64_t now = time_now_us();
+  delay((1000000 - now % 1000000) / 1000);
+  uint32_t second = (time_now_us() + 500000) / 1000000;
+  time_rtc->adjust(DateTime(second));
+  status.rtc_adjusts++;
+  Serial.printf("RTC set from NTP to %u\n", second);
+}
+
+bool time_service_begin(RTC_DS3231 *rtc) {
+  time_rtc = rtc;
+
+  // Whole seconds first, so the clock is usable even if the edge search fails
+  int64_t mono;
+  uint32_t epoch = read_rtc(mono);
+  correct((int64_t)epoch * 1000000 + 500000, mono, TIME_SOURCE_RTC, false);
+  last_rtc_sync = mono;
+
+  int64_t edge_mono;
+  uint32_t edge_epoch;
+  if (!find_edge(1100, edge_mono, edge_epoch)) {
+    Serial.println("ERROR: RTC seconds do not advance, clock set to the second only");
+    return false;
+  }
+  correct((int64_t)edge_epoch * 1000000, edge_mono, TIME_SOURCE_RTC, false);
+  last_rtc_sync = edge_mono;
+  return true;
+}
+
+void time_service_loop() {
+  if (!time_rtc) return;
+
+  portENTER_CRITICAL(&time_spinlock);
+  bool ntp_update = ntp_pending;
+  int64_t ntp_time = ntp_epoch_us;
+  int64_t ntp_at = ntp_mono;
+  ntp_pending = false;
+  portEXIT_CRITICAL(&time_spinlock);
+  if (ntp_update) {
+    correct(local_from_utc(ntp_time), ntp_at, TIME_SOURCE_NTP, true);
+    status.ntp_syncs++;
+    last_ntp_sync = ntp_at;
+    ntp_valid = true;
+  }
+
+  int64_t now = esp_timer_get_time();
+  if (now - last_rtc_sync < (int64_t)TIME_RTC_RESYNC_MS * 1000) return;
+  last_rtc_sync = now;
+
+  int64_t edge_mono;
+  uint32_t edge_epoch;
+  if (!resync_edge(edge_mono, edge_epoch)) {
+    Serial.println("ERROR: RTC second edge not found, keeping the local clock");
+    return;
+  }
+
+  bool ntp_fresh = ntp_valid && edge_mono - last_ntp_sync < (int64_t)TIME_NTP_VALID_MS * 1000;
+  if (!ntp_fresh) {
+    correct((int64_t)edge_epoch * 1000000, edge_mono, TIME_SOURCE_RTC, true);
+    return;
+  }
+
+  // NTP is the reference: only check the RTC against it
+  portENTER_CRITICAL(&time_spinlock);
+  int64_t rtc_error = (int64_t)edge_epoch * 1000000 - extrapolate(edge_mono);
+  portEXIT_CRITICAL(&time_spinlock);
+  if (llabs(rtc_error) > (int64_t)TIME_RTC_ADJUST_MS * 1000) {
+    adjust_rtc();
+  }
+}
+
+// SNTP callback (lwIP task): time was just set to *tv
+static void ntp_synced(struct timeval *tv) {
+  int64_t mono = esp_timer_get_time();
+  portENTER_CRITICAL(&time_spinlock);
+  ntp_epoch_us = (int64_t)tv->tv_sec * 1000000 + tv->tv_usec;
+  ntp_mono = mono;
+  ntp_pending = true;
+  portEXIT_CRITICAL(&time_spinlock);
+}
+
+void time_service_start_ntp() {
+  if (ntp_started) return;
+  ntp_started = true;
+  sntp_set_time_sync_notification_cb(ntp_synced);
+  configTzTime(TIME_TZ, TIME_NTP_SERVER);
+}
+
+int64_t time_now_us() {
+  int64_t mono = esp_timer_get_time();
+  portENTER_CRITICAL(&time_spinlock);
+  int64_t now = extrapolate(mono);
+  portEXIT_CRITICAL(&time_spinlock);
+  return now;
+}
+
+int64_t time_at_us(uint32_t t_us) {
+  // micros() is the low 32 bits of esp_timer
+  int64_t mono = esp_timer_get_time();
+  mono += (int32_t)(t_us - (uint32_t)mono);
+  portENTER_CRITICAL(&time_spinlock);
+  int64_t at = extrapolate(mono);
+  portEXIT_CRITICAL(&time_spinlock);
+  return at;
+}
+
+DateTime time_now() {
+  return DateTime((uint32_t)(time_now_us() / 1000000));
+}
+
+TimeStatus time_status() {
+  portENTER_CRITICAL(&time_spinlock);
+  TimeStatus copy = status;
+  portEXIT_CRITICAL(&time_spinlock);
+  return copy;
+}
+
+size_t time_json(char *out, size_t size) {
+  static const char *const source_names[] = { "none", "rtc", "ntp" };
+  TimeStatus s = time_status();
+  int64_t now = time_now_us();
+  int len = snprintf(out, size,
+                     "{\"now\":%lu.%06lu,\"source\":\"%s\",\"drift_ppb\":%d,\"last_error_us\":%d,"
+                     "\"last_sync\":%u,\"resyncs\":%u,\"rtc_reads\":%u,\"rtc_adjusts\":%u,\"ntp_syncs\":%u}",
+                     (unsigned long)(now / 1000000), (unsigned long)(now % 1000000),
+                     source_names[s.source], s.drift_ppb, s.last_error_us, s.last_sync,
+                     s.resyncs, s.rtc_reads, s.rtc_adjusts, s.ntp_syncs);
+  return len < 0 ? 0 : min((size_t)len, size - 1);
+}
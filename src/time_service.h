@@ -0,0 +1,107 @@
+// time_service.h
+#ifndef TIME_SERVICE_H
+#define TIME_SERVICE_H
+
+#include <Arduino.h>
+#include <RTClib.h>
+
+/**
+ * Disciplined wall clock
+ *
+ * The DS3231 shares the I2C bus with the ADS1115, so it is not read per
+ * sample. Instead the RTC is read at boot and every TIME_RTC_RESYNC_MS, and
+ * wall time in between is extrapolated from the 64-bit esp_timer clock.
+ * Timestamps are microseconds and cost no bus traffic.
+ *
+ * The RTC only counts whole seconds, so a resync polls it around the
+ * second edge the clock expects. Reads are TIME_EDGE_POLL_MS apart, and the
+ * edge lies between the last old and the first new second. That gives the
+ * phase to about a millisecond in a few reads. The residual error at each
+ * resync measures how fast the local crystal runs against the RTC; the
+ * rate correction (drift_ppb) is folded into the extrapolation.
+ *
+ * Once WiFi is up, SNTP (TIME_NTP_SERVER) outranks the RTC for
+ * TIME_NTP_VALID_MS after each sync. Resyncs then check the RTC against
+ * the clock, and set it on a second boundary if it is off by more than
+ * TIME_RTC_ADJUST_MS.
+ *
+ * The clock counts the RTC's wall time, which is local time: daily files
+ * and rollups start at local midnight. SNTP delivers UTC, which is shifted
+ * into the TIME_TZ zone (a POSIX TZ string, including the DST rules) before
+ * it is used, so the RTC stays in that zone when NTP sets it. Set TIME_TZ
+ * to "UTC0" to keep the RTC and the logs in UTC.
+ *
+ * Only the network task calls time_service_loop() and talks to the RTC
+ * after boot; the time functions may be called from any task.
+ */
+
+// ===== CONFIGURATION =====
+#ifndef TIME_RTC_RESYNC_MS
+#define TIME_RTC_RESYNC_MS 600000     // RTC reads once the clock is set
+#endif
+#define TIME_EDGE_POLL_MS 2           // Spacing of RTC reads around an expected second edge
+#define TIME_EDGE_WINDOW_MS 40        // Polling time around the expected edge before a full search
+#define TIME_MAX_DRIFT_PPB 200000     // Largest accepted rate correction (200 ppm)
+#define TIME_DRIFT_MIN_SPAN_MS 60000  // Shortest time between syncs that updates the rate
+#define TIME_NTP_SERVER "pool.ntp.org"
+#ifndef TIME_TZ
+#define TIME_TZ "CET-1CEST,M3.5.0,M10.5.0/3"  // Zone of the RTC and the logs (Central Europe)
+#endif
+#define TIME_NTP_VALID_MS 7200000     // NTP outranks the RTC this long after a sync
+#define TIME_RTC_ADJUST_MS 500        // Set the RTC from NTP when it is off by more
+
+enum TimeSource : uint8_t {
+  TIME_SOURCE_NONE,   // RTC not read yet
+  TIME_SOURCE_RTC,
+  TIME_SOURCE_NTP
+};
+
+struct TimeStatus {
+  TimeSource source;        // Reference of the last correction
+  int32_t drift_ppb;        // Rate correction of the local clock
+  int32_t last_error_us;    // Offset corrected at the last resync
+  uint32_t last_sync;       // Unix time of the last resync
+  uint32_t resyncs;         // Corrections from RTC or NTP
+  uint32_t rtc_reads;       // RTC transactions since boot
+  uint32_t rtc_adjusts;     // RTC set from NTP
+  uint32_t ntp_syncs;
+};
+
+/**
+ * Set the clock from the RTC. Polls it for up to ~1 s to find a second
+ * edge, so call it before the sampler starts using the bus.
+ * @param rtc Initialized DS3231
+ * @return false if no second edge was seen (the clock still holds the RTC time)
+ */
+bool time_service_begin(RTC_DS3231 *rtc);
+
+/**
+ * Apply NTP updates and resync with the RTC when due (network task).
+ * A resync waits for the RTC's next second edge, up to ~1 s.
+ */
+void time_service_loop();
+
+// Start SNTP (network task, once WiFi is connected; later calls do nothing)
+void time_service_start_ntp();
+
+// Current Unix time in microseconds
+int64_t time_now_us();
+
+/**
+ * Unix time in microseconds of a recent micros() value, e.g. a sample's
+ * t_us (within ~35 minutes, before micros() wraps)
+ */
+int64_t time_at_us(uint32_t t_us);
+
+// Current time in whole seconds
+DateTime time_now();
+
+TimeStatus time_status();
+
+/**
+ * Format the status as JSON
+ * @return Length written
+ */
+size_t time_json(char *out, size_t size);
+
+#endif
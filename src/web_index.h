@@ -0,0 +1,171 @@
+// web_index.h
+// Generated by web/build_web.py from web/index.html - do not edit
+#ifndef WEB_INDEX_H
+#define WEB_INDEX_H
+
+#include <Arduino.h>
+
+#define INDEX_HTML_ETAG "\"5b7edd1bfdede806\""
+
+const size_t index_html_gz_len = 2499;
+const uint8_t index_html_gz[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x8d, 0x59, 0x7b, 0x6f, 0xdb, 0x38,
+  0x12, 0xff, 0xdf, 0x9f, 0x82, 0xd5, 0xe2, 0xce, 0x16, 0x62, 0xcb, 0xcf, 0x3c, 0xd6, 0xaf, 0x22,
+  0x4d, 0xd2, 0x45, 0x70, 0xdb, 0x6d, 0x90, 0xb6, 0x07, 0xdc, 0x15, 0xc5, 0x81, 0x96, 0x28, 0x8b,
+  0x8d, 0x2c, 0x0a, 0x14, 0x15, 0xc7, 0xeb, 0xe6, 0xbb, 0xdf, 0x0c, 0x49, 0xc9, 0x92, 0xed, 0xa4,
+  0x45, 0xd1, 0x4a, 0x22, 0xe7, 0x3d, 0xbf, 0x19, 0x0e, 0xdd, 0xe9, 0x9b, 0xeb, 0x8f, 0x57, 0x9f,
+  0xff, 0x73, 0x77, 0x43, 0x22, 0xb5, 0x8a, 0xe7, 0x8d, 0x69, 0xf1, 0x60, 0x34, 0x80, 0xc7, 0x8a,
+  0x29, 0x4a, 0xfc, 0x88, 0xca, 0x8c, 0xa9, 0x99, 0x93, 0xab, 0xb0, 0x73, 0xe1, 0x14, 0xcb, 0x09,
+  0x5d, 0xb1, 0x99, 0xf3, 0xc8, 0xd9, 0x3a, 0x15, 0x52, 0x39, 0xc4, 0x17, 0x89, 0x62, 0x09, 0x90,
+  0xad, 0x79, 0xa0, 0xa2, 0x59, 0xc0, 0x1e, 0xb9, 0xcf, 0x3a, 0xfa, 0xa3, 0x4d, 0x78, 0xc2, 0x15,
+  0xa7, 0x71, 0x27, 0xf3, 0x69, 0xcc, 0x66, 0x7d, 0x14, 0xa2, 0xb8, 0x8a, 0xd9, 0xfc, 0x1d, 0x55,
+  0x8a, 0xc9, 0x0d, 0xf9, 0x20, 0x80, 0x42, 0x48, 0x72, 0x4d, 0x41, 0xf4, 0x7b, 0x1e, 0xb3, 0x6c,
+  0xda, 0x35, 0x14, 0x8d, 0x69, 0xa6, 0x36, 0xf8, 0x5c, 0x88, 0x60, 0xb3, 0x0d, 0x41, 0x4b, 0x27,
+  0xa4, 0x2b, 0x1e, 0x6f, 0xc6, 0x97, 0x12, 0x44, 0xb6, 0x33, 0x9a, 0x64, 0x9d, 0x8c, 0x49, 0x1e,
+  0x4e, 0x56, 0x54, 0x2e, 0x79, 0x32, 0x1e, 0xf4, 0xd2, 0xa7, 0xc9, 0x82, 0xfa, 0x0f, 0x4b, 0x29,
+  0xf2, 0x24, 0xe8, 0xf8, 0x22, 0x16, 0x72, 0xfc, 0x5b, 0x78, 0x8a, 0x7f, 0x26, 0xcf, 0x8d, 0xa8,
+  0xdf, 0x8e, 0x06, 0x5b, 0xbb, 0x3a, 0x1c, 0x0e, 0x27, 0x8a, 0x3d, 0xa9, 0x0e, 0x8d, 0xf9, 0x32,
+  0x19, 0xfb, 0xe0, 0x02, 0x93, 0x40, 0x94, 0xc7, 0xdb, 0x98, 0x67, 0xaa, 0xa3, 0x95, 0x77, 0xd4,
+  0x26, 0x65, 0xe3, 0x44, 0x24, 0x6c, 0x92, 0xd2, 0x20, 0xe0, 0xc9, 0x72, 0xdc, 0x03, 0x6d, 0x4f,
+  0xc6, 0xbd, 0xf1, 0x45, 0x0f, 0x35, 0x5a, 0xed, 0x3d, 0x42, 0x73, 0x25, 0x40, 0x42, 0xcc, 0xb7,
+  0x76, 0xa9, 0x0f, 0xdb, 0xa4, 0x57, 0xb2, 0xf6, 0x4f, 0xd1, 0x3e, 0x21, 0x03, 0x26, 0x3b, 0x92,
+  0x06, 0x3c, 0xcf, 0xc6, 0x17, 0xc7, 0x2d, 0x0e, 0x43, 0xa0, 0x7b, 0xea, 0x64, 0x11, 0x0d, 0xc4,
+  0x1a, 0x24, 0x0f, 0x40, 0xce, 0x08, 0xfe, 0xca, 0xe5, 0x82, 0xb6, 0x7a, 0x6d, 0xfd, 0xc7, 0xeb,
+  0xbb, 0x93, 0x80, 0x67, 0x69, 0x4c, 0x37, 0xe3, 0x30, 0x66, 0x4f, 0x93, 0xef, 0x79, 0xa6, 0x78,
+  0xb8, 0xe9, 0xd8, 0x84, 0x8c, 0xb3, 0x94, 0x42, 0x22, 0x16, 0x4c, 0xad, 0x19, 0x4b, 0x26, 0xda,
+  0xcd, 0x0e, 0x57, 0x6c, 0x95, 0xed, 0x9c, 0xa5, 0x5b, 0x1d, 0x82, 0x80, 0xf9, 0x42, 0x52, 0xc5,
+  0x45, 0x62, 0x7c, 0xb5, 0x66, 0xf4, 0x7a, 0x67, 0x67, 0xbe, 0x5f, 0x2a, 0x59, 0xc4, 0xc2, 0x7f,
+  0x40, 0xa6, 0x71, 0x24, 0x1e, 0x99, 0x3c, 0x60, 0x05, 0x07, 0x98, 0x8c, 0x39, 0xf0, 0x3f, 0x37,
+  0xbc, 0x10, 0x52, 0xd9, 0xa1, 0x3e, 0x6e, 0x64, 0xdb, 0x9a, 0x99, 0x4b, 0x9a, 0xea, 0xc0, 0x20,
+  0xd5, 0x42, 0x25, 0x5b, 0x13, 0x10, 0xa3, 0xb8, 0x1e, 0x1c, 0xf0, 0xb8, 0x8c, 0xdd, 0x19, 0x78,
+  0xdf, 0x87, 0x30, 0x4c, 0xfc, 0x5c, 0x66, 0x60, 0x5c, 0x2a, 0xb8, 0xf6, 0x41, 0xe3, 0x62, 0xcd,
+  0xf8, 0x32, 0x52, 0xe3, 0x85, 0x88, 0x83, 0x23, 0x39, 0x3d, 0xea, 0xa2, 0x51, 0xde, 0x41, 0x18,
+  0x6f, 0x0f, 0x13, 0x30, 0xb8, 0xa0, 0xe7, 0xa3, 0x53, 0x1b, 0x87, 0x75, 0x04, 0x51, 0x2b, 0x18,
+  0x02, 0x16, 0x33, 0xc5, 0x8e, 0xb0, 0x04, 0xfe, 0xf0, 0xf4, 0x38, 0x4b, 0x9e, 0x06, 0xf4, 0x28,
+  0x4b, 0xaf, 0x77, 0xbe, 0x80, 0x4c, 0x57, 0x59, 0xea, 0x58, 0xaa, 0x47, 0xde, 0x60, 0x6e, 0xd0,
+  0xdb, 0xc5, 0xae, 0xb3, 0x12, 0xf2, 0x98, 0xe0, 0x33, 0xff, 0xfc, 0xf4, 0x3c, 0x38, 0x26, 0x18,
+  0x21, 0xf8, 0x6b, 0xb2, 0x6d, 0x92, 0x05, 0x80, 0x88, 0xab, 0xcd, 0xb8, 0xe7, 0xfd, 0x8e, 0x1b,
+  0xd8, 0x1f, 0x60, 0xf5, 0x50, 0xe5, 0x70, 0x34, 0xa4, 0xa3, 0x5e, 0x4d, 0x65, 0x91, 0x3a, 0x53,
+  0x96, 0x07, 0xb0, 0x37, 0x16, 0x75, 0x16, 0x42, 0x29, 0xb1, 0x32, 0x44, 0x50, 0xa2, 0xb2, 0xc0,
+  0x43, 0x6f, 0x12, 0x99, 0xac, 0xf6, 0x8f, 0x96, 0x48, 0x10, 0x04, 0xd5, 0xb2, 0x87, 0x2a, 0x43,
+  0xd0, 0x09, 0xa1, 0x0a, 0x60, 0xd6, 0x20, 0x50, 0x56, 0x20, 0x6a, 0x29, 0x82, 0x74, 0x76, 0x66,
+  0xd0, 0x93, 0xf1, 0xbf, 0x19, 0xfa, 0xc7, 0x56, 0x28, 0x23, 0xa5, 0x2a, 0xea, 0x24, 0xf4, 0xf1,
+  0x88, 0x8f, 0xec, 0x77, 0xe6, 0xb3, 0xb0, 0x2e, 0xac, 0xee, 0xd7, 0xd9, 0x81, 0x5f, 0xba, 0xe6,
+  0x8f, 0xf5, 0x19, 0x0f, 0xd5, 0x6e, 0x5f, 0xb7, 0x25, 0x11, 0x0a, 0x7a, 0xe9, 0x2b, 0xfe, 0xbc,
+  0x1a, 0x5a, 0x8b, 0x22, 0x32, 0x30, 0x4d, 0xaa, 0xde, 0xb4, 0x4a, 0xe9, 0x1d, 0xf1, 0x70, 0x0c,
+  0xcd, 0x23, 0x16, 0x04, 0xb4, 0x08, 0x55, 0xff, 0xf4, 0xf4, 0x7c, 0x30, 0xaa, 0xf0, 0xac, 0xa9,
+  0x4c, 0xb6, 0x47, 0xfb, 0xd6, 0xd0, 0x2f, 0x70, 0xf7, 0xdb, 0xc5, 0xe9, 0xd9, 0xa8, 0x57, 0xe5,
+  0x62, 0x52, 0x8a, 0x63, 0xd8, 0x09, 0x2f, 0x82, 0xf3, 0x9d, 0xb2, 0xf3, 0x41, 0xdf, 0x37, 0xca,
+  0xa0, 0x91, 0x85, 0x5c, 0xae, 0x00, 0xe5, 0x01, 0x8d, 0xcb, 0x26, 0x62, 0xba, 0xb1, 0xc8, 0xb8,
+  0x2e, 0xe6, 0x90, 0x3f, 0x31, 0x28, 0x7a, 0x91, 0x02, 0x60, 0x62, 0x16, 0x2a, 0x78, 0x18, 0x37,
+  0xfb, 0xbd, 0xde, 0x3f, 0x4a, 0x08, 0xe1, 0xfb, 0x81, 0xde, 0x5a, 0x33, 0x3d, 0x75, 0x8f, 0x75,
+  0xc8, 0xfd, 0x96, 0xba, 0xcb, 0x9e, 0xb6, 0xa9, 0x58, 0x3f, 0xf4, 0xe9, 0x17, 0x2b, 0xa0, 0xc8,
+  0xc9, 0x48, 0xe7, 0xe4, 0x28, 0x4c, 0x8c, 0xa2, 0x45, 0x0e, 0x68, 0xda, 0xef, 0xa4, 0x2f, 0x58,
+  0x57, 0x36, 0x58, 0x8b, 0x44, 0x0c, 0x8e, 0x2d, 0xaf, 0x69, 0xd7, 0x9e, 0xa9, 0xd3, 0xae, 0x3d,
+  0xe9, 0xf1, 0x70, 0x85, 0x47, 0xc0, 0x1f, 0x89, 0x1f, 0xd3, 0x2c, 0x9b, 0x39, 0xa6, 0xc4, 0xf1,
+  0xa4, 0x8e, 0xfa, 0xbb, 0x63, 0x9a, 0x26, 0x74, 0xc9, 0x56, 0xa0, 0x80, 0x7c, 0xda, 0x64, 0x10,
+  0x22, 0x10, 0xd0, 0x07, 0x92, 0x74, 0x5e, 0x1e, 0xdc, 0xe4, 0x9d, 0x14, 0x6b, 0x38, 0x8f, 0xa7,
+  0xdd, 0x14, 0xe5, 0x83, 0xc4, 0x79, 0xc3, 0x08, 0xe6, 0xc1, 0xcc, 0x31, 0x10, 0x70, 0xe6, 0xb5,
+  0x0d, 0xab, 0xb1, 0x28, 0x39, 0xd4, 0x49, 0x49, 0x24, 0x59, 0x38, 0x73, 0xba, 0x6f, 0x03, 0x2e,
+  0x67, 0x5d, 0x87, 0x68, 0x83, 0x67, 0x4e, 0xe1, 0x38, 0x4f, 0xf0, 0x84, 0x71, 0xe6, 0x5f, 0xef,
+  0xa1, 0xd6, 0xc9, 0x35, 0x97, 0xcc, 0x87, 0xf1, 0x61, 0xf3, 0x6d, 0xda, 0xa5, 0x73, 0xf2, 0x83,
+  0x5c, 0xe5, 0x52, 0xa2, 0x91, 0x77, 0x20, 0x72, 0x4c, 0xa6, 0x70, 0x04, 0x26, 0x5a, 0x3d, 0xaa,
+  0x40, 0xe5, 0xb8, 0x50, 0xb1, 0x2e, 0x1a, 0xcc, 0xed, 0xcc, 0x01, 0x6f, 0x3b, 0x63, 0xb3, 0x7c,
+  0x05, 0xb1, 0xdb, 0x94, 0xca, 0x0f, 0x13, 0x73, 0xa4, 0xc8, 0x4b, 0xdf, 0xa6, 0x79, 0xac, 0xa5,
+  0xe0, 0x11, 0x98, 0xe1, 0x6a, 0x8e, 0x93, 0x95, 0xc9, 0xa0, 0xde, 0xc0, 0xae, 0xed, 0x14, 0xce,
+  0x43, 0xab, 0x25, 0x45, 0x2b, 0x3f, 0xf0, 0x16, 0xb1, 0xee, 0x10, 0x91, 0xf8, 0x31, 0xf7, 0x1f,
+  0x66, 0x4e, 0x2c, 0x68, 0x70, 0x07, 0x79, 0x68, 0xb9, 0xce, 0xfc, 0x4f, 0x78, 0x27, 0xc8, 0x34,
+  0xed, 0x1a, 0xd1, 0xda, 0x1f, 0x59, 0xcf, 0xa5, 0x69, 0x88, 0xb5, 0xb8, 0x9a, 0xd3, 0xe8, 0x40,
+  0xbd, 0x5d, 0x9e, 0x7f, 0xfc, 0x7c, 0x49, 0xbe, 0xe8, 0x77, 0x8c, 0x28, 0x26, 0xf8, 0xe6, 0xd3,
+  0xdd, 0x70, 0x40, 0x5e, 0x04, 0x02, 0x04, 0x7d, 0x17, 0xe6, 0x48, 0x64, 0xaa, 0x0c, 0xf3, 0x71,
+  0x20, 0x98, 0x03, 0xd4, 0xd4, 0x74, 0x69, 0x45, 0xad, 0xd2, 0x9d, 0xba, 0x0f, 0xb5, 0x4a, 0xd3,
+  0xb0, 0x1c, 0xce, 0xaf, 0x0c, 0x3d, 0xb9, 0xd6, 0xc2, 0x20, 0x7b, 0x43, 0x6d, 0xea, 0xa5, 0x64,
+  0x64, 0x23, 0x72, 0x92, 0xe5, 0xf6, 0x65, 0x4d, 0xc1, 0x4e, 0x68, 0x81, 0x46, 0x29, 0x51, 0x11,
+  0x23, 0x98, 0x95, 0xb1, 0x31, 0x2d, 0x9d, 0xc3, 0x88, 0x29, 0x45, 0xb2, 0x2c, 0xd3, 0x05, 0xb5,
+  0x62, 0x4f, 0x78, 0xed, 0x85, 0xde, 0x9c, 0xbf, 0x2d, 0xa8, 0x3f, 0x47, 0x3c, 0x23, 0x66, 0xa6,
+  0x21, 0x3e, 0x4d, 0x00, 0xd2, 0x64, 0xc1, 0x08, 0x14, 0x3d, 0x64, 0xc9, 0x33, 0x44, 0x07, 0x76,
+  0xdb, 0xc2, 0x45, 0xbb, 0x43, 0x01, 0x16, 0x57, 0x42, 0x80, 0xdf, 0x0e, 0x81, 0x99, 0x3a, 0x12,
+  0x88, 0x50, 0x0c, 0x9d, 0x95, 0x0e, 0x69, 0x2a, 0xac, 0x68, 0x4c, 0x79, 0x92, 0xe6, 0xe0, 0x04,
+  0x0c, 0xa2, 0x10, 0x5f, 0x1e, 0x04, 0x2c, 0x71, 0x76, 0xf6, 0xea, 0x4d, 0xc7, 0xce, 0xe4, 0xb8,
+  0xe2, 0x90, 0x47, 0x1a, 0xe7, 0xf0, 0xe1, 0xec, 0x30, 0x67, 0x78, 0xb3, 0x7c, 0xb1, 0xe2, 0xea,
+  0x20, 0xf1, 0x85, 0xa2, 0x22, 0x94, 0x05, 0x98, 0xa6, 0x5d, 0xb4, 0x6f, 0x27, 0xa4, 0x04, 0xa1,
+  0x1f, 0x8b, 0x8c, 0x7d, 0x40, 0xe7, 0x00, 0x86, 0x15, 0x69, 0xce, 0xfc, 0x8a, 0x26, 0x3e, 0x8b,
+  0xab, 0x22, 0x4c, 0x3d, 0xd4, 0x1e, 0x30, 0xd6, 0xfb, 0x92, 0xa7, 0x6a, 0xde, 0x78, 0xa4, 0x92,
+  0xdc, 0x5d, 0xfe, 0x71, 0xf3, 0xbf, 0x4f, 0xb7, 0xff, 0xbd, 0x21, 0x33, 0x02, 0x5d, 0x7a, 0xa2,
+  0x17, 0x53, 0x2a, 0xe9, 0x2a, 0x83, 0x95, 0x84, 0xad, 0xc9, 0x97, 0xfb, 0x3f, 0x3f, 0x31, 0x2a,
+  0xfd, 0xe8, 0x4e, 0xaf, 0xb6, 0x60, 0x5c, 0xd1, 0x63, 0x9c, 0x97, 0xe9, 0x55, 0xd7, 0xb0, 0x40,
+  0xb3, 0x00, 0x7a, 0xc3, 0xe8, 0x2d, 0x99, 0x6a, 0x35, 0x61, 0xa5, 0xe9, 0x92, 0x1f, 0x3f, 0x48,
+  0xb3, 0xdb, 0x9c, 0x34, 0x78, 0x48, 0x5a, 0xb0, 0xe2, 0xe1, 0x9d, 0xe6, 0x52, 0xe9, 0xd7, 0x98,
+  0x25, 0x4b, 0x15, 0x91, 0x0e, 0xe9, 0xbb, 0xe4, 0xcd, 0x0c, 0xc9, 0x5c, 0x2d, 0xe6, 0x64, 0x66,
+  0x58, 0x50, 0xac, 0x08, 0x43, 0xb8, 0x01, 0x81, 0xe4, 0x5e, 0x5b, 0x03, 0x27, 0x33, 0xaf, 0x40,
+  0xa6, 0xdf, 0x26, 0x8d, 0x46, 0x98, 0x27, 0x06, 0x10, 0x18, 0x2d, 0xaa, 0x3e, 0xc1, 0xf9, 0xdd,
+  0x5a, 0x6c, 0x14, 0xcb, 0x5c, 0xb2, 0x6d, 0x10, 0x82, 0x7a, 0xf5, 0x27, 0x99, 0x82, 0x7f, 0x83,
+  0x91, 0x4b, 0x24, 0x53, 0xb9, 0x84, 0xd0, 0xeb, 0xc5, 0x13, 0xd2, 0x24, 0xef, 0x40, 0xd7, 0x3e,
+  0xe1, 0xe8, 0xe2, 0xf4, 0xfc, 0xac, 0xa4, 0xb5, 0x1b, 0x5d, 0x23, 0xc1, 0x53, 0xe2, 0x3d, 0x1e,
+  0x7a, 0x2d, 0xb0, 0x1b, 0xf9, 0xff, 0x75, 0x4c, 0xc0, 0xf9, 0xf0, 0x7c, 0xd4, 0xbf, 0xa8, 0xe8,
+  0xab, 0xc8, 0x30, 0xc2, 0xf7, 0xc5, 0x7c, 0x30, 0x62, 0x0e, 0xc9, 0x4b, 0x51, 0xfb, 0x1c, 0x7f,
+  0x20, 0xc7, 0x73, 0x25, 0x04, 0x2c, 0x6e, 0x29, 0xba, 0x6c, 0x03, 0x26, 0xb2, 0x36, 0xc1, 0x9e,
+  0x69, 0x62, 0x80, 0x81, 0x64, 0x10, 0xae, 0x40, 0xf8, 0x39, 0x36, 0x0e, 0xcf, 0x97, 0x0c, 0xfa,
+  0xcb, 0x4d, 0xac, 0xdb, 0x08, 0xb2, 0xb8, 0x85, 0x03, 0xc0, 0xe9, 0x12, 0xe6, 0x69, 0x50, 0xfd,
+  0x05, 0x98, 0x06, 0x2e, 0x58, 0x2a, 0x76, 0x8d, 0x48, 0xe6, 0xe1, 0xf3, 0xca, 0xf4, 0x03, 0x20,
+  0xc0, 0xaf, 0x8a, 0xe5, 0xac, 0x6e, 0x13, 0x9c, 0xc0, 0xf7, 0x62, 0xdd, 0x8a, 0xe9, 0x82, 0xc5,
+  0x6d, 0xdd, 0x03, 0xdb, 0xb6, 0xc8, 0xb2, 0x9d, 0x75, 0x31, 0x07, 0x39, 0x60, 0x7d, 0x33, 0xe6,
+  0x4d, 0xb7, 0x4d, 0x70, 0x8e, 0xb0, 0x0b, 0x00, 0x59, 0x5c, 0x91, 0x38, 0x46, 0x54, 0x96, 0xda,
+  0xa4, 0x59, 0xbd, 0xe0, 0x34, 0x4b, 0x07, 0x50, 0x81, 0x91, 0x6b, 0x24, 0x53, 0xcb, 0x44, 0x81,
+  0x84, 0x50, 0x0f, 0xb7, 0x61, 0x05, 0x1f, 0xf8, 0x49, 0xd3, 0x94, 0x25, 0xc1, 0x55, 0xc4, 0xe3,
+  0xa0, 0x85, 0x54, 0xa6, 0xe1, 0x80, 0xf4, 0x24, 0x8f, 0xc1, 0x5a, 0x6d, 0xb4, 0x0b, 0x8c, 0x68,
+  0x50, 0x8d, 0x98, 0x6a, 0x85, 0xcf, 0x20, 0x3a, 0x63, 0x56, 0xdb, 0x01, 0x8d, 0xe1, 0xd6, 0x74,
+  0xf0, 0xb7, 0x65, 0x4d, 0xc5, 0x8a, 0xf8, 0xfa, 0xcd, 0x85, 0x51, 0x59, 0xde, 0x50, 0x3f, 0x6a,
+  0x95, 0x81, 0x02, 0x99, 0x64, 0x6b, 0x1c, 0xdd, 0x57, 0x45, 0x9e, 0xb5, 0x98, 0x98, 0xd7, 0xe5,
+  0x83, 0x42, 0xb4, 0xad, 0xbe, 0xaa, 0x05, 0x68, 0xf2, 0x32, 0xdd, 0x50, 0x8e, 0x36, 0xd7, 0xef,
+  0x36, 0xb7, 0x41, 0x4b, 0x47, 0x0e, 0x42, 0x56, 0x17, 0xc6, 0xdd, 0x83, 0xbc, 0xdd, 0x24, 0x4a,
+  0x6e, 0x5a, 0x0c, 0xff, 0xdd, 0xa5, 0x0a, 0x0f, 0x72, 0xc4, 0x12, 0x16, 0x2a, 0xd1, 0x7b, 0x1e,
+  0x36, 0xbf, 0x22, 0xfe, 0x66, 0x05, 0x76, 0x8b, 0x24, 0x60, 0xa9, 0x9e, 0x9c, 0x4c, 0xf4, 0xbb,
+  0xc5, 0x42, 0xf3, 0xeb, 0xf5, 0xed, 0xfd, 0x37, 0x00, 0x70, 0x55, 0x00, 0x64, 0xd4, 0x8c, 0x1c,
+  0x66, 0xd9, 0x17, 0x01, 0xfb, 0x72, 0x7f, 0x7b, 0x25, 0x56, 0x29, 0x34, 0x77, 0x40, 0x29, 0xea,
+  0x75, 0x5d, 0x23, 0xc7, 0x20, 0xad, 0x88, 0xac, 0x76, 0xc7, 0xa8, 0xd0, 0x58, 0xc2, 0xb0, 0xd7,
+  0xa0, 0x62, 0x92, 0xb9, 0x53, 0xa5, 0x8b, 0xc7, 0x40, 0x46, 0x13, 0x1f, 0xc2, 0x00, 0x4e, 0x4f,
+  0x84, 0x18, 0x5e, 0x06, 0xf0, 0xd9, 0x42, 0x9b, 0x2a, 0xfd, 0xc5, 0x88, 0xc2, 0x5d, 0x5d, 0x88,
+  0x6e, 0xd3, 0x18, 0x86, 0xda, 0xf1, 0x3e, 0x5b, 0x42, 0x0e, 0x58, 0x8b, 0x2e, 0x8f, 0xeb, 0xf8,
+  0xfd, 0x6f, 0x7c, 0x1a, 0x6a, 0x78, 0x2b, 0xf0, 0xd8, 0xec, 0x06, 0x62, 0x9d, 0xe0, 0x74, 0xf1,
+  0x16, 0xbd, 0x79, 0x35, 0x06, 0x85, 0xa6, 0xa0, 0xf4, 0xb2, 0xa6, 0xc8, 0x1c, 0x27, 0xb8, 0x62,
+  0x0e, 0x14, 0xa3, 0x0c, 0x56, 0x4b, 0x5d, 0xdf, 0xe9, 0x23, 0x35, 0x47, 0xc0, 0xf8, 0x51, 0xf0,
+  0xa0, 0xd5, 0x73, 0x9b, 0x05, 0x89, 0x3d, 0x63, 0x80, 0x6a, 0x07, 0x4b, 0x44, 0xa5, 0x1d, 0x0f,
+  0x8c, 0x44, 0x6b, 0x06, 0x79, 0x46, 0xae, 0x7a, 0x79, 0x9b, 0x48, 0x7f, 0x45, 0xd7, 0xda, 0x28,
+  0xf0, 0xdb, 0x1e, 0xa8, 0xb2, 0x48, 0xac, 0xff, 0xd2, 0x83, 0xa8, 0xee, 0x25, 0x6d, 0xf2, 0xc0,
+  0x93, 0x60, 0x87, 0xad, 0xa4, 0x5e, 0xe1, 0x66, 0x64, 0x25, 0xf6, 0xf2, 0x82, 0x31, 0x41, 0x72,
+  0xdb, 0xd9, 0x5e, 0x45, 0xb8, 0x61, 0xd9, 0x83, 0x78, 0xb2, 0x67, 0xcc, 0x6e, 0x98, 0x2b, 0x0d,
+  0xc0, 0x71, 0xae, 0xda, 0x28, 0xf7, 0xe5, 0xe2, 0xbe, 0x09, 0x28, 0xbe, 0x79, 0x7a, 0x58, 0xf4,
+  0xec, 0xac, 0x88, 0xa1, 0xc5, 0x71, 0x51, 0x07, 0x33, 0x64, 0x0a, 0x6a, 0xbb, 0xd9, 0xa5, 0x29,
+  0xef, 0x6a, 0x7c, 0xbe, 0x06, 0x6d, 0x5d, 0x2d, 0x80, 0xa3, 0x7f, 0x9a, 0xd3, 0x4e, 0x93, 0xd9,
+  0x83, 0x0f, 0x57, 0x63, 0x0e, 0x63, 0x83, 0x5e, 0x2c, 0x0f, 0x6b, 0x57, 0x97, 0x81, 0x07, 0xe3,
+  0x54, 0x52, 0x69, 0x20, 0x58, 0x73, 0xba, 0x08, 0xdf, 0x48, 0x4f, 0x3c, 0xb8, 0x30, 0x6d, 0xc1,
+  0x85, 0x40, 0x9f, 0xe1, 0x37, 0x78, 0xf1, 0x6b, 0x35, 0xdf, 0x53, 0x30, 0x25, 0xc0, 0x79, 0x4c,
+  0x40, 0x58, 0xb0, 0x34, 0xcd, 0xf0, 0x8e, 0xbd, 0xd1, 0x76, 0x6f, 0xe9, 0x7d, 0xcf, 0x44, 0xd2,
+  0xd2, 0x3d, 0xe7, 0xa8, 0x12, 0xfc, 0x6d, 0xae, 0xa8, 0x6d, 0x6c, 0x49, 0x99, 0xf2, 0xb0, 0x1c,
+  0x38, 0xcb, 0xca, 0x96, 0x56, 0xb4, 0x0e, 0x5b, 0xad, 0xa4, 0x74, 0x66, 0x56, 0xa7, 0x37, 0x03,
+  0x40, 0x41, 0xf4, 0x62, 0xd0, 0xed, 0x65, 0x00, 0xb2, 0x59, 0x3b, 0x77, 0x2c, 0x9b, 0xe9, 0x30,
+  0x10, 0x9c, 0x96, 0x19, 0x0a, 0x60, 0x8c, 0x21, 0x6f, 0xa1, 0xbe, 0x4b, 0xe7, 0x00, 0x48, 0x64,
+  0x5c, 0x59, 0x00, 0xcd, 0xb0, 0x84, 0x01, 0x37, 0x03, 0x05, 0x70, 0xda, 0xc9, 0xa2, 0x60, 0xc5,
+  0x4f, 0xc3, 0x63, 0x3b, 0x25, 0x39, 0x29, 0x95, 0x69, 0xff, 0x3d, 0x8d, 0x13, 0x24, 0x45, 0x40,
+  0x27, 0x9a, 0xb6, 0x59, 0x7a, 0x8b, 0x19, 0x28, 0xa9, 0xdc, 0x17, 0x90, 0xa2, 0x7f, 0xf5, 0x69,
+  0x16, 0x2c, 0xfa, 0x18, 0x41, 0xbe, 0x62, 0xde, 0x81, 0xd9, 0xc6, 0xad, 0x56, 0x4b, 0xb3, 0xbc,
+  0x68, 0x11, 0x18, 0x81, 0xd9, 0x2a, 0x55, 0x1b, 0xac, 0x10, 0xfc, 0x19, 0xa0, 0x50, 0x5c, 0xe4,
+  0x0b, 0xa6, 0xb3, 0xda, 0xb1, 0xc2, 0x10, 0x15, 0x15, 0x51, 0xcc, 0x5b, 0xb1, 0x2c, 0x03, 0xdc,
+  0x03, 0xbf, 0xfe, 0x41, 0xa0, 0x69, 0x0f, 0x98, 0x6a, 0x6d, 0xd4, 0x0b, 0x1e, 0xc3, 0x80, 0x8d,
+  0xd3, 0xe4, 0xfd, 0xd5, 0x73, 0x65, 0x37, 0xc0, 0xef, 0xe7, 0x8b, 0x14, 0x52, 0x7e, 0x7a, 0x36,
+  0x99, 0xa1, 0x1a, 0xf8, 0xf5, 0x24, 0xfd, 0xab, 0x9c, 0xd5, 0x7b, 0x0d, 0xf0, 0x1e, 0x44, 0x1c,
+  0x6f, 0xec, 0x7b, 0xf3, 0x52, 0x75, 0x92, 0x7e, 0xdd, 0xb5, 0x9f, 0x09, 0xb7, 0x85, 0x0f, 0xc2,
+  0x5f, 0x14, 0x81, 0x5d, 0xf3, 0x20, 0x26, 0x00, 0xca, 0xc9, 0xcb, 0x2c, 0x78, 0x9b, 0x3b, 0x60,
+  0x69, 0xde, 0xde, 0x8d, 0xf5, 0xd9, 0x59, 0x0e, 0xe2, 0x48, 0x66, 0xc2, 0x83, 0x10, 0xaa, 0xce,
+  0xe0, 0xab, 0x6c, 0x09, 0x67, 0x53, 0x35, 0xfb, 0x07, 0xbb, 0x80, 0x02, 0xf1, 0x80, 0x18, 0xda,
+  0xe7, 0xb5, 0xd8, 0x78, 0x91, 0xdb, 0xee, 0x57, 0x50, 0x54, 0x0c, 0xf9, 0xe5, 0x34, 0xbf, 0x9b,
+  0x19, 0x64, 0xe9, 0xae, 0x97, 0xc5, 0x28, 0x09, 0x86, 0xf8, 0x4e, 0x5f, 0x23, 0xb7, 0xdc, 0x34,
+  0x2f, 0xbb, 0x7d, 0xfb, 0x0d, 0xa3, 0xa8, 0xba, 0x4d, 0x02, 0xf6, 0xf4, 0x31, 0x6c, 0x69, 0xa9,
+  0x27, 0x78, 0x61, 0x28, 0xee, 0x15, 0x95, 0xa1, 0xe2, 0xce, 0x08, 0xda, 0xfd, 0x24, 0xd1, 0xfc,
+  0xf9, 0x4c, 0x81, 0x1c, 0xae, 0xc6, 0xfe, 0xee, 0x34, 0x98, 0xe0, 0xaf, 0x34, 0xf6, 0x8a, 0x04,
+  0x77, 0x29, 0xf3, 0xfb, 0x4c, 0xd7, 0xfc, 0xff, 0xcc, 0xff, 0x01, 0x5f, 0xa1, 0xb4, 0x3b, 0xb7,
+  0x19, 0x00, 0x00,
+};
+
+#endif
@@ -0,0 +1,279 @@
+"""
+Reader and converter for the binary "Raw YYYY-MM-DD.bin" logs written by the
+firmware when LOG_BINARY is enabled (see src/binlog.h for the layout).
+
+Usage:
+    python visualization/BinLog.py "Raw 2025-03-07.bin"              # write Amps/Volts .txt next to it
+    python visualization/BinLog.py "Raw 2025-03-07.bin" --csv out.csv # write a CSV instead
+"""
+import sys
+import os
+import mmap
+import struct
+import zlib
+import datetime
+import numpy as np
+
+
+MAGIC = b'BMSL'
+MAX_CHANNELS = 4
+HEADER = struct.Struct('<4sHHIIBBH%df%df%dB' % (MAX_CHANNELS, MAX_CHANNELS, MAX_CHANNELS))
+BLOCK_HEADER = struct.Struct('<HHII')
+BLOCK_MAGIC = 0xB10C
+PACKED_BLOCK_HEADER = struct.Struct('<HHIHI')
+PACKED_BLOCK_MAGIC = 0xB10D
+
+# Channel order used by the firmware (SampleChannel in src/sampler.h)
+CHANNEL_NAMES = ['Amps', 'Volts']
+
+# ADS1115 LSB size in nV per PGA setting (RawSample::gain: 0 = 2/3x ... 5 = 16x)
+ADS_LSB_NV = np.array([187500.0, 125000.0, 62500.0, 31250.0, 15625.0, 7812.5])
+
+
+def record_size(version, channels):
+    """Bytes per record of versions 1 and 2: int16 codes, plus packed 4-bit gains in version 2."""
+    return 2 * channels + ((channels + 1) // 2 if version >= 2 else 0)
+
+
+def read_header(buf):
+    """
+    Parses the file header.
+    Returns a dict with the header fields; raises ValueError on a foreign file.
+    """
+    if len(buf) < HEADER.size:
+        raise ValueError("File too short for a binary log header")
+
+    fields = HEADER.unpack_from(buf, 0)
+    magic, version, header_size, start_epoch, interval_ms, channels, frac_bits, block_records = fields[:8]
+    if magic != MAGIC:
+        raise ValueError(f"Not a binary log (magic {magic!r})")
+
+    scale = np.array(fields[8:8 + MAX_CHANNELS][:channels], dtype=np.float64)
+    offset = np.array(fields[8 + MAX_CHANNELS:8 + 2 * MAX_CHANNELS][:channels], dtype=np.float64)
+    gain = np.array(fields[8 + 2 * MAX_CHANNELS:8 + 3 * MAX_CHANNELS][:channels], dtype=np.uint8)
+    return {
+        'version': version,
+        'header_size': header_size,
+        'start_epoch': start_epoch,
+        'interval_ms': interval_ms,
+        'channels': channels,
+        'frac_bits': frac_bits,
+        'block_records': block_records,
+        'scale': scale / (1 << frac_bits),
+        'offset': offset,
+        'gain': gain,
+    }
+
+
+def unpack_block(payload, count, channels):
+    """
+    Decodes the payload of a packed (version 3) block.
+    Returns (codes, gains) arrays of shape (count, channels); raises
+    ValueError if the payload does not hold exactly count records.
+    """
+    gain_bytes = (channels + 1) // 2
+    lead = np.frombuffer(payload, dtype=np.uint8, count=gain_bytes + 1)
+    first_gains = np.stack((lead[:gain_bytes] & 0x0F, lead[:gain_bytes] >> 4), axis=-1).reshape(-1)[:channels]
+    change_count = int(lead[gain_bytes])
+    changes = np.frombuffer(payload, dtype=np.uint8, count=2 * change_count,
+                            offset=gain_bytes + 1).reshape(-1, 2)
+
+    # Varints of 3-bit groups, low nibble of each byte first; 0x8 = more follows
+    data = np.frombuffer(payload, dtype=np.uint8, offset=gain_bytes + 1 + 2 * change_count)
+    nibbles = np.empty(2 * len(data), dtype=np.int64)
+    nibbles[0::2] = data & 0x0F
+    nibbles[1::2] = data >> 4
+    values = count * channels
+    ends = np.flatnonzero((nibbles & 0x08) == 0)
+    if len(ends) < values or len(nibbles) - (ends[values - 1] + 1) > 1:
+        raise ValueError("Packed block does not match its record count")
+    ends = ends[:values]
+    starts = np.concatenate(([0], ends[:-1] + 1))
+    token = np.repeat(np.arange(values), ends - starts + 1)
+    shift = 3 * (np.arange(len(token)) - starts[token])
+    zigzag = np.bincount(token, weights=(nibbles[:len(token)] & 0x07) << shift,
+                         minlength=values).astype(np.int64)
+
+    deltas = (zigzag >> 1) ^ -(zigzag & 1)
+    codes = np.cumsum(deltas.reshape(count, channels), axis=0).astype(np.int16)
+
+    gains = np.tile(first_gains, (count, 1))
+    for record, change in changes:
+        if (change >> 4) < channels:
+            gains[record:, change >> 4] = change & 0x0F
+    return codes, gains
+
+
+def read_binlog(file_path, verify_crc=True):
+    """
+    Loads a whole binary log into numpy arrays.
+
+    Returns a dict with:
+    - header: parsed file header
+    - epoch:  float64 array of unix times, one per record
+    - codes:  int16 array of shape (records, channels) with raw ADC codes
+    - gains:  uint8 array of shape (records, channels) with the PGA gain of each
+              code (version 1 files: the header gain)
+    - values: float64 array of shape (records, channels) in physical units
+    - bad_blocks: number of blocks skipped because of a CRC mismatch
+
+    The file is memory-mapped, so only the pages of the blocks are read.
+    Packed (version 3) blocks are decoded one block at a time.
+    """
+    with open(file_path, 'rb') as file:
+        if os.fstat(file.fileno()).st_size < HEADER.size:
+            raise ValueError("File too short for a binary log header")
+        buf = mmap.mmap(file.fileno(), 0, access=mmap.ACCESS_READ)
+
+    header = read_header(buf)
+    channels = header['channels']
+    version = header['version']
+    packed = version >= 3
+    block_header = PACKED_BLOCK_HEADER if packed else BLOCK_HEADER
+    block_magic = PACKED_BLOCK_MAGIC if packed else BLOCK_MAGIC
+    crc_bytes = 10 if packed else 8
+    size = record_size(version, channels)
+    packed_gains = (channels + 1) // 2 if version == 2 else 0
+    record = np.dtype([('code', '<i2', (channels,)), ('gain', 'u1', (packed_gains,))])
+    interval_s = header['interval_ms'] / 1000.0
+
+    code_chunks = []
+    gain_chunks = []
+    epoch_chunks = []
+    bad_blocks = 0
+    pos = header['header_size']
+
+    # Walk the block headers; fixed-size records are sliced straight out of the buffer
+    while pos + block_header.size <= len(buf):
+        fields = block_header.unpack_from(buf, pos)
+        magic, count, epoch = fields[:3]
+        crc = fields[-1]
+        if magic != block_magic:
+            print(f"Warning: Lost block sync at offset {pos}, stopping")
+            break
+
+        data_start = pos + block_header.size
+        data_end = data_start + (fields[3] if packed else count * size)
+        if data_end > len(buf):
+            print(f"Warning: Truncated block at offset {pos}")
+            break
+
+        if verify_crc:
+            actual = zlib.crc32(buf[data_start:data_end], zlib.crc32(buf[pos:pos + crc_bytes]))
+            if actual != crc:
+                bad_blocks += 1
+                pos = data_end
+                continue
+
+        if packed:
+            try:
+                codes, gains = unpack_block(buf[data_start:data_end], count, channels)
+            except ValueError:
+                bad_blocks += 1
+                pos = data_end
+                continue
+        else:
+            records = np.frombuffer(buf, dtype=record, count=count, offset=data_start)
+            codes = records['code'].reshape(-1, channels)
+            if version >= 2:
+                # Two channels per byte, low nibble first
+                packed_bytes = records['gain'].reshape(-1, packed_gains)
+                nibbles = np.stack((packed_bytes & 0x0F, packed_bytes >> 4), axis=-1)
+                gains = nibbles.reshape(count, 2 * packed_gains)[:, :channels]
+            else:
+                gains = np.broadcast_to(header['gain'], codes.shape)
+
+        code_chunks.append(codes)
+        gain_chunks.append(gains)
+        epoch_chunks.append(epoch + np.arange(count) * interval_s)
+        pos = data_end
+
+    codes = np.concatenate(code_chunks) if code_chunks else np.zeros((0, channels), dtype=np.int16)
+    gains = np.concatenate(gain_chunks) if gain_chunks else np.zeros((0, channels), dtype=np.uint8)
+    epochs = np.concatenate(epoch_chunks) if epoch_chunks else np.zeros(0)
+
+    range_factor = ADS_LSB_NV[gains] / ADS_LSB_NV[header['gain']]
+    values = codes * range_factor * header['scale'] + header['offset']
+    return {
+        'header': header,
+        'epoch': epochs,
+        'codes': codes,
+        'gains': gains,
+        'values': values,
+        'bad_blocks': bad_blocks,
+    }
+
+
+def write_text_logs(log, out_dir):
+    """
+    Writes the records in the firmware's text format ("HH:MM:SS --> v, v, ...",
+    60 values per line) as "Amps YYYY-MM-DD.txt" / "Volts YYYY-MM-DD.txt",
+    so PlotData.py can plot converted files. Lines are broken at time gaps.
+    Returns the list of written paths.
+    """
+    epochs = log['epoch']
+    if len(epochs) == 0:
+        return []
+
+    interval_s = log['header']['interval_ms'] / 1000.0
+    day = datetime.datetime.utcfromtimestamp(epochs[0]).strftime("%Y-%m-%d")
+
+    # Line starts: every 60th record and every record after a gap
+    gaps = np.flatnonzero(np.abs(np.diff(epochs) - interval_s) > interval_s / 2) + 1
+    starts = []
+    segment_bounds = np.concatenate(([0], gaps, [len(epochs)]))
+    for begin, end in zip(segment_bounds[:-1], segment_bounds[1:]):
+        starts.extend(range(begin, end, 60))
+    starts.append(len(epochs))
+
+    written = []
+    for ch in range(min(log['header']['channels'], len(CHANNEL_NAMES))):
+        path = os.path.join(out_dir, f"{CHANNEL_NAMES[ch]} {day}.txt")
+        column = log['values'][:, ch]
+        with open(path, 'w') as file:
+            for begin, end in zip(starts[:-1], starts[1:]):
+                stamp = datetime.datetime.utcfromtimestamp(epochs[begin]).strftime("%H:%M:%S")
+                file.write(f"\n{stamp} --> ")
+                file.write(", ".join(f"{value:.2f}" for value in column[begin:end]))
+                file.write("\n")
+        written.append(path)
+    return written
+
+
+def write_csv(log, out_path):
+    """
+    Writes one CSV row per record: ISO timestamp followed by each channel value.
+    """
+    channels = log['header']['channels']
+    names = [CHANNEL_NAMES[ch] if ch < len(CHANNEL_NAMES) else f"ch{ch}" for ch in range(channels)]
+    with open(out_path, 'w') as file:
+        file.write("timestamp," + ",".join(names) + "\n")
+        for epoch, row in zip(log['epoch'], log['values']):
+            stamp = datetime.datetime.utcfromtimestamp(epoch).strftime("%Y-%m-%d %H:%M:%S.%f")[:-3]
+            file.write(stamp + "," + ",".join(f"{value:.4f}" for value in row) + "\n")
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return
+
+    file_path = sys.argv[1]
+    log = read_binlog(file_path)
+    header = log['header']
+    print(f"Loaded {len(log['epoch'])} records, {header['channels']} channels, "
+          f"{header['interval_ms']} ms interval from {file_path}")
+    if log['bad_blocks']:
+        print(f"Warning: {log['bad_blocks']} blocks failed the CRC check and were skipped")
+
+    if len(sys.argv) > 3 and sys.argv[2] == '--csv':
+        write_csv(log, sys.argv[3])
+        print(f"CSV written to: {sys.argv[3]}")
+    else:
+        out_dir = os.path.dirname(os.path.abspath(file_path))
+        for path in write_text_logs(log, out_dir):
+            print(f"Text log written to: {path}")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,137 @@
+"""
+Reader for the current events captured by the firmware's burst trigger
+(see src/burst.h for the layout). The same bytes are appended to
+"Events YYYY-MM-DD.evt" and published on "battery/event".
+
+Usage:
+    python visualization/BurstEvent.py "Events 2025-03-07.evt"          # list the events
+    python visualization/BurstEvent.py "Events 2025-03-07.evt" --plot 3 # plot event number 3 (needs matplotlib)
+
+From your own collector:
+    from BurstEvent import decode_event
+    event, _ = decode_event(message.payload)
+"""
+import sys
+import struct
+import zlib
+import datetime
+import numpy as np
+
+
+MAGIC = b'BEVT'
+TRIGGERS = {1: 'level', 2: 'slope'}
+CHANNEL_NAMES = ['Amps', 'Volts']
+
+# magic, version, trigger, header_size, epoch, epoch_ms, count, pre_count,
+# channels, trigger_gain, sequence, trigger_code, reference gains (4 bits per channel)
+FIXED_HEADER = struct.Struct('<4sBBHIHHHBBIhH')
+SAMPLE = np.dtype([('dt_us', '<i4'), ('code', '<i2'), ('channel', 'u1'), ('gain', 'u1')])
+
+# ADS1115 LSB size in nV per PGA setting (0 = 2/3x ... 5 = 16x)
+ADS_LSB_NV = np.array([187500.0, 125000.0, 62500.0, 31250.0, 15625.0, 7812.5])
+
+
+def decode_event(buf, offset=0):
+    """
+    Decodes one event starting at offset.
+    Returns (event dict, offset just past the event). The dict holds the
+    header fields, 'time' (datetime of the trigger), 'samples' (structured
+    array) and per-channel 't' (seconds relative to the trigger) and 'values'.
+    Raises ValueError on a foreign or truncated record.
+    """
+    if len(buf) - offset < FIXED_HEADER.size:
+        raise ValueError("Too short for an event header")
+    (magic, version, trigger, header_size, epoch, epoch_ms, count, pre_count,
+     channels, trigger_gain, sequence, trigger_code, gains) = FIXED_HEADER.unpack_from(buf, offset)
+    if magic != MAGIC:
+        raise ValueError(f"Not an event record (magic {magic!r})")
+
+    floats = struct.unpack_from(f'<{2 * channels}f', buf, offset + FIXED_HEADER.size)
+    scale, offsets = np.array(floats[:channels]), np.array(floats[channels:])
+    crc_pos = offset + FIXED_HEADER.size + 8 * channels
+    (crc,) = struct.unpack_from('<I', buf, crc_pos)
+
+    data_start = offset + header_size
+    data_end = data_start + count * SAMPLE.itemsize
+    if data_end > len(buf):
+        raise ValueError("Truncated event")
+    actual = zlib.crc32(buf[data_start:data_end], zlib.crc32(buf[offset:crc_pos]))
+
+    samples = np.frombuffer(buf, dtype=SAMPLE, count=count, offset=data_start)
+
+    # Version 1 events were taken at one gain per channel
+    def range_factor(ch, gain):
+        if version < 2:
+            return 1.0
+        return ADS_LSB_NV[gain] / ADS_LSB_NV[(gains >> (4 * ch)) & 0x0F]
+
+    event = {
+        'version': version,
+        'trigger': TRIGGERS.get(trigger, str(trigger)),
+        'time': datetime.datetime.utcfromtimestamp(epoch + epoch_ms / 1000.0),
+        'sequence': sequence,
+        'pre_count': pre_count,
+        'trigger_value': trigger_code * range_factor(0, trigger_gain) * scale[0] + offsets[0],
+        'crc_ok': actual == crc,
+        'samples': samples,
+        't': [],
+        'values': [],
+    }
+    for ch in range(channels):
+        picked = samples[samples['channel'] == ch]
+        event['t'].append(picked['dt_us'] / 1e6)
+        event['values'].append(picked['code'] * range_factor(ch, picked['gain']) * scale[ch] + offsets[ch])
+    return event, data_end
+
+
+def read_events(file_path):
+    """
+    Loads all events of an event file.
+    """
+    with open(file_path, 'rb') as file:
+        buf = file.read()
+
+    events = []
+    pos = 0
+    while pos < len(buf):
+        try:
+            event, pos = decode_event(buf, pos)
+        except ValueError as error:
+            print(f"Warning: {error} at offset {pos}, stopping")
+            break
+        events.append(event)
+    return events
+
+
+def plot_event(event):
+    import matplotlib.pyplot as plt
+
+    fig, axes = plt.subplots(len(event['t']), 1, sharex=True, figsize=(10, 6))
+    for ch, axis in enumerate(np.atleast_1d(axes)):
+        axis.plot(event['t'][ch] * 1000, event['values'][ch], linewidth=0.8)
+        axis.axvline(0, color='red', linestyle='--', linewidth=0.8)
+        axis.set_ylabel(CHANNEL_NAMES[ch] if ch < len(CHANNEL_NAMES) else f"ch{ch}")
+        axis.grid(True)
+    axes[-1].set_xlabel("ms relative to trigger")
+    fig.suptitle(f"Event #{event['sequence']} {event['time']:%Y-%m-%d %H:%M:%S.%f} ({event['trigger']} trigger)")
+    plt.show()
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return
+
+    events = read_events(sys.argv[1])
+    for i, event in enumerate(events):
+        amps = event['values'][0]
+        print(f"{i:3d}  #{event['sequence']:<5d} {event['time']:%H:%M:%S.%f}  {event['trigger']:5s}  "
+              f"trigger {event['trigger_value']:7.2f} A  peak {np.max(np.abs(amps)):7.2f} A  "
+              f"{len(event['samples'])} samples{'' if event['crc_ok'] else '  CRC ERROR'}")
+
+    if len(sys.argv) > 3 and sys.argv[2] == '--plot':
+        plot_event(events[int(sys.argv[3])])
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,95 @@
+"""
+Decoder for the batched binary MQTT messages published by the firmware on
+"battery/data" (see src/mqtt_batch.h for the layout).
+
+Usage:
+    python visualization/MqttBatch.py <broker> [port]     # print decoded batches (needs paho-mqtt)
+
+From your own collector:
+    from MqttBatch import decode_batch
+    batch = decode_batch(message.payload)
+"""
+import sys
+import struct
+import datetime
+import numpy as np
+
+
+SCHEMA_VERSION = 1
+FLAG_GAP_BEFORE = 0x01
+FLAG_BACKLOG = 0x02
+NO_DATA = -32768
+TOPIC = 'battery/data'
+
+# version, flags, channels, header_size, interval_ms, count, epoch, sequence
+FIXED_HEADER = struct.Struct('<BBBBHHII')
+
+
+def decode_batch(payload):
+    """
+    Decodes one batch message.
+
+    Returns a dict with:
+    - version, flags, sequence, interval_ms: header fields
+    - epoch:  float64 array of unix times, one per record
+    - codes:  int16 array of shape (records, channels)
+    - values: float64 array of shape (records, channels), NaN where a channel had no data
+    Raises ValueError for an unknown schema version or a truncated message.
+    """
+    if len(payload) < FIXED_HEADER.size:
+        raise ValueError("Message too short for a batch header")
+
+    version, flags, channels, header_size, interval_ms, count, epoch, sequence = \
+        FIXED_HEADER.unpack_from(payload, 0)
+    if version != SCHEMA_VERSION:
+        raise ValueError(f"Unsupported batch schema version {version}")
+    if len(payload) < header_size + count * channels * 2:
+        raise ValueError("Truncated batch message")
+
+    calibration = np.frombuffer(payload, dtype='<f4', count=2 * channels, offset=FIXED_HEADER.size)
+    scale = calibration[:channels].astype(np.float64)
+    offset = calibration[channels:].astype(np.float64)
+
+    codes = np.frombuffer(payload, dtype='<i2', count=count * channels, offset=header_size).reshape(-1, channels)
+    values = codes * scale + offset
+    values[codes == NO_DATA] = np.nan
+
+    return {
+        'version': version,
+        'flags': flags,
+        'sequence': sequence,
+        'interval_ms': interval_ms,
+        'epoch': epoch + np.arange(count) * (interval_ms / 1000.0),
+        'codes': codes,
+        'values': values,
+    }
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return
+
+    import paho.mqtt.client as mqtt
+
+    def on_message(client, userdata, message):
+        try:
+            batch = decode_batch(message.payload)
+        except ValueError as error:
+            print(f"Skipping message on {message.topic}: {error}")
+            return
+        start = datetime.datetime.utcfromtimestamp(batch['epoch'][0]) if len(batch['epoch']) else None
+        notes = (" (gap before)" if batch['flags'] & FLAG_GAP_BEFORE else "") + \
+                (" (backlog)" if batch['flags'] & FLAG_BACKLOG else "")
+        print(f"#{batch['sequence']} {start} {len(batch['epoch'])} records{notes}: "
+              f"mean {np.nanmean(batch['values'], axis=0)}")
+
+    client = mqtt.Client()
+    client.on_message = on_message
+    client.connect(sys.argv[1], int(sys.argv[2]) if len(sys.argv) > 2 else 1883)
+    client.subscribe(TOPIC)
+    client.loop_forever()
+
+
+if __name__ == '__main__':
+    main()
@@ -1,89 +1,197 @@
-import sys
+"""
+Plots current, voltage and cumulative discharge capacity from the firmware's
+logs, for one day or a range of days and for one or more devices.
+
+Usage:
+    python visualization/PlotData.py                          # latest day in visualization/data
+    python visualization/PlotData.py 2025-03-07               # one day
+    python visualization/PlotData.py 2025-03-01 2025-03-31    # all days in the range, merged
+    python visualization/PlotData.py 2025-03-07 --device fleet/bms1 --device fleet/bms2
+
+Each device directory holds one YYYY-MM-DD folder per day with
+"Amps YYYY-MM-DD.txt" and "Volts YYYY-MM-DD.txt", or "Raw YYYY-MM-DD.bin"
+(see BinLog.py), which is preferred when present. Parsed text logs are cached
+as .npy files in a .cache folder next to them, and days are loaded in
+parallel (--jobs, default one per CPU core; --no-cache to reparse).
+"""
 import os
-import re
+import argparse
 import datetime
+from concurrent.futures import ProcessPoolExecutor
 import matplotlib.pyplot as plt
 import matplotlib.dates as mdates
 import numpy as np
 
 
-def read_data_file(file_path):
+# Folder next to each text log that holds its parsed copy
+CACHE_DIR = ".cache"
+CACHE_DTYPE = np.dtype([('second', '<i4'), ('value', '<f8')])
+
+# Samples closer together than this count towards the capacity; longer gaps
+# (logging stopped, missing days) add nothing
+MAX_GAP_S = 300
+
+# Series longer than this are drawn as plain lines, without point markers
+MARKER_POINTS = 20000
+
+
+def parse_anchor(stamp):
     """
-    Reads data from a file where each line represents one minute of data.
-    
-    The file format is:
-    - First row may contain values without timestamp
-    - Subsequent rows have a timestamp (HH:MM:SS) followed by '-->'
-    - After the '-->' are comma-separated values, one for each second
-    
-    Returns two lists:
-    - timestamps: List of datetime objects with second-level precision
-    - values: List of corresponding measurement values
+    Parses an "HH:MM:SS" (or "HH:MM") line timestamp.
+    Returns seconds since midnight, or None if it is not a time.
     """
-    with open(file_path, 'r') as file:
-        lines = file.readlines()
-    
-    timestamps = []
-    values = []
-    current_minute = None
-    
-    for line in lines:
-        line = line.strip()
-        if not line:
-            continue  # Skip empty lines
-            
-        # Check if line has a timestamp marker
-        if '-->' in line:
-            parts = line.split('-->')
-            timestamp_str = parts[0].strip()
-            data_part = parts[1].strip()
-            
-            # Parse the timestamp (usually in HH:MM:SS format)
+    try:
+        parts = [int(part) for part in stamp.strip().split(b':')]
+    except ValueError:
+        return None
+    if len(parts) == 2:
+        parts.append(0)
+    if len(parts) != 3:
+        return None
+    return parts[0] * 3600 + parts[1] * 60 + parts[2]
+
+
+def parse_values(fields):
+    """
+    Converts value strings to float64 in one numpy call. Unparseable values
+    become NaN so the values after them keep their seconds.
+    """
+    try:
+        return np.array(fields, dtype=np.bytes_).astype(np.float64)
+    except ValueError:
+        values = np.empty(len(fields))
+        for i, field in enumerate(fields):
             try:
-                # This gives us the minute marker
-                time_obj = datetime.datetime.strptime(timestamp_str, "%H:%M:%S")
-                current_minute = time_obj
+                values[i] = float(field)
             except ValueError:
-                try:
-                    # Try without seconds
-                    time_obj = datetime.datetime.strptime(timestamp_str, "%H:%M")
-                    current_minute = time_obj
-                except ValueError:
-                    print(f"Warning: Could not parse timestamp: {timestamp_str}")
-                    continue
+                print(f"Warning: Could not parse value: {field.decode(errors='replace')}")
+                values[i] = np.nan
+        return values
+
+
+def parse_text_log(file_path):
+    """
+    Parses a text log where each line holds up to a minute of data.
+
+    The file format is:
+    - Lines start with the time of their first value (HH:MM:SS) followed by '-->'
+    - After the '-->' are comma-separated values, one for each second
+    - A line without a timestamp continues the line before it; lines before
+      the first timestamp are dropped
+
+    Only the line split runs per line (1440 per day); values are converted
+    and timestamped as whole arrays.
+
+    Returns two numpy arrays:
+    - seconds: int32 seconds since midnight of each value
+    - values: float64 measurement values
+    """
+    with open(file_path, 'rb') as file:
+        text = file.read()
+
+    anchors = []
+    counts = []
+    fields = []
+    for line in text.split(b'\n'):
+        stamp, marker, data = line.partition(b'-->')
+        if marker:
+            anchor = parse_anchor(stamp)
+            if anchor is None:
+                print(f"Warning: Could not parse timestamp: {stamp.decode(errors='replace').strip()}")
+                continue
         else:
-            # Line without timestamp - use data directly
-            data_part = line
-        
-        # Parse the comma-separated values
-        second_values = []
-        for val in data_part.split(','):
-            val = val.strip()
-            if val:  # Skip empty values
-                try:
-                    second_values.append(float(val))
-                except ValueError:
-                    print(f"Warning: Could not parse value: {val}")
-        
-        # If we have a current minute and values, create timestamps for each second
-        if current_minute and second_values:
-            for second_idx, value in enumerate(second_values):
-                # Create a timestamp with the correct second
-                second_timestamp = current_minute.replace(second=second_idx % 60)
-                
-                # If we're about to overflow to the next minute (would have second >= 60),
-                # then increment the minute appropriately
-                if second_idx >= 60:
-                    extra_minutes = second_idx // 60
-                    second_timestamp += datetime.timedelta(minutes=extra_minutes)
-                
-                timestamps.append(second_timestamp)
-                values.append(value)
-    
-    if not timestamps:
+            anchor = -1
+            data = stamp
+
+        line_fields = data.replace(b',', b' ').split()
+        if line_fields:
+            anchors.append(anchor)
+            counts.append(len(line_fields))
+            fields.extend(line_fields)
+
+    if not fields:
         raise ValueError(f"No valid data found in file: {file_path}")
-        
-    return timestamps, values
+
+    anchors = np.array(anchors, dtype=np.int64)
+    counts = np.array(counts, dtype=np.int64)
+    line_start = np.cumsum(counts) - counts
+
+    # Each line is timed from the last timestamped line at or before it:
+    # value k of the file sits at anchor + (k - first value of that line)
+    line_index = np.arange(len(anchors))
+    anchored = np.maximum.accumulate(np.where(anchors >= 0, line_index, -1))
+    keep = np.repeat(anchored >= 0, counts)
+    anchored = np.maximum(anchored, 0)
+    base = np.repeat(anchors[anchored] - line_start[anchored], counts)
+    seconds = base + np.arange(len(fields))
+
+    values = parse_values(fields)
+    keep &= ~np.isnan(values)
+    if not keep.any():
+        raise ValueError(f"No valid data found in file: {file_path}")
+    return seconds[keep].astype(np.int32), values[keep]
+
+
+def cache_path(file_path):
+    """Path of the parsed copy of a text log."""
+    directory, name = os.path.split(file_path)
+    return os.path.join(directory, CACHE_DIR, os.path.splitext(name)[0] + ".npy")
+
+
+def read_data_file(file_path, use_cache=True):
+    """
+    Reads a text log (see parse_text_log), from its .npy cache when that is
+    newer than the log. The cache is rewritten after every parse, so a log
+    that is still growing is reparsed once per change.
+
+    Returns (seconds since midnight, values) as numpy arrays.
+    """
+    cache = cache_path(file_path)
+    if use_cache and os.path.exists(cache) and os.path.getmtime(cache) >= os.path.getmtime(file_path):
+        try:
+            data = np.load(cache)
+            if data.dtype == CACHE_DTYPE:
+                return data['second'], data['value']
+        except (OSError, ValueError):
+            pass
+        print(f"Warning: Ignoring unreadable cache {cache}")
+
+    seconds, values = parse_text_log(file_path)
+
+    if use_cache:
+        data = np.empty(len(seconds), dtype=CACHE_DTYPE)
+        data['second'] = seconds
+        data['value'] = values
+        try:
+            os.makedirs(os.path.dirname(cache), exist_ok=True)
+            temp = cache + ".tmp"
+            with open(temp, 'wb') as file:
+                np.save(file, data)
+            os.replace(temp, cache)
+        except OSError as e:
+            print(f"Warning: Could not write cache {cache}: {e}")
+
+    return seconds, values
+
+
+def read_binary_log(file_path):
+    """
+    Reads a "Raw YYYY-MM-DD.bin" log (memory-mapped, see BinLog.py).
+    Returns (timestamps as datetime64[ms], voltages, currents).
+    """
+    from BinLog import read_binlog
+
+    log = read_binlog(file_path)
+    if len(log['epoch']) == 0:
+        raise ValueError(f"No valid data found in file: {file_path}")
+    if log['bad_blocks']:
+        print(f"Warning: {log['bad_blocks']} blocks in {file_path} failed the CRC check and were skipped")
+
+    timestamps = np.round(log['epoch'] * 1000).astype(np.int64).astype('datetime64[ms]')
+    values = log['values']
+    currents = values[:, 0]
+    voltages = values[:, 1] if values.shape[1] > 1 else np.zeros(len(currents))
+    return timestamps, voltages, currents
 
 
 def find_date_directories(base_dir="visualization/data"):
@@ -113,13 +221,22 @@ def find_date_directories(base_dir="visualization/data"):
     return sorted(date_dirs, key=lambda x: x[0])
 
 
-def load_data_from_directory(dir_path, reference_date):
+def load_data_from_directory(dir_path, reference_date, use_cache=True):
     """
-    Loads voltage and current data from "Amps YYYY-MM-DD.txt" and "Volts YYYY-MM-DD.txt" in the specified directory.
+    Loads voltage and current data from "Raw YYYY-MM-DD.bin", or else from
+    "Amps YYYY-MM-DD.txt" and "Volts YYYY-MM-DD.txt" in the specified directory.
     Applies the reference date to timestamps for plotting.
+
+    Returns numpy arrays: timestamps (datetime64[ms]), voltages, currents.
     """
     date_str = reference_date.strftime("%Y-%m-%d")
-    
+
+    # The binary log holds the raw codes, so it is exact and needs no parsing
+    raw_file = os.path.join(dir_path, f"Raw {date_str}.bin")
+    if os.path.exists(raw_file):
+        print(f"Loading raw data from: {raw_file}")
+        return read_binary_log(raw_file)
+
     # Check for Amps file in the directory
     amps_file = os.path.join(dir_path, f"Amps {date_str}.txt")
     amps_found = os.path.exists(amps_file)
@@ -162,147 +279,147 @@ def load_data_from_directory(dir_path, reference_date):
     if not amps_found and not volts_found:
         raise FileNotFoundError(f"No data files found for date {date_str} in directory {dir_path} or parent directory")
     
-    # Handle case where only one type of file is found
-    timestamps = None
-    voltages = []
-    currents = []
-    
     # Load amps data if available
     if amps_found:
         print(f"Loading current data from: {amps_file}")
-        amps_timestamps, amps_values = read_data_file(amps_file)
-        if timestamps is None:
-            timestamps = amps_timestamps
-        currents = amps_values
+        amps_seconds, amps_values = read_data_file(amps_file, use_cache)
     else:
         print(f"Warning: No current data file found for date {date_str}")
-        amps_timestamps = []
-        amps_values = []
-    
+
     # Load volts data if available
     if volts_found:
         print(f"Loading voltage data from: {volts_file}")
-        volts_timestamps, volts_values = read_data_file(volts_file)
-        if timestamps is None:
-            timestamps = volts_timestamps
-        voltages = volts_values
+        volts_seconds, volts_values = read_data_file(volts_file, use_cache)
     else:
         print(f"Warning: No voltage data file found for date {date_str}")
-        volts_timestamps = []
-        volts_values = []
-    
+
     # If both files are present, align the data
     if amps_found and volts_found:
-        timestamps, voltages, currents = align_data(amps_timestamps, amps_values, 
-                                                  volts_timestamps, volts_values)
+        seconds, voltages, currents = align_data(amps_seconds, amps_values,
+                                                 volts_seconds, volts_values)
     elif amps_found:
         # Only amps data available
-        timestamps = amps_timestamps
+        seconds = amps_seconds
         currents = amps_values
-        voltages = [0] * len(timestamps)  # Placeholder zeros for missing voltage data
-    elif volts_found:
+        voltages = np.zeros(len(seconds))  # Placeholder zeros for missing voltage data
+    else:
         # Only volts data available
-        timestamps = volts_timestamps
+        seconds = volts_seconds
         voltages = volts_values
-        currents = [0] * len(timestamps)  # Placeholder zeros for missing current data
-    
+        currents = np.zeros(len(seconds))  # Placeholder zeros for missing current data
+
     # Apply reference date to timestamps
-    dated_timestamps = []
-    for ts in timestamps:
-        full_dt = datetime.datetime.combine(reference_date, 
-                                          datetime.time(ts.hour, ts.minute, ts.second))
-        dated_timestamps.append(full_dt)
-    
-    return dated_timestamps, voltages, currents
+    timestamps = np.datetime64(reference_date, 'ms') + seconds.astype('timedelta64[s]')
+    return timestamps, voltages, currents
 
 
-def align_data(amps_timestamps, amps_values, volts_timestamps, volts_values):
+def align_data(amps_seconds, amps_values, volts_seconds, volts_values):
     """
     Aligns current and voltage data based on timestamps.
-    Returns common timestamps and corresponding values.
+    Returns common timestamps (sorted) and corresponding values.
     Handles cases where one of the data arrays might be empty.
     """
     # Handle special cases where one dataset might be empty
-    if not amps_timestamps or not amps_values:
+    if len(amps_seconds) == 0:
         print("Warning: No current data available for alignment")
-        return volts_timestamps, volts_values, [0] * len(volts_values)
-    
-    if not volts_timestamps or not volts_values:
+        return volts_seconds, volts_values, np.zeros(len(volts_values))
+
+    if len(volts_seconds) == 0:
         print("Warning: No voltage data available for alignment")
-        return amps_timestamps, [0] * len(amps_values), amps_values
-    
-    # Create mappings of timestamp to value for easy lookup
-    amps_map = {}
-    for i, ts in enumerate(amps_timestamps):
-        if i < len(amps_values):
-            amps_map[ts.strftime("%H:%M:%S")] = amps_values[i]
-    
-    volts_map = {}
-    for i, ts in enumerate(volts_timestamps):
-        if i < len(volts_values):
-            volts_map[ts.strftime("%H:%M:%S")] = volts_values[i]
-    
-    # Find common timestamps
-    common_timestamps = []
-    common_volts = []
-    common_amps = []
-    
-    # Use all timestamps from amps file as reference and find matching voltage values
-    for i, ts in enumerate(amps_timestamps):
-        time_key = ts.strftime("%H:%M:%S")
-        if time_key in volts_map and time_key in amps_map:
-            common_timestamps.append(ts)
-            common_volts.append(volts_map[time_key])
-            common_amps.append(amps_map[time_key])
-    
-    if not common_timestamps:
+        return amps_seconds, np.zeros(len(amps_values)), amps_values
+
+    # Seconds present in both files; a second logged twice uses its first value
+    common, amps_index, volts_index = np.intersect1d(amps_seconds, volts_seconds,
+                                                     return_indices=True)
+
+    if len(common) == 0:
         print("Warning: No exact timestamp matches between current and voltage files.")
         print("Using current timestamps and aligning voltage data.")
-        
+
         # Use all amps timestamps and closest voltage values
-        min_length = min(len(amps_timestamps), len(volts_values))
-        return amps_timestamps[:min_length], volts_values[:min_length], amps_values[:min_length]
-    
-    return common_timestamps, common_volts, common_amps
+        min_length = min(len(amps_seconds), len(volts_values))
+        return amps_seconds[:min_length], volts_values[:min_length], amps_values[:min_length]
+
+    return common, volts_values[volts_index], amps_values[amps_index]
+
+
+def load_day(task):
+    """
+    Worker for load_days(): loads one (device, date, directory) task.
+    Returns (device, date, data or None, error message or None).
+    """
+    device, date, dir_path, use_cache = task
+    try:
+        return device, date, load_data_from_directory(dir_path, date, use_cache), None
+    except (OSError, ValueError) as e:
+        return device, date, None, str(e)
+
+
+def load_days(tasks, jobs=None):
+    """
+    Loads days in parallel, one task per (device, day), and merges each
+    device's days in date order.
+
+    tasks: list of (device, date, directory, use_cache) tuples
+    jobs:  worker processes (default: one per CPU core)
+    Returns {device: (timestamps, voltages, currents)} for devices with data.
+    """
+    jobs = jobs or os.cpu_count() or 1
+    if jobs > 1 and len(tasks) > 1:
+        with ProcessPoolExecutor(max_workers=min(jobs, len(tasks))) as pool:
+            results = list(pool.map(load_day, tasks))
+    else:
+        results = [load_day(task) for task in tasks]
+
+    days = {}
+    for device, date, data, error in sorted(results, key=lambda result: (result[0], result[1])):
+        if data is None:
+            print(f"Warning: Skipping {device} {date}: {error}")
+            continue
+        days.setdefault(device, []).append(data)
+
+    merged = {}
+    for device, parts in days.items():
+        merged[device] = tuple(np.concatenate([part[k] for part in parts]) for k in range(3))
+    return merged
 
 
 def compute_cumulative_capacity(timestamps, current_values):
     """
     Computes cumulative capacity in Ah, only counting discharge current (positive values).
+    Each interval uses the current at its start; gaps over MAX_GAP_S add nothing.
     """
-    cumulative_capacity = [0]
-    
-    for i in range(1, len(current_values)):
-        # Calculate time difference in hours
-        dt = (timestamps[i] - timestamps[i-1]).total_seconds() / 3600
-        current = current_values[i-1]  # Using previous current value
-        
-        # Only discharge (positive current) reduces the capacity
-        if current > 0:
-            delta_capacity = current * dt
-            cumulative_capacity.append(cumulative_capacity[-1] + delta_capacity)
-        else:
-            cumulative_capacity.append(cumulative_capacity[-1])
-    
-    return np.array(cumulative_capacity)
+    current_values = np.asarray(current_values, dtype=np.float64)
+    if len(current_values) == 0:
+        return np.zeros(0)
+
+    # Time differences in hours
+    dt = np.diff(timestamps) / np.timedelta64(1, 's')
+    dt[dt > MAX_GAP_S] = 0
+    current = current_values[:-1]  # Using previous current value
+
+    # Only discharge (positive current) reduces the capacity
+    delta_capacity = np.where(current > 0, current * dt / 3600, 0.0)
+    return np.concatenate(([0.0], np.cumsum(delta_capacity)))
 
 
-def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_date):
+def plot_combined_data(timestamps, voltages, currents, capacity_values, label):
     """
     Creates a single visualization with all three metrics overlapping:
     - Current (A) over time
     - Voltage (V) over time 
     - Cumulative capacity (Ah) over time
     All metrics share the same x-axis but have their own y-axes.
+    label names the plotted days (and device) in the title and file name.
     """
     # Create figure and primary axis
     fig, ax1 = plt.subplots(figsize=(15, 8))
-    fig.suptitle(f"Battery Data Analysis - {plot_date.strftime('%Y-%m-%d')}", fontsize=16)
+    fig.suptitle(f"Battery Data Analysis - {label}", fontsize=16)
     
     # Get time range for proper formatting
-    if timestamps:
-        min_time = min(timestamps)
-        max_time = max(timestamps)
+    if len(timestamps):
+        min_time = timestamps.min().item()
+        max_time = timestamps.max().item()
         total_seconds = (max_time - min_time).total_seconds()
         hours_span = total_seconds / 3600
     else:
@@ -324,11 +441,16 @@ def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_dat
         major_formatter = mdates.DateFormatter('%H:%M')
         major_locator = mdates.MinuteLocator(byminute=range(0, 60, 15))  # Every 15 minutes
         minor_locator = mdates.MinuteLocator(byminute=range(0, 60, 5))   # Every 5 minutes
-    else:
+    elif hours_span < 48:
         # For longer periods, show hour with hourly ticks
         major_formatter = mdates.DateFormatter('%H:%M')
         major_locator = mdates.HourLocator()
         minor_locator = mdates.MinuteLocator(byminute=[0, 30])  # Every 30 minutes
+    else:
+        # For several days, let matplotlib pick day ticks
+        major_locator = mdates.AutoDateLocator(maxticks=16)
+        major_formatter = mdates.ConciseDateFormatter(major_locator)
+        minor_locator = mdates.HourLocator(byhour=[0, 6, 12, 18])
     
     # Apply the formatting to the x-axis
     ax1.xaxis.set_major_formatter(major_formatter)
@@ -340,7 +462,7 @@ def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_dat
     ax1.grid(True, which='minor', linestyle=':', alpha=0.4)
     
     # Ensure all data points are plotted by setting the limit to actual data range
-    if timestamps:
+    if len(timestamps):
         ax1.set_xlim(min_time, max_time)
         
         # Add interactive time information with tooltips for precise second values
@@ -355,28 +477,31 @@ def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_dat
         ax1.format_coord = format_coord
     
     # Check if we have current data (not all zeros)
-    has_current_data = any(abs(current) > 0.001 for current in currents)
+    has_current_data = bool(np.any(np.abs(currents) > 0.001))
+    
+    # Long series are too dense for point markers
+    marker = '.' if len(timestamps) <= MARKER_POINTS else None
     
     # Plot 1: Current over time (primary y-axis) if data exists
     color_current = 'black'
-    ax1.set_xlabel(f"Time on {plot_date.strftime('%Y-%m-%d')}")
+    ax1.set_xlabel(f"Time on {label}")
     ax1.set_ylabel("Current [A]", color=color_current)
     
     if has_current_data:
         # Plot every data point with markers
-        ax1.plot(timestamps, currents, color=color_current, linewidth=2.0, marker='.', 
+        ax1.plot(timestamps, currents, color=color_current, linewidth=2.0, marker=marker, 
                markersize=3, label='Current [A]')
         
         # Fill between to highlight charging/discharging areas
-        ax1.fill_between(timestamps, currents, 0, where=(np.array(currents) >= 0), 
+        ax1.fill_between(timestamps, currents, 0, where=(currents >= 0), 
                       interpolate=True, color='blue', alpha=0.15, label='Charging')
-        ax1.fill_between(timestamps, currents, 0, where=(np.array(currents) < 0), 
+        ax1.fill_between(timestamps, currents, 0, where=(currents < 0), 
                       interpolate=True, color='red', alpha=0.15, label='Discharging')
     else:
         print("Warning: No current data to plot")
     
     # Check if we have voltage data (not all zeros)
-    has_voltage_data = any(abs(voltage) > 0.001 for voltage in voltages)
+    has_voltage_data = bool(np.any(np.abs(voltages) > 0.001))
     
     # Create second y-axis and plot voltage
     ax2 = ax1.twinx()
@@ -386,7 +511,7 @@ def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_dat
     if has_voltage_data:
         # Plot with markers to show individual data points
         ax2.plot(timestamps, voltages, color=color_voltage, linewidth=2.0, 
-               marker='.', markersize=3, label='Voltage [V]')
+               marker=marker, markersize=3, label='Voltage [V]')
     else:
         print("Warning: No voltage data to plot")
     
@@ -402,10 +527,10 @@ def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_dat
         
         # Plot with markers to show individual data points
         ax3.plot(timestamps, capacity_values, color=color_capacity, linewidth=2.0, 
-               marker='.', markersize=3, label='Capacity [Ah]')
+               marker=marker, markersize=3, label='Capacity [Ah]')
         
         # Set the y-limit for capacity to start from 0
-        max_capacity = max(capacity_values) if max(capacity_values) > 0 else 1
+        max_capacity = capacity_values.max() if capacity_values.max() > 0 else 1
         ax3.set_ylim(0, max_capacity * 1.1)
     
     # Create combined legend
@@ -449,9 +574,10 @@ def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_dat
     plt.setp(ax1.get_xticklabels(), rotation=45, ha='right')
     
     # Add time range annotation at the bottom
-    if timestamps:
-        start_time = min(timestamps).strftime('%H:%M:%S')
-        end_time = max(timestamps).strftime('%H:%M:%S')
+    if len(timestamps):
+        time_format = '%H:%M:%S' if hours_span < 24 else '%Y-%m-%d %H:%M:%S'
+        start_time = min_time.strftime(time_format)
+        end_time = max_time.strftime(time_format)
         time_range_text = f"Time Range: {start_time} to {end_time}"
         fig.text(0.5, 0.01, time_range_text, ha='center', fontsize=10)
     
@@ -477,7 +603,7 @@ def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_dat
         if not os.path.exists(save_dir):
             os.makedirs(save_dir)
         
-        filename = os.path.join(save_dir, f"battery_data_{plot_date.strftime('%Y-%m-%d')}.png")
+        filename = os.path.join(save_dir, f"battery_data_{label.replace(' ', '_').replace('/', '-')}.png")
         fig.savefig(filename, dpi=300)
         print(f"Plot saved to: {filename}")
     else:
@@ -486,79 +612,108 @@ def plot_combined_data(timestamps, voltages, currents, capacity_values, plot_dat
     plt.close(fig)
 
 
+def select_dates(date_dirs, first, last):
+    """
+    Picks the (date, directory) entries to plot from date_dirs (sorted).
+    first/last are the command line dates; a single missing or invalid date
+    falls back to the latest date, as the plot of one day always did.
+    """
+    if first is None:
+        return date_dirs[-1:]  # No argument provided; use the latest date
+
+    try:
+        first_date = datetime.datetime.strptime(first, "%Y-%m-%d").date()
+        last_date = datetime.datetime.strptime(last, "%Y-%m-%d").date() if last else first_date
+    except ValueError:
+        print("Invalid date format. Please use YYYY-MM-DD.")
+        print("Using the latest date instead.")
+        return date_dirs[-1:]
+
+    selected = [d for d in date_dirs if first_date <= d[0] <= last_date]
+    if not selected and last is None:
+        print(f"No data found for date {first_date}.")
+        print("Using the latest date instead.")
+        return date_dirs[-1:]
+    return selected
+
+
 def main():
-    base_dir = "visualization/data"
-    
-    # Check if files directory exists
-    if not os.path.exists(base_dir):
-        print(f"Error: Directory '{base_dir}' does not exist.")
-        return
-    
-    # Find date directories
-    date_dirs = find_date_directories(base_dir)
-    
-    if not date_dirs:
-        print(f"No valid date directories found in '{base_dir}'.")
-        print("Please create date folders (YYYY-MM-DD) containing Amps.txt and Volts.txt files.")
+    parser = argparse.ArgumentParser(description="Plot battery logs for one day or a range of days.")
+    parser.add_argument('first', nargs='?', help="date to plot (YYYY-MM-DD), default the latest")
+    parser.add_argument('last', nargs='?', help="last date of a range to merge")
+    parser.add_argument('--device', action='append', metavar='DIR',
+                        help="device data directory with YYYY-MM-DD folders (repeatable, default visualization/data)")
+    parser.add_argument('--jobs', type=int, default=None, help="worker processes (default one per CPU core)")
+    parser.add_argument('--no-cache', action='store_true', help="reparse text logs instead of using .npy caches")
+    args = parser.parse_args()
+
+    tasks = []
+    for base_dir in args.device or ["visualization/data"]:
+        device = os.path.basename(os.path.normpath(base_dir))
+
+        # Check if files directory exists
+        if not os.path.exists(base_dir):
+            print(f"Error: Directory '{base_dir}' does not exist.")
+            continue
+
+        # Find date directories
+        date_dirs = find_date_directories(base_dir)
+
+        if not date_dirs:
+            print(f"No valid date directories found in '{base_dir}'.")
+            print("Please create date folders (YYYY-MM-DD) containing Amps.txt and Volts.txt files.")
+            continue
+
+        # Display available dates
+        print(f"Available dates in {base_dir}:")
+        for date, _ in date_dirs:
+            print(f"  - {date}")
+
+        for date, dir_path in select_dates(date_dirs, args.first, args.last):
+            tasks.append((device, date, dir_path, not args.no_cache))
+
+    if not tasks:
+        print("Nothing to plot.")
         return
-    
-    # Display available dates
-    print("Available dates:")
-    for date, _ in date_dirs:
-        print(f"  - {date}")
-    
-    # Check if a date argument was provided
-    if len(sys.argv) > 1:
-        try:
-            requested_date = datetime.datetime.strptime(sys.argv[1], "%Y-%m-%d").date()
-            
-            # Look for matching directory
-            matching_dirs = [d for d in date_dirs if d[0] == requested_date]
-            
-            if matching_dirs:
-                selected_date, selected_dir = matching_dirs[0]
-            else:
-                print(f"No data found for date {requested_date}.")
-                print("Using the latest date instead.")
-                selected_date, selected_dir = date_dirs[-1]  # Use the latest
-        except ValueError:
-            print("Invalid date format. Please use YYYY-MM-DD.")
-            print("Using the latest date instead.")
-            selected_date, selected_dir = date_dirs[-1]  # Use the latest
-    else:
-        # No argument provided; use the latest date
-        selected_date, selected_dir = date_dirs[-1]  # Use the latest
-    
-    print(f"Using data for date: {selected_date}")
-    
+
+    dates = sorted({task[1] for task in tasks})
+    date_label = str(dates[0]) if len(dates) == 1 else f"{dates[0]} to {dates[-1]}"
+    print(f"Using data for {date_label} from {len(tasks)} day directories")
+
     try:
-        # Load data from the selected directory
-        timestamps, voltages, currents = load_data_from_directory(selected_dir, selected_date)
-        
-        # Print debug info to verify second-level resolution
-        print(f"Loaded {len(timestamps)} data points")
-        print(f"First 5 timestamps:")
-        for i in range(min(5, len(timestamps))):
-            print(f"  {timestamps[i].strftime('%H:%M:%S')}: {currents[i]}")
-            
-        print(f"Last 5 timestamps:")
-        for i in range(max(0, len(timestamps)-5), len(timestamps)):
-            print(f"  {timestamps[i].strftime('%H:%M:%S')}: {currents[i]}")
-        
-        # Calculate cumulative capacity
-        capacity_values = compute_cumulative_capacity(timestamps, currents)
-        
-        # Create combined plot with all three metrics
-        plot_combined_data(timestamps, voltages, currents, capacity_values, selected_date)
-        
-        # Print summary information
-        print("Summary:")
-        print(f"Max Current: {max(currents):.2f} A")
-        print(f"Min Current: {min(currents):.2f} A")
-        print(f"Max Voltage: {max(voltages):.2f} V")
-        print(f"Min Voltage: {min(voltages):.2f} V")
-        print(f"Final Cumulative Capacity: {capacity_values[-1]:.2f} Ah")
-    
+        # Load all days in parallel, merged per device
+        devices = load_days(tasks, args.jobs)
+        if not devices:
+            print("No data could be loaded.")
+            return
+
+        for device, (timestamps, voltages, currents) in devices.items():
+            label = date_label if len(devices) == 1 else f"{device} {date_label}"
+
+            # Print debug info to verify second-level resolution
+            print(f"{device}: Loaded {len(timestamps)} data points")
+            print(f"First 5 timestamps:")
+            for i in range(min(5, len(timestamps))):
+                print(f"  {timestamps[i].item().strftime('%Y-%m-%d %H:%M:%S')}: {currents[i]}")
+
+            print(f"Last 5 timestamps:")
+            for i in range(max(0, len(timestamps)-5), len(timestamps)):
+                print(f"  {timestamps[i].item().strftime('%Y-%m-%d %H:%M:%S')}: {currents[i]}")
+
+            # Calculate cumulative capacity
+            capacity_values = compute_cumulative_capacity(timestamps, currents)
+
+            # Create combined plot with all three metrics
+            plot_combined_data(timestamps, voltages, currents, capacity_values, label)
+
+            # Print summary information
+            print("Summary:")
+            print(f"Max Current: {currents.max():.2f} A")
+            print(f"Min Current: {currents.min():.2f} A")
+            print(f"Max Voltage: {voltages.max():.2f} V")
+            print(f"Min Voltage: {voltages.min():.2f} V")
+            print(f"Final Cumulative Capacity: {capacity_values[-1]:.2f} Ah")
+
     except Exception as e:
         print(f"Error processing data: {e}")
         import traceback
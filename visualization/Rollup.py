@@ -0,0 +1,119 @@
+"""
+Reader for the rollup files written by the firmware (see src/rollup.h):
+"Minute YYYY-MM-DD.rol" (one record per minute) and "Hour YYYY-MM.rol"
+(one record per hour) with min/max/mean per channel and charge in Ah.
+
+Usage:
+    python visualization/Rollup.py "Hour 2025-03.rol"              # print a summary per record
+    python visualization/Rollup.py "Hour 2025-03.rol" --csv out.csv # write a CSV instead
+"""
+import sys
+import struct
+import datetime
+import numpy as np
+
+
+MAGIC = b'BMSR'
+HEADER = struct.Struct('<4sHHIBBHI')
+
+# Channel order used by the firmware (SampleChannel in src/sampler.h)
+CHANNEL_NAMES = ['Amps', 'Volts']
+
+
+def record_dtype(channels):
+    return np.dtype([
+        ('epoch', '<u4'),
+        ('count', '<u4'),
+        ('min', '<f4', (channels,)),
+        ('max', '<f4', (channels,)),
+        ('mean', '<f4', (channels,)),
+        ('charge_ah', '<f4'),
+    ])
+
+
+def read_rollup(file_path):
+    """
+    Loads a rollup file.
+    Returns (header dict, numpy structured array of records). Records of a
+    period that was interrupted by a restart are merged into one.
+    """
+    with open(file_path, 'rb') as file:
+        buf = file.read()
+
+    if len(buf) < HEADER.size:
+        raise ValueError("File too short for a rollup header")
+    magic, version, header_size, period_s, channels, _, record_size, start_epoch = HEADER.unpack_from(buf, 0)
+    if magic != MAGIC:
+        raise ValueError(f"Not a rollup file (magic {magic!r})")
+
+    dtype = record_dtype(channels)
+    if dtype.itemsize != record_size:
+        raise ValueError(f"Unexpected record size {record_size}")
+    count = (len(buf) - header_size) // record_size
+    records = np.frombuffer(buf, dtype=dtype, count=count, offset=header_size)
+
+    header = {
+        'version': version,
+        'period_s': period_s,
+        'channels': channels,
+        'start_epoch': start_epoch,
+    }
+    return header, merge_duplicates(records)
+
+
+def merge_duplicates(records):
+    """
+    Combines records that share an epoch (count-weighted mean, summed charge).
+    """
+    if len(records) == 0 or np.all(np.diff(records['epoch'].astype(np.int64)) > 0):
+        return records
+
+    epochs = np.unique(records['epoch'])
+    merged = np.zeros(len(epochs), dtype=records.dtype)
+    for i, epoch in enumerate(epochs):
+        same = records[records['epoch'] == epoch]
+        counts = same['count'].astype(np.float64)
+        merged[i]['epoch'] = epoch
+        merged[i]['count'] = counts.sum()
+        merged[i]['min'] = same['min'].min(axis=0)
+        merged[i]['max'] = same['max'].max(axis=0)
+        merged[i]['mean'] = (same['mean'] * counts[:, None]).sum(axis=0) / counts.sum()
+        merged[i]['charge_ah'] = same['charge_ah'].sum()
+    return merged
+
+
+def write_csv(header, records, out_path):
+    names = [CHANNEL_NAMES[ch] if ch < len(CHANNEL_NAMES) else f"ch{ch}" for ch in range(header['channels'])]
+    columns = [f"{name}_{stat}" for name in names for stat in ('min', 'max', 'mean')]
+    with open(out_path, 'w') as file:
+        file.write("timestamp,count," + ",".join(columns) + ",charge_ah\n")
+        for record in records:
+            stamp = datetime.datetime.utcfromtimestamp(int(record['epoch'])).strftime("%Y-%m-%d %H:%M:%S")
+            values = [record[stat][ch] for ch in range(header['channels']) for stat in ('min', 'max', 'mean')]
+            file.write(f"{stamp},{record['count']}," + ",".join(f"{v:.4f}" for v in values) +
+                       f",{record['charge_ah']:.6f}\n")
+
+
+def main():
+    if len(sys.argv) < 2:
+        print(__doc__)
+        return
+
+    header, records = read_rollup(sys.argv[1])
+    print(f"Loaded {len(records)} records of {header['period_s']} s from {sys.argv[1]}, "
+          f"net charge {records['charge_ah'].sum():.3f} Ah")
+
+    if len(sys.argv) > 3 and sys.argv[2] == '--csv':
+        write_csv(header, records, sys.argv[3])
+        print(f"CSV written to: {sys.argv[3]}")
+        return
+
+    for record in records:
+        stamp = datetime.datetime.utcfromtimestamp(int(record['epoch'])).strftime("%Y-%m-%d %H:%M")
+        parts = [f"{CHANNEL_NAMES[ch]} {record['min'][ch]:.2f}/{record['mean'][ch]:.2f}/{record['max'][ch]:.2f}"
+                 for ch in range(min(header['channels'], len(CHANNEL_NAMES)))]
+        print(f"{stamp}  n={record['count']:5d}  " + "  ".join(parts) + f"  {record['charge_ah']:+.4f} Ah")
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,69 @@
+"""
+Compresses the web UI into a C header for the firmware.
+
+    python web/build_web.py
+
+Reads web/index.html, gzips it and writes src/web_index.h with the bytes as
+a PROGMEM array and an ETag derived from the content. Also runs as a
+PlatformIO pre-build script (extra_scripts in platformio.ini), so edits to
+the page are picked up automatically. The header is only rewritten when
+the page changed, to avoid needless rebuilds.
+"""
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - defined when run by PlatformIO
+    ROOT = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+SOURCE = os.path.join(ROOT, 'web', 'index.html')
+TARGET = os.path.join(ROOT, 'src', 'web_index.h')
+
+
+def build_header(html):
+    data = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = hashlib.sha1(html).hexdigest()[:16]
+
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append('  ' + ', '.join('0x%02x' % b for b in data[i:i + 16]) + ',')
+
+    return (
+        '// web_index.h\n'
+        '// Generated by web/build_web.py from web/index.html - do not edit\n'
+        '#ifndef WEB_INDEX_H\n'
+        '#define WEB_INDEX_H\n'
+        '\n'
+        '#include <Arduino.h>\n'
+        '\n'
+        '#define INDEX_HTML_ETAG "\\"%s\\""\n'
+        '\n'
+        'const size_t index_html_gz_len = %d;\n'
+        'const uint8_t index_html_gz[] PROGMEM = {\n'
+        '%s\n'
+        '};\n'
+        '\n'
+        '#endif\n' % (etag, len(data), '\n'.join(lines))
+    ), len(html), len(data)
+
+
+def main():
+    with open(SOURCE, 'rb') as file:
+        html = file.read()
+
+    header, raw_size, gz_size = build_header(html)
+
+    if os.path.exists(TARGET):
+        with open(TARGET) as file:
+            if file.read() == header:
+                return
+
+    with open(TARGET, 'w') as file:
+        file.write(header)
+    print(f"web_index.h: {raw_size} bytes -> {gz_size} bytes gzip")
+
+
+main()